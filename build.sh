@@ -5,7 +5,10 @@ set -e
 
 # cleanup previous builds
 rm -f wrappers/python/dist/*
+rm -rf dist/c_api
 DOCKER_BUILDKIT=1 docker build -f Dockerfile.manylinux_2_28_x86_64 -t mediapipe_liveness_detector:latest --build-arg PYTHON_BIN=/opt/python/cp312-cp312/bin/python3.12 --build-arg RELEASE_VERSION=$RELEASE_VERSION .
 docker create -ti --name liveness_detector_pip_package_container mediapipe_liveness_detector:latest
 docker cp liveness_detector_pip_package_container:/livenessDetector/wrappers/python/dist wrappers/python
+mkdir -p dist
+docker cp liveness_detector_pip_package_container:/livenessDetector/dist/c_api dist
 docker rm -f liveness_detector_pip_package_container
\ No newline at end of file
@@ -0,0 +1,417 @@
+#include "asset_bundle.h"
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+constexpr size_t kIconAlignment = 64;
+
+size_t align_up(size_t value, size_t alignment) {
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+// Builds the string pool while the writer lays out the records.
+class StringPool {
+public:
+    AssetBundle::StringRef add(const std::string& s) {
+        auto it = offsets_.find(s);
+        if (it != offsets_.end()) {
+            return {it->second, static_cast<uint32_t>(s.size())};
+        }
+        uint32_t offset = static_cast<uint32_t>(data_.size());
+        data_.insert(data_.end(), s.begin(), s.end());
+        data_.push_back('\0');
+        offsets_.emplace(s, offset);
+        return {offset, static_cast<uint32_t>(s.size())};
+    }
+
+    const std::vector<char>& data() const { return data_; }
+
+private:
+    std::vector<char> data_;
+    std::map<std::string, uint32_t> offsets_;
+};
+
+template <typename T>
+void append_records(std::vector<uint8_t>& out, const std::vector<T>& records) {
+    const uint8_t* begin = reinterpret_cast<const uint8_t*>(records.data());
+    out.insert(out.end(), begin, begin + records.size() * sizeof(T));
+}
+
+} // end anonymous namespace
+
+// --------------------- AssetBundle -------------------------------
+
+std::shared_ptr<const AssetBundle> AssetBundle::open(const std::string& path) {
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd == -1) {
+        throw std::runtime_error("Unable to open asset bundle: " + path);
+    }
+
+    struct stat st {};
+    if (fstat(fd, &st) == -1 || st.st_size < static_cast<off_t>(sizeof(FileHeader))) {
+        close(fd);
+        throw std::runtime_error("Asset bundle is too small: " + path);
+    }
+
+    size_t size = static_cast<size_t>(st.st_size);
+    void* mapped = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (mapped == MAP_FAILED) {
+        throw std::runtime_error("Unable to map asset bundle: " + path);
+    }
+
+    std::shared_ptr<AssetBundle> bundle(new AssetBundle(path, static_cast<const uint8_t*>(mapped), size));
+    bundle->validate();
+    return bundle;
+}
+
+AssetBundle::AssetBundle(std::string path, const uint8_t* data, size_t size)
+    : path_(std::move(path)),
+      data_(data),
+      size_(size),
+      header_(reinterpret_cast<const FileHeader*>(data)),
+      gestures_(nullptr),
+      steps_(nullptr),
+      locales_(nullptr),
+      entries_(nullptr),
+      icons_(nullptr),
+      strings_(nullptr) {}
+
+AssetBundle::~AssetBundle() {
+    if (data_) {
+        munmap(const_cast<uint8_t*>(data_), size_);
+    }
+}
+
+void AssetBundle::validate() {
+    if (std::memcmp(header_->magic, kMagic, sizeof(kMagic)) != 0) {
+        throw std::runtime_error("Not an asset bundle: " + path_);
+    }
+    if (header_->version != kVersion) {
+        throw std::runtime_error("Unsupported asset bundle version " + std::to_string(header_->version) +
+                                 " (expected " + std::to_string(kVersion) + "): " + path_);
+    }
+    if (header_->file_size != size_) {
+        throw std::runtime_error("Truncated asset bundle: " + path_);
+    }
+
+    auto check_range = [this](uint64_t offset, uint64_t count, size_t record_size, const char* what) {
+        if (offset > size_ || count * record_size > size_ - offset) {
+            throw std::runtime_error(std::string("Asset bundle ") + what + " section out of range: " + path_);
+        }
+    };
+    check_range(header_->gestures_offset, header_->gesture_count, sizeof(GestureRecord), "gestures");
+    check_range(header_->steps_offset, header_->step_count, sizeof(StepRecord), "steps");
+    check_range(header_->locales_offset, header_->locale_count, sizeof(LocaleRecord), "locales");
+    check_range(header_->entries_offset, header_->entry_count, sizeof(CatalogEntry), "entries");
+    check_range(header_->icons_offset, header_->icon_count, sizeof(IconRecord), "icons");
+    check_range(header_->strings_offset, header_->strings_size, 1, "strings");
+
+    gestures_ = reinterpret_cast<const GestureRecord*>(data_ + header_->gestures_offset);
+    steps_ = reinterpret_cast<const StepRecord*>(data_ + header_->steps_offset);
+    locales_ = reinterpret_cast<const LocaleRecord*>(data_ + header_->locales_offset);
+    entries_ = reinterpret_cast<const CatalogEntry*>(data_ + header_->entries_offset);
+    icons_ = reinterpret_cast<const IconRecord*>(data_ + header_->icons_offset);
+    strings_ = reinterpret_cast<const char*>(data_ + header_->strings_offset);
+
+    for (size_t i = 0; i < header_->gesture_count; ++i) {
+        const GestureRecord& g = gestures_[i];
+        if (static_cast<uint64_t>(g.first_step) + g.step_count > header_->step_count) {
+            throw std::runtime_error("Asset bundle gesture steps out of range: " + path_);
+        }
+    }
+    for (size_t i = 0; i < header_->locale_count; ++i) {
+        const LocaleRecord& l = locales_[i];
+        if (static_cast<uint64_t>(l.first_entry) + l.entry_count > header_->entry_count) {
+            throw std::runtime_error("Asset bundle locale entries out of range: " + path_);
+        }
+    }
+    for (size_t i = 0; i < header_->icon_count; ++i) {
+        const IconRecord& icon = icons_[i];
+        check_range(icon.data_offset, icon.data_size, 1, "icon data");
+        if (static_cast<uint64_t>(icon.rows) * icon.step > icon.data_size) {
+            throw std::runtime_error("Asset bundle icon data too small: " + path_);
+        }
+    }
+}
+
+size_t AssetBundle::gesture_count() const {
+    return header_->gesture_count;
+}
+
+const AssetBundle::GestureRecord& AssetBundle::gesture(size_t index) const {
+    return gestures_[index];
+}
+
+std::vector<Gesture::Step> AssetBundle::gesture_steps(size_t index) const {
+    const GestureRecord& record = gestures_[index];
+    std::vector<Gesture::Step> steps;
+    steps.reserve(record.step_count);
+    for (uint32_t i = 0; i < record.step_count; ++i) {
+        const StepRecord& s = steps_[record.first_step + i];
+        std::optional<Gesture::Step::ResetCondition> reset;
+        if (s.has_reset) {
+            reset = Gesture::Step::ResetCondition{
+                static_cast<Gesture::Step::ResetCondition::Type>(s.reset_type), s.reset_value, s.reset_window_ms, -1,
+                compile_expression(s.reset_expression)};
+        }
+        steps.push_back(Gesture::Step{static_cast<Gesture::Step::MoveType>(s.move_to_next_type), s.value, reset, s.window_ms, -1,
+                                      compile_expression(s.expression)});
+    }
+    return steps;
+}
+
+std::shared_ptr<const GesturePredicate> AssetBundle::compile_expression(const StringRef& ref) const {
+    if (ref.size == 0) {
+        return nullptr;
+    }
+    std::string error;
+    auto predicate = GesturePredicate::compile(std::string(str(ref)), &error);
+    if (!predicate) {
+        throw std::runtime_error("Invalid expression in asset bundle " + path_ + ": " + error);
+    }
+    return predicate;
+}
+
+std::optional<size_t> AssetBundle::find_locale(std::string_view locale) const {
+    for (size_t i = 0; i < header_->locale_count; ++i) {
+        if (str(locales_[i].name) == locale) {
+            return i;
+        }
+    }
+    return std::nullopt;
+}
+
+std::optional<std::string_view> AssetBundle::lookup(size_t locale_index, std::string_view key) const {
+    const LocaleRecord& locale = locales_[locale_index];
+    const CatalogEntry* begin = entries_ + locale.first_entry;
+    const CatalogEntry* end = begin + locale.entry_count;
+    const CatalogEntry* it = std::lower_bound(begin, end, key, [this](const CatalogEntry& e, std::string_view k) {
+        return str(e.key) < k;
+    });
+    if (it != end && str(it->key) == key) {
+        return str(it->value);
+    }
+    return std::nullopt;
+}
+
+std::optional<AssetBundle::Icon> AssetBundle::find_icon(std::string_view icon_path) const {
+    const IconRecord* begin = icons_;
+    const IconRecord* end = icons_ + header_->icon_count;
+    const IconRecord* it = std::lower_bound(begin, end, icon_path, [this](const IconRecord& r, std::string_view p) {
+        return str(r.icon_path) < p;
+    });
+    if (it == end || str(it->icon_path) != icon_path) {
+        return std::nullopt;
+    }
+    return Icon{static_cast<int>(it->rows), static_cast<int>(it->cols), it->type, it->step, data_ + it->data_offset};
+}
+
+std::string_view AssetBundle::str(const StringRef& ref) const {
+    if (static_cast<uint64_t>(ref.offset) + ref.size > header_->strings_size) {
+        return {};
+    }
+    return std::string_view(strings_ + ref.offset, ref.size);
+}
+
+const std::string& AssetBundle::path() const {
+    return path_;
+}
+
+// --------------------- AssetBundleWriter -------------------------
+
+void AssetBundleWriter::add_gesture(const std::string& name, const Gesture& gesture, const std::string& icon_path) {
+    gestures_.push_back(PendingGesture{
+        name,
+        gesture.get_gesture_id(),
+        gesture.get_label(),
+        icon_path,
+        gesture.get_signal_index(),
+        gesture.get_signal_key(),
+        gesture.get_total_recommended_max_time(),
+        gesture.get_take_picture_at_the_end(),
+        gesture.get_sequence()
+    });
+}
+
+void AssetBundleWriter::add_locale(const std::string& name, const nlohmann::json& translations) {
+    flatten_json(translations, "", locales_[name]);
+}
+
+void AssetBundleWriter::add_icon(const std::string& icon_path, int rows, int cols, int type, size_t step, const uint8_t* data) {
+    PendingIcon icon{icon_path, rows, cols, type, step, std::vector<uint8_t>(data, data + rows * step)};
+    icons_.push_back(std::move(icon));
+}
+
+bool AssetBundleWriter::has_icon(const std::string& icon_path) const {
+    return std::any_of(icons_.begin(), icons_.end(), [&](const PendingIcon& i) { return i.icon_path == icon_path; });
+}
+
+void AssetBundleWriter::flatten_json(const nlohmann::json& node, const std::string& prefix, std::map<std::string, std::string>& out) {
+    if (node.is_object()) {
+        for (auto it = node.begin(); it != node.end(); ++it) {
+            flatten_json(it.value(), prefix.empty() ? it.key() : prefix + "." + it.key(), out);
+        }
+    } else if (node.is_string()) {
+        out[prefix] = node.get<std::string>();
+    }
+}
+
+bool AssetBundleWriter::write(const std::string& path, std::string* error) const {
+    StringPool pool;
+
+    std::vector<AssetBundle::GestureRecord> gesture_records;
+    std::vector<AssetBundle::StepRecord> step_records;
+    for (const auto& g : gestures_) {
+        AssetBundle::GestureRecord r{};
+        r.name = pool.add(g.name);
+        r.gesture_id = pool.add(g.gesture_id);
+        r.label = pool.add(g.label);
+        r.icon_path = pool.add(g.icon_path);
+        r.signal_key = pool.add(g.signal_key.value_or(""));
+        r.signal_index = g.signal_index.value_or(0);
+        r.has_signal_index = g.signal_index.has_value();
+        r.has_signal_key = g.signal_key.has_value();
+        r.take_picture_at_the_end = g.take_picture_at_the_end;
+        r.total_recommended_max_time = g.total_recommended_max_time;
+        r.first_step = static_cast<uint32_t>(step_records.size());
+        r.step_count = static_cast<uint32_t>(g.steps.size());
+        gesture_records.push_back(r);
+
+        for (const auto& step : g.steps) {
+            AssetBundle::StepRecord s{};
+            s.move_to_next_type = static_cast<uint8_t>(step.move_to_next_type);
+            s.value = step.value;
+            s.window_ms = step.window_ms;
+            if (step.predicate) {
+                s.expression = pool.add(step.predicate->source());
+            }
+            if (step.reset.has_value()) {
+                s.has_reset = 1;
+                s.reset_type = static_cast<uint8_t>(step.reset->type);
+                s.reset_value = step.reset->value;
+                s.reset_window_ms = step.reset->window_ms;
+                if (step.reset->predicate) {
+                    s.reset_expression = pool.add(step.reset->predicate->source());
+                }
+            }
+            step_records.push_back(s);
+        }
+    }
+
+    // std::map keeps both locale names and catalog keys sorted, which is what
+    // AssetBundle::lookup relies on for its binary search.
+    std::vector<AssetBundle::LocaleRecord> locale_records;
+    std::vector<AssetBundle::CatalogEntry> entries;
+    for (const auto& [name, catalog] : locales_) {
+        AssetBundle::LocaleRecord l{};
+        l.name = pool.add(name);
+        l.first_entry = static_cast<uint32_t>(entries.size());
+        l.entry_count = static_cast<uint32_t>(catalog.size());
+        locale_records.push_back(l);
+        for (const auto& [key, value] : catalog) {
+            entries.push_back({pool.add(key), pool.add(value)});
+        }
+    }
+
+    std::vector<const PendingIcon*> sorted_icons;
+    for (const auto& icon : icons_) {
+        sorted_icons.push_back(&icon);
+    }
+    std::sort(sorted_icons.begin(), sorted_icons.end(), [](const PendingIcon* a, const PendingIcon* b) {
+        return a->icon_path < b->icon_path;
+    });
+    std::vector<AssetBundle::IconRecord> icon_records;
+    for (const auto* icon : sorted_icons) {
+        AssetBundle::IconRecord r{};
+        r.icon_path = pool.add(icon->icon_path);
+        r.rows = static_cast<uint32_t>(icon->rows);
+        r.cols = static_cast<uint32_t>(icon->cols);
+        r.type = icon->type;
+        r.step = static_cast<uint32_t>(icon->step);
+        r.data_size = icon->data.size();
+        icon_records.push_back(r);
+    }
+
+    AssetBundle::FileHeader header{};
+    std::memcpy(header.magic, AssetBundle::kMagic, sizeof(header.magic));
+    header.version = AssetBundle::kVersion;
+    header.gesture_count = static_cast<uint32_t>(gesture_records.size());
+    header.step_count = static_cast<uint32_t>(step_records.size());
+    header.locale_count = static_cast<uint32_t>(locale_records.size());
+    header.entry_count = static_cast<uint32_t>(entries.size());
+    header.icon_count = static_cast<uint32_t>(icon_records.size());
+
+    size_t offset = align_up(sizeof(header), alignof(double));
+    header.gestures_offset = offset;
+    offset = align_up(offset + gesture_records.size() * sizeof(AssetBundle::GestureRecord), alignof(double));
+    header.steps_offset = offset;
+    offset = align_up(offset + step_records.size() * sizeof(AssetBundle::StepRecord), alignof(double));
+    header.locales_offset = offset;
+    offset = align_up(offset + locale_records.size() * sizeof(AssetBundle::LocaleRecord), alignof(double));
+    header.entries_offset = offset;
+    offset = align_up(offset + entries.size() * sizeof(AssetBundle::CatalogEntry), alignof(double));
+    header.icons_offset = offset;
+    offset = align_up(offset + icon_records.size() * sizeof(AssetBundle::IconRecord), alignof(double));
+    header.strings_offset = offset;
+    header.strings_size = pool.data().size();
+    offset += pool.data().size();
+
+    // Icon pixels go last, each aligned so the mapped data can back a cv::Mat directly.
+    for (size_t i = 0; i < icon_records.size(); ++i) {
+        offset = align_up(offset, kIconAlignment);
+        icon_records[i].data_offset = offset;
+        offset += sorted_icons[i]->data.size();
+    }
+    header.file_size = offset;
+
+    std::vector<uint8_t> out;
+    out.reserve(offset);
+    auto pad_to = [&out](uint64_t target) { out.resize(target, 0); };
+
+    const uint8_t* header_bytes = reinterpret_cast<const uint8_t*>(&header);
+    out.insert(out.end(), header_bytes, header_bytes + sizeof(header));
+    pad_to(header.gestures_offset);
+    append_records(out, gesture_records);
+    pad_to(header.steps_offset);
+    append_records(out, step_records);
+    pad_to(header.locales_offset);
+    append_records(out, locale_records);
+    pad_to(header.entries_offset);
+    append_records(out, entries);
+    pad_to(header.icons_offset);
+    append_records(out, icon_records);
+    pad_to(header.strings_offset);
+    out.insert(out.end(), pool.data().begin(), pool.data().end());
+    for (size_t i = 0; i < icon_records.size(); ++i) {
+        pad_to(icon_records[i].data_offset);
+        out.insert(out.end(), sorted_icons[i]->data.begin(), sorted_icons[i]->data.end());
+    }
+
+    // Write to a temporary file and rename it so running servers never map a half-written bundle.
+    std::string tmp_path = path + ".tmp";
+    {
+        std::ofstream f(tmp_path, std::ios::binary | std::ios::trunc);
+        if (!f) {
+            if (error) *error = "Unable to open " + tmp_path + " for writing";
+            return false;
+        }
+        f.write(reinterpret_cast<const char*>(out.data()), static_cast<std::streamsize>(out.size()));
+        if (!f) {
+            if (error) *error = "Error writing " + tmp_path;
+            return false;
+        }
+    }
+    if (std::rename(tmp_path.c_str(), path.c_str()) != 0) {
+        if (error) *error = "Unable to rename " + tmp_path + " to " + path;
+        return false;
+    }
+    return true;
+}
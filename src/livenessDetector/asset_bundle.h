@@ -0,0 +1,184 @@
+#pragma once
+
+#include "gesture.h"
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "nlohmann/json.hpp"
+
+// Versioned binary bundle holding compiled gesture step tables, a flattened
+// string catalog per locale and pre-decoded icons. The bundle is produced
+// offline by assetBundleCompiler and mapped read-only by the server, so its
+// pages are shared between every process that opens the same file.
+class AssetBundle {
+public:
+    static constexpr char kMagic[8] = {'L', 'D', 'B', 'U', 'N', 'D', 'L', 'E'};
+    static constexpr uint32_t kVersion = 3;
+
+    // On-disk layout. All offsets are relative to the start of the file.
+    struct StringRef {
+        uint32_t offset; // into the string pool
+        uint32_t size;
+    };
+
+    struct FileHeader {
+        char magic[8];
+        uint32_t version;
+        uint32_t gesture_count;
+        uint32_t step_count;
+        uint32_t locale_count;
+        uint32_t entry_count;
+        uint32_t icon_count;
+        uint64_t gestures_offset;
+        uint64_t steps_offset;
+        uint64_t locales_offset;
+        uint64_t entries_offset;
+        uint64_t icons_offset;
+        uint64_t strings_offset;
+        uint64_t strings_size;
+        uint64_t file_size;
+    };
+
+    struct GestureRecord {
+        StringRef name; // file stem, used by --gestures_list
+        StringRef gesture_id;
+        StringRef label;
+        StringRef icon_path;
+        StringRef signal_key;
+        int32_t signal_index;
+        uint8_t has_signal_index;
+        uint8_t has_signal_key;
+        uint8_t take_picture_at_the_end;
+        uint8_t reserved;
+        double total_recommended_max_time;
+        uint32_t first_step;
+        uint32_t step_count;
+    };
+
+    struct StepRecord {
+        uint8_t move_to_next_type; // Gesture::Step::MoveType
+        uint8_t has_reset;
+        uint8_t reset_type;        // Gesture::Step::ResetCondition::Type
+        uint8_t reserved[5];
+        double value;
+        double reset_value;
+        double window_ms;       // Hold*, Velocity* and RangeHigher steps
+        double reset_window_ms; // velocity reset conditions
+        StringRef expression;       // Expression steps, compiled again on load
+        StringRef reset_expression; // Expression reset conditions
+    };
+
+    struct LocaleRecord {
+        StringRef name;
+        uint32_t first_entry;
+        uint32_t entry_count; // entries are sorted by key
+    };
+
+    struct CatalogEntry {
+        StringRef key;
+        StringRef value;
+    };
+
+    struct IconRecord {
+        StringRef icon_path;
+        uint32_t rows;
+        uint32_t cols;
+        int32_t type; // OpenCV matrix type, e.g. CV_8UC4
+        uint32_t step;
+        uint64_t data_offset;
+        uint64_t data_size;
+    };
+
+    struct Icon {
+        int rows;
+        int cols;
+        int type;
+        size_t step;
+        const uint8_t* data;
+    };
+
+    // Maps the bundle at path. Throws std::runtime_error if the file cannot be
+    // mapped or is not a valid bundle of the supported version.
+    static std::shared_ptr<const AssetBundle> open(const std::string& path);
+
+    ~AssetBundle();
+
+    AssetBundle(const AssetBundle&) = delete;
+    AssetBundle& operator=(const AssetBundle&) = delete;
+
+    size_t gesture_count() const;
+    const GestureRecord& gesture(size_t index) const;
+    std::vector<Gesture::Step> gesture_steps(size_t index) const;
+
+    std::optional<size_t> find_locale(std::string_view locale) const;
+    std::optional<std::string_view> lookup(size_t locale_index, std::string_view key) const;
+
+    std::optional<Icon> find_icon(std::string_view icon_path) const;
+
+    std::string_view str(const StringRef& ref) const;
+    const std::string& path() const;
+
+private:
+    AssetBundle(std::string path, const uint8_t* data, size_t size);
+
+    std::string path_;
+    const uint8_t* data_;
+    size_t size_;
+    const FileHeader* header_;
+    const GestureRecord* gestures_;
+    const StepRecord* steps_;
+    const LocaleRecord* locales_;
+    const CatalogEntry* entries_;
+    const IconRecord* icons_;
+    const char* strings_;
+
+    void validate();
+    std::shared_ptr<const GesturePredicate> compile_expression(const StringRef& ref) const;
+};
+
+// Accumulates compiled assets in memory and serializes them into the layout
+// described by AssetBundle::FileHeader.
+class AssetBundleWriter {
+public:
+    void add_gesture(const std::string& name, const Gesture& gesture, const std::string& icon_path);
+    void add_locale(const std::string& name, const nlohmann::json& translations);
+    void add_icon(const std::string& icon_path, int rows, int cols, int type, size_t step, const uint8_t* data);
+    bool has_icon(const std::string& icon_path) const;
+
+    // Returns false and fills error if the file could not be written.
+    bool write(const std::string& path, std::string* error = nullptr) const;
+
+    // Flattens nested objects into dotted keys, as TranslationManager::translate
+    // walks them ("gestures.blink.label").
+    static void flatten_json(const nlohmann::json& node, const std::string& prefix, std::map<std::string, std::string>& out);
+
+private:
+    struct PendingGesture {
+        std::string name;
+        std::string gesture_id;
+        std::string label;
+        std::string icon_path;
+        std::optional<int> signal_index;
+        std::optional<std::string> signal_key;
+        double total_recommended_max_time;
+        bool take_picture_at_the_end;
+        std::vector<Gesture::Step> steps;
+    };
+
+    struct PendingIcon {
+        std::string icon_path;
+        int rows;
+        int cols;
+        int type;
+        size_t step;
+        std::vector<uint8_t> data;
+    };
+
+    std::vector<PendingGesture> gestures_;
+    std::map<std::string, std::map<std::string, std::string>> locales_;
+    std::vector<PendingIcon> icons_;
+};
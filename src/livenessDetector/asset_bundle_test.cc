@@ -0,0 +1,58 @@
+#include "asset_bundle.h"
+#include "gesture_detector.h"
+#include "translation_manager.h"
+#include <iostream>
+#include <cassert>
+
+int main() {
+    const std::string bundle_path = "test_bundle.ldab";
+
+    // Compile a gesture, a locale and a small icon into a bundle
+    std::vector<Gesture::Step> steps = {
+        {Gesture::Step::MoveType::Higher, 10.0, {{Gesture::Step::ResetCondition::Type::Lower, 5.0}}},
+        {Gesture::Step::MoveType::Lower, 8.0, std::nullopt}
+    };
+    Gesture gesture("gesture1", "TestGesture", 5000, true, steps, std::nullopt, std::string("eyeBlinkLeft"));
+
+    AssetBundleWriter writer;
+    writer.add_gesture("gesture1", gesture, "icon.png");
+    writer.add_locale("en", nlohmann::json::parse(R"({"gestures": {"gesture1": {"label": "Blink!"}}})"));
+    writer.add_locale("default", nlohmann::json::parse(R"({"gestures": {"gesture1": {"label": "Blink"}}})"));
+    const uint8_t pixels[2 * 2 * 4] = {255, 0, 0, 255, 0, 255, 0, 255, 0, 0, 255, 255, 255, 255, 255, 255};
+    writer.add_icon("icon.png", 2, 2, 24 /* CV_8UC4 */, 8, pixels);
+
+    std::string error;
+    if (!writer.write(bundle_path, &error)) {
+        std::cerr << "Failed to write bundle: " << error << "\n";
+        return 1;
+    }
+
+    // Map it back and load the gesture into a detector
+    auto bundle = AssetBundle::open(bundle_path);
+    std::cout << "Gestures in bundle: " << bundle->gesture_count() << "\n";
+
+    GestureDetector detector;
+    auto result = detector.add_gesture_from_bundle(*bundle, 0);
+    assert(result.success);
+    std::cout << "Loaded gesture: " << result.gestureId << " (" << result.label << "), icon: " << result.icon_path << "\n";
+    assert(detector.get_gestures()[0]->get_sequence().size() == 2);
+
+    detector.start_all();
+    detector.process_signals({{"eyeBlinkLeft", 11.0}}, 0.0);
+    detector.process_signals({{"eyeBlinkLeft", 7.0}}, 33.0);
+    std::cout << "Gesture index after updates: " << detector.get_gestures()[0]->get_current_index() << "\n";
+
+    // Translations resolve through the flattened catalog, with the usual locale fallbacks
+    TranslationManager en("en_US", bundle);
+    TranslationManager fr("fr", bundle);
+    std::cout << "en_US: " << en.translate("gestures.gesture1.label") << "\n";
+    std::cout << "fr (default): " << fr.translate("gestures.gesture1.label") << "\n";
+    std::cout << "missing: " << en.translate("nonexistent.key") << "\n";
+
+    auto icon = bundle->find_icon("icon.png");
+    assert(icon.has_value());
+    std::cout << "Icon: " << icon->cols << "x" << icon->rows << ", first pixel B=" << int(icon->data[0]) << "\n";
+
+    std::cout << "Test completed.\n";
+    return 0;
+}
@@ -0,0 +1,241 @@
+#include "asset_snapshot.h"
+#include "logger.h"
+#include <filesystem>
+#include <set>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+// Changes are usually written as a burst (editor save, rsync, bundle rename);
+// rebuild once the folders have been quiet for this long.
+constexpr int kDebounceMs = 250;
+
+std::vector<std::string> split_locale(const std::string& locale) {
+    std::vector<std::string> parts;
+    size_t start = 0, end = 0;
+    while ((end = locale.find('_', start)) != std::string::npos) {
+        parts.push_back(locale.substr(start, end - start));
+        start = end + 1;
+    }
+    parts.push_back(locale.substr(start));
+    return parts;
+}
+
+} // end anonymous namespace
+
+// --------------------- AssetSnapshot -----------------------------
+
+std::shared_ptr<const TranslationManager> AssetSnapshot::translator(const std::string& language) const {
+    auto it = translators.find(language);
+    if (it != translators.end()) {
+        return it->second;
+    }
+    auto parts = split_locale(language);
+    if (parts.size() > 1) {
+        it = translators.find(parts[0]);
+        if (it != translators.end()) {
+            return it->second;
+        }
+    }
+    return translators.at("default");
+}
+
+// --------------------- AssetSnapshotStore ------------------------
+
+AssetSnapshotStore::AssetSnapshotStore(Sources sources)
+    : sources_(std::move(sources)),
+      next_generation_(1),
+      watching_(false),
+      inotify_fd_(-1),
+      wake_pipe_{-1, -1} {}
+
+AssetSnapshotStore::~AssetSnapshotStore() {
+    stop_watching();
+}
+
+std::shared_ptr<const AssetSnapshot> AssetSnapshotStore::current() const {
+    return std::atomic_load(&current_);
+}
+
+bool AssetSnapshotStore::reload() {
+    std::string error;
+    auto snapshot = build(next_generation_, &error);
+    if (!snapshot) {
+        LOG_ERROR("Asset reload failed, keeping generation {}: {}", current() ? current()->generation : 0, error);
+        return false;
+    }
+    next_generation_++;
+    std::atomic_store(&current_, snapshot);
+    LOG_INFO("Published asset snapshot generation {} with {} gestures", snapshot->generation, snapshot->gestures.size());
+    return true;
+}
+
+std::shared_ptr<const AssetSnapshot> AssetSnapshotStore::build(uint64_t generation, std::string* error) const {
+    auto snapshot = std::make_shared<AssetSnapshot>();
+    snapshot->generation = generation;
+    std::set<std::string> locale_names = {"default"};
+
+    if (!sources_.bundle_path.empty()) {
+        try {
+            snapshot->bundle = AssetBundle::open(sources_.bundle_path);
+        } catch (const std::exception& e) {
+            *error = e.what();
+            return nullptr;
+        }
+        for (size_t i = 0; i < snapshot->bundle->gesture_count(); ++i) {
+            auto result = snapshot->gesture_template.add_gesture_from_bundle(*snapshot->bundle, i);
+            if (result.success) {
+                std::string name(snapshot->bundle->str(snapshot->bundle->gesture(i).name));
+                snapshot->gestures.push_back({name, result});
+            }
+        }
+    } else {
+        for (const auto& folder : sources_.gestures_folders) {
+            std::error_code ec;
+            for (const auto& entry : fs::directory_iterator(folder, ec)) {
+                if (entry.path().extension() != ".json") continue;
+                auto result = snapshot->gesture_template.add_gesture_from_file(entry.path().string());
+                if (!result.success) {
+                    // A half-written or broken file must not silently drop a gesture
+                    // from the live set; keep the previous snapshot instead.
+                    *error = "failed to load gesture from file: " + entry.path().string();
+                    return nullptr;
+                }
+                snapshot->gestures.push_back({entry.path().stem().string(), result});
+            }
+            if (ec) {
+                LOG_ERROR("Error accessing the gestures folder: {}: {}", folder, ec.message());
+            }
+        }
+        for (const auto& dir : sources_.locales_paths) {
+            std::error_code ec;
+            for (const auto& entry : fs::directory_iterator(dir, ec)) {
+                if (entry.path().extension() == ".json") {
+                    locale_names.insert(entry.path().stem().string());
+                }
+            }
+        }
+    }
+
+    if (snapshot->gestures.empty()) {
+        *error = "no gestures could be loaded";
+        return nullptr;
+    }
+
+    std::vector<DerivedSignals::Spec> derived_specs;
+    for (const auto& dir : sources_.signals_paths) {
+        if (!SignalFilterBank::load_specs_from_folder(dir, snapshot->signal_filters, error) ||
+            !DerivedSignals::load_specs_from_folder(dir, derived_specs, error)) {
+            return nullptr;
+        }
+    }
+    snapshot->derived_signals = std::make_shared<const DerivedSignals>(derived_specs);
+
+    locale_names.insert(sources_.languages.begin(), sources_.languages.end());
+    for (const auto& name : locale_names) {
+        if (snapshot->bundle) {
+            snapshot->translators[name] = std::make_shared<TranslationManager>(name, snapshot->bundle);
+        } else {
+            snapshot->translators[name] = std::make_shared<TranslationManager>(name, sources_.locales_paths);
+        }
+    }
+    return snapshot;
+}
+
+std::vector<std::string> AssetSnapshotStore::watched_directories() const {
+    std::vector<std::string> dirs;
+    if (!sources_.bundle_path.empty()) {
+        fs::path parent = fs::path(sources_.bundle_path).parent_path();
+        dirs.push_back(parent.empty() ? "." : parent.string());
+    } else {
+        dirs.insert(dirs.end(), sources_.gestures_folders.begin(), sources_.gestures_folders.end());
+        dirs.insert(dirs.end(), sources_.locales_paths.begin(), sources_.locales_paths.end());
+    }
+    for (const auto& dir : sources_.signals_paths) {
+        if (fs::is_directory(dir)) {
+            dirs.push_back(dir);
+        }
+    }
+    return dirs;
+}
+
+bool AssetSnapshotStore::start_watching() {
+    if (watching_) {
+        return true;
+    }
+
+    inotify_fd_ = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (inotify_fd_ == -1) {
+        perror("inotify_init1");
+        return false;
+    }
+    if (pipe2(wake_pipe_, O_CLOEXEC) == -1) {
+        perror("pipe2");
+        close(inotify_fd_);
+        inotify_fd_ = -1;
+        return false;
+    }
+
+    const uint32_t mask = IN_CLOSE_WRITE | IN_MOVED_TO | IN_MOVED_FROM | IN_CREATE | IN_DELETE;
+    for (const auto& dir : watched_directories()) {
+        if (inotify_add_watch(inotify_fd_, dir.c_str(), mask) == -1) {
+            LOG_WARNING("Not watching {} for asset changes", dir);
+        }
+    }
+
+    watching_ = true;
+    watcher_thread_ = std::thread(&AssetSnapshotStore::watch_loop, this);
+    return true;
+}
+
+void AssetSnapshotStore::stop_watching() {
+    if (!watching_) {
+        return;
+    }
+    watching_ = false;
+    char byte = 0;
+    if (write(wake_pipe_[1], &byte, 1) == -1) {
+        perror("write");
+    }
+    if (watcher_thread_.joinable()) {
+        watcher_thread_.join();
+    }
+    close(wake_pipe_[0]);
+    close(wake_pipe_[1]);
+    close(inotify_fd_);
+    wake_pipe_[0] = wake_pipe_[1] = inotify_fd_ = -1;
+}
+
+void AssetSnapshotStore::watch_loop() {
+    alignas(struct inotify_event) char buffer[4096];
+    auto drain = [&]() {
+        while (read(inotify_fd_, buffer, sizeof(buffer)) > 0) {}
+    };
+
+    while (watching_) {
+        pollfd fds[2] = {{inotify_fd_, POLLIN, 0}, {wake_pipe_[0], POLLIN, 0}};
+        if (poll(fds, 2, -1) <= 0 || (fds[1].revents & POLLIN)) {
+            continue;
+        }
+        drain();
+
+        // Debounce: wait until no more events arrive for kDebounceMs.
+        while (watching_) {
+            pollfd quiet[2] = {{inotify_fd_, POLLIN, 0}, {wake_pipe_[0], POLLIN, 0}};
+            int ready = poll(quiet, 2, kDebounceMs);
+            if (ready <= 0 || (quiet[1].revents & POLLIN)) {
+                break;
+            }
+            drain();
+        }
+
+        if (watching_) {
+            reload();
+        }
+    }
+}
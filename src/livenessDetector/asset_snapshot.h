@@ -0,0 +1,77 @@
+#pragma once
+
+#include "asset_bundle.h"
+#include "derived_signals.h"
+#include "gesture_detector.h"
+#include "signal_filter_bank.h"
+#include "translation_manager.h"
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Immutable view of the gesture and locale definitions at one point in time.
+// Sessions keep the snapshot they started with for their whole lifetime and
+// copy their gestures out of gesture_template, which is never started.
+struct AssetSnapshot {
+    struct GestureEntry {
+        std::string name; // file stem, as matched by --gestures_list
+        GestureDetector::AddResult info;
+    };
+
+    uint64_t generation = 0;
+    GestureDetector gesture_template; // index-aligned with gestures
+    std::vector<GestureEntry> gestures;
+    std::shared_ptr<const AssetBundle> bundle;
+    std::map<std::string, std::shared_ptr<const TranslationManager>> translators;
+    std::vector<SignalFilterBank::FilterSpec> signal_filters; // each session runs its own bank
+    std::shared_ptr<const DerivedSignals> derived_signals; // shared: computed by the face processor
+
+    // Same fallback chain as TranslationManager: exact locale, language part, "default".
+    std::shared_ptr<const TranslationManager> translator(const std::string& language) const;
+};
+
+// Builds AssetSnapshots from the gestures/locales folders (or a compiled bundle)
+// and publishes them RCU-style: readers take the current snapshot with an
+// atomic load, a background inotify watcher builds a replacement whenever the
+// sources change and swaps it in with an atomic store.
+class AssetSnapshotStore {
+public:
+    struct Sources {
+        std::vector<std::string> gestures_folders;
+        std::vector<std::string> locales_paths;
+        std::string bundle_path; // when set, replaces the folders above
+        std::vector<std::string> languages; // translators built eagerly
+        std::vector<std::string> signals_paths; // signal filter and derived signal declarations, also used with a bundle
+    };
+
+    explicit AssetSnapshotStore(Sources sources);
+    ~AssetSnapshotStore();
+
+    AssetSnapshotStore(const AssetSnapshotStore&) = delete;
+    AssetSnapshotStore& operator=(const AssetSnapshotStore&) = delete;
+
+    // Builds a new snapshot and publishes it. On failure the current snapshot is kept.
+    bool reload();
+    std::shared_ptr<const AssetSnapshot> current() const;
+
+    bool start_watching();
+    void stop_watching();
+
+private:
+    Sources sources_;
+    std::shared_ptr<const AssetSnapshot> current_;
+    uint64_t next_generation_;
+
+    std::thread watcher_thread_;
+    std::atomic<bool> watching_;
+    int inotify_fd_;
+    int wake_pipe_[2];
+
+    std::shared_ptr<const AssetSnapshot> build(uint64_t generation, std::string* error) const;
+    std::vector<std::string> watched_directories() const;
+    void watch_loop();
+};
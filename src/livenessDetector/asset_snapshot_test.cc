@@ -0,0 +1,91 @@
+#include "asset_snapshot.h"
+#include "test_check.h"
+#include <iostream>
+#include <fstream>
+#include <filesystem>
+#include <thread>
+#include <chrono>
+
+void write_gesture(const std::string& path, double first_value) {
+    std::ofstream out(path);
+    out << R"({
+        "gestureId": "gesture1",
+        "label": "TestGesture",
+        "signal_key": "eyeBlinkLeft",
+        "total_recommended_max_time": 5000,
+        "take_picture_at_the_end": false,
+        "instructions": [
+            {"move_to_next_type": "higher", "value": )" << first_value << R"(},
+            {"move_to_next_type": "lower", "value": 0.2}
+        ]
+    })";
+}
+
+void write_locale(const std::string& path, const std::string& label) {
+    std::ofstream out(path);
+    out << R"({"gestures": {"gesture1": {"label": ")" << label << R"("}}})";
+}
+
+int main() {
+    // Set up a test gestures folder with its locales
+    const std::string gestures_dir = "snapshot_gestures";
+    std::filesystem::create_directories(gestures_dir + "/locales");
+    write_gesture(gestures_dir + "/gesture1.json", 0.5);
+    write_locale(gestures_dir + "/locales/en.json", "Blink");
+
+    AssetSnapshotStore::Sources sources;
+    sources.gestures_folders = {gestures_dir};
+    sources.locales_paths = {gestures_dir + "/locales"};
+    sources.languages = {"en"};
+
+    AssetSnapshotStore store(sources);
+    if (!store.reload()) {
+        std::cerr << "Initial load failed\n";
+        return 1;
+    }
+
+    auto first = store.current();
+    auto label = [](const AssetSnapshot& snapshot) {
+        return snapshot.translator("en")->translate("gestures.gesture1.label");
+    };
+    auto first_value = [](const AssetSnapshot& snapshot) {
+        return snapshot.gesture_template.get_gestures()[0]->get_sequence()[0].value;
+    };
+    std::cout << "Generation " << first->generation << ": "
+              << first->translator("en_US")->translate("gestures.gesture1.label") << ", step 0 value "
+              << first->gesture_template.get_gestures()[0]->get_sequence()[0].value << "\n";
+
+    store.start_watching();
+
+    // Change a threshold and a string; the watcher publishes a new snapshot
+    write_gesture(gestures_dir + "/gesture1.json", 0.7);
+    write_locale(gestures_dir + "/locales/en.json", "Blink twice");
+    auto second = store.current();
+    for (int i = 0; i < 40 && (label(*second) != "Blink twice" || first_value(*second) != 0.7); ++i) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        second = store.current();
+    }
+    std::cout << "Generation " << second->generation << ": " << label(*second) << ", step 0 value "
+              << first_value(*second) << "\n";
+    TEST_CHECK(second->generation > first->generation);
+    TEST_CHECK(label(*second) == "Blink twice");
+    TEST_CHECK(first_value(*second) == 0.7);
+
+    // The old snapshot is untouched for sessions still holding it
+    std::cout << "Generation " << first->generation << " still reads: " << label(*first) << "\n";
+    TEST_CHECK(label(*first) == "Blink" && first_value(*first) == 0.5);
+
+    // A broken file keeps the last good snapshot
+    {
+        std::ofstream out(gestures_dir + "/gesture1.json");
+        out << "{ not json";
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(1000));
+    uint64_t generation = store.current()->generation;
+    std::cout << "After broken edit, generation: " << generation << "\n";
+    TEST_CHECK(generation == second->generation);
+
+    store.stop_watching();
+    std::cout << "Test completed.\n";
+    return 0;
+}
@@ -0,0 +1,142 @@
+#include "best_frame_buffer.h"
+#include <algorithm>
+#include <cstdlib>
+
+bool BestFrameBuffer::Config::apply_request(const nlohmann::json& request, std::string* error) {
+    if (request.contains("frames")) {
+        if (!request["frames"].is_number_integer() ||
+            request["frames"].get<int>() < 1 || request["frames"].get<int>() > 30) {
+            if (error) *error = "frames must be an integer between 1 and 30";
+            return false;
+        }
+        frames = request["frames"].get<size_t>();
+    }
+    if (request.contains("window_before_ms")) {
+        if (!request["window_before_ms"].is_number_integer() ||
+            request["window_before_ms"].get<int64_t>() < 0 || request["window_before_ms"].get<int64_t>() > 2000) {
+            if (error) *error = "window_before_ms must be an integer between 0 and 2000";
+            return false;
+        }
+        window_before_ms = request["window_before_ms"].get<int64_t>();
+    }
+    if (request.contains("window_after_ms")) {
+        if (!request["window_after_ms"].is_number_integer() ||
+            request["window_after_ms"].get<int64_t>() < 0 || request["window_after_ms"].get<int64_t>() > 2000) {
+            if (error) *error = "window_after_ms must be an integer between 0 and 2000";
+            return false;
+        }
+        window_after_ms = request["window_after_ms"].get<int64_t>();
+    }
+    return true;
+}
+
+BestFrameBuffer::BestFrameBuffer() : BestFrameBuffer(Config()) {}
+
+BestFrameBuffer::BestFrameBuffer(Config config)
+    : config_(std::move(config)),
+      slots_(std::max<size_t>(config_.frames, 1)) {}
+
+void BestFrameBuffer::push(const cv::Mat& frame, int64_t timestamp_ms, const Cues& cues) {
+    Slot& slot = slots_[next_];
+    frame.copyTo(slot.frame); // no allocation once the ring is full of same-size frames
+    slot.cues = cues;
+    slot.timestamp_ms = timestamp_ms;
+    slot.sharpness = -1.0;
+    next_ = (next_ + 1) % slots_.size();
+    count_ = std::min(count_ + 1, slots_.size());
+}
+
+bool BestFrameBuffer::set_cues(int64_t timestamp_ms, const Cues& cues) {
+    for (size_t i = 0; i < count_; ++i) {
+        Slot& slot = slots_[(next_ + slots_.size() - 1 - i) % slots_.size()]; // newest first
+        if (slot.timestamp_ms == timestamp_ms) {
+            slot.cues = cues;
+            slot.sharpness = -1.0; // measured on the face region
+            return true;
+        }
+    }
+    return false;
+}
+
+void BestFrameBuffer::clear() {
+    next_ = 0;
+    count_ = 0;
+}
+
+double BestFrameBuffer::sharpness(const cv::Mat& frame, const cv::Rect& region, int width,
+                                  cv::Mat& small, cv::Mat& gray, cv::Mat& laplacian) {
+    cv::Mat roi = frame(region);
+    int height = std::max(1, cvRound(static_cast<double>(width) * roi.rows / roi.cols));
+    cv::resize(roi, small, cv::Size(width, height), 0, 0, cv::INTER_AREA);
+    if (small.channels() == 3) {
+        cv::cvtColor(small, gray, cv::COLOR_BGR2GRAY);
+    } else {
+        gray = small;
+    }
+    cv::Laplacian(gray, laplacian, CV_16S);
+    cv::Scalar mean, stddev;
+    cv::meanStdDev(laplacian, mean, stddev);
+    return stddev[0] * stddev[0];
+}
+
+std::optional<BestFrameBuffer::Pick> BestFrameBuffer::best(int64_t center_ms) {
+    if (count_ == 0) {
+        return std::nullopt;
+    }
+    std::vector<size_t> candidates;
+    for (size_t i = 0; i < count_; ++i) {
+        const Slot& slot = slots_[i];
+        if (slot.timestamp_ms >= center_ms - config_.window_before_ms &&
+            slot.timestamp_ms <= center_ms + config_.window_after_ms) {
+            candidates.push_back(i);
+        }
+    }
+    if (candidates.empty()) {
+        candidates.push_back((next_ + slots_.size() - 1) % slots_.size()); // newest
+    }
+
+    double max_sharpness = 0.0;
+    float max_area = 0.0f;
+    for (size_t i : candidates) {
+        Slot& slot = slots_[i];
+        cv::Rect whole(0, 0, slot.frame.cols, slot.frame.rows);
+        if (slot.sharpness < 0.0) {
+            const cv::Rect2f& face = slot.cues.face;
+            cv::Rect region(cv::Point(cvRound(face.x * whole.width), cvRound(face.y * whole.height)),
+                            cv::Point(cvRound((face.x + face.width) * whole.width),
+                                      cvRound((face.y + face.height) * whole.height)));
+            region &= whole;
+            if (region.area() == 0) {
+                region = whole;
+            }
+            slot.sharpness = sharpness(slot.frame, region, config_.analysis_width, small_, gray_, laplacian_);
+        }
+        max_sharpness = std::max(max_sharpness, slot.sharpness);
+        max_area = std::max(max_area, slot.cues.face.area());
+    }
+
+    Pick pick;
+    pick.candidates = candidates.size();
+    int64_t pick_distance = 0;
+    for (size_t i : candidates) {
+        const Slot& slot = slots_[i];
+        double score = max_sharpness > 0.0 ? slot.sharpness / max_sharpness : 1.0;
+        if (max_area > 0.0f) {
+            score *= slot.cues.face.area() / max_area;
+        }
+        if (!std::isnan(slot.cues.pose) && config_.max_pose > 0.0f) {
+            score *= std::max(0.0f, 1.0f - std::abs(slot.cues.pose) / config_.max_pose);
+        }
+        int64_t distance = std::llabs(slot.timestamp_ms - center_ms);
+        // Ties go to the frame nearest the completion
+        if (!pick.frame || score > pick.score || (score == pick.score && distance < pick_distance)) {
+            pick.frame = &slot.frame;
+            pick.cues = slot.cues;
+            pick.timestamp_ms = slot.timestamp_ms;
+            pick.score = score;
+            pick.sharpness = slot.sharpness;
+            pick_distance = distance;
+        }
+    }
+    return pick;
+}
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <opencv2/opencv.hpp>
+#include <cmath>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <vector>
+#include "nlohmann/json.hpp"
+
+// The last few frames, kept so that the picture of a completed gesture is the
+// best frame around the completion rather than whichever one was current when
+// it fired, often mid-motion and blurred. push() copies each frame into a
+// pooled slot, set_cues() attaches the landmarker result for that frame once it
+// arrives; best() scores only the frames in the window around a completion,
+// and only once per frame:
+//
+//   score = sharpness / best sharpness * face area / largest face area * frontal
+//
+// Sharpness is the variance of the Laplacian of a small grayscale copy of the
+// face region (the whole frame when there is no face box), and frontal falls
+// from 1 for a head facing the camera to 0 at max_pose radians. Frames without
+// a face lose to any frame with one. Use from one thread.
+class BestFrameBuffer {
+public:
+    struct Config {
+        size_t frames = 10;           // ring size; at 30 fps it should cover the window
+        int64_t window_before_ms = 200;
+        int64_t window_after_ms = 100;
+        int analysis_width = 96;      // width of the grayscale copy the sharpness is measured on
+        float max_pose = 0.5f;        // head rotation, in radians, at which frontal reaches 0
+
+        // Overrides the fields present in {"frames":10,"window_before_ms":200,"window_after_ms":100}.
+        // Returns false and fills error when a field has the wrong type or value.
+        bool apply_request(const nlohmann::json& request, std::string* error = nullptr);
+    };
+
+    // What the landmarker reported with a frame.
+    struct Cues {
+        cv::Rect2f face;  // normalized face box, empty when there is no face
+        float pose = NAN; // largest head rotation away from frontal, radians; NaN when unknown
+    };
+
+    struct Pick {
+        const cv::Mat* frame = nullptr; // valid until the next push()
+        Cues cues;
+        int64_t timestamp_ms = 0;
+        double score = 0.0;
+        double sharpness = 0.0;
+        size_t candidates = 0; // frames in the window
+    };
+
+    BestFrameBuffer();
+    explicit BestFrameBuffer(Config config);
+
+    // Copies frame, reusing the buffer of the oldest slot.
+    void push(const cv::Mat& frame, int64_t timestamp_ms, const Cues& cues);
+    // Same, without cues until set_cues().
+    void push(const cv::Mat& frame, int64_t timestamp_ms) { push(frame, timestamp_ms, Cues()); }
+    // Attaches the cues of the frame pushed with timestamp_ms. Returns false
+    // when that frame is no longer kept.
+    bool set_cues(int64_t timestamp_ms, const Cues& cues);
+
+    // Best frame kept in [center_ms - window_before_ms, center_ms + window_after_ms];
+    // the newest frame when none falls in the window, nullopt when empty.
+    std::optional<Pick> best(int64_t center_ms);
+
+    // When a picture for a completion at center_ms can be picked: once the window has passed.
+    int64_t ready_at(int64_t center_ms) const { return center_ms + config_.window_after_ms; }
+
+    size_t size() const { return count_; }
+    const Config& config() const { return config_; }
+    void clear();
+
+    // Variance of the Laplacian of region of frame, measured on a copy width pixels wide.
+    static double sharpness(const cv::Mat& frame, const cv::Rect& region, int width,
+                            cv::Mat& small, cv::Mat& gray, cv::Mat& laplacian);
+
+private:
+    struct Slot {
+        cv::Mat frame;
+        Cues cues;
+        int64_t timestamp_ms = 0;
+        double sharpness = -1.0; // -1 until scored
+    };
+
+    Config config_;
+    std::vector<Slot> slots_;
+    size_t next_ = 0;  // slot the next push() writes
+    size_t count_ = 0;
+    cv::Mat small_;
+    cv::Mat gray_;
+    cv::Mat laplacian_;
+};
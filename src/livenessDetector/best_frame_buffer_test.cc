@@ -0,0 +1,125 @@
+#include "best_frame_buffer.h"
+#include "test_check.h"
+#include <iostream>
+#include <chrono>
+
+static cv::Mat noise_frame(int seed) {
+    cv::Mat frame(480, 640, CV_8UC3);
+    cv::RNG rng(seed);
+    rng.fill(frame, cv::RNG::UNIFORM, cv::Scalar::all(40), cv::Scalar::all(216));
+    return frame;
+}
+
+static cv::Mat blurred(const cv::Mat& frame) {
+    cv::Mat out;
+    cv::GaussianBlur(frame, out, cv::Size(15, 15), 5.0);
+    return out;
+}
+
+int main() {
+    using Cues = BestFrameBuffer::Cues;
+    const cv::Rect2f face(0.3f, 0.2f, 0.4f, 0.5f);
+    cv::Mat sharp = noise_frame(1);
+    cv::Mat motion = blurred(sharp);
+
+    BestFrameBuffer buffer;
+    TEST_CHECK(!buffer.best(0));
+
+    // The sharp frame wins over the blurred ones around it
+    buffer.push(motion, 0, {face, 0.0f});
+    buffer.push(sharp, 33, {face, 0.0f});
+    buffer.push(motion, 66, {face, 0.0f});
+    buffer.push(motion, 100, {face, 0.0f});
+    auto pick = buffer.best(100);
+    TEST_CHECK(pick && pick->timestamp_ms == 33 && pick->candidates == 4);
+    std::cout << "Sharp frame picked, sharpness " << pick->sharpness << "\n";
+
+    // ... but not when it is outside the window
+    BestFrameBuffer::Config narrow;
+    narrow.window_before_ms = 20;
+    narrow.window_after_ms = 0;
+    BestFrameBuffer windowed(narrow);
+    windowed.push(sharp, 0, {face, 0.0f});
+    windowed.push(motion, 50, {face, 0.0f});
+    windowed.push(motion, 66, {face, 0.0f});
+    pick = windowed.best(66);
+    TEST_CHECK(pick && pick->timestamp_ms != 0 && pick->candidates == 2);
+    // Nothing in the window: the newest frame
+    pick = windowed.best(5000);
+    TEST_CHECK(pick && pick->timestamp_ms == 66 && pick->candidates == 1);
+    std::cout << "Only frames in the window compete\n";
+
+    // A frame without a face loses, however sharp
+    BestFrameBuffer faces;
+    faces.push(sharp, 0, {cv::Rect2f(), NAN});
+    faces.push(motion, 33, {face, NAN});
+    TEST_CHECK(faces.best(33)->timestamp_ms == 33);
+
+    // A frontal head beats a turned one, and a closer face a farther one
+    BestFrameBuffer pose;
+    pose.push(sharp, 0, {face, 0.4f});
+    pose.push(sharp, 33, {face, 0.05f});
+    pose.push(sharp, 66, {cv::Rect2f(0.4f, 0.3f, 0.2f, 0.25f), 0.0f});
+    pick = pose.best(66);
+    TEST_CHECK(pick->timestamp_ms == 33);
+    std::cout << "Face and frontal pose weigh in, score " << pick->score << "\n";
+
+    // Cues come with the landmarker result, after the frame was pushed
+    BestFrameBuffer late;
+    late.push(sharp, 0);
+    late.push(motion, 33);
+    pick = late.best(33);
+    TEST_CHECK(pick && pick->timestamp_ms == 0); // no face anywhere: the sharpest
+    TEST_CHECK(late.set_cues(33, {face, 0.0f}));
+    pick = late.best(33);
+    TEST_CHECK(pick && pick->timestamp_ms == 33 && pick->cues.face == face);
+    TEST_CHECK(!late.set_cues(66, {face, 0.0f}));
+    std::cout << "Cues attached to the frame they were found on\n";
+
+    // The ring keeps the last frames, reusing their buffers
+    BestFrameBuffer::Config small;
+    small.frames = 3;
+    BestFrameBuffer ring(small);
+    for (int i = 0; i < 3; ++i) {
+        ring.push(sharp, i * 33, {face, 0.0f});
+    }
+    const uchar* data = ring.best(0)->frame->data;
+    for (int i = 3; i < 9; ++i) {
+        ring.push(motion, i * 33, {face, 0.0f});
+    }
+    TEST_CHECK(ring.size() == 3);
+    pick = ring.best(0); // every frame is newer than the window: the newest
+    TEST_CHECK(pick->timestamp_ms == 8 * 33);
+    bool reused = false;
+    for (int i = 6; i < 9; ++i) {
+        reused = reused || ring.best(i * 33)->frame->data == data;
+    }
+    TEST_CHECK(reused);
+    std::cout << "Ring reuses its buffers\n";
+
+    // Request parsing
+    BestFrameBuffer::Config parsed;
+    std::string error;
+    TEST_CHECK(parsed.apply_request({{"frames", 12}, {"window_before_ms", 300}, {"window_after_ms", 0}}, &error));
+    TEST_CHECK(parsed.frames == 12 && parsed.window_before_ms == 300 && parsed.window_after_ms == 0);
+    TEST_CHECK(!parsed.apply_request({{"frames", 0}}, &error));
+    TEST_CHECK(!parsed.apply_request({{"window_after_ms", "soon"}}, &error));
+    std::cout << "Rejected: " << error << "\n";
+
+    // Cost: the copy on every frame, the scoring only when a picture is due
+    const int iterations = 300;
+    BestFrameBuffer timed;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; ++i) {
+        timed.push(i % 2 ? sharp : motion, i * 33, {face, 0.0f});
+    }
+    double push_us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+    start = std::chrono::steady_clock::now();
+    pick = timed.best((iterations - 4) * 33);
+    double best_us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+    std::cout << "push: " << push_us / iterations << " us per 640x480 frame, best: " << best_us
+              << " us for " << pick->candidates << " frames\n";
+
+    std::cout << "Test completed.\n";
+    return 0;
+}
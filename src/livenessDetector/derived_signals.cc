@@ -0,0 +1,253 @@
+#include "derived_signals.h"
+#include <algorithm>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <limits>
+#include <map>
+#include <tuple>
+
+namespace {
+
+bool read_point(const nlohmann::json& value, int& point) {
+    if (!value.is_number_integer()) {
+        return false;
+    }
+    point = value.get<int>();
+    return point >= 0 && point < DerivedSignals::kLandmarks;
+}
+
+bool read_pair(const nlohmann::json& value, std::pair<int, int>& pair) {
+    return value.is_array() && value.size() == 2 &&
+           read_point(value[0], pair.first) && read_point(value[1], pair.second);
+}
+
+} // end anonymous namespace
+
+bool DerivedSignals::parse_specs(const nlohmann::json& j, std::vector<Spec>& specs, std::string* error) {
+    if (!j.contains("derived")) {
+        return true;
+    }
+    if (!j["derived"].is_array()) {
+        if (error) *error = "'derived' must be an array";
+        return false;
+    }
+
+    for (const auto& entry : j["derived"]) {
+        if (!entry.contains("name") || !entry["name"].is_string() ||
+            !entry.contains("type") || !entry["type"].is_string()) {
+            if (error) *error = "each derived signal needs string 'name' and 'type'";
+            return false;
+        }
+
+        Spec spec;
+        spec.name = entry["name"].get<std::string>();
+        const std::string type = entry["type"].get<std::string>();
+        const std::string where = "derived signal '" + spec.name + "': ";
+        const std::string bad_point = "landmark indexes must be integers between 0 and " + std::to_string(kLandmarks - 1);
+
+        if (entry.contains("depth")) {
+            if (!entry["depth"].is_boolean()) {
+                if (error) *error = where + "depth must be a boolean";
+                return false;
+            }
+            spec.depth = entry["depth"].get<bool>();
+        }
+
+        if (type == "distance" || type == "angle") {
+            spec.type = type == "distance" ? Type::Distance : Type::Angle;
+            size_t expected = spec.type == Type::Distance ? 2 : 3;
+            if (!entry.contains("points") || !entry["points"].is_array() || entry["points"].size() != expected) {
+                if (error) *error = where + "points must list " + std::to_string(expected) + " landmarks";
+                return false;
+            }
+            for (const auto& value : entry["points"]) {
+                int point;
+                if (!read_point(value, point)) {
+                    if (error) *error = where + bad_point;
+                    return false;
+                }
+                spec.points.push_back(point);
+            }
+            if (entry.contains("normalize_by")) {
+                if (spec.type != Type::Distance || !read_pair(entry["normalize_by"], spec.normalize_by)) {
+                    if (error) *error = where + "normalize_by must be a pair of landmarks, on a distance";
+                    return false;
+                }
+            }
+        } else if (type == "aspect_ratio") {
+            spec.type = Type::AspectRatio;
+            if (!entry.contains("vertical") || !entry["vertical"].is_array() || entry["vertical"].empty() ||
+                !entry.contains("horizontal") || !read_pair(entry["horizontal"], spec.horizontal)) {
+                if (error) *error = where + "needs 'vertical' (pairs of landmarks) and 'horizontal' (a pair)";
+                return false;
+            }
+            for (const auto& value : entry["vertical"]) {
+                std::pair<int, int> pair;
+                if (!read_pair(value, pair)) {
+                    if (error) *error = where + bad_point;
+                    return false;
+                }
+                spec.vertical.push_back(pair);
+            }
+        } else {
+            if (error) *error = "unknown derived signal type '" + type + "'";
+            return false;
+        }
+        specs.push_back(std::move(spec));
+    }
+    return true;
+}
+
+bool DerivedSignals::load_specs_from_folder(const std::string& folder, std::vector<Spec>& specs, std::string* error) {
+    std::error_code ec;
+    if (!std::filesystem::is_directory(folder, ec)) {
+        return true;
+    }
+    for (const auto& entry : std::filesystem::directory_iterator(folder, ec)) {
+        if (entry.path().extension() != ".json") continue;
+        std::ifstream file(entry.path());
+        try {
+            nlohmann::json j;
+            file >> j;
+            std::string parse_error;
+            if (!parse_specs(j, specs, &parse_error)) {
+                if (error) *error = entry.path().string() + ": " + parse_error;
+                return false;
+            }
+        } catch (const std::exception& e) {
+            if (error) *error = entry.path().string() + ": " + e.what();
+            return false;
+        }
+    }
+    return true;
+}
+
+DerivedSignals::DerivedSignals(const std::vector<Spec>& specs) {
+    // Collect the distinct pairs first, so the planar ones can be laid out before the 3D ones.
+    using Key = std::tuple<bool, int, int>; // depth, a, b with a <= b
+    std::map<Key, uint32_t> pair_index;
+    auto key = [](const std::pair<int, int>& pair, bool depth) {
+        return Key(depth, std::min(pair.first, pair.second), std::max(pair.first, pair.second));
+    };
+    auto each_pair = [](const Spec& spec, auto&& visit) {
+        switch (spec.type) {
+            case Type::Distance:
+                visit(std::make_pair(spec.points[0], spec.points[1]));
+                if (spec.normalize_by.first >= 0) visit(spec.normalize_by);
+                break;
+            case Type::AspectRatio:
+                for (const auto& pair : spec.vertical) visit(pair);
+                visit(spec.horizontal);
+                break;
+            case Type::Angle:
+                visit(std::make_pair(spec.points[0], spec.points[1]));
+                visit(std::make_pair(spec.points[1], spec.points[2]));
+                visit(std::make_pair(spec.points[0], spec.points[2]));
+                break;
+        }
+    };
+    for (const auto& spec : specs) {
+        each_pair(spec, [&](const std::pair<int, int>& pair) {
+            pair_index.emplace(key(pair, spec.depth), 0);
+        });
+    }
+    for (auto& [k, index] : pair_index) { // std::map orders the planar pairs (depth false) first
+        index = static_cast<uint32_t>(pair_a_.size());
+        pair_a_.push_back(std::get<1>(k));
+        pair_b_.push_back(std::get<2>(k));
+        max_point_ = std::max(max_point_, std::get<2>(k));
+        if (!std::get<0>(k)) {
+            ++planar_pairs_;
+        }
+    }
+
+    for (const auto& spec : specs) {
+        names_.push_back(spec.name);
+        types_.push_back(spec.type);
+        term_offset_.push_back(static_cast<uint32_t>(terms_.size()));
+        auto index = [&](const std::pair<int, int>& pair) { return pair_index.at(key(pair, spec.depth)); };
+        int32_t denominator = -1;
+        switch (spec.type) {
+            case Type::Distance:
+                terms_.push_back(index({spec.points[0], spec.points[1]}));
+                if (spec.normalize_by.first >= 0) denominator = static_cast<int32_t>(index(spec.normalize_by));
+                break;
+            case Type::AspectRatio:
+                for (const auto& pair : spec.vertical) terms_.push_back(index(pair));
+                denominator = static_cast<int32_t>(index(spec.horizontal));
+                break;
+            case Type::Angle:
+                terms_.push_back(index({spec.points[0], spec.points[1]}));
+                terms_.push_back(index({spec.points[1], spec.points[2]}));
+                terms_.push_back(index({spec.points[0], spec.points[2]}));
+                break;
+        }
+        term_count_.push_back(static_cast<uint32_t>(terms_.size()) - term_offset_.back());
+        denominator_.push_back(denominator);
+    }
+}
+
+int DerivedSignals::index_of(const std::string& name) const {
+    auto it = std::find(names_.begin(), names_.end(), name);
+    return it == names_.end() ? -1 : static_cast<int>(it - names_.begin());
+}
+
+void DerivedSignals::compute(const LandmarkBuffer& landmarks, std::vector<double>& values, std::vector<float>& scratch) const {
+    const double nan = std::numeric_limits<double>::quiet_NaN();
+    values.assign(names_.size(), nan);
+    if (static_cast<int>(landmarks.size()) <= max_point_) {
+        return;
+    }
+
+    // One pass over the pairs: branch-free loops over index arrays, which the
+    // compiler turns into gathers and vector square roots where it can.
+    const size_t pairs = pair_a_.size();
+    scratch.resize(pairs);
+    const float* x = landmarks.x();
+    const float* y = landmarks.y();
+    const float* z = landmarks.z();
+    const int32_t* a = pair_a_.data();
+    const int32_t* b = pair_b_.data();
+    float* distance = scratch.data();
+    for (size_t i = 0; i < planar_pairs_; ++i) {
+        float dx = x[a[i]] - x[b[i]];
+        float dy = y[a[i]] - y[b[i]];
+        distance[i] = std::sqrt(dx * dx + dy * dy);
+    }
+    for (size_t i = planar_pairs_; i < pairs; ++i) {
+        float dx = x[a[i]] - x[b[i]];
+        float dy = y[a[i]] - y[b[i]];
+        float dz = z[a[i]] - z[b[i]];
+        distance[i] = std::sqrt(dx * dx + dy * dy + dz * dz);
+    }
+
+    constexpr double kEpsilon = 1e-9;
+    for (size_t s = 0; s < names_.size(); ++s) {
+        const uint32_t* terms = terms_.data() + term_offset_[s];
+        if (types_[s] == Type::Angle) {
+            double ab = distance[terms[0]];
+            double bc = distance[terms[1]];
+            double ac = distance[terms[2]];
+            if (ab < kEpsilon || bc < kEpsilon) {
+                continue;
+            }
+            double cosine = (ab * ab + bc * bc - ac * ac) / (2.0 * ab * bc);
+            values[s] = std::acos(std::clamp(cosine, -1.0, 1.0));
+            continue;
+        }
+        double sum = 0.0;
+        for (uint32_t t = 0; t < term_count_[s]; ++t) {
+            sum += distance[terms[t]];
+        }
+        double value = sum / term_count_[s];
+        if (denominator_[s] >= 0) {
+            double reference = distance[denominator_[s]];
+            if (reference < kEpsilon) {
+                continue;
+            }
+            value /= reference;
+        }
+        values[s] = value;
+    }
+}
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "landmark_buffer.h"
+#include "nlohmann/json.hpp"
+
+// Signals computed from the face landmarks, declared next to the signal
+// filters in <gestures_folder>/signals/*.json:
+//   {"derived": [
+//       {"name": "leftEyeAspect", "type": "aspect_ratio",
+//        "vertical": [[160, 144], [158, 153]], "horizontal": [33, 133]},
+//       {"name": "mouthOpening", "type": "distance", "points": [13, 14], "normalize_by": [33, 263]},
+//       {"name": "mouthCornerAngle", "type": "angle", "points": [61, 13, 291]}
+//   ]}
+// aspect_ratio is the mean of the vertical distances over the horizontal one
+// (the eye and mouth aspect ratios), distance is optionally divided by a
+// reference distance, and angle is the angle at the middle point, in radians.
+// Points are landmark indexes; "depth": true measures in 3D instead of 2D.
+// Results are published under their names, so filters and gestures use them
+// like any landmarker signal.
+//
+// Each of these is a combination of point-to-point distances. The specs
+// compile into one table of distinct point pairs, computed in a single pass
+// over the landmark arrays per frame, and a list of terms per signal that
+// combine them. Immutable once built: one instance is shared by every session
+// of a snapshot.
+class DerivedSignals {
+public:
+    enum class Type { Distance, AspectRatio, Angle };
+
+    struct Spec {
+        std::string name;
+        Type type = Type::Distance;
+        std::vector<int> points;                    // distance: 2, angle: 3
+        std::vector<std::pair<int, int>> vertical;  // aspect_ratio
+        std::pair<int, int> horizontal{-1, -1};     // aspect_ratio
+        std::pair<int, int> normalize_by{-1, -1};   // distance, optional
+        bool depth = false;
+    };
+
+    // MediaPipe's face mesh with iris refinement.
+    static constexpr int kLandmarks = 478;
+
+    // Parses the "derived" array of one signals file and appends to specs.
+    // Returns false and fills error on the first invalid entry.
+    static bool parse_specs(const nlohmann::json& j, std::vector<Spec>& specs, std::string* error = nullptr);
+    // Loads every *.json file in folder; a missing folder is not an error.
+    static bool load_specs_from_folder(const std::string& folder, std::vector<Spec>& specs, std::string* error = nullptr);
+
+    DerivedSignals() = default;
+    explicit DerivedSignals(const std::vector<Spec>& specs);
+
+    size_t size() const { return names_.size(); }
+    bool empty() const { return names_.empty(); }
+    const std::string& name(size_t i) const { return names_[i]; }
+    // Index of the signal called name, -1 when there is none.
+    int index_of(const std::string& name) const;
+    size_t pair_count() const { return pair_a_.size(); }
+
+    // Fills values (resized to size()) with every signal, NaN where it cannot
+    // be computed: too few landmarks, or a zero reference distance.
+    // scratch holds the pair distances between calls.
+    void compute(const LandmarkBuffer& landmarks, std::vector<double>& values, std::vector<float>& scratch) const;
+
+private:
+    // Distinct point pairs; the first planar_pairs_ are measured in 2D, the rest in 3D.
+    std::vector<int32_t> pair_a_;
+    std::vector<int32_t> pair_b_;
+    size_t planar_pairs_ = 0;
+    int max_point_ = -1;
+
+    // Per signal: value = mean(distance[terms]) / distance[denominator], or the
+    // angle at the middle point for angles (terms: ab, bc, ac).
+    std::vector<std::string> names_;
+    std::vector<Type> types_;
+    std::vector<uint32_t> term_offset_;
+    std::vector<uint32_t> term_count_;
+    std::vector<int32_t> denominator_; // -1 for none
+    std::vector<uint32_t> terms_;      // pair indexes
+};
@@ -0,0 +1,125 @@
+#include "derived_signals.h"
+#include "test_check.h"
+#include <iostream>
+#include <chrono>
+#include <cmath>
+#include <string>
+
+static bool near(double a, double b) {
+    return std::abs(a - b) < 1e-5;
+}
+
+static void place(LandmarkBuffer& landmarks, int index, float x, float y, float z = 0.0f) {
+    landmarks.x()[index] = x;
+    landmarks.y()[index] = y;
+    landmarks.z()[index] = z;
+}
+
+int main() {
+    std::vector<DerivedSignals::Spec> specs;
+    std::string error;
+    bool parsed = DerivedSignals::parse_specs(nlohmann::json::parse(R"({
+        "derived": [
+            {"name": "leftEyeAspect", "type": "aspect_ratio", "vertical": [[160, 144], [158, 153]], "horizontal": [33, 133]},
+            {"name": "mouthOpening", "type": "distance", "points": [13, 14], "normalize_by": [33, 133]},
+            {"name": "rawMouth", "type": "distance", "points": [14, 13]},
+            {"name": "mouthDepth", "type": "distance", "points": [13, 14], "depth": true},
+            {"name": "corner", "type": "angle", "points": [61, 13, 291]}
+        ]
+    })"), specs, &error);
+    TEST_CHECK(parsed && specs.size() == 5);
+
+    // A file with filters only has nothing derived
+    parsed = DerivedSignals::parse_specs(nlohmann::json::parse(R"({"filters": []})"), specs, &error);
+    TEST_CHECK(parsed && specs.size() == 5);
+
+    DerivedSignals derived(specs);
+    TEST_CHECK(derived.size() == 5);
+    TEST_CHECK(derived.index_of("corner") == 4);
+    TEST_CHECK(derived.index_of("yaw") == -1);
+    // Shared pairs are measured once: 160-144, 158-153, 33-133, 13-14 (2D, both orders),
+    // 13-14 (3D), 61-13, 13-291, 61-291
+    TEST_CHECK(derived.pair_count() == 8);
+    std::cout << "Compiled " << derived.size() << " signals into " << derived.pair_count() << " distances\n";
+
+    LandmarkBuffer landmarks;
+    landmarks.resize(DerivedSignals::kLandmarks);
+    // Eye 0.4 wide, lids 0.1 and 0.06 apart: aspect ratio 0.2
+    place(landmarks, 33, 0.3f, 0.5f);
+    place(landmarks, 133, 0.7f, 0.5f);
+    place(landmarks, 160, 0.4f, 0.45f);
+    place(landmarks, 144, 0.4f, 0.55f);
+    place(landmarks, 158, 0.6f, 0.47f);
+    place(landmarks, 153, 0.6f, 0.53f);
+    // Lips 0.08 apart in the image and 0.06 in depth
+    place(landmarks, 13, 0.5f, 0.7f, 0.0f);
+    place(landmarks, 14, 0.5f, 0.78f, 0.06f);
+    // Right angle at the upper lip
+    place(landmarks, 61, 0.4f, 0.7f);
+    place(landmarks, 291, 0.5f, 0.6f);
+
+    std::vector<double> values;
+    std::vector<float> scratch;
+    derived.compute(landmarks, values, scratch);
+    TEST_CHECK(values.size() == 5);
+    TEST_CHECK(near(values[0], 0.2));
+    TEST_CHECK(near(values[1], 0.2));
+    TEST_CHECK(near(values[2], 0.08));
+    TEST_CHECK(near(values[3], 0.1));
+    TEST_CHECK(near(values[4], M_PI / 2));
+    std::cout << "leftEyeAspect " << values[0] << ", mouthOpening " << values[1]
+              << ", mouthDepth " << values[3] << ", corner " << values[4] << "\n";
+
+    // A collapsed reference distance leaves the ratio absent rather than infinite
+    place(landmarks, 133, 0.3f, 0.5f);
+    derived.compute(landmarks, values, scratch);
+    TEST_CHECK(std::isnan(values[0]) && std::isnan(values[1]));
+    TEST_CHECK(near(values[2], 0.08));
+
+    // Without the iris landmarks (or without a face) nothing can be computed
+    LandmarkBuffer short_buffer;
+    short_buffer.resize(100);
+    derived.compute(short_buffer, values, scratch);
+    TEST_CHECK(values.size() == 5 && std::isnan(values[4]));
+    std::cout << "Missing landmarks give absent signals\n";
+
+    // Invalid specs are rejected with a message
+    auto rejects = [](const char* text) {
+        std::vector<DerivedSignals::Spec> rejected;
+        std::string message;
+        bool ok = DerivedSignals::parse_specs(nlohmann::json::parse(text), rejected, &message);
+        if (!ok) std::cout << "Rejected: " << message << "\n";
+        return !ok;
+    };
+    TEST_CHECK(rejects(R"({"derived": [{"name": "a", "type": "distance", "points": [13, 478]}]})"));
+    TEST_CHECK(rejects(R"({"derived": [{"name": "a", "type": "distance", "points": [13]}]})"));
+    TEST_CHECK(rejects(R"({"derived": [{"name": "a", "type": "angle", "points": [1, 2, 3], "normalize_by": [1, 2]}]})"));
+    TEST_CHECK(rejects(R"({"derived": [{"name": "a", "type": "aspect_ratio", "vertical": [], "horizontal": [1, 2]}]})"));
+    TEST_CHECK(rejects(R"({"derived": [{"name": "a", "type": "curvature", "points": [1, 2]}]})"));
+    TEST_CHECK(rejects(R"({"derived": {"name": "a"}})"));
+
+    // Cost per frame for a realistic set: both eyes, the mouth and a few distances
+    std::vector<DerivedSignals::Spec> many = specs;
+    for (int i = 0; i < 20; ++i) {
+        DerivedSignals::Spec spec;
+        spec.name = "distance" + std::to_string(i);
+        spec.points = {i * 20, i * 20 + 7};
+        spec.normalize_by = {33, 263};
+        many.push_back(spec);
+    }
+    DerivedSignals large(many);
+    const int iterations = 100000;
+    double sink = 0.0;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; ++i) {
+        landmarks.x()[13] = 0.5f + static_cast<float>(i % 7) * 1e-3f;
+        large.compute(landmarks, values, scratch);
+        sink += values[2];
+    }
+    double us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+    std::cout << "compute: " << us * 1000.0 / iterations << " ns per frame for " << large.size()
+              << " signals over " << large.pair_count() << " distances (" << sink << ")\n";
+
+    std::cout << "Test completed.\n";
+    return 0;
+}
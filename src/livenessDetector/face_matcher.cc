@@ -0,0 +1,188 @@
+#include "face_matcher.h"
+#include "logger.h"
+#include <opencv2/calib3d.hpp>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <utility>
+
+namespace {
+
+constexpr int kFaceSize = 112;
+
+// Where SFace expects the eyes, the nose tip and the mouth corners of a 112x112 face.
+const cv::Point2f kFaceTemplate[5] = {
+    {38.2946f, 51.6963f}, {73.5318f, 51.5014f}, {56.0252f, 71.7366f}, {41.5493f, 92.3655f}, {70.7299f, 92.2041f}};
+
+} // namespace
+
+std::unique_ptr<SFaceMatcher> SFaceMatcher::create(const Config& config, std::string* error) {
+    try {
+        auto detector = cv::FaceDetectorYN::create(config.detector_model, "", cv::Size(320, 320),
+                                                   config.detection_score);
+        cv::dnn::Net recognizer = cv::dnn::readNet(config.recognizer_model);
+        if (!detector || recognizer.empty()) {
+            if (error) *error = "Unable to load the face matching models";
+            return nullptr;
+        }
+        return std::unique_ptr<SFaceMatcher>(new SFaceMatcher(config, detector, recognizer));
+    } catch (const cv::Exception& e) {
+        if (error) *error = std::string("Unable to load the face matching models: ") + e.what();
+        return nullptr;
+    }
+}
+
+std::shared_ptr<SFaceMatcher> SFaceMatcher::shared(const Config& config, std::string* error) {
+    static std::mutex mutex;
+    static std::map<std::pair<std::string, std::string>, std::shared_ptr<SFaceMatcher>> matchers;
+    std::lock_guard<std::mutex> lock(mutex);
+    auto& matcher = matchers[{config.detector_model, config.recognizer_model}];
+    if (!matcher) {
+        matcher = create(config, error);
+    }
+    return matcher;
+}
+
+SFaceMatcher::SFaceMatcher(Config config, cv::Ptr<cv::FaceDetectorYN> detector, cv::dnn::Net recognizer)
+    : config_(std::move(config)),
+      detector_(std::move(detector)),
+      recognizer_(std::move(recognizer)) {}
+
+size_t SFaceMatcher::cached_references() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return references_.size();
+}
+
+bool SFaceMatcher::align(const cv::Mat& picture, cv::Mat& face) {
+    if (picture.empty()) {
+        return false;
+    }
+    cv::Mat faces;
+    detector_->setInputSize(picture.size());
+    detector_->detect(picture, faces);
+    if (faces.rows == 0) {
+        return false;
+    }
+    // Rows: x, y, w, h, five landmark points, score. Keep the most confident face.
+    int best = 0;
+    for (int i = 1; i < faces.rows; ++i) {
+        if (faces.at<float>(i, 14) > faces.at<float>(best, 14)) {
+            best = i;
+        }
+    }
+    std::vector<cv::Point2f> landmarks(5);
+    for (int i = 0; i < 5; ++i) {
+        landmarks[i] = cv::Point2f(faces.at<float>(best, 4 + 2 * i), faces.at<float>(best, 5 + 2 * i));
+    }
+    std::vector<cv::Point2f> target(kFaceTemplate, kFaceTemplate + 5);
+    cv::Mat transform = cv::estimateAffinePartial2D(landmarks, target, cv::noArray(), cv::LMEDS);
+    if (transform.empty()) {
+        return false;
+    }
+    cv::warpAffine(picture, face, transform, cv::Size(kFaceSize, kFaceSize));
+    return true;
+}
+
+cv::Mat SFaceMatcher::embed(const std::vector<cv::Mat>& pictures, std::vector<bool>& found) {
+    found.assign(pictures.size(), false);
+    std::vector<cv::Mat> faces;
+    std::vector<int> rows; // row of each aligned face in the result
+    for (size_t i = 0; i < pictures.size(); ++i) {
+        cv::Mat face;
+        if (align(pictures[i], face)) {
+            found[i] = true;
+            rows.push_back(static_cast<int>(i));
+            faces.push_back(face);
+        }
+    }
+
+    cv::Mat embeddings;
+    if (faces.empty()) {
+        return cv::Mat::zeros(static_cast<int>(pictures.size()), 1, CV_32F);
+    }
+    // Same input as cv::FaceRecognizerSF::feature: BGR to RGB, no scaling.
+    if (batched_) {
+        try {
+            recognizer_.setInput(cv::dnn::blobFromImages(faces, 1.0, cv::Size(kFaceSize, kFaceSize), cv::Scalar(), true, false));
+            embeddings = recognizer_.forward().reshape(1, static_cast<int>(faces.size())).clone();
+        } catch (const cv::Exception& e) {
+            LOG_INFO("[FaceMatcher] The recognizer does not take batches, embedding one face at a time: {}", e.what());
+            batched_ = false;
+        }
+    }
+    if (!batched_) {
+        embeddings.release();
+        for (const auto& face : faces) {
+            recognizer_.setInput(cv::dnn::blobFromImage(face, 1.0, cv::Size(kFaceSize, kFaceSize), cv::Scalar(), true, false));
+            embeddings.push_back(recognizer_.forward().reshape(1, 1));
+        }
+    }
+
+    cv::Mat result = cv::Mat::zeros(static_cast<int>(pictures.size()), embeddings.cols, CV_32F);
+    for (size_t i = 0; i < rows.size(); ++i) {
+        cv::normalize(embeddings.row(static_cast<int>(i)), result.row(rows[i]));
+    }
+    return result;
+}
+
+bool SFaceMatcher::reference_embedding(const std::string& path, cv::Mat& embedding, std::string* error) {
+    std::error_code ec;
+    Reference reference;
+    reference.modified = std::filesystem::last_write_time(path, ec);
+    reference.size = ec ? 0 : std::filesystem::file_size(path, ec);
+    auto cached = references_.find(path);
+    if (cached != references_.end()) {
+        if (!ec && cached->second.modified == reference.modified && cached->second.size == reference.size) {
+            embedding = cached->second.embedding;
+            return true;
+        }
+        // Replaced or removed since: never match against the previous picture.
+        references_.erase(cached);
+        reference_order_.erase(std::find(reference_order_.begin(), reference_order_.end(), path));
+    }
+    cv::Mat picture = cv::imread(path);
+    if (picture.empty()) {
+        if (error) *error = "Unable to read the reference picture " + path;
+        return false;
+    }
+    std::vector<bool> found;
+    cv::Mat embeddings = embed({picture}, found);
+    if (!found[0]) {
+        if (error) *error = "No face in the reference picture " + path;
+        return false;
+    }
+    if (references_.size() >= config_.max_references && !reference_order_.empty()) {
+        references_.erase(reference_order_.front());
+        reference_order_.pop_front();
+    }
+    embedding = embeddings.row(0).clone();
+    reference.embedding = embedding;
+    references_[path] = std::move(reference);
+    reference_order_.push_back(path);
+    return true;
+}
+
+bool SFaceMatcher::match(const std::vector<cv::Mat>& pictures,
+                         const std::vector<std::string>& reference_paths,
+                         std::vector<std::vector<double>>* distances,
+                         std::string* error) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::vector<cv::Mat> references(reference_paths.size());
+    for (size_t r = 0; r < reference_paths.size(); ++r) {
+        if (!reference_embedding(reference_paths[r], references[r], error)) {
+            return false;
+        }
+    }
+
+    std::vector<bool> found;
+    cv::Mat embeddings = embed(pictures, found);
+    distances->assign(references.size(), std::vector<double>(pictures.size(), std::numeric_limits<double>::quiet_NaN()));
+    for (size_t r = 0; r < references.size(); ++r) {
+        for (size_t p = 0; p < pictures.size(); ++p) {
+            if (found[p]) {
+                (*distances)[r][p] = 1.0 - references[r].dot(embeddings.row(static_cast<int>(p)));
+            }
+        }
+    }
+    return true;
+}
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <opencv2/opencv.hpp>
+#include <opencv2/dnn.hpp>
+#include <opencv2/objdetect.hpp>
+#include <deque>
+#include <filesystem>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Compares the pictures taken during a verification with reference pictures
+// of the person. Lower distances mean more alike faces; below threshold() they
+// are taken as the same person.
+class FaceMatcher {
+public:
+    virtual ~FaceMatcher() = default;
+
+    // Fills (*distances)[r][p] with the distance of pictures[p] to the picture
+    // at reference_paths[r], NaN when pictures[p] has no face. Returns false
+    // and fills error when a reference cannot be read or has no face.
+    virtual bool match(const std::vector<cv::Mat>& pictures,
+                       const std::vector<std::string>& reference_paths,
+                       std::vector<std::vector<double>>* distances,
+                       std::string* error = nullptr) = 0;
+
+    virtual double threshold() const = 0;
+};
+
+// FaceMatcher on embeddings from local ONNX models: YuNet finds the face and
+// its five landmarks (cv::FaceDetectorYN), the face is aligned to 112x112 the
+// way SFace expects, and SFace turns it into a 128-float embedding. The
+// distance is the cosine distance of two embeddings.
+//
+// The pictures of a match() go through the recognizer in one batch; with a
+// model exported for a batch of one they are run one at a time instead. The
+// embedding of each reference is computed once and kept, by path, for the
+// last max_references references; a file replaced since (another size or
+// modification time) is embedded again. match() is serialized: the models are not
+// thread safe, so run it on a worker, not on the frame path.
+class SFaceMatcher : public FaceMatcher {
+public:
+    struct Config {
+        std::string detector_model;   // e.g. face_detection_yunet_2023mar.onnx
+        std::string recognizer_model; // e.g. face_recognition_sface_2021dec.onnx
+        float detection_score = 0.9f;
+        double threshold = 0.637;     // cosine distance; SFace's 0.363 cosine similarity
+        size_t max_references = 16;
+    };
+
+    // Returns nullptr and fills error when a model cannot be loaded.
+    static std::unique_ptr<SFaceMatcher> create(const Config& config, std::string* error = nullptr);
+    // The process's matcher for config's models, created on first use and kept,
+    // so the models load once and cached references outlive a verification.
+    // The first config given for a pair of models is the one used. A failed
+    // load is not kept: the next call tries again.
+    static std::shared_ptr<SFaceMatcher> shared(const Config& config, std::string* error = nullptr);
+
+    bool match(const std::vector<cv::Mat>& pictures,
+               const std::vector<std::string>& reference_paths,
+               std::vector<std::vector<double>>* distances,
+               std::string* error = nullptr) override;
+
+    double threshold() const override { return config_.threshold; }
+    size_t cached_references() const;
+
+private:
+    SFaceMatcher(Config config, cv::Ptr<cv::FaceDetectorYN> detector, cv::dnn::Net recognizer);
+
+    // Embeddings of the faces in pictures, one L2-normalized row each; false
+    // in found for a picture without a face, whose row is left at zero.
+    cv::Mat embed(const std::vector<cv::Mat>& pictures, std::vector<bool>& found);
+    bool align(const cv::Mat& picture, cv::Mat& face);
+    // Cached embedding of the reference picture at path, computed on first use
+    // and again once the file changes.
+    bool reference_embedding(const std::string& path, cv::Mat& embedding, std::string* error);
+
+    Config config_;
+    cv::Ptr<cv::FaceDetectorYN> detector_;
+    cv::dnn::Net recognizer_;
+    bool batched_ = true; // cleared once the recognizer refuses a batch
+
+    struct Reference {
+        std::filesystem::file_time_type modified;
+        std::uintmax_t size = 0;
+        cv::Mat embedding;
+    };
+
+    mutable std::mutex mutex_;
+    std::map<std::string, Reference> references_;
+    std::deque<std::string> reference_order_; // oldest first, for eviction
+};
@@ -0,0 +1,91 @@
+#include "face_matcher.h"
+#include <iostream>
+#include <cassert>
+#include <chrono>
+#include <cmath>
+#include <filesystem>
+
+int main(int argc, char** argv) {
+    if (argc < 5) {
+        std::cerr << "Usage: " << argv[0]
+                  << " <yunet_model.onnx> <sface_model.onnx> <reference_image> <picture1> [picture2 ...]\n";
+        return EXIT_FAILURE;
+    }
+
+    // Missing models are reported, not thrown
+    std::string error;
+    SFaceMatcher::Config missing;
+    missing.detector_model = "missing_yunet.onnx";
+    missing.recognizer_model = "missing_sface.onnx";
+    auto not_loaded = SFaceMatcher::create(missing, &error);
+    assert(!not_loaded);
+    std::cout << "Rejected: " << error << "\n";
+    auto not_shared = SFaceMatcher::shared(missing, &error);
+    assert(!not_shared);
+
+    SFaceMatcher::Config config;
+    config.detector_model = argv[1];
+    config.recognizer_model = argv[2];
+    auto matcher = SFaceMatcher::shared(config, &error);
+    if (!matcher) {
+        std::cerr << error << "\n";
+        return EXIT_FAILURE;
+    }
+    // One matcher per process for the same models
+    auto again = SFaceMatcher::shared(config, &error);
+    assert(again == matcher);
+
+    const std::string reference = argv[3];
+    std::vector<cv::Mat> pictures;
+    for (int i = 4; i < argc; ++i) {
+        pictures.push_back(cv::imread(argv[i]));
+    }
+    // A picture without a face gets no distance
+    pictures.push_back(cv::Mat(480, 640, CV_8UC3, cv::Scalar::all(128)));
+
+    std::vector<std::vector<double>> distances;
+    auto start = std::chrono::steady_clock::now();
+    bool matched = matcher->match(pictures, {reference}, &distances, &error);
+    double first_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    if (!matched) {
+        std::cerr << error << "\n";
+        return EXIT_FAILURE;
+    }
+    assert(distances.size() == 1 && distances[0].size() == pictures.size());
+    assert(std::isnan(distances[0].back()));
+    for (int i = 4; i < argc; ++i) {
+        double distance = distances[0][i - 4];
+        std::cout << argv[i] << ": distance " << distance
+                  << (distance < matcher->threshold() ? " (same person)\n" : " (different person)\n");
+    }
+
+    // The reference embedding is cached: the second match only embeds the pictures
+    start = std::chrono::steady_clock::now();
+    matched = again->match(pictures, {reference}, &distances, &error);
+    double second_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    assert(matched && matcher->cached_references() == 1);
+    std::cout << "match: " << first_ms << " ms, then " << second_ms << " ms with the reference cached, for "
+              << pictures.size() << " pictures\n";
+
+    // A reference replaced by another picture is embedded again: the first
+    // picture now matches it exactly
+    const std::string replaced = "replaced_reference.jpg";
+    std::filesystem::copy_file(reference, replaced, std::filesystem::copy_options::overwrite_existing);
+    matched = matcher->match(pictures, {replaced}, &distances, &error);
+    assert(matched);
+    std::filesystem::copy_file(argv[4], replaced, std::filesystem::copy_options::overwrite_existing);
+    std::filesystem::last_write_time(replaced, std::filesystem::last_write_time(replaced) + std::chrono::seconds(1));
+    matched = matcher->match(pictures, {replaced}, &distances, &error);
+    assert(matched && matcher->cached_references() == 2);
+    std::cout << "Replaced reference: distance " << distances[0][0] << " to " << argv[4] << "\n";
+    assert(distances[0][0] < 1e-3);
+    std::filesystem::remove(replaced);
+
+    // A reference that cannot be read fails the match
+    matched = matcher->match(pictures, {"missing_reference.jpg"}, &distances, &error);
+    assert(!matched);
+    std::cout << "Rejected: " << error << "\n";
+
+    std::cout << "Test completed.\n";
+    return 0;
+}
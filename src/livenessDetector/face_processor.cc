@@ -1,8 +1,10 @@
 #include "face_processor.h"
+#include "logger.h"
 #include <cmath>
 #include <sstream>
 #include <stdexcept>
 #include <chrono>
+#include <algorithm>
 
 // Utility Functions
 std::tuple<float, float, float> GetAnglesFromRotationMatrix(const cv::Matx33f& rotation_matrix) {
@@ -18,16 +20,27 @@ int64_t current_time_millis() {
 }
 
 // FaceProcessor Implementation
-FaceProcessor::FaceProcessor(const std::string& model_path) {
+FaceProcessor::FaceProcessor(const std::string& model_path)
+    : model_path_(model_path),
+      outputs_(std::make_shared<const LandmarkerOutputs>(LandmarkerOutputs::all())) {
+    std::string error;
+    graph_ = *outputs_;
+    landmarker_ = CreateLandmarker(graph_, &error);
+    if (!landmarker_) {
+        throw std::runtime_error("Error creating face landmarker: " + error);
+    }
+}
+
+std::unique_ptr<mediapipe::tasks::vision::face_landmarker::FaceLandmarker> FaceProcessor::CreateLandmarker(const LandmarkerOutputs& outputs, std::string* error) {
     auto options = std::make_unique<mediapipe::tasks::vision::face_landmarker::FaceLandmarkerOptions>();
-    options->base_options.model_asset_path = model_path;
+    options->base_options.model_asset_path = model_path_;
     options->running_mode = mediapipe::tasks::vision::core::RunningMode::LIVE_STREAM;
     options->num_faces = 1;
     options->min_face_detection_confidence = 0.5f;
     options->min_face_presence_confidence = 0.5f;
     options->min_tracking_confidence = 0.5f;
-    options->output_face_blendshapes = true;
-    options->output_facial_transformation_matrixes = true;
+    options->output_face_blendshapes = outputs.blendshapes;
+    options->output_facial_transformation_matrixes = outputs.transformation;
 
     options->result_callback = [this](const absl::StatusOr<mediapipe::tasks::vision::face_landmarker::FaceLandmarkerResult>& result_or, const mediapipe::Image& image, int64_t timestamp_ms) {
         this->ResultCallbackImpl(result_or, image, timestamp_ms);
@@ -35,9 +48,30 @@ FaceProcessor::FaceProcessor(const std::string& model_path) {
 
     auto face_landmarker_or = mediapipe::tasks::vision::face_landmarker::FaceLandmarker::Create(std::move(options));
     if (!face_landmarker_or.ok()) {
-        throw std::runtime_error("Error creating face landmarker: " + std::string(face_landmarker_or.status().message()));
+        *error = std::string(face_landmarker_or.status().message());
+        return nullptr;
+    }
+    return std::move(face_landmarker_or.value());
+}
+
+bool FaceProcessor::SetOutputs(const LandmarkerOutputs& outputs) {
+    bool rebuild = !outputs.served_by(graph_);
+    if (rebuild) {
+        // Build the new graph first, so a failure leaves the current one running.
+        std::string error;
+        auto landmarker = CreateLandmarker(outputs, &error);
+        if (!landmarker) {
+            LOG_ERROR("Unable to rebuild the face landmarker: {}", error);
+            return false;
+        }
+        landmarker_->Close(); // delivers the results still in flight
+        landmarker_ = std::move(landmarker);
+        graph_ = outputs;
+        LOG_INFO("Face landmarker rebuilt: blendshapes {}, transformation matrix {}",
+                 outputs.blendshapes, outputs.transformation);
     }
-    landmarker_ = std::move(face_landmarker_or.value());
+    std::atomic_store(&outputs_, std::make_shared<const LandmarkerOutputs>(outputs));
+    return rebuild;
 }
 
 FaceProcessor::~FaceProcessor() {
@@ -46,49 +80,112 @@ FaceProcessor::~FaceProcessor() {
     }
 }
 
-void FaceProcessor::ProcessImage(const cv::Mat& img) {
+int64_t FaceProcessor::ProcessImage(const cv::Mat& img, int64_t timestamp_ms) {
     if (do_process_image_ && landmarker_) {
-        auto input_frame = std::make_shared<mediapipe::ImageFrame>(mediapipe::ImageFormat::SRGB, img.cols, img.rows, mediapipe::ImageFrame::kDefaultAlignmentBoundary);
-        cv::Mat input_frame_mat = mediapipe::formats::MatView(input_frame.get());
-        cv::cvtColor(img, input_frame_mat, cv::COLOR_BGR2RGB);
-        mediapipe::Image mp_image(input_frame);
-        landmarker_->DetectAsync(mp_image, current_time_millis());
+        return SendFrame(img, timestamp_ms);
     }
+    return -1;
+}
+
+int64_t FaceProcessor::SendFrame(const cv::Mat& img, int64_t requested_ms) {
+    auto input_frame = std::make_shared<mediapipe::ImageFrame>(mediapipe::ImageFormat::SRGB, img.cols, img.rows, mediapipe::ImageFrame::kDefaultAlignmentBoundary);
+    cv::Mat input_frame_mat = mediapipe::formats::MatView(input_frame.get());
+    cv::cvtColor(img, input_frame_mat, cv::COLOR_BGR2RGB);
+    mediapipe::Image mp_image(input_frame);
+    int64_t timestamp_ms = std::max(requested_ms < 0 ? current_time_millis() : requested_ms, last_timestamp_ms_ + 1);
+    last_timestamp_ms_ = timestamp_ms;
+    {
+        std::lock_guard<std::mutex> lock(submissions_mutex_);
+        submissions_[timestamp_ms % kSubmissions] = {timestamp_ms, std::chrono::steady_clock::now()};
+    }
+    landmarker_->DetectAsync(mp_image, timestamp_ms);
+    return timestamp_ms;
+}
+
+int FaceProcessor::WarmUp(int frames, const cv::Mat& sample) {
+    if (!landmarker_ || frames <= 0) {
+        return 0;
+    }
+
+    cv::Mat frame = sample;
+    if (frame.empty()) {
+        // Smooth gradient plus noise: exercises the color conversion and the face detector.
+        frame.create(480, 640, CV_8UC3);
+        cv::Mat noise(frame.size(), CV_8UC3);
+        for (int y = 0; y < frame.rows; ++y) {
+            frame.row(y).setTo(cv::Scalar(y * 255 / frame.rows, 128, 255 - y * 255 / frame.rows));
+        }
+        cv::randu(noise, cv::Scalar::all(0), cv::Scalar::all(32));
+        frame += noise;
+    }
+
+    warmup_results_ = 0;
+    warming_up_ = true;
+    int completed = 0;
+    for (int i = 0; i < frames; ++i) {
+        SendFrame(frame, -1);
+        // In live stream mode a frame sent while the graph is busy may be dropped,
+        // so send the next one only after this one has come back.
+        std::unique_lock<std::mutex> lock(warmup_mutex_);
+        if (!warmup_cv_.wait_for(lock, std::chrono::seconds(5), [&]() { return warmup_results_ > completed; })) {
+            LOG_WARNING("Warm-up frame {} timed out", i);
+            break;
+        }
+        completed = warmup_results_;
+    }
+    warming_up_ = false;
+    return completed;
 }
 
 void FaceProcessor::SetDoProcessImage(bool value) {
     do_process_image_ = value;
 }
 
-void FaceProcessor::SetCallback(std::function<void(const std::map<std::string, float>&, const std::map<std::string, float>&)> callbackFn) {
+void FaceProcessor::SetCallback(std::function<void(const std::map<std::string, float>&, const std::map<std::string, float>&, int64_t)> callbackFn) {
     results_callback_fn_ = std::move(callbackFn);
 }
 
 void FaceProcessor::ResultCallbackImpl(const absl::StatusOr<mediapipe::tasks::vision::face_landmarker::FaceLandmarkerResult>& result_or, const mediapipe::Image& image, int64_t timestamp_ms) {
+    if (warming_up_) {
+        std::lock_guard<std::mutex> lock(warmup_mutex_);
+        warmup_results_++;
+        warmup_cv_.notify_all();
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(submissions_mutex_);
+        const Submission& submission = submissions_[timestamp_ms % kSubmissions];
+        if (submission.timestamp_ms == timestamp_ms) {
+            last_inference_us_.store(std::chrono::duration_cast<std::chrono::microseconds>(
+                std::chrono::steady_clock::now() - submission.submitted).count(), std::memory_order_relaxed);
+        }
+    }
     if (!result_or.ok()) {
-        std::cerr << "Error processing image: " << result_or.status().message() << std::endl;
+        LOG_ERROR("Error processing image: {}", result_or.status().message());
         return;
     }
-    ProcessResult(result_or.value(), timestamp_ms);
+    float aspect = image.height() > 0 ? static_cast<float>(image.width()) / image.height() : 1.0f;
+    ProcessResult(result_or.value(), timestamp_ms, aspect);
 }
 
-void FaceProcessor::ProcessResult(const mediapipe::tasks::vision::face_landmarker::FaceLandmarkerResult& result, int64_t timestamp_ms) {
+void FaceProcessor::ProcessResult(const mediapipe::tasks::vision::face_landmarker::FaceLandmarkerResult& result, int64_t timestamp_ms, float aspect) {
     std::map<std::string, float> lastBlendshapes;
     std::map<std::string, float> importantTransformationValues;
+    auto outputs = std::atomic_load(&outputs_);
 
     if (result.face_blendshapes.has_value()) {
         const auto& blendshapes_list = result.face_blendshapes.value(); 
         if (!blendshapes_list.empty()) {
             const auto& blendshapes = blendshapes_list[0]; 
             for (const auto& category : blendshapes.categories) {
-                if (category.category_name.has_value()) {
+                if (category.category_name.has_value() && outputs->wants_blendshape(category.category_name.value())) {
                     lastBlendshapes[category.category_name.value()] = category.score;
                 }
             }
         }
     }
 
-    if (result.facial_transformation_matrixes.has_value()) {
+    if (outputs->transformation && result.facial_transformation_matrixes.has_value()) {
         const auto& transformation_matrix = result.facial_transformation_matrixes.value().at(0);
         cv::Mat matrix(4, 4, CV_32F);
         for (int i = 0; i < 4; ++i) {
@@ -114,14 +211,41 @@ void FaceProcessor::ProcessResult(const mediapipe::tasks::vision::face_landmarke
         importantTransformationValues["Left Square"] = landmarks.landmarks.at(227).x;
         importantTransformationValues["Right Square"] = landmarks.landmarks.at(345).x;
         importantTransformationValues["Bottom Square"] = landmarks.landmarks.at(152).y;
+
+        // Normalized x and z are in image widths; bring them to image heights.
+        auto buffer = landmark_pool_.acquire();
+        size_t count = landmarks.landmarks.size();
+        buffer->resize(count);
+        buffer->set_timestamp_ms(timestamp_ms);
+        buffer->set_aspect(aspect);
+        float* x = buffer->x();
+        float* y = buffer->y();
+        float* z = buffer->z();
+        for (size_t i = 0; i < count; ++i) {
+            const auto& landmark = landmarks.landmarks[i];
+            x[i] = landmark.x * aspect;
+            y[i] = landmark.y;
+            z[i] = landmark.z * aspect;
+        }
+
+        if (outputs->derived) {
+            outputs->derived->compute(*buffer, derived_values_, derived_distances_);
+            for (size_t i = 0; i < derived_values_.size(); ++i) {
+                if (!std::isnan(derived_values_[i])) {
+                    importantTransformationValues[outputs->derived->name(i)] = static_cast<float>(derived_values_[i]);
+                }
+            }
+        }
+        std::atomic_store(&latest_landmarks_, std::shared_ptr<const LandmarkBuffer>(std::move(buffer)));
     } else {
         importantTransformationValues["Top Square"] = -1.0f;
         importantTransformationValues["Left Square"] = -1.0f;
         importantTransformationValues["Right Square"] = -1.0f;
         importantTransformationValues["Bottom Square"] = -1.0f;
+        std::atomic_store(&latest_landmarks_, std::shared_ptr<const LandmarkBuffer>());
     }
 
     if (results_callback_fn_) {
-        results_callback_fn_(lastBlendshapes, importantTransformationValues);
+        results_callback_fn_(lastBlendshapes, importantTransformationValues, timestamp_ms);
     }
 }
\ No newline at end of file
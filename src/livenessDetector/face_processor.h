@@ -2,17 +2,24 @@
 #define FACE_PROCESSOR_H
 
 #include <iostream>
+#include <array>
+#include <chrono>
 #include <memory>
 #include <vector>
 #include <string>
 #include <map>
 #include <functional>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
 #include <opencv2/opencv.hpp>
 #include "absl/status/statusor.h"
 #include "mediapipe/framework/formats/image_frame.h"
 #include "mediapipe/framework/formats/image_frame_opencv.h"
 #include "mediapipe/framework/formats/image.h"
 #include "mediapipe/tasks/cc/vision/face_landmarker/face_landmarker.h"
+#include "landmark_buffer.h"
+#include "landmarker_outputs.h"
 
 
 std::tuple<float, float, float> GetAnglesFromRotationMatrix(const cv::Matx33f& rotation_matrix);
@@ -24,17 +31,68 @@ public:
     FaceProcessor(const std::string& model_path);
     ~FaceProcessor();
 
-    void ProcessImage(const cv::Mat& img);
+    // Sends img to the landmarker stamped with timestamp_ms (the current time
+    // when negative), moved past the previous frame's when it is not after it.
+    // Returns the timestamp used, or -1 when the frame was not sent.
+    int64_t ProcessImage(const cv::Mat& img, int64_t timestamp_ms = -1);
+    // Submission to result time of the latest landmarker result, in microseconds.
+    int64_t LastInferenceMicros() const { return last_inference_us_.load(std::memory_order_relaxed); }
     void SetDoProcessImage(bool value);
-    void SetCallback(std::function<void(const std::map<std::string, float>&, const std::map<std::string, float>&)> callbackFn);
+    // Runs `frames` frames through the landmarker and waits for each result, so the
+    // lazy TFLite/XNNPACK initialization happens before the first real frame. Results
+    // are not passed to the callback. Uses `sample` when given (a frame with a face
+    // also warms up the landmark and blendshape models), otherwise a synthetic frame.
+    // Returns the number of frames that produced a result.
+    int WarmUp(int frames, const cv::Mat& sample = cv::Mat());
+    // Called from the landmarker thread with each result and the timestamp
+    // ProcessImage returned for its frame.
+    void SetCallback(std::function<void(const std::map<std::string, float>&, const std::map<std::string, float>&, int64_t)> callbackFn);
+    // Restricts the results to the outputs a session reads (all of them until
+    // called). Turning blendshapes or the transformation matrix on or off
+    // rebuilds the landmarker, after the results of the frames in flight; warm
+    // it up again before real frames. Call from the thread that sends frames.
+    // Returns true when the landmarker was rebuilt.
+    bool SetOutputs(const LandmarkerOutputs& outputs);
+    // Landmarks of the latest result, null when it found no face. Each result
+    // gets its own buffer from a pool, so a consumer may keep one while later
+    // results arrive; dropping the reference recycles it. Any thread.
+    std::shared_ptr<const LandmarkBuffer> LatestLandmarks() const { return std::atomic_load(&latest_landmarks_); }
 
 private:
     void ResultCallbackImpl(const absl::StatusOr<mediapipe::tasks::vision::face_landmarker::FaceLandmarkerResult>& result_or, const mediapipe::Image& image, int64_t timestamp_ms);
-    void ProcessResult(const mediapipe::tasks::vision::face_landmarker::FaceLandmarkerResult& result, int64_t timestamp_ms);
+    int64_t SendFrame(const cv::Mat& img, int64_t timestamp_ms);
+    // aspect is the image width over its height, for the derived signals.
+    void ProcessResult(const mediapipe::tasks::vision::face_landmarker::FaceLandmarkerResult& result, int64_t timestamp_ms, float aspect);
+    std::unique_ptr<mediapipe::tasks::vision::face_landmarker::FaceLandmarker> CreateLandmarker(const LandmarkerOutputs& outputs, std::string* error);
 
+    std::string model_path_;
     std::unique_ptr<mediapipe::tasks::vision::face_landmarker::FaceLandmarker> landmarker_;
+    LandmarkerOutputs graph_; // outputs landmarker_ was built with
+    std::shared_ptr<const LandmarkerOutputs> outputs_; // atomic_load/atomic_store: read by the landmarker thread
     bool do_process_image_ = false;
-    std::function<void(const std::map<std::string, float>&, const std::map<std::string, float>&)> results_callback_fn_;
+    int64_t last_timestamp_ms_ = 0; // the landmarker rejects non-increasing timestamps
+
+    LandmarkBufferPool landmark_pool_;
+    std::shared_ptr<const LandmarkBuffer> latest_landmarks_; // atomic_load/atomic_store
+    // Derived signal buffers, reused across results (landmarker thread only).
+    std::vector<double> derived_values_;
+    std::vector<float> derived_distances_;
+
+    // Submission times of the frames in flight, by timestamp, for LastInferenceMicros.
+    struct Submission {
+        int64_t timestamp_ms = -1;
+        std::chrono::steady_clock::time_point submitted;
+    };
+    static constexpr size_t kSubmissions = 16;
+    std::array<Submission, kSubmissions> submissions_;
+    std::mutex submissions_mutex_;
+    std::atomic<int64_t> last_inference_us_{0};
+
+    std::atomic<bool> warming_up_{false};
+    std::mutex warmup_mutex_;
+    std::condition_variable warmup_cv_;
+    int warmup_results_ = 0;
+    std::function<void(const std::map<std::string, float>&, const std::map<std::string, float>&, int64_t)> results_callback_fn_;
 };
 
 #endif // FACE_PROCESSOR_H
\ No newline at end of file
@@ -68,17 +68,24 @@ int main(int argc, char** argv) {
         FaceProcessor processor1(model_path);
         processor1.SetDoProcessImage(true);
         processor1.SetCallback([&](const std::map<std::string, float>& blendshapes,
-                                   const std::map<std::string, float>& transformationValues) {
+                                   const std::map<std::string, float>& transformationValues, int64_t) {
             printResults("Video 1", blendshapes, transformationValues, video1_output_file);
         });
 
         FaceProcessor processor2(model_path);
         processor2.SetDoProcessImage(true);
         processor2.SetCallback([&](const std::map<std::string, float>& blendshapes,
-                                   const std::map<std::string, float>& transformationValues) {
+                                   const std::map<std::string, float>& transformationValues, int64_t) {
             printResults("Video 2", blendshapes, transformationValues, video2_output_file);
         });
 
+        // Warm up the first processor and time it; the second one pays initialization on its first frames
+        auto warmup_start = std::chrono::steady_clock::now();
+        int warmed = processor1.WarmUp(3);
+        std::cout << "Processor 1 warm-up: " << warmed << " frames in "
+                  << std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - warmup_start).count()
+                  << " ms\n";
+
         // Open video files
         cv::VideoCapture cap1(video1_path);
         if (!cap1.isOpened()) {
@@ -0,0 +1,92 @@
+#include "flight_recorder.h"
+#include <arpa/inet.h>
+#include <cstring>
+#include <fstream>
+
+FlightRecorder::FlightRecorder(size_t capacity) {
+    capacity_ = 1;
+    while (capacity_ < capacity) {
+        capacity_ <<= 1;
+    }
+    mask_ = capacity_ - 1;
+    slots_.reset(new Slot[capacity_]);
+}
+
+uint16_t FlightRecorder::signal_id(const std::string& name) {
+    std::lock_guard<std::mutex> lock(names_mutex_);
+    auto it = signal_ids_.find(name);
+    if (it != signal_ids_.end()) {
+        return it->second;
+    }
+    uint16_t id = static_cast<uint16_t>(signal_names_.size());
+    signal_names_.push_back(name);
+    signal_ids_.emplace(name, id);
+    return id;
+}
+
+std::vector<FlightRecorder::Record> FlightRecorder::snapshot() const {
+    uint64_t head = head_.load(std::memory_order_acquire);
+    uint64_t first = head > capacity_ ? head - capacity_ : 0;
+
+    std::vector<Record> records;
+    records.reserve(head - first);
+    for (uint64_t sequence = first; sequence < head; ++sequence) {
+        const Slot& slot = slots_[sequence & mask_];
+        if (slot.sequence.load(std::memory_order_acquire) != sequence + 1) {
+            continue; // still being written, or already overwritten
+        }
+        Record record = slot.record;
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (slot.sequence.load(std::memory_order_relaxed) == sequence + 1) {
+            records.push_back(record);
+        }
+    }
+    return records;
+}
+
+uint64_t FlightRecorder::total_records() const {
+    return head_.load(std::memory_order_relaxed);
+}
+
+FlightRecorder::Dump FlightRecorder::dump(const nlohmann::json& extra) const {
+    std::vector<Record> records = snapshot();
+
+    nlohmann::json header = extra;
+    header["type"] = "flight_recorder";
+    header["version"] = kVersion;
+    header["record_size"] = sizeof(Record);
+    header["capacity"] = capacity_;
+    header["total_records"] = total_records();
+    {
+        std::lock_guard<std::mutex> lock(names_mutex_);
+        header["signals"] = signal_names_;
+    }
+
+    Dump dump;
+    dump.header = header.dump();
+    dump.payload.resize(records.size() * sizeof(Record));
+    if (!records.empty()) {
+        std::memcpy(dump.payload.data(), records.data(), dump.payload.size());
+    }
+    return dump;
+}
+
+bool FlightRecorder::write_file(const std::string& path, const Dump& dump, std::string* error) {
+    // Same framing as the 0x03 socket message, without the message id.
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    if (!file) {
+        if (error) *error = "cannot open " + path;
+        return false;
+    }
+    uint32_t header_size = htonl(static_cast<uint32_t>(dump.header.size()));
+    uint32_t payload_size = htonl(static_cast<uint32_t>(dump.payload.size()));
+    file.write(reinterpret_cast<const char*>(&header_size), sizeof(header_size));
+    file.write(dump.header.data(), dump.header.size());
+    file.write(reinterpret_cast<const char*>(&payload_size), sizeof(payload_size));
+    file.write(reinterpret_cast<const char*>(dump.payload.data()), dump.payload.size());
+    if (!file) {
+        if (error) *error = "failed writing " + path;
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,104 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "nlohmann/json.hpp"
+
+// Fixed-size ring of compact events for one session: the signals gestures
+// read, step transitions, requester phases and per-frame latencies. Recording
+// is one relaxed fetch_add and a 24-byte store, from any thread, and never
+// allocates; the oldest records are overwritten once the ring is full.
+//
+// The ring is only read when a session ends not alive or a client asks for it
+// (see dump()), so a failed verification can be replayed offline.
+class FlightRecorder {
+public:
+    enum class Type : uint8_t {
+        Signal = 1,      // id: signal name, value: signal value
+        StepAdvance = 2, // id: gesture index, arg: new step index
+        StepReset = 3,   // id: gesture index, arg: step the gesture was on
+        GestureDone = 4, // id: gesture index
+        Phase = 5,       // arg: index in the requester plan
+        NotAlive = 6,    // arg: plan index that timed out
+        Latency = 7,     // id: Stage, arg: microseconds
+        SuspiciousInput = 8, // arg: identical frames in a row
+    };
+
+    enum class Stage : uint16_t {
+        SignalTick = 0, // filter bank and gesture detector for one landmarker result
+        Render = 1,     // overlay for one frame
+    };
+
+    // On-disk and on-wire layout, little endian.
+    struct Record {
+        uint64_t timestamp_ns; // steady clock
+        uint8_t type;          // Type
+        uint8_t reserved;
+        uint16_t id;
+        uint32_t arg;
+        double value;
+    };
+    static_assert(sizeof(Record) == 24, "Record layout is part of the dump format");
+
+    struct Dump {
+        std::string header; // JSON, see dump()
+        std::vector<uint8_t> payload; // Records, oldest first
+    };
+
+    static constexpr uint32_t kVersion = 1;
+
+    // capacity is rounded up to a power of two.
+    explicit FlightRecorder(size_t capacity = 16384);
+
+    FlightRecorder(const FlightRecorder&) = delete;
+    FlightRecorder& operator=(const FlightRecorder&) = delete;
+
+    static uint64_t now_ns() {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    void record(Type type, uint16_t id, uint32_t arg, double value, uint64_t timestamp_ns) noexcept {
+        uint64_t sequence = head_.fetch_add(1, std::memory_order_relaxed);
+        Slot& slot = slots_[sequence & mask_];
+        // Seqlock per slot: readers drop a record whose sequence changed while they copied it.
+        slot.sequence.store(0, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        slot.record = Record{timestamp_ns, static_cast<uint8_t>(type), 0, id, arg, value};
+        slot.sequence.store(sequence + 1, std::memory_order_release);
+    }
+
+    // Ids for signal names, stable for the recorder's lifetime. Takes a lock:
+    // look ids up once (e.g. when subscriptions change), not per record.
+    uint16_t signal_id(const std::string& name);
+
+    // Records still in the ring, oldest first.
+    std::vector<Record> snapshot() const;
+    uint64_t total_records() const;
+
+    // Header JSON: {"type":"flight_recorder","version":1,"record_size":24,
+    // "capacity":..,"total_records":..,"signals":[names by id], ...extra}.
+    Dump dump(const nlohmann::json& extra = nlohmann::json::object()) const;
+    static bool write_file(const std::string& path, const Dump& dump, std::string* error = nullptr);
+
+private:
+    struct alignas(32) Slot {
+        std::atomic<uint64_t> sequence{0}; // index + 1 of the record, 0 while being written
+        Record record{};
+    };
+
+    std::unique_ptr<Slot[]> slots_;
+    size_t capacity_;
+    size_t mask_;
+    std::atomic<uint64_t> head_{0};
+
+    mutable std::mutex names_mutex_;
+    std::vector<std::string> signal_names_;
+    std::unordered_map<std::string, uint16_t> signal_ids_;
+};
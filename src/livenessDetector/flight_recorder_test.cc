@@ -0,0 +1,78 @@
+#include "flight_recorder.h"
+#include "test_check.h"
+#include "gesture_detector.h"
+#include <iostream>
+#include <cstdio>
+#include <fstream>
+#include <thread>
+
+int main() {
+    // Two threads recording at once, as the landmarker and socket threads do
+    FlightRecorder recorder(1000); // rounded up to 1024
+    std::thread other([&recorder]() {
+        for (int i = 0; i < 600; ++i) {
+            recorder.record(FlightRecorder::Type::Latency, 1, i, 0.0, FlightRecorder::now_ns());
+        }
+    });
+    for (int i = 0; i < 600; ++i) {
+        recorder.record(FlightRecorder::Type::Signal, 0, 0, i, FlightRecorder::now_ns());
+    }
+    other.join();
+
+    auto records = recorder.snapshot();
+    std::cout << "Recorded " << recorder.total_records() << ", ring holds " << records.size() << "\n";
+    TEST_CHECK(recorder.total_records() == 1200);
+    TEST_CHECK(records.size() == 1024);
+
+    // Cost of one record
+    const int iterations = 10000000;
+    uint64_t t = FlightRecorder::now_ns();
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; ++i) {
+        recorder.record(FlightRecorder::Type::Signal, 3, 0, i * 0.5, t);
+    }
+    std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+    std::cout << "record(): " << elapsed.count() / iterations << " ns\n";
+
+    // A detector with a recorder logs the signals it reads and every step change
+    FlightRecorder session_recorder;
+    GestureDetector detector;
+    std::vector<Gesture::Step> steps = {
+        {Gesture::Step::MoveType::Higher, 0.5, Gesture::Step::ResetCondition{Gesture::Step::ResetCondition::Type::Lower, 0.1}},
+        {Gesture::Step::MoveType::Lower, 0.1, std::nullopt},
+        {Gesture::Step::MoveType::Higher, 0.5, std::nullopt},
+    };
+    detector.add_gesture(std::make_unique<Gesture>("jaw", "Open your mouth", 10.0, false, steps,
+                                                   std::nullopt, std::string("jawOpen")));
+    detector.set_flight_recorder(&session_recorder);
+    detector.start_all();
+    double timestamp_ms = 0.0;
+    for (double value : {0.2, 0.7, 0.05, 0.8}) {
+        detector.process_signals({{"jawOpen", value}, {"eyeBlinkLeft", 0.0}}, timestamp_ms += 33.0);
+    }
+
+    int signals = 0, advances = 0, done = 0;
+    for (const auto& r : session_recorder.snapshot()) {
+        switch (static_cast<FlightRecorder::Type>(r.type)) {
+            case FlightRecorder::Type::Signal: ++signals; break;
+            case FlightRecorder::Type::StepAdvance: ++advances; break;
+            case FlightRecorder::Type::GestureDone: ++done; break;
+            default: break;
+        }
+    }
+    std::cout << "signals " << signals << ", step advances " << advances << ", done " << done << "\n";
+    TEST_CHECK(signals == 4 && advances == 2 && done == 1);
+
+    // Dump round trip through a file
+    FlightRecorder::Dump dump = session_recorder.dump({{"reason", "on_demand"}});
+    std::cout << "Header: " << dump.header << "\n";
+    std::string path = "flight_recorder_test.ldfr";
+    TEST_CHECK(FlightRecorder::write_file(path, dump));
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    TEST_CHECK(static_cast<size_t>(file.tellg()) == 8 + dump.header.size() + dump.payload.size());
+    std::remove(path.c_str());
+    TEST_CHECK(nlohmann::json::parse(dump.header)["signals"][0] == "jawOpen");
+
+    std::cout << "Test completed.\n";
+    return 0;
+}
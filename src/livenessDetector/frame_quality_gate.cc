@@ -0,0 +1,121 @@
+#include "frame_quality_gate.h"
+#include <algorithm>
+#include <cstdlib>
+
+FrameHash FrameHash::compute(const cv::Mat& gray) {
+    FrameHash hash;
+    cv::Mat cells(kGrid, kGrid, CV_8U, hash.cells.data());
+    cv::resize(gray, cells, cells.size(), 0, 0, cv::INTER_AREA); // writes into hash.cells
+    hash.valid = true;
+    return hash;
+}
+
+int FrameHash::max_cell_difference(const FrameHash& other) const {
+    int difference = 0;
+    for (size_t i = 0; i < cells.size(); ++i) {
+        difference = std::max(difference, std::abs(int(cells[i]) - int(other.cells[i])));
+    }
+    return difference;
+}
+
+FrameQualityGate::FrameQualityGate() : FrameQualityGate(Config()) {}
+
+FrameQualityGate::FrameQualityGate(Config config) : config_(config) {}
+
+void FrameQualityGate::reset() {
+    hash_ = FrameHash();
+    metrics_ = Metrics();
+}
+
+FrameQualityGate::Verdict FrameQualityGate::assess(const cv::Mat& frame) {
+    if (frame.empty() || frame.depth() != CV_8U) {
+        return Verdict::Ok; // not ours to judge; let the landmarker report it
+    }
+
+    int width = std::min(config_.width, frame.cols);
+    int height = std::max(1, frame.rows * width / frame.cols);
+    // Never assign frame to a member: the next resize would write into the caller's buffer.
+    const cv::Mat* source = &frame;
+    if (width != frame.cols) {
+        cv::resize(frame, small_, cv::Size(width, height), 0, 0, cv::INTER_AREA);
+        source = &small_;
+    }
+    if (source->channels() == 3) {
+        cv::cvtColor(*source, gray_, cv::COLOR_BGR2GRAY);
+    } else if (source->channels() == 4) {
+        cv::cvtColor(*source, gray_, cv::COLOR_BGRA2GRAY);
+    } else {
+        source->copyTo(gray_);
+    }
+
+    // Luminance and clipping in one pass over the small copy.
+    uint64_t sum = 0;
+    int dark = 0;
+    int bright = 0;
+    for (int y = 0; y < gray_.rows; ++y) {
+        const uint8_t* row = gray_.ptr<uint8_t>(y);
+        for (int x = 0; x < gray_.cols; ++x) {
+            uint8_t value = row[x];
+            sum += value;
+            dark += value <= 16;
+            bright += value >= 240;
+        }
+    }
+    double pixels = static_cast<double>(gray_.total());
+    metrics_.luminance = sum / pixels;
+    metrics_.dark_clipped = dark / pixels;
+    metrics_.bright_clipped = bright / pixels;
+
+    // Compared with the last frame sent to the landmarker, not the previous
+    // frame: a slow movement drifts a little per frame, and would otherwise
+    // never add up to a change.
+    FrameHash hash = FrameHash::compute(gray_);
+    bool repeated = false;
+    if (hash_.valid) {
+        metrics_.repeat_difference = hash.max_cell_difference(hash_);
+        repeated = metrics_.repeat_difference <= config_.repeat_tolerance;
+    } else {
+        metrics_.repeat_difference = -1;
+    }
+    if (repeated) {
+        metrics_.repeated_frames++;
+        return metrics_.repeated_frames >= config_.frozen_frames ? Verdict::Frozen : Verdict::Repeated;
+    }
+    metrics_.repeated_frames = 0;
+
+    Verdict verdict = check();
+    if (verdict == Verdict::Ok) {
+        hash_ = hash;
+    }
+    return verdict;
+}
+
+FrameQualityGate::Verdict FrameQualityGate::check() {
+    // Lighting first: a dark frame also looks blurred.
+    if (metrics_.luminance < config_.min_luminance || metrics_.dark_clipped > config_.max_clipped) {
+        return Verdict::TooDark;
+    }
+    if (metrics_.luminance > config_.max_luminance || metrics_.bright_clipped > config_.max_clipped) {
+        return Verdict::TooBright;
+    }
+    cv::Laplacian(gray_, laplacian_, CV_16S);
+    cv::Scalar mean, stddev;
+    cv::meanStdDev(laplacian_, mean, stddev);
+    metrics_.sharpness = stddev[0] * stddev[0];
+    if (metrics_.sharpness < config_.min_sharpness) {
+        return Verdict::Blurry;
+    }
+    return Verdict::Ok;
+}
+
+const char* FrameQualityGate::warning_key(Verdict verdict) {
+    switch (verdict) {
+        case Verdict::TooDark: return "warning.too_dark_message";
+        case Verdict::TooBright: return "warning.too_bright_message";
+        case Verdict::Blurry: return "warning.blurry_message";
+        case Verdict::Frozen: return "warning.frozen_frame_message";
+        case Verdict::Ok:
+        case Verdict::Repeated: break;
+    }
+    return nullptr;
+}
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <opencv2/opencv.hpp>
+
+// Block-mean perceptual hash of a luma plane: the mean of each cell of a
+// kGrid x kGrid grid. Two captures of the same still image (a frozen camera,
+// a replayed picture) differ by at most a gray level or two per cell, while a
+// blink or a head movement moves some cells by much more than that. The cell
+// means are kept rather than thresholded into bits so that the comparison does
+// not flip on cells that sit near the threshold.
+struct FrameHash {
+    static constexpr int kGrid = 16;
+
+    std::array<uint8_t, kGrid * kGrid> cells{};
+    bool valid = false;
+
+    // gray: 8-bit single channel. Uses OpenCV's vectorized area resize.
+    static FrameHash compute(const cv::Mat& gray);
+
+    // Largest difference between the means of the same cell.
+    int max_cell_difference(const FrameHash& other) const;
+};
+
+// Cheap checks run on a frame before it is sent to the landmarker, so frames
+// that cannot produce a usable result skip inference: too dark or too bright
+// (mean luminance and clipped pixels), blurred (variance of the Laplacian),
+// repeated (same FrameHash as the last frame let through) and frozen (a long
+// run of repeated frames, e.g. a stuck camera or a replayed image).
+//
+// Everything is measured on a small grayscale copy of the frame, with
+// OpenCV's vectorized resize and Laplacian. Keeps the hash of the last frame
+// it let through, so use one gate per camera stream, from one thread.
+class FrameQualityGate {
+public:
+    enum class Verdict { Ok, TooDark, TooBright, Blurry, Repeated, Frozen };
+
+    struct Config {
+        int width = 160;             // width of the analysis copy; the height keeps the aspect ratio
+        double min_luminance = 40.0; // mean gray level, 0-255
+        double max_luminance = 220.0;
+        double max_clipped = 0.5;    // fraction of pixels at or below 16, or at or above 240
+        double min_sharpness = 15.0; // variance of the Laplacian of the analysis copy
+        int repeat_tolerance = 2;    // max cell difference, in gray levels, of a repeated frame
+        int frozen_frames = 30;      // consecutive repeated frames before Frozen
+    };
+
+    struct Metrics {
+        double luminance = 0.0;
+        double dark_clipped = 0.0;
+        double bright_clipped = 0.0;
+        double sharpness = 0.0;
+        int repeat_difference = -1; // max cell difference with the last Ok frame, -1 when there is none
+        int repeated_frames = 0;    // length of the current run of repeated frames
+    };
+
+    // Not a Config() default argument: Config's member initializers are not
+    // usable until FrameQualityGate is complete.
+    FrameQualityGate();
+    explicit FrameQualityGate(Config config);
+
+    // Expects an 8-bit BGR (or gray) frame. A frame within repeat_tolerance
+    // of the last Ok frame is Repeated, and Frozen once the run reaches
+    // frozen_frames; any other frame is checked for lighting and sharpness,
+    // and becomes the reference for repeats when it is Ok.
+    Verdict assess(const cv::Mat& frame);
+    const Metrics& metrics() const { return metrics_; }
+    const FrameHash& hash() const { return hash_; }
+    void reset();
+
+    // Translation key of the warning shown for verdict, nullptr for Ok and Repeated.
+    static const char* warning_key(Verdict verdict);
+
+private:
+    Verdict check(); // lighting and sharpness of gray_
+
+    Config config_;
+    Metrics metrics_;
+    FrameHash hash_; // of the last Ok frame
+    cv::Mat small_;
+    cv::Mat gray_;
+    cv::Mat laplacian_;
+};
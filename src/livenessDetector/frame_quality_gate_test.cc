@@ -0,0 +1,118 @@
+#include "frame_quality_gate.h"
+#include <iostream>
+#include <cassert>
+#include <chrono>
+#include <string>
+
+static cv::Mat noise_frame(int seed) {
+    cv::Mat frame(480, 640, CV_8UC3);
+    cv::RNG rng(seed);
+    rng.fill(frame, cv::RNG::UNIFORM, cv::Scalar::all(40), cv::Scalar::all(216));
+    return frame;
+}
+
+int main() {
+    using Verdict = FrameQualityGate::Verdict;
+
+    FrameQualityGate::Config config;
+    config.frozen_frames = 3;
+    FrameQualityGate gate(config);
+
+    // Lighting
+    Verdict verdict = gate.assess(cv::Mat(480, 640, CV_8UC3, cv::Scalar::all(10)));
+    assert(verdict == Verdict::TooDark);
+    assert(gate.metrics().dark_clipped == 1.0);
+    verdict = gate.assess(cv::Mat(480, 640, CV_8UC3, cv::Scalar::all(250)));
+    assert(verdict == Verdict::TooBright);
+    std::cout << "Dark and bright frames rejected\n";
+
+    // A smooth gradient has no edges: its Laplacian is flat
+    cv::Mat gradient(480, 640, CV_8UC3);
+    for (int x = 0; x < gradient.cols; ++x) {
+        gradient.col(x).setTo(cv::Scalar::all(70 + x * 120 / gradient.cols));
+    }
+    verdict = gate.assess(gradient);
+    assert(verdict == Verdict::Blurry);
+    std::cout << "Gradient sharpness: " << gate.metrics().sharpness << "\n";
+
+    // A repeat of an accepted frame is Repeated, and Frozen once the run is long enough
+    gate.reset();
+    cv::Mat frame = noise_frame(1);
+    verdict = gate.assess(frame);
+    assert(verdict == Verdict::Ok);
+    assert(gate.metrics().repeat_difference < 0);
+    std::cout << "Noise sharpness: " << gate.metrics().sharpness << ", luminance: " << gate.metrics().luminance << "\n";
+    verdict = gate.assess(frame);
+    assert(verdict == Verdict::Repeated);
+    assert(gate.metrics().repeat_difference == 0);
+    verdict = gate.assess(frame);
+    assert(verdict == Verdict::Repeated);
+    verdict = gate.assess(frame);
+    assert(verdict == Verdict::Frozen);
+    assert(gate.metrics().repeated_frames == 3);
+    verdict = gate.assess(noise_frame(2));
+    assert(verdict == Verdict::Ok);
+    assert(gate.metrics().repeated_frames == 0);
+    std::cout << "Frozen stream detected and cleared\n";
+
+    // A local change, like closing the eyes, is not a repeat
+    cv::Mat changed = noise_frame(2);
+    changed(cv::Rect(300, 200, 40, 20)) += cv::Scalar::all(60);
+    verdict = gate.assess(changed);
+    assert(verdict == Verdict::Ok);
+    std::cout << "Local change: max cell difference " << gate.metrics().repeat_difference << "\n";
+
+    // A repeat of a rejected frame keeps its verdict, and does not replace the last Ok frame
+    cv::Mat dark(480, 640, CV_8UC3, cv::Scalar::all(10));
+    verdict = gate.assess(dark);
+    assert(verdict == Verdict::TooDark);
+    verdict = gate.assess(dark);
+    assert(verdict == Verdict::TooDark);
+    verdict = gate.assess(changed);
+    assert(verdict == Verdict::Repeated);
+
+    // A slow movement, under repeat_tolerance per frame, adds up against the last Ok frame
+    gate.reset();
+    cv::Mat still = noise_frame(8);
+    int admitted = 0;
+    for (int step = 0; step < 12; ++step) {
+        cv::Mat drifted = still + cv::Scalar::all(step);
+        verdict = gate.assess(drifted);
+        assert(verdict == Verdict::Ok || verdict == Verdict::Repeated);
+        admitted += verdict == Verdict::Ok;
+    }
+    assert(admitted == 4); // steps 0, 3, 6 and 9
+    std::cout << "Slow drift let through every " << config.repeat_tolerance + 1 << " frames\n";
+
+    // Small hashes: identical images hash identically, noise moves cells
+    cv::Mat gray;
+    cv::cvtColor(noise_frame(6), gray, cv::COLOR_BGR2GRAY);
+    FrameHash a = FrameHash::compute(gray);
+    FrameHash b = FrameHash::compute(gray.clone());
+    assert(a.valid && a.max_cell_difference(b) == 0);
+    cv::cvtColor(noise_frame(7), gray, cv::COLOR_BGR2GRAY);
+    assert(a.max_cell_difference(FrameHash::compute(gray)) > 0);
+
+    // The caller's frame is never written to
+    cv::Mat before = frame.clone();
+    gate.assess(frame);
+    gate.assess(noise_frame(3));
+    assert(cv::norm(frame, before, cv::NORM_INF) == 0);
+
+    assert(std::string(FrameQualityGate::warning_key(Verdict::TooDark)) == "warning.too_dark_message");
+    assert(FrameQualityGate::warning_key(Verdict::Ok) == nullptr);
+    assert(FrameQualityGate::warning_key(Verdict::Repeated) == nullptr);
+
+    // Cost per 640x480 frame
+    const int iterations = 200;
+    cv::Mat frames[2] = {noise_frame(4), noise_frame(5)};
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; ++i) {
+        gate.assess(frames[i % 2]);
+    }
+    double us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+    std::cout << "assess: " << us / iterations << " us per 640x480 frame\n";
+
+    std::cout << "Test completed.\n";
+    return 0;
+}
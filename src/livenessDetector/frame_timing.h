@@ -0,0 +1,63 @@
+#pragma once
+
+#include <cstdint>
+
+// Server-side account of one timestamped frame (message 0x04), sent back with
+// the processed image so the client can put its own capture-to-response time
+// next to the server's stages. Durations are in microseconds.
+struct FrameTiming {
+    enum class Status : uint8_t {
+        Processed = 0, // sent to the landmarker with the client's timestamp
+        Nudged = 1,    // sent, with a timestamp moved past the landmarker's previous one
+        Dropped = 2,   // not sent: capture timestamp not after the previous frame's
+        Skipped = 3,   // not sent: rejected or repeated by the frame quality gate
+    };
+
+    uint64_t capture_timestamp_us = 0; // echoed from the request; 0 for frames sent as 0x01
+    Status status = Status::Processed;
+    uint32_t receive_us = 0;   // reading the frame from the socket
+    uint32_t gate_us = 0;      // frame quality gate
+    uint32_t submit_us = 0;    // color conversion and landmarker submission
+    uint32_t render_us = 0;    // overlay
+    uint32_t inference_us = 0; // submission to result of the landmarker's latest result
+    uint32_t total_us = 0;     // first byte read to reply
+    uint32_t nudged_frames = 0;  // this connection so far
+    uint32_t dropped_frames = 0; // this connection so far
+    // Not sent: the landmarker timestamp of the frame, -1 when it was not sent to it.
+    int64_t landmarker_timestamp_ms = -1;
+};
+
+// Maps a client's capture timestamps, in microseconds on any monotonic clock,
+// onto the landmarker's millisecond timeline. The first frame pins the offset
+// between the two clocks, so capture spacing is kept. A frame whose capture
+// timestamp is not after the previous one (duplicated or reordered) is dropped.
+// Nudges happen in the landmarker, which may be shared by several connections;
+// the caller reports them with count_nudge(). One clock per connection.
+class CaptureClock {
+public:
+    // Returns false when the frame must be dropped; otherwise fills timestamp_ms.
+    bool map(uint64_t capture_us, int64_t now_ms, int64_t* timestamp_ms) {
+        if (started_ && capture_us <= last_capture_us_) {
+            ++dropped_;
+            return false;
+        }
+        if (!started_) {
+            offset_ms_ = now_ms - static_cast<int64_t>(capture_us / 1000);
+            started_ = true;
+        }
+        last_capture_us_ = capture_us;
+        *timestamp_ms = static_cast<int64_t>(capture_us / 1000) + offset_ms_;
+        return true;
+    }
+
+    void count_nudge() { ++nudged_; }
+    uint32_t nudged() const { return nudged_; }
+    uint32_t dropped() const { return dropped_; }
+
+private:
+    bool started_ = false;
+    uint64_t last_capture_us_ = 0;
+    int64_t offset_ms_ = 0;
+    uint32_t nudged_ = 0;
+    uint32_t dropped_ = 0;
+};
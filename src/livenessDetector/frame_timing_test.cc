@@ -0,0 +1,40 @@
+#include "frame_timing.h"
+#include "test_check.h"
+#include <iostream>
+
+int main() {
+    CaptureClock clock;
+    int64_t timestamp_ms = 0;
+
+    // The first frame pins the offset; later frames keep the capture spacing
+    TEST_CHECK(clock.map(5000000, 1700000000000, &timestamp_ms));
+    TEST_CHECK(timestamp_ms == 1700000000000);
+    TEST_CHECK(clock.map(5033333, 1700000000100, &timestamp_ms));
+    TEST_CHECK(timestamp_ms == 1700000000033);
+    TEST_CHECK(clock.map(5066666, 1700000000101, &timestamp_ms));
+    TEST_CHECK(timestamp_ms == 1700000000066);
+    std::cout << "Capture spacing kept\n";
+
+    // Duplicated and reordered captures are dropped
+    TEST_CHECK(!clock.map(5066666, 1700000000200, &timestamp_ms));
+    TEST_CHECK(!clock.map(5050000, 1700000000200, &timestamp_ms));
+    TEST_CHECK(clock.dropped() == 2);
+    TEST_CHECK(timestamp_ms == 1700000000066);
+
+    // Two captures within the same millisecond map to the same timestamp;
+    // the landmarker nudges the second one and the caller counts it
+    TEST_CHECK(clock.map(5066900, 1700000000201, &timestamp_ms));
+    TEST_CHECK(timestamp_ms == 1700000000066);
+    clock.count_nudge();
+    TEST_CHECK(clock.nudged() == 1);
+    std::cout << "Dropped: " << clock.dropped() << ", nudged: " << clock.nudged() << "\n";
+
+    // Each connection has its own offset
+    CaptureClock other;
+    TEST_CHECK(other.map(42, 1700000000300, &timestamp_ms));
+    TEST_CHECK(timestamp_ms == 1700000000300);
+    TEST_CHECK(other.dropped() == 0);
+
+    std::cout << "Test completed.\n";
+    return 0;
+}
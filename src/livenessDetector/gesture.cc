@@ -1,6 +1,6 @@
 #include "gesture.h"
+#include "logger.h"
 #include <chrono>
-#include <iostream>
 
 Gesture::Gesture(std::string gestureId,
                  std::string label,
@@ -20,7 +20,11 @@ Gesture::Gesture(std::string gestureId,
       current_index_(0),
       start_time_(std::chrono::system_clock::now()) {}
 
-bool Gesture::update(double value, std::optional<int> index, std::optional<std::string> signal_key) {
+bool Gesture::update(double value,
+                     std::optional<int> index,
+                     std::optional<std::string> signal_key,
+                     const SignalWindowStats* window_stats,
+                     const SignalTable* signal_table) {
     if (working_) {
         //std::cout << "Gesture update! value: " << value;
         //// Print index if it has a value
@@ -38,8 +42,9 @@ bool Gesture::update(double value, std::optional<int> index, std::optional<std::
         //std::cout << std::endl;
         
         if ((index.has_value() && signal_index_.has_value() && (*index == *signal_index_)) ||
-            (signal_key.has_value() && signal_key_.has_value() && (*signal_key == *signal_key_))) {
-            if (check_(value)) {
+            (signal_key.has_value() && signal_key_.has_value() && (*signal_key == *signal_key_)) ||
+            (signal_table && !signal_index_.has_value() && !signal_key_.has_value())) {
+            if (check_(value, window_stats, signal_table)) {
                 if (current_index_ == 0) {
                     start_time_ = std::chrono::system_clock::now();
                 }
@@ -48,7 +53,7 @@ bool Gesture::update(double value, std::optional<int> index, std::optional<std::
                     return true;
                 }
             } else {
-                if (check_reset_(value)) {
+                if (check_reset_(value, window_stats, signal_table)) {
                     reset();
                 }
             }
@@ -112,7 +117,60 @@ void Gesture::start() {
     working_ = true;
 }
 
-bool Gesture::check_(double value) const {
+namespace {
+
+bool is_windowed(Gesture::Step::MoveType type) {
+    return type != Gesture::Step::MoveType::Higher && type != Gesture::Step::MoveType::Lower &&
+           type != Gesture::Step::MoveType::Expression;
+}
+
+bool is_windowed(Gesture::Step::ResetCondition::Type type) {
+    return type == Gesture::Step::ResetCondition::Type::VelocityHigher ||
+           type == Gesture::Step::ResetCondition::Type::VelocityLower;
+}
+
+} // end anonymous namespace
+
+bool Gesture::uses_windows() const {
+    for (const auto& step : sequence_) {
+        if (is_windowed(step.move_to_next_type) || (step.reset && is_windowed(step.reset->type))) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool Gesture::bind_windows(SignalWindowStats& window_stats) {
+    if (!uses_windows()) {
+        return true;
+    }
+    if (!signal_key_) {
+        LOG_ERROR("Gesture {}: windowed steps need a signal_key", gestureId_);
+        return false;
+    }
+    for (auto& step : sequence_) {
+        if (is_windowed(step.move_to_next_type)) {
+            step.window_slot = window_stats.require(*signal_key_, step.window_ms);
+        }
+        if (step.reset && is_windowed(step.reset->type)) {
+            step.reset->window_slot = window_stats.require(*signal_key_, step.reset->window_ms);
+        }
+    }
+    return true;
+}
+
+void Gesture::bind_signals(SignalTable& signal_table) {
+    for (auto& step : sequence_) {
+        if (step.predicate) {
+            step.signal_slots = step.predicate->bind(signal_table);
+        }
+        if (step.reset && step.reset->predicate) {
+            step.reset->signal_slots = step.reset->predicate->bind(signal_table);
+        }
+    }
+}
+
+bool Gesture::check_(double value, const SignalWindowStats* window_stats, const SignalTable* signal_table) const {
     if (current_index_ >= sequence_.size()) {
         return false;
     }
@@ -127,12 +185,34 @@ bool Gesture::check_(double value) const {
         case Step::MoveType::Lower:
             //std::cout << "Lower, value: " << value << " , current_step value:" << current_step.value << std::endl;
             return value < current_step.value;
+        case Step::MoveType::Expression:
+            return signal_table && current_step.predicate &&
+                   current_step.predicate->evaluate(*signal_table, current_step.signal_slots);
+        default:
+            break;
+    }
+
+    if (!window_stats || current_step.window_slot < 0) {
+        return false;
+    }
+    const SignalWindowStats::Window& window = window_stats->window(current_step.window_slot);
+    switch (current_step.move_to_next_type) {
+        case Step::MoveType::HoldHigher:
+            return window_stats->full(current_step.window_slot) && window.min > current_step.value;
+        case Step::MoveType::HoldLower:
+            return window_stats->full(current_step.window_slot) && window.max < current_step.value;
+        case Step::MoveType::VelocityHigher:
+            return window.coverage_ms > 0.0 && window.velocity > current_step.value;
+        case Step::MoveType::VelocityLower:
+            return window.coverage_ms > 0.0 && window.velocity < current_step.value;
+        case Step::MoveType::RangeHigher:
+            return window.max - window.min > current_step.value;
         default:
             return false;
     }
 }
 
-bool Gesture::check_reset_(double value) const {
+bool Gesture::check_reset_(double value, const SignalWindowStats* window_stats, const SignalTable* signal_table) const {
     if (current_index_ >= sequence_.size()) {
         return false;
     }
@@ -154,6 +234,16 @@ bool Gesture::check_reset_(double value) const {
             duration<double, std::milli> elapsed = now - start_time_;
             return elapsed.count() > reset.value;
         }
+        case Step::ResetCondition::Type::VelocityHigher:
+            return window_stats && reset.window_slot >= 0 &&
+                   window_stats->window(reset.window_slot).coverage_ms > 0.0 &&
+                   window_stats->window(reset.window_slot).velocity > reset.value;
+        case Step::ResetCondition::Type::VelocityLower:
+            return window_stats && reset.window_slot >= 0 &&
+                   window_stats->window(reset.window_slot).coverage_ms > 0.0 &&
+                   window_stats->window(reset.window_slot).velocity < reset.value;
+        case Step::ResetCondition::Type::Expression:
+            return signal_table && reset.predicate && reset.predicate->evaluate(*signal_table, reset.signal_slots);
         default:
             return false;
     }
@@ -4,20 +4,36 @@
 #include <optional>
 #include <string>
 #include <chrono>
+#include <memory>
+#include "gesture_predicate.h"
+#include "signal_window_stats.h"
 
 class Gesture {
 public:
     struct Step {
-        enum class MoveType { Higher, Lower };
-        MoveType move_to_next_type;
-        double value;
+        // Hold*, Velocity* and RangeHigher look at the last window_ms of the signal:
+        // HoldHigher/HoldLower need every sample in the window above/below value,
+        // Velocity* compare the change per second across the window, RangeHigher
+        // needs max - min over the window above value. Expression evaluates
+        // predicate over any signals of the frame and ignores value.
+        enum class MoveType { Higher, Lower, HoldHigher, HoldLower, VelocityHigher, VelocityLower, RangeHigher, Expression };
+        MoveType move_to_next_type = MoveType::Higher;
+        double value = 0.0;
 
         struct ResetCondition {
-            enum class Type { Lower, Higher, TimeoutAfterMs };
-            Type type;
-            double value;
+            enum class Type { Lower, Higher, TimeoutAfterMs, VelocityHigher, VelocityLower, Expression };
+            Type type = Type::Lower;
+            double value = 0.0;
+            double window_ms = 0.0;
+            int window_slot = -1;
+            std::shared_ptr<const GesturePredicate> predicate{};
+            std::vector<int> signal_slots{};
         };
         std::optional<ResetCondition> reset;
+        double window_ms = 0.0;
+        int window_slot = -1; // SignalWindowStats slot, assigned by bind_windows
+        std::shared_ptr<const GesturePredicate> predicate{}; // shared by every copy of the gesture
+        std::vector<int> signal_slots{}; // SignalTable slots of predicate->signals(), assigned by bind_signals
     };
 
     Gesture(std::string gestureId,
@@ -28,7 +44,18 @@ public:
             std::optional<int> signal_index = std::nullopt,
             std::optional<std::string> signal_key = std::nullopt);
 
-    bool update(double value, std::optional<int> index = std::nullopt, std::optional<std::string> signal_key = std::nullopt);
+    bool update(double value,
+                std::optional<int> index = std::nullopt,
+                std::optional<std::string> signal_key = std::nullopt,
+                const SignalWindowStats* window_stats = nullptr,
+                const SignalTable* signal_table = nullptr);
+    // Registers the windows used by this gesture's steps and stores their slots.
+    // Returns false if a windowed step cannot be bound (it needs a signal_key).
+    bool bind_windows(SignalWindowStats& window_stats);
+    bool uses_windows() const;
+    // Registers the signals read by expression steps in signal_table. A gesture
+    // without signal_key or signal_index is then updated on every frame.
+    void bind_signals(SignalTable& signal_table);
     void stop();
     void reset();
     std::string get_label() const;
@@ -55,6 +82,6 @@ private:
     size_t current_index_;
     std::chrono::system_clock::time_point start_time_;
 
-    bool check_(double value) const;
-    bool check_reset_(double value) const;
+    bool check_(double value, const SignalWindowStats* window_stats, const SignalTable* signal_table) const;
+    bool check_reset_(double value, const SignalWindowStats* window_stats, const SignalTable* signal_table) const;
 };
\ No newline at end of file
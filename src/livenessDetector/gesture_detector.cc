@@ -1,33 +1,65 @@
 #include "gesture_detector.h"
+#include "logger.h"
+#include <algorithm>
+#include <chrono>
 #include <fstream>
 #include <filesystem>
-#include <iostream>
 
 using json = nlohmann::json;
 namespace fs = std::filesystem;
 
 GestureDetector::GestureDetector() {
-    std::cout << "GestureDetector created.\n";
+    LOG_DEBUG("GestureDetector created.");
 }
 
 GestureDetector::~GestureDetector() {
-    std::cout << "GestureDetector destroyed.\n";
+    LOG_DEBUG("GestureDetector destroyed.");
     cleanup();
 }
 
 void GestureDetector::cleanup() {
+    // Commands queued for the old gestures would otherwise apply to the ones
+    // added next at the same indexes.
+    Command command;
+    while (commands_.pop(command)) {}
     gestures_.clear();
+    label_index_.clear();
+    id_index_.clear();
+    active_.clear();
+    window_stats_ = SignalWindowStats();
+    signal_table_ = SignalTable();
+    by_signal_key_.clear();
+    by_signal_index_.clear();
+    by_frame_.clear();
+    table_recorder_ids_.clear();
+    subscriptions_dirty_ = true;
 }
 
 void GestureDetector::add_gesture(std::unique_ptr<Gesture> gesture) {
+    push_gesture(std::move(gesture));
+}
+
+bool GestureDetector::push_gesture(std::unique_ptr<Gesture> gesture) {
+    if (!gesture->bind_windows(window_stats_)) {
+        return false;
+    }
+    gesture->bind_signals(signal_table_);
+    // The first gesture added under a label or id wins, as the old linear scans did.
+    label_index_.emplace(gesture->get_label(), gestures_.size());
+    id_index_.emplace(gesture->get_gesture_id(), gestures_.size());
+    if (gesture->get_working()) {
+        active_.push_back(gestures_.size());
+        subscriptions_dirty_ = true;
+    }
     gestures_.push_back(std::move(gesture));
+    return true;
 }
 
 GestureDetector::AddResult GestureDetector::add_gesture_from_file(const std::string& file_path) {
     AddResult result{false, "", "", "", 0.0, false};
     
     if (!fs::exists(file_path)) {
-        std::cerr << "File does not exist: " << file_path << "\n";
+        LOG_ERROR("File does not exist: {}", file_path);
         return result;
     }
 
@@ -39,7 +71,7 @@ GestureDetector::AddResult GestureDetector::add_gesture_from_file(const std::str
         if (!gesture_data.contains("gestureId") || 
             !gesture_data.contains("label") ||
             !gesture_data.contains("instructions")) {
-            std::cerr << "Invalid gesture data: missing required fields.\n";
+            LOG_ERROR("Invalid gesture data: missing required fields.");
             return result;
         }
 
@@ -53,16 +85,23 @@ GestureDetector::AddResult GestureDetector::add_gesture_from_file(const std::str
             signal_key = gesture_data["signal_key"].get<std::string>();
         }
 
+        // A gesture missing one of its steps would pass with less work than it asks for.
+        std::vector<Gesture::Step> steps;
+        if (!parse_instructions(gesture_data["instructions"], &steps)) {
+            LOG_ERROR("Invalid instructions in gesture file: {}", file_path);
+            return result;
+        }
+
         auto gesture = std::make_unique<Gesture>(
             gesture_data["gestureId"].get<std::string>(),
             gesture_data["label"].get<std::string>(),
             gesture_data["total_recommended_max_time"].get<double>(),
             gesture_data["take_picture_at_the_end"].get<bool>(),
-            parse_instructions(gesture_data["instructions"]),
+            std::move(steps),
             signal_index,
             signal_key
         );
-        std::cout << "New gesture with size: " << gesture->get_sequence().size() << std::endl;
+        LOG_DEBUG("New gesture with size: {}", gesture->get_sequence().size());
         
         result.success = true;
         result.gestureId = gesture->get_gesture_id();
@@ -74,38 +113,142 @@ GestureDetector::AddResult GestureDetector::add_gesture_from_file(const std::str
             result.icon_path = gesture_data["icon_path"].get<std::string>();
         }
 
-        gestures_.push_back(std::move(gesture));
+        result.success = push_gesture(std::move(gesture));
     }
     catch (const std::exception& e) {
-        std::cerr << "Error parsing gesture file: " << e.what() << "\n";
+        LOG_ERROR("Error parsing gesture file: {}", e.what());
     }
     
     return result;
 }
 
+GestureDetector::AddResult GestureDetector::add_gesture_from_bundle(const AssetBundle& bundle, size_t index) {
+    AddResult result{false, "", "", "", 0.0, false};
+
+    if (index >= bundle.gesture_count()) {
+        LOG_ERROR("Gesture index out of range in bundle: {}", bundle.path());
+        return result;
+    }
+
+    const AssetBundle::GestureRecord& record = bundle.gesture(index);
+    std::optional<int> signal_index;
+    std::optional<std::string> signal_key;
+    if (record.has_signal_index) {
+        signal_index = record.signal_index;
+    }
+    if (record.has_signal_key) {
+        signal_key = std::string(bundle.str(record.signal_key));
+    }
+
+    std::vector<Gesture::Step> steps;
+    try {
+        steps = bundle.gesture_steps(index);
+    } catch (const std::exception& e) {
+        LOG_ERROR("Error reading gesture from bundle: {}", e.what());
+        return result;
+    }
+
+    auto gesture = std::make_unique<Gesture>(
+        std::string(bundle.str(record.gesture_id)),
+        std::string(bundle.str(record.label)),
+        record.total_recommended_max_time,
+        record.take_picture_at_the_end != 0,
+        std::move(steps),
+        signal_index,
+        signal_key
+    );
+
+    result.gestureId = gesture->get_gesture_id();
+    result.label = gesture->get_label();
+    result.icon_path = std::string(bundle.str(record.icon_path));
+    result.total_recommended_max_time = gesture->get_total_recommended_max_time();
+    result.take_picture_at_the_end = gesture->get_take_picture_at_the_end();
+
+    result.success = push_gesture(std::move(gesture));
+    return result;
+}
+
 void GestureDetector::process_signal(double value, int signal_index) {
-    for (auto& gesture : gestures_) {
-        if (gesture->get_working()) {
-            if (gesture->update(value, signal_index)) {
-                signal_trigger(gesture.get());
+    apply_commands();
+    refresh_subscriptions();
+    auto subscribers = by_signal_index_.find(signal_index);
+    if (subscribers == by_signal_index_.end()) {
+        return;
+    }
+    uint64_t now_ns = recorder_ ? FlightRecorder::now_ns() : 0;
+    for (size_t index : subscribers->second) {
+        update_gesture(index, now_ns, value, signal_index, {}, nullptr);
+    }
+}
+
+void GestureDetector::process_signals(const std::unordered_map<std::string, double>& signals, double timestamp_ms) {
+    apply_commands();
+    if (window_stats_.size() > 0) {
+        window_stats_.update(signals, timestamp_ms);
+    }
+    if (signal_table_.size() > 0) {
+        signal_table_.load(signals);
+    }
+
+    refresh_subscriptions();
+    uint64_t now_ns = recorder_ ? FlightRecorder::now_ns() : 0;
+    // One map lookup per distinct signal key, not one per gesture.
+    for (const auto& [signal_key, subscribers] : by_signal_key_) {
+        if (subscribers.gestures.empty()) {
+            continue;
+        }
+        auto it = signals.find(signal_key);
+        if (it == signals.end()) {
+            continue;
+        }
+        if (recorder_) {
+            recorder_->record(FlightRecorder::Type::Signal, subscribers.recorder_id, 0, it->second, now_ns);
+        }
+        for (size_t index : subscribers.gestures) {
+            update_gesture(index, now_ns, it->second, {}, it->first, &signal_table_);
+        }
+    }
+    // Expression-only gestures read the signal table instead of one signal.
+    if (!by_frame_.empty() && recorder_) {
+        for (size_t slot = 0; slot < signal_table_.size(); ++slot) {
+            if (signal_table_.present(static_cast<int>(slot))) {
+                recorder_->record(FlightRecorder::Type::Signal, table_recorder_ids_[slot], 0,
+                                  signal_table_.value(static_cast<int>(slot)), now_ns);
             }
         }
     }
+    for (size_t index : by_frame_) {
+        update_gesture(index, now_ns, 0.0, {}, {}, &signal_table_);
+    }
 }
 
-void GestureDetector::process_signals(const std::unordered_map<std::string, double>& signals) {
-    for (auto& gesture : gestures_) {
-        if (gesture->get_working() && gesture->get_signal_key().has_value()) {
-            //std::cout << "Gesture: " << gesture->get_gesture_id() << ", Working: " << gesture->get_working() << ", signal key: " << gesture->get_signal_key().value() << std::endl;
-            auto it = signals.find(gesture->get_signal_key().value());
-            if (it != signals.end()) {
-                //std::cout << "Signal Found!!: " << gesture->get_signal_key().value() << std::endl;
-                if (gesture->update(it->second, {}, it->first)) {
-                    signal_trigger(gesture.get());
-                }
-            }
+void GestureDetector::update_gesture(size_t index, uint64_t now_ns, double value,
+                                     std::optional<int> signal_index,
+                                     std::optional<std::string> signal_key,
+                                     const SignalTable* signal_table) {
+    Gesture* gesture = gestures_[index].get();
+    size_t before = gesture->get_current_index();
+    bool done = gesture->update(value, signal_index, std::move(signal_key),
+                                signal_index ? nullptr : &window_stats_, signal_table);
+    if (recorder_) {
+        size_t after = gesture->get_current_index();
+        uint16_t id = static_cast<uint16_t>(index);
+        if (done) {
+            recorder_->record(FlightRecorder::Type::GestureDone, id, static_cast<uint32_t>(after), value, now_ns);
+        } else if (after > before) {
+            recorder_->record(FlightRecorder::Type::StepAdvance, id, static_cast<uint32_t>(after), value, now_ns);
+        } else if (after < before) {
+            recorder_->record(FlightRecorder::Type::StepReset, id, static_cast<uint32_t>(before), value, now_ns);
         }
     }
+    if (done) {
+        signal_trigger(gesture);
+    }
+}
+
+void GestureDetector::set_flight_recorder(FlightRecorder* recorder) {
+    recorder_ = recorder;
+    subscriptions_dirty_ = true;
 }
 
 void GestureDetector::set_signal_trigger_callback(std::function<void(const std::string&)> callback) {
@@ -113,91 +256,184 @@ void GestureDetector::set_signal_trigger_callback(std::function<void(const std::
 }
 
 bool GestureDetector::reset_all() {
-    for (auto& gesture : gestures_) {
-        gesture->reset();
-    }
+    commands_.push({Command::Action::Reset, true, 0});
     return !gestures_.empty();
 }
 
 bool GestureDetector::reset_by_index(size_t index) {
-    if (index < gestures_.size()) {
-        gestures_[index]->reset();
-        return true;
+    if (index >= gestures_.size()) {
+        return false;
     }
-    return false;
+    commands_.push({Command::Action::Reset, false, index});
+    return true;
 }
 
 bool GestureDetector::reset_by_label(const std::string& label) {
-    for (auto& gesture : gestures_) {
-        if (gesture->get_label() == label) {
-            gesture->reset();
-            return true;
-        }
-    }
-    return false;
+    auto index = find_by_label(label);
+    return index && reset_by_index(*index);
 }
 
 bool GestureDetector::start_all() {
-    for (auto& gesture : gestures_) {
-        gesture->start();
-    }
+    commands_.push({Command::Action::Start, true, 0});
     return !gestures_.empty();
 }
 
 bool GestureDetector::start_by_index(size_t index) {
-    if (index < gestures_.size()) {
-        gestures_[index]->start();
-        return true;
+    if (index >= gestures_.size()) {
+        return false;
     }
-    return false;
+    commands_.push({Command::Action::Start, false, index});
+    return true;
 }
 
 bool GestureDetector::start_by_label(const std::string& label) {
-    for (auto& gesture : gestures_) {
-        if (gesture->get_label() == label) {
-            gesture->start();
-            return true;
-        }
-    }
-    return false;
+    auto index = find_by_label(label);
+    return index && start_by_index(*index);
 }
 
 bool GestureDetector::stop_all() {
-    for (auto& gesture : gestures_) {
-        gesture->stop();
-    }
+    commands_.push({Command::Action::Stop, true, 0});
     return !gestures_.empty();
 }
 
 bool GestureDetector::stop_by_index(size_t index) {
-    if (index < gestures_.size()) {
-        gestures_[index]->stop();
-        return true;
+    if (index >= gestures_.size()) {
+        return false;
     }
-    return false;
+    commands_.push({Command::Action::Stop, false, index});
+    return true;
 }
 
 bool GestureDetector::stop_by_label(const std::string& label) {
-    for (auto& gesture : gestures_) {
-        if (gesture->get_label() == label) {
-            gesture->stop();
-            return true;
+    auto index = find_by_label(label);
+    return index && stop_by_index(*index);
+}
+
+void GestureDetector::apply_commands() {
+    Command command;
+    while (commands_.pop(command)) {
+        if (command.all && command.action == Command::Action::Stop) {
+            for (auto& gesture : gestures_) {
+                gesture->stop();
+            }
+            active_.clear();
+            subscriptions_dirty_ = true;
+        } else if (command.all) {
+            // Starting or resetting every gesture also restarts the signal history.
+            window_stats_.reset();
+            for (size_t i = 0; i < gestures_.size(); ++i) {
+                apply(command.action, i);
+            }
+        } else if (command.index < gestures_.size()) {
+            apply(command.action, command.index);
         }
     }
-    return false;
+}
+
+void GestureDetector::apply(Command::Action action, size_t index) {
+    Gesture* gesture = gestures_[index].get();
+    switch (action) {
+        case Command::Action::Reset:
+            gesture->reset();
+            break;
+        case Command::Action::Start:
+            if (!gesture->get_working()) {
+                active_.push_back(index);
+                subscriptions_dirty_ = true;
+            }
+            gesture->start();
+            break;
+        case Command::Action::Stop:
+            if (gesture->get_working()) {
+                auto it = std::find(active_.begin(), active_.end(), index);
+                if (it != active_.end()) {
+                    *it = active_.back();
+                    active_.pop_back();
+                    subscriptions_dirty_ = true;
+                }
+            }
+            gesture->stop();
+            break;
+    }
 }
 
 const std::vector<std::unique_ptr<Gesture>>& GestureDetector::get_gestures() const {
     return gestures_;
 }
 
+bool GestureDetector::collect_signals(std::set<std::string>& names) const {
+    bool named = true;
+    for (const auto& gesture : gestures_) {
+        if (auto key = gesture->get_signal_key()) {
+            names.insert(*key);
+        } else if (gesture->get_signal_index()) {
+            named = false;
+        }
+        for (const auto& step : gesture->get_sequence()) {
+            if (step.predicate) {
+                names.insert(step.predicate->signals().begin(), step.predicate->signals().end());
+            }
+            if (step.reset && step.reset->predicate) {
+                names.insert(step.reset->predicate->signals().begin(), step.reset->predicate->signals().end());
+            }
+        }
+    }
+    return named;
+}
+
 Gesture* GestureDetector::get_gesture_by_label(const std::string& label) const {
-    for (auto& gesture : gestures_) {
-        if (gesture->get_label() == label) {
-            return gesture.get();
+    auto index = find_by_label(label);
+    return index ? gestures_[*index].get() : nullptr;
+}
+
+Gesture* GestureDetector::get_gesture_by_id(const std::string& gesture_id) const {
+    auto it = id_index_.find(gesture_id);
+    return it != id_index_.end() ? gestures_[it->second].get() : nullptr;
+}
+
+std::optional<size_t> GestureDetector::find_by_label(const std::string& label) const {
+    auto it = label_index_.find(label);
+    if (it == label_index_.end()) {
+        return std::nullopt;
+    }
+    return it->second;
+}
+
+void GestureDetector::refresh_subscriptions() {
+    if (!subscriptions_dirty_) {
+        return;
+    }
+    subscriptions_dirty_ = false;
+
+    // Keep the order gestures were added in, so triggers fire in a stable order.
+    std::sort(active_.begin(), active_.end());
+    for (auto& [key, subscribers] : by_signal_key_) subscribers.gestures.clear();
+    for (auto& [index, subscribers] : by_signal_index_) subscribers.clear();
+    by_frame_.clear();
+
+    for (size_t index : active_) {
+        const Gesture& gesture = *gestures_[index];
+        const auto& signal_key = gesture.get_signal_key();
+        const auto& signal_index = gesture.get_signal_index();
+        if (signal_key) {
+            by_signal_key_[*signal_key].gestures.push_back(index);
+        } else if (signal_index) {
+            by_signal_index_[*signal_index].push_back(index);
+        } else if (signal_table_.size() > 0) {
+            by_frame_.push_back(index);
+        }
+    }
+
+    // Recorder ids take a lock, so they are looked up here rather than per frame.
+    if (recorder_) {
+        for (auto& [key, subscribers] : by_signal_key_) {
+            subscribers.recorder_id = recorder_->signal_id(key);
+        }
+        table_recorder_ids_.resize(signal_table_.size());
+        for (size_t slot = 0; slot < signal_table_.size(); ++slot) {
+            table_recorder_ids_[slot] = recorder_->signal_id(signal_table_.name(static_cast<int>(slot)));
         }
     }
-    return nullptr;
 }
 
 void GestureDetector::signal_trigger(Gesture* gesture) {
@@ -206,14 +442,45 @@ void GestureDetector::signal_trigger(Gesture* gesture) {
     }
 }
 
-std::vector<Gesture::Step> GestureDetector::parse_instructions(const nlohmann::json& instructions) {
-    std::vector<Gesture::Step> steps;
-
+bool GestureDetector::parse_instructions(const nlohmann::json& instructions, std::vector<Gesture::Step>* steps) {
+    steps->clear();
     for (const auto& item : instructions) {
-        Gesture::Step::MoveType move_type = (item["move_to_next_type"] == "higher") ? 
-            Gesture::Step::MoveType::Higher : Gesture::Step::MoveType::Lower;
+        static const std::unordered_map<std::string, Gesture::Step::MoveType> move_types = {
+            {"higher", Gesture::Step::MoveType::Higher},
+            {"lower", Gesture::Step::MoveType::Lower},
+            {"hold_higher", Gesture::Step::MoveType::HoldHigher},
+            {"hold_lower", Gesture::Step::MoveType::HoldLower},
+            {"velocity_higher", Gesture::Step::MoveType::VelocityHigher},
+            {"velocity_lower", Gesture::Step::MoveType::VelocityLower},
+            {"range_higher", Gesture::Step::MoveType::RangeHigher},
+            {"expression", Gesture::Step::MoveType::Expression},
+        };
+        auto move_it = move_types.find(item["move_to_next_type"].get<std::string>());
+        if (move_it == move_types.end()) {
+            LOG_ERROR("Unknown move_to_next_type: {}", item["move_to_next_type"].dump());
+            return false;
+        }
+        Gesture::Step::MoveType move_type = move_it->second;
+
+        std::shared_ptr<const GesturePredicate> predicate;
+        if (move_type == Gesture::Step::MoveType::Expression) {
+            std::string error;
+            predicate = GesturePredicate::compile(item.value("expression", std::string()), &error);
+            if (!predicate) {
+                LOG_ERROR("Invalid step expression: {}", error);
+                return false;
+            }
+        }
 
-        double value = item["value"];
+        double value = move_type == Gesture::Step::MoveType::Expression ? item.value("value", 0.0) : item["value"].get<double>();
+        double window_ms = item.value("window_ms", 0.0);
+        bool windowed = move_type != Gesture::Step::MoveType::Higher &&
+                        move_type != Gesture::Step::MoveType::Lower &&
+                        move_type != Gesture::Step::MoveType::Expression;
+        if (windowed && window_ms <= 0.0) {
+            LOG_ERROR("Step {} needs a positive window_ms.", item["move_to_next_type"].dump());
+            return false;
+        }
 
         std::optional<Gesture::Step::ResetCondition> reset_condition = std::nullopt;
 
@@ -227,17 +494,40 @@ std::vector<Gesture::Step> GestureDetector::parse_instructions(const nlohmann::j
                 reset_type = Gesture::Step::ResetCondition::Type::Higher;
             } else if (reset_data["type"] == "timeout_after_ms") {
                 reset_type = Gesture::Step::ResetCondition::Type::TimeoutAfterMs;
+            } else if (reset_data["type"] == "velocity_higher") {
+                reset_type = Gesture::Step::ResetCondition::Type::VelocityHigher;
+            } else if (reset_data["type"] == "velocity_lower") {
+                reset_type = Gesture::Step::ResetCondition::Type::VelocityLower;
+            } else if (reset_data["type"] == "expression") {
+                reset_type = Gesture::Step::ResetCondition::Type::Expression;
             } else {
-                std::cerr << "Unknown reset condition type.\n";
-                continue;
+                LOG_ERROR("Unknown reset condition type.");
+                return false;
             }
 
-            double reset_value = reset_data["value"];
-            reset_condition = Gesture::Step::ResetCondition{ reset_type, reset_value };
+            std::shared_ptr<const GesturePredicate> reset_predicate;
+            if (reset_type == Gesture::Step::ResetCondition::Type::Expression) {
+                std::string error;
+                reset_predicate = GesturePredicate::compile(reset_data.value("expression", std::string()), &error);
+                if (!reset_predicate) {
+                    LOG_ERROR("Invalid reset expression: {}", error);
+                    return false;
+                }
+            }
+
+            double reset_value = reset_type == Gesture::Step::ResetCondition::Type::Expression
+                ? reset_data.value("value", 0.0) : reset_data["value"].get<double>();
+            double reset_window_ms = reset_data.value("window_ms", 0.0);
+            if ((reset_type == Gesture::Step::ResetCondition::Type::VelocityHigher ||
+                 reset_type == Gesture::Step::ResetCondition::Type::VelocityLower) && reset_window_ms <= 0.0) {
+                LOG_ERROR("Velocity reset condition needs a positive window_ms.");
+                return false;
+            }
+            reset_condition = Gesture::Step::ResetCondition{ reset_type, reset_value, reset_window_ms, -1, reset_predicate };
         }
 
-        steps.push_back(Gesture::Step{ move_type, value, reset_condition });
+        steps->push_back(Gesture::Step{ move_type, value, reset_condition, window_ms, -1, predicate });
     }
 
-    return steps;
+    return true;
 }
\ No newline at end of file
@@ -1,7 +1,12 @@
 #pragma once
 
 #include "gesture.h"
+#include "asset_bundle.h"
+#include "signal_window_stats.h"
+#include "mpsc_queue.h"
+#include "flight_recorder.h"
 #include <vector>
+#include <set>
 #include <string>
 #include <functional>
 #include <optional>
@@ -24,15 +29,28 @@ public:
     GestureDetector();
     ~GestureDetector();
 
+    // Removes every gesture with its queued commands, windows and signal
+    // slots. Call from the thread that ticks, like process_signal(s).
     void cleanup();
     void add_gesture(std::unique_ptr<Gesture> gesture);
     AddResult add_gesture_from_file(const std::string& file_path);
+    AddResult add_gesture_from_bundle(const AssetBundle& bundle, size_t index);
     
     void process_signal(double value, int signal_index);
-    void process_signals(const std::unordered_map<std::string, double>& signals);
+    // timestamp_ms is the frame's time on a monotonic clock, which windowed
+    // steps measure their windows against.
+    void process_signals(const std::unordered_map<std::string, double>& signals, double timestamp_ms);
     
     void set_signal_trigger_callback(std::function<void(const std::string&)> callback);
     
+    // Start, stop and reset may be called from any thread, including from the
+    // trigger callback. They only queue a command, which the next
+    // process_signal(s) call applies before looking at the signals, so the
+    // gesture lists are never changed while a tick walks them. Queuing takes no
+    // lock but allocates a node; it does not make the detector's other methods
+    // thread safe, and callers sharing it with other state (LivenessSession
+    // and its requester) still serialize on their own lock. The return value
+    // says whether the gesture exists, not whether it changed state.
     bool reset_all();
     bool reset_by_index(size_t index);
     bool reset_by_label(const std::string& label);
@@ -47,11 +65,64 @@ public:
     
     const std::vector<std::unique_ptr<Gesture>>& get_gestures() const;
     Gesture* get_gesture_by_label(const std::string& label) const;
+    Gesture* get_gesture_by_id(const std::string& gesture_id) const;
+    // Adds the names of the signals the gestures read (signal_key and the
+    // signals of expression steps). Returns false when a gesture reads a
+    // signal by signal_index, which has no name.
+    bool collect_signals(std::set<std::string>& names) const;
+
+    // Records the signals active gestures read and their step transitions
+    // (ids are indexes in get_gestures()). recorder must outlive the detector
+    // or be unset; set it before the first tick.
+    void set_flight_recorder(FlightRecorder* recorder);
 
 private:
     std::vector<std::unique_ptr<Gesture>> gestures_;
     std::function<void(const std::string&)> signal_trigger_callback_;
+    // Windows shared by every gesture step that needs signal history.
+    SignalWindowStats window_stats_;
+    // Signals read by expression steps, refreshed once per frame.
+    SignalTable signal_table_;
+
+    struct Command {
+        enum class Action { Start, Stop, Reset };
+        Action action = Action::Start;
+        bool all = false;
+        size_t index = 0;
+    };
+    MpscQueue<Command> commands_;
+
+    // Gestures are only started and stopped through commands, which keeps
+    // these indexes in step with Gesture::get_working(). The label and id
+    // indexes are written only while gestures are added, before any ticks.
+    std::unordered_map<std::string, size_t> label_index_;
+    std::unordered_map<std::string, size_t> id_index_;
+    std::vector<size_t> active_; // indexes of working gestures
+    // Working gestures by the signal they read, rebuilt from active_ on the
+    // first frame after a start or stop. A trigger callback that starts or
+    // stops gestures therefore only marks them dirty mid-frame.
+    struct KeySubscribers {
+        std::vector<size_t> gestures;
+        uint16_t recorder_id = 0;
+    };
+    std::unordered_map<std::string, KeySubscribers> by_signal_key_;
+    std::unordered_map<int, std::vector<size_t>> by_signal_index_;
+    std::vector<size_t> by_frame_; // expression-only gestures
+    bool subscriptions_dirty_ = true;
+
+    FlightRecorder* recorder_ = nullptr;
+    std::vector<uint16_t> table_recorder_ids_; // recorder signal id per signal_table_ slot
     
     void signal_trigger(Gesture* gesture);
-    std::vector<Gesture::Step> static parse_instructions(const nlohmann::json& instructions);
+    bool push_gesture(std::unique_ptr<Gesture> gesture);
+    std::optional<size_t> find_by_label(const std::string& label) const;
+    void refresh_subscriptions();
+    void apply_commands();
+    void apply(Command::Action action, size_t index);
+    void update_gesture(size_t index, uint64_t now_ns, double value,
+                        std::optional<int> signal_index,
+                        std::optional<std::string> signal_key,
+                        const SignalTable* signal_table);
+    // Returns false when a step is invalid: the gesture is then refused rather than loaded short of a step.
+    static bool parse_instructions(const nlohmann::json& instructions, std::vector<Gesture::Step>* steps);
 };
\ No newline at end of file
@@ -1,7 +1,9 @@
 #include "gesture_detector.h"
+#include "test_check.h"
 #include <iostream>
 #include <thread>
 #include <chrono>
+#include <fstream>
 
 // Callback function for when a gesture is detected
 void on_gesture_detected(const std::string& label) {
@@ -61,6 +63,108 @@ int main() {
     std::this_thread::sleep_for(std::chrono::seconds(6)); // Wait for timeout
     detector.process_signal(11, 1); // Should reset due to timeout
 
+    // Large library: only the started gesture is visited per frame
+    GestureDetector library;
+    int triggered = 0;
+    library.set_signal_trigger_callback([&](const std::string& label) {
+        ++triggered;
+        library.stop_by_label(label);
+    });
+    for (int i = 0; i < 1000; ++i) {
+        std::vector<Gesture::Step> steps = {{Gesture::Step::MoveType::Higher, 0.5, std::nullopt}};
+        library.add_gesture(std::make_unique<Gesture>("id" + std::to_string(i), "label" + std::to_string(i), 10.0, false,
+                                                      steps, std::nullopt, std::string("signal" + std::to_string(i % 50))));
+    }
+    TEST_CHECK(library.get_gesture_by_id("id999") == library.get_gesture_by_label("label999"));
+    TEST_CHECK(library.get_gesture_by_label("missing") == nullptr);
+    TEST_CHECK(library.start_by_label("label7"));
+
+    std::unordered_map<std::string, double> frame;
+    for (int i = 0; i < 50; ++i) frame["signal" + std::to_string(i)] = 0.1;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < 10000; ++i) library.process_signals(frame, i * 33.0);
+    std::chrono::duration<double, std::micro> elapsed = std::chrono::steady_clock::now() - start;
+    std::cout << "1000 gestures, 1 active: " << elapsed.count() / 10000 << " us per frame\n";
+
+    frame["signal7"] = 0.9;
+    library.process_signals(frame, 330000.0);
+    library.process_signals(frame, 330033.0); // stopped by the callback, must not trigger again
+    std::cout << "Library gesture triggered " << triggered << " time(s)\n";
+    TEST_CHECK(triggered == 1);
+
+    // The signals the gestures read, by name
+    std::set<std::string> names;
+    TEST_CHECK(library.collect_signals(names));
+    TEST_CHECK(names.size() == 50 && names.count("signal49") == 1);
+    GestureDetector indexed;
+    indexed.add_gesture(std::make_unique<Gesture>("byIndex", "byIndex", 10.0, false,
+                                                  std::vector<Gesture::Step>{{Gesture::Step::MoveType::Higher, 0.5, std::nullopt}}, 2));
+    TEST_CHECK(!indexed.collect_signals(names));
+
+    // Start and stop are queued: they take effect on the next tick, before its signals are read
+    GestureDetector queued;
+    int queued_triggers = 0;
+    queued.set_signal_trigger_callback([&](const std::string&) { ++queued_triggers; });
+    queued.add_gesture(std::make_unique<Gesture>("q", "q", 10.0, false,
+                                                 std::vector<Gesture::Step>{{Gesture::Step::MoveType::Higher, 0.5, std::nullopt}},
+                                                 std::nullopt, std::string("s")));
+    Gesture* queued_gesture = queued.get_gesture_by_id("q");
+    TEST_CHECK(queued.start_by_label("q"));
+    TEST_CHECK(!queued_gesture->get_working());
+    queued.process_signals({{"s", 0.9}}, 0.0);
+    TEST_CHECK(queued_gesture->get_working() && queued_triggers == 1);
+    TEST_CHECK(queued.stop_by_label("q"));
+    TEST_CHECK(queued_gesture->get_working());
+    queued.process_signals({{"s", 0.9}}, 33.0);
+    TEST_CHECK(!queued_gesture->get_working() && queued_triggers == 1);
+    TEST_CHECK(!queued.start_by_label("missing"));
+    std::cout << "Start and stop apply on the next tick\n";
+
+    // Commands queued before cleanup() do not reach the gestures added after it
+    GestureDetector reused;
+    auto one_step = std::vector<Gesture::Step>{{Gesture::Step::MoveType::Higher, 0.5, std::nullopt}};
+    reused.add_gesture(std::make_unique<Gesture>("old", "old", 10.0, false, one_step, std::nullopt, std::string("s")));
+    TEST_CHECK(reused.start_by_index(0));
+    reused.cleanup();
+    reused.add_gesture(std::make_unique<Gesture>("new", "new", 10.0, false, one_step, std::nullopt, std::string("s")));
+    reused.process_signals({{"s", 0.1}}, 0.0);
+    TEST_CHECK(!reused.get_gesture_by_id("new")->get_working());
+    std::cout << "Cleanup drops queued commands\n";
+
+    // Expression steps need no window_ms; a windowed step without one refuses the whole gesture
+    auto load = [](const std::string& path, const std::string& instructions) {
+        std::ofstream(path) << R"({"gestureId":"g","label":"g","total_recommended_max_time":10,"take_picture_at_the_end":false,"instructions":)"
+                            << instructions << "}";
+        GestureDetector detector;
+        auto result = detector.add_gesture_from_file(path);
+        size_t steps = result.success ? detector.get_gesture_by_id("g")->get_sequence().size() : 0;
+        return std::make_pair(result.success, steps);
+    };
+    auto loaded = load("expression_gesture.json", R"([{"move_to_next_type":"expression","expression":"a > 0.5 && b > 0.5"},
+        {"move_to_next_type":"higher","value":0.5,"reset":{"type":"expression","expression":"a < 0.1"}}])");
+    TEST_CHECK(loaded.first && loaded.second == 2);
+    loaded = load("short_gesture.json", R"([{"move_to_next_type":"higher","value":0.5},{"move_to_next_type":"hold_higher","value":0.5}])");
+    TEST_CHECK(!loaded.first);
+    loaded = load("bad_reset_gesture.json", R"([{"move_to_next_type":"higher","value":0.5,"reset":{"type":"sideways","value":1}}])");
+    TEST_CHECK(!loaded.first);
+    std::cout << "Gestures with an invalid step refused\n";
+
+    // Windows are measured on the frame timestamps, not on the wall clock
+    std::ofstream("hold_gesture.json") << R"({"gestureId":"hold","label":"hold","total_recommended_max_time":10,"take_picture_at_the_end":false,"signal_key":"eyeBlinkLeft",
+        "instructions":[{"move_to_next_type":"hold_higher","value":0.5,"window_ms":200}]})";
+    GestureDetector held;
+    int held_triggers = 0;
+    held.set_signal_trigger_callback([&](const std::string&) { ++held_triggers; });
+    TEST_CHECK(held.add_gesture_from_file("hold_gesture.json").success);
+    held.start_all();
+    for (double timestamp_ms : {0.0, 100.0, 150.0}) {
+        held.process_signals({{"eyeBlinkLeft", 0.9}}, timestamp_ms);
+    }
+    TEST_CHECK(held_triggers == 0);
+    held.process_signals({{"eyeBlinkLeft", 0.9}}, 200.0);
+    TEST_CHECK(held_triggers == 1);
+    std::cout << "Hold completed after 200 ms of frame time\n";
+
     std::cout << "Test completed.\n";
     return 0;
 }
\ No newline at end of file
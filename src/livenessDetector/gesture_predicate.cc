@@ -0,0 +1,271 @@
+#include "gesture_predicate.h"
+#include <cctype>
+#include <cmath>
+#include <cstdlib>
+#include <stdexcept>
+
+int SignalTable::slot(const std::string& name) {
+    for (size_t i = 0; i < names_.size(); ++i) {
+        if (names_[i] == name) {
+            return static_cast<int>(i);
+        }
+    }
+    names_.push_back(name);
+    values_.push_back(0.0);
+    present_.push_back(0);
+    return static_cast<int>(names_.size() - 1);
+}
+
+void SignalTable::load(const std::unordered_map<std::string, double>& signals) {
+    for (size_t i = 0; i < names_.size(); ++i) {
+        auto it = signals.find(names_[i]);
+        present_[i] = it != signals.end();
+        if (present_[i]) {
+            values_[i] = it->second;
+        }
+    }
+}
+
+// Recursive descent parser that emits bytecode as it goes. Every parse_*
+// method leaves its result in register reg and may use the registers above it,
+// so register allocation is just the nesting depth of the expression.
+class PredicateCompiler {
+public:
+    PredicateCompiler(const std::string& source, GesturePredicate& out) : src_(source), out_(out) {}
+
+    void compile() {
+        parse_or(0);
+        skip_space();
+        if (pos_ != src_.size()) {
+            fail("unexpected '" + src_.substr(pos_, 1) + "'");
+        }
+    }
+
+private:
+    using Op = GesturePredicate::Op;
+
+    const std::string& src_;
+    GesturePredicate& out_;
+    size_t pos_ = 0;
+
+    [[noreturn]] void fail(const std::string& message) const {
+        throw std::invalid_argument(message + " at position " + std::to_string(pos_));
+    }
+
+    void skip_space() {
+        while (pos_ < src_.size() && std::isspace(static_cast<unsigned char>(src_[pos_]))) ++pos_;
+    }
+
+    bool accept(const char* token) {
+        skip_space();
+        size_t n = std::char_traits<char>::length(token);
+        if (src_.compare(pos_, n, token) == 0) {
+            pos_ += n;
+            return true;
+        }
+        return false;
+    }
+
+    void expect(const char* token) {
+        if (!accept(token)) fail(std::string("expected '") + token + "'");
+    }
+
+    void emit(Op op, int dst, int a = 0, int b = 0, uint32_t operand = 0) {
+        if (dst >= GesturePredicate::kMaxRegisters || b >= GesturePredicate::kMaxRegisters) {
+            fail("expression nested too deeply");
+        }
+        out_.code_.push_back({op, static_cast<uint8_t>(dst), static_cast<uint8_t>(a), static_cast<uint8_t>(b), operand});
+    }
+
+    void parse_or(int reg) {
+        parse_and(reg);
+        while (accept("||")) {
+            parse_and(reg + 1);
+            emit(Op::Or, reg, reg, reg + 1);
+        }
+    }
+
+    void parse_and(int reg) {
+        parse_not(reg);
+        while (accept("&&")) {
+            parse_not(reg + 1);
+            emit(Op::And, reg, reg, reg + 1);
+        }
+    }
+
+    void parse_not(int reg) {
+        skip_space();
+        if (pos_ < src_.size() && src_[pos_] == '!' && src_.compare(pos_, 2, "!=") != 0) {
+            ++pos_;
+            parse_not(reg);
+            emit(Op::Not, reg, reg);
+            return;
+        }
+        parse_comparison(reg);
+    }
+
+    void parse_comparison(int reg) {
+        parse_sum(reg);
+        // Two-character operators first, so "<=" is not read as "<".
+        static const std::pair<const char*, Op> ops[] = {
+            {"<=", Op::Le}, {">=", Op::Ge}, {"==", Op::Eq}, {"!=", Op::Ne}, {"<", Op::Lt}, {">", Op::Gt},
+        };
+        for (const auto& [token, op] : ops) {
+            if (accept(token)) {
+                parse_sum(reg + 1);
+                emit(op, reg, reg, reg + 1);
+                return;
+            }
+        }
+    }
+
+    void parse_sum(int reg) {
+        parse_product(reg);
+        while (true) {
+            if (accept("+")) {
+                parse_product(reg + 1);
+                emit(Op::Add, reg, reg, reg + 1);
+            } else if (accept("-")) {
+                parse_product(reg + 1);
+                emit(Op::Sub, reg, reg, reg + 1);
+            } else {
+                return;
+            }
+        }
+    }
+
+    void parse_product(int reg) {
+        parse_unary(reg);
+        while (true) {
+            if (accept("*")) {
+                parse_unary(reg + 1);
+                emit(Op::Mul, reg, reg, reg + 1);
+            } else if (accept("/")) {
+                parse_unary(reg + 1);
+                emit(Op::Div, reg, reg, reg + 1);
+            } else {
+                return;
+            }
+        }
+    }
+
+    void parse_unary(int reg) {
+        if (accept("-")) {
+            parse_unary(reg);
+            emit(Op::Neg, reg, reg);
+            return;
+        }
+        parse_primary(reg);
+    }
+
+    void parse_primary(int reg) {
+        skip_space();
+        if (pos_ >= src_.size()) fail("unexpected end of expression");
+
+        if (accept("(")) {
+            parse_or(reg);
+            expect(")");
+            return;
+        }
+
+        char c = src_[pos_];
+        if (std::isdigit(static_cast<unsigned char>(c)) || c == '.') {
+            const char* begin = src_.c_str() + pos_;
+            char* end = nullptr;
+            double value = std::strtod(begin, &end);
+            if (end == begin) fail("invalid number");
+            pos_ += end - begin;
+            emit(Op::LoadConst, reg, 0, 0, static_cast<uint32_t>(out_.constants_.size()));
+            out_.constants_.push_back(value);
+            return;
+        }
+
+        if (std::isalpha(static_cast<unsigned char>(c)) || c == '_') {
+            size_t start = pos_;
+            while (pos_ < src_.size() && (std::isalnum(static_cast<unsigned char>(src_[pos_])) || src_[pos_] == '_')) ++pos_;
+            std::string name = src_.substr(start, pos_ - start);
+
+            if (accept("(")) {
+                if (name == "abs") {
+                    parse_or(reg);
+                    emit(Op::Abs, reg, reg);
+                } else if (name == "min" || name == "max") {
+                    parse_or(reg);
+                    expect(",");
+                    parse_or(reg + 1);
+                    emit(name == "min" ? Op::Min : Op::Max, reg, reg, reg + 1);
+                } else {
+                    pos_ = start;
+                    fail("unknown function '" + name + "'");
+                }
+                expect(")");
+                return;
+            }
+
+            uint32_t index = 0;
+            while (index < out_.signals_.size() && out_.signals_[index] != name) ++index;
+            if (index == out_.signals_.size()) {
+                out_.signals_.push_back(name);
+            }
+            emit(Op::LoadSignal, reg, 0, 0, index);
+            return;
+        }
+
+        fail("unexpected '" + std::string(1, c) + "'");
+    }
+};
+
+std::shared_ptr<const GesturePredicate> GesturePredicate::compile(const std::string& expression, std::string* error) {
+    auto predicate = std::make_shared<GesturePredicate>();
+    predicate->source_ = expression;
+    try {
+        PredicateCompiler(predicate->source_, *predicate).compile();
+    } catch (const std::invalid_argument& e) {
+        if (error) *error = e.what();
+        return nullptr;
+    }
+    return predicate;
+}
+
+std::vector<int> GesturePredicate::bind(SignalTable& table) const {
+    std::vector<int> slots;
+    slots.reserve(signals_.size());
+    for (const auto& name : signals_) {
+        slots.push_back(table.slot(name));
+    }
+    return slots;
+}
+
+bool GesturePredicate::evaluate(const SignalTable& table, const std::vector<int>& slots) const {
+    for (int slot : slots) {
+        if (!table.present(slot)) {
+            return false;
+        }
+    }
+
+    double r[kMaxRegisters];
+    for (const Instruction& in : code_) {
+        switch (in.op) {
+            case Op::LoadSignal: r[in.dst] = table.value(slots[in.operand]); break;
+            case Op::LoadConst:  r[in.dst] = constants_[in.operand]; break;
+            case Op::Add: r[in.dst] = r[in.a] + r[in.b]; break;
+            case Op::Sub: r[in.dst] = r[in.a] - r[in.b]; break;
+            case Op::Mul: r[in.dst] = r[in.a] * r[in.b]; break;
+            case Op::Div: r[in.dst] = r[in.a] / r[in.b]; break;
+            case Op::Neg: r[in.dst] = -r[in.a]; break;
+            case Op::Abs: r[in.dst] = std::fabs(r[in.a]); break;
+            case Op::Min: r[in.dst] = std::fmin(r[in.a], r[in.b]); break;
+            case Op::Max: r[in.dst] = std::fmax(r[in.a], r[in.b]); break;
+            case Op::Lt:  r[in.dst] = r[in.a] < r[in.b]; break;
+            case Op::Le:  r[in.dst] = r[in.a] <= r[in.b]; break;
+            case Op::Gt:  r[in.dst] = r[in.a] > r[in.b]; break;
+            case Op::Ge:  r[in.dst] = r[in.a] >= r[in.b]; break;
+            case Op::Eq:  r[in.dst] = r[in.a] == r[in.b]; break;
+            case Op::Ne:  r[in.dst] = r[in.a] != r[in.b]; break;
+            case Op::And: r[in.dst] = r[in.a] != 0.0 && r[in.b] != 0.0; break;
+            case Op::Or:  r[in.dst] = r[in.a] != 0.0 || r[in.b] != 0.0; break;
+            case Op::Not: r[in.dst] = r[in.a] == 0.0; break;
+        }
+    }
+    return !code_.empty() && r[0] != 0.0;
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Dense per-frame copy of the signals some predicate reads. Each name gets a
+// slot the first time it is asked for; load() then fills the slots from the
+// landmarker's map with one lookup per slot, and predicates read the vector.
+class SignalTable {
+public:
+    int slot(const std::string& name);
+    void load(const std::unordered_map<std::string, double>& signals);
+
+    double value(int slot) const { return values_[slot]; }
+    bool present(int slot) const { return present_[slot] != 0; }
+    const std::string& name(int slot) const { return names_[slot]; }
+    size_t size() const { return names_.size(); }
+
+private:
+    std::vector<std::string> names_;
+    std::vector<double> values_;
+    std::vector<uint8_t> present_;
+};
+
+// Boolean expression over several signals, compiled once into register
+// bytecode, e.g.
+//   eyeBlinkLeft > 0.5 && eyeBlinkRight > 0.5 && abs(yaw) < 0.2
+//
+// Grammar, loosest binding first: ||, &&, !, comparisons (< <= > >= == !=),
+// + -, * /, unary -, then numbers, signal names, abs(x), min(a, b), max(a, b)
+// and parentheses. Booleans are 0 and 1. The predicate is false on any frame
+// where one of its signals is missing.
+class GesturePredicate {
+public:
+    enum class Op : uint8_t {
+        LoadSignal, LoadConst,
+        Add, Sub, Mul, Div, Neg, Abs, Min, Max,
+        Lt, Le, Gt, Ge, Eq, Ne,
+        And, Or, Not
+    };
+
+    struct Instruction {
+        Op op;
+        uint8_t dst;
+        uint8_t a;
+        uint8_t b;
+        uint32_t operand; // signal index for LoadSignal, constant index for LoadConst
+    };
+
+    static constexpr int kMaxRegisters = 16;
+
+    // Returns nullptr and fills error if expression does not parse.
+    static std::shared_ptr<const GesturePredicate> compile(const std::string& expression, std::string* error = nullptr);
+
+    // Maps the predicate's signals to slots of table; the result is passed to evaluate.
+    std::vector<int> bind(SignalTable& table) const;
+    bool evaluate(const SignalTable& table, const std::vector<int>& slots) const;
+
+    const std::string& source() const { return source_; }
+    const std::vector<std::string>& signals() const { return signals_; }
+    const std::vector<Instruction>& code() const { return code_; }
+
+private:
+    std::string source_;
+    std::vector<std::string> signals_;
+    std::vector<double> constants_;
+    std::vector<Instruction> code_;
+
+    friend class PredicateCompiler;
+};
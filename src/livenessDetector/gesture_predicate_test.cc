@@ -0,0 +1,94 @@
+#include "gesture_predicate.h"
+#include "gesture.h"
+#include <iostream>
+#include <cassert>
+#include <chrono>
+
+namespace {
+
+template <typename F>
+double ns_per_call(int iterations, F&& f) {
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; ++i) {
+        f(i);
+    }
+    std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+    return elapsed.count() / iterations;
+}
+
+} // end anonymous namespace
+
+int main() {
+    std::string error;
+    auto predicate = GesturePredicate::compile("eyeBlinkLeft > 0.5 && eyeBlinkRight > 0.5 && abs(yaw) < 0.2", &error);
+    assert(predicate);
+    std::cout << "Compiled " << predicate->code().size() << " instructions over "
+              << predicate->signals().size() << " signals\n";
+
+    SignalTable table;
+    std::vector<int> slots = predicate->bind(table);
+
+    table.load({{"eyeBlinkLeft", 0.8}, {"eyeBlinkRight", 0.7}, {"yaw", -0.1}});
+    std::cout << "both eyes closed, facing camera: " << predicate->evaluate(table, slots) << "\n";
+    assert(predicate->evaluate(table, slots));
+
+    table.load({{"eyeBlinkLeft", 0.8}, {"eyeBlinkRight", 0.7}, {"yaw", -0.3}});
+    std::cout << "head turned: " << predicate->evaluate(table, slots) << "\n";
+    assert(!predicate->evaluate(table, slots));
+
+    table.load({{"eyeBlinkLeft", 0.8}, {"yaw", 0.0}});
+    std::cout << "missing signal: " << predicate->evaluate(table, slots) << "\n";
+    assert(!predicate->evaluate(table, slots));
+
+    // Precedence and functions
+    auto arithmetic = GesturePredicate::compile("!(a < 0) && max(a, b) - min(a, b) * 2 >= 1 || -a == 3");
+    std::vector<int> arithmetic_slots = arithmetic->bind(table);
+    table.load({{"a", 3.0}, {"b", 1.0}});
+    assert(arithmetic->evaluate(table, arithmetic_slots));  // 3 - 1 * 2 >= 1
+    table.load({{"a", -3.0}, {"b", 1.0}});
+    assert(arithmetic->evaluate(table, arithmetic_slots));  // -a == 3
+    table.load({{"a", 1.0}, {"b", 1.5}});
+    assert(!arithmetic->evaluate(table, arithmetic_slots));
+
+    for (const char* bad : {"a >", "sqrt(a) > 1", "(a > 1", "a > 1 b"}) {
+        bool rejected = !GesturePredicate::compile(bad, &error);
+        std::cout << "'" << bad << "' rejected: " << (rejected ? "yes" : "no") << " (" << error << ")\n";
+        assert(rejected);
+    }
+
+    // Benchmark: one expression step against today's single-comparison step.
+    // Neither step ever passes, so every iteration runs the full check.
+    const int iterations = 5000000;
+
+    Gesture::Step compare{Gesture::Step::MoveType::Higher, 2.0, std::nullopt};
+    Gesture single("single", "Single", 10.0, false, {compare}, std::nullopt, std::string("eyeBlinkLeft"));
+    single.start();
+    const std::optional<std::string> key("eyeBlinkLeft");
+    double single_ns = ns_per_call(iterations, [&](int i) {
+        single.update(0.001 * (i & 1023), std::nullopt, key);
+    });
+
+    Gesture::Step expression{Gesture::Step::MoveType::Expression, 0.0, std::nullopt, 0.0, -1,
+                             GesturePredicate::compile("eyeBlinkLeft > 2 && eyeBlinkRight > 0.5 && abs(yaw) < 0.2")};
+    Gesture multi("multi", "Multi", 10.0, false, {expression});
+    SignalTable gesture_table;
+    multi.bind_signals(gesture_table);
+    multi.start();
+    gesture_table.load({{"eyeBlinkLeft", 0.1}, {"eyeBlinkRight", 0.7}, {"yaw", 0.0}});
+    double expression_ns = ns_per_call(iterations, [&](int) {
+        multi.update(0.0, std::nullopt, std::nullopt, nullptr, &gesture_table);
+    });
+
+    std::unordered_map<std::string, double> frame = {
+        {"eyeBlinkLeft", 0.1}, {"eyeBlinkRight", 0.7}, {"yaw", 0.0}, {"jawOpen", 0.2}, {"mouthSmileLeft", 0.3}};
+    double load_ns = ns_per_call(iterations / 10, [&](int) {
+        gesture_table.load(frame);
+    });
+
+    std::cout << "single comparison step: " << single_ns << " ns\n"
+              << "expression step (3 signals): " << expression_ns << " ns\n"
+              << "signal table load per frame (3 slots): " << load_ns << " ns\n";
+
+    std::cout << "Test completed.\n";
+    return 0;
+}
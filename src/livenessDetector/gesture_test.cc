@@ -1,4 +1,6 @@
 #include "gesture.h"
+#include "test_check.h"
+#include "signal_window_stats.h"
 #include <iostream>
 #include <chrono>
 #include <thread>
@@ -46,6 +48,23 @@ int main() {
     std::cout << "Updating value with 11 after timeout (should reset): " 
               << (gesture.update(11, signal_index) ? "Gesture detected!" : "No detection") << "\n";
 
+    // A velocity reset needs samples: an empty window has no velocity, not a velocity of 0
+    std::vector<Gesture::Step> windowed = {
+        {Gesture::Step::MoveType::Higher, 10.0, std::nullopt},
+        {Gesture::Step::MoveType::Higher, 12.0, {{Gesture::Step::ResetCondition::Type::VelocityHigher, -1.0, 200.0}}}
+    };
+    Gesture velocity_gesture("Velocity gesture", "VelocityGesture", 30.0, false, windowed, std::nullopt, "signal");
+    SignalWindowStats window_stats;
+    TEST_CHECK(velocity_gesture.bind_windows(window_stats));
+    velocity_gesture.start();
+    bool detected = velocity_gesture.update(11, std::nullopt, "signal", &window_stats);
+    TEST_CHECK(!detected);
+    detected = velocity_gesture.update(5, std::nullopt, "signal", &window_stats); // no reset on the empty window
+    TEST_CHECK(!detected);
+    detected = velocity_gesture.update(13, std::nullopt, "signal", &window_stats);
+    TEST_CHECK(detected);
+    std::cout << "Velocity reset ignores an empty window\n";
+
     std::cout << "Test sequence completed.\n";
 
     return 0;
@@ -1,15 +1,15 @@
 #include "gestures_requester.h"
+#include "logger.h"
 #include <chrono>
 #include <algorithm>
 #include <random>
-#include <iostream>
 #include <filesystem>
 
 using namespace std::chrono;
 
 GesturesRequester::GesturesRequester(int number_of_gestures,
                                      GestureDetector* gesture_detector,
-                                     TranslationManager* translator,
+                                     const TranslationManager* translator,
                                      const std::string& font_path,
                                      DebugLevel debug_level)
     : number_of_gestures_to_request_(number_of_gestures),
@@ -34,12 +34,11 @@ GesturesRequester::GesturesRequester(int number_of_gestures,
             ft_ = cv::freetype::createFreeType2(); // allocate instance
             ft_->loadFontData(font_path, 0);       // try loading font
         } catch (const cv::Exception& e) {
-            std::cerr << "Failed to load font: " << font_path << "\n"
-                      << e.what() << std::endl;
+            LOG_ERROR("Failed to load font: {}\n{}", font_path, e.what());
             ft_ = nullptr; // loading failed
         }
     } else {
-        std::cerr << "Font file does not exist: " << font_path << std::endl;
+        LOG_ERROR("Font file does not exist: {}", font_path);
         ft_ = nullptr; // File does not exist
     }
 }
@@ -58,13 +57,24 @@ cv::Mat GesturesRequester::process_image(cv::Mat img,
                                         int show_face,
                                         const std::unordered_map<std::string, double>& npoints,
                                         const std::string& warning_message) {
-    cv::Mat img_out = img.clone();
+    cv::Mat img_out;
+    process_image(img, img_out, show_face, npoints, warning_message);
+    return img_out;
+}
+
+void GesturesRequester::process_image(const cv::Mat& img,
+                                      cv::Mat& img_out,
+                                      int show_face,
+                                      const std::unordered_map<std::string, double>& npoints,
+                                      const std::string& warning_message) {
+    // copyTo only reallocates img_out when its size or type differs.
+    img.copyTo(img_out);
     
     if (!npoints.empty()) {
         if (show_face == 1) {
             draw_square(img_out, npoints);
         } else if (show_face == 2) {
-            img_out = pixelate_outside_square(img_out, npoints);
+            pixelate_outside_square(img_out, npoints).copyTo(img_out);
         }
     }
     
@@ -90,8 +100,6 @@ cv::Mat GesturesRequester::process_image(cv::Mat img,
             add_text_to_image(img_out, warning_message, 80, cv::Scalar(0, 255, 255));
         }
     }
-    
-    return img_out;
 }
 
 void GesturesRequester::set_gestures_list(const std::vector<GestureDetector::AddResult>& gestures) {
@@ -100,8 +108,54 @@ void GesturesRequester::set_gestures_list(const std::vector<GestureDetector::Add
     start_gestures_sequence();
 }
 
+void GesturesRequester::restart() {
+    gesture_detector_->stop_all();
+    overwrite_text_.clear();
+    process_status_ = GesturesRequesterSystemStatus::IDLE;
+    generate_gestures_to_test_list(number_of_gestures_to_request_);
+    start_gestures_sequence();
+}
+
+std::vector<std::string> GesturesRequester::get_requested_gesture_ids() const {
+    std::vector<std::string> ids;
+    for (const auto& request : gestures_to_test_) {
+        if (request.start_gesture) {
+            ids.push_back(request.gestureId);
+        }
+    }
+    return ids;
+}
+
+std::vector<std::string> GesturesRequester::get_plan_ids() const {
+    std::vector<std::string> ids;
+    for (const auto& request : gestures_to_test_) {
+        ids.push_back(request.gestureId);
+    }
+    return ids;
+}
+
+std::string GesturesRequester::get_current_gesture_id() const {
+    return current_gesture_request_ ? current_gesture_request_->gestureId : std::string();
+}
+
+bool GesturesRequester::expects_picture() const {
+    if (current_gesture_index_ == 0 || !current_gesture_request_ || !current_gesture_request_->take_picture_at_the_end) {
+        return false;
+    }
+    for (const auto& gesture : gesture_detector_->get_gestures()) {
+        if (gesture->get_label() == current_gesture_request_->label) {
+            return gesture->get_current_index() + 1 >= gesture->get_sequence().size();
+        }
+    }
+    return false;
+}
+
+void GesturesRequester::set_flight_recorder(FlightRecorder* recorder) {
+    recorder_ = recorder;
+}
+
 void GesturesRequester::gesture_detected_callback(const std::string& gesture_label) {
-    std::cout << "Gesture Detected:" << gesture_label << std::endl;
+    LOG_INFO("Gesture Detected:{}", gesture_label);
     move_to_next_gesture();
 }
 
@@ -114,7 +168,7 @@ void GesturesRequester::move_to_next_gesture(uint64_t current_time) {
     }
     
     if (current_gesture_request_->take_picture_at_the_end && ask_to_take_picture_callback_) {
-        ask_to_take_picture_callback_();
+        ask_to_take_picture_callback_(current_gesture_request_->gestureId);
     }
     
     //std::cout << "move to next gesture: " << current_gesture_index_ << std::endl;
@@ -130,6 +184,10 @@ void GesturesRequester::move_to_next_gesture(uint64_t current_time) {
     if (current_gesture_index_ < gestures_to_test_.size()) {
         current_gesture_request_ = &gestures_to_test_[current_gesture_index_];
         current_gesture_started_at_ = current_time;
+        if (recorder_) {
+            recorder_->record(FlightRecorder::Type::Phase, 0, static_cast<uint32_t>(current_gesture_index_), 0.0,
+                              FlightRecorder::now_ns());
+        }
         
         if (current_gesture_request_->start_gesture) {
             gesture_detector_->start_by_label(current_gesture_request_->label);
@@ -149,11 +207,8 @@ void GesturesRequester::generate_gestures_to_test_list(int number_of_gestures_to
                std::mt19937{std::random_device{}()});
   
     for (const auto& gesture : selected_gestures) {
-        cv::Mat icon;
-        if (!gesture.icon_path.empty() && std::filesystem::exists(gesture.icon_path)) {
-            icon = cv::imread(gesture.icon_path, cv::IMREAD_UNCHANGED);
-        }
-        
+        cv::Mat icon = load_icon(gesture.icon_path);
+
         gestures_to_test_.push_back({
             gesture.gestureId,
             gesture.label,
@@ -168,10 +223,30 @@ void GesturesRequester::generate_gestures_to_test_list(int number_of_gestures_to
     gestures_to_test_.push_back({"youarealive", "You Are Alive", 5000, false, false, "", cv::Mat()});
 }
 
+cv::Mat GesturesRequester::load_icon(const std::string& icon_path) const {
+    if (icon_path.empty()) {
+        return cv::Mat();
+    }
+    if (asset_bundle_) {
+        if (auto icon = asset_bundle_->find_icon(icon_path)) {
+            // Header over the mapped bundle pages; icons are only ever read.
+            return cv::Mat(icon->rows, icon->cols, icon->type, const_cast<uint8_t*>(icon->data), icon->step);
+        }
+    }
+    if (std::filesystem::exists(icon_path)) {
+        return cv::imread(icon_path, cv::IMREAD_UNCHANGED);
+    }
+    return cv::Mat();
+}
+
 void GesturesRequester::start_gestures_sequence() {
     current_gesture_index_ = 1;
     current_gesture_request_ = &gestures_to_test_[current_gesture_index_];
     start_time_ = true;
+    if (recorder_) {
+        recorder_->record(FlightRecorder::Type::Phase, 0, static_cast<uint32_t>(current_gesture_index_), 0.0,
+                          FlightRecorder::now_ns());
+    }
 }
 
 // Image processing helper methods implementation
@@ -437,6 +512,10 @@ std::pair<std::string, cv::Mat> GesturesRequester::process_requests() {
 }
 
 void GesturesRequester::reset_not_alive() {
+    if (recorder_) {
+        recorder_->record(FlightRecorder::Type::NotAlive, 0, static_cast<uint32_t>(current_gesture_index_), 0.0,
+                          FlightRecorder::now_ns());
+    }
     current_gesture_index_ = 0;
     current_gesture_request_ = &gestures_to_test_[current_gesture_index_];
     if (report_alive_callback_) {
@@ -448,10 +527,14 @@ void GesturesRequester::set_report_alive_callback(std::function<void(bool)> call
     report_alive_callback_ = callback;
 }
 
-void GesturesRequester::set_ask_to_take_picture_callback(std::function<void()> callback) {
+void GesturesRequester::set_ask_to_take_picture_callback(std::function<void(const std::string&)> callback) {
     ask_to_take_picture_callback_ = callback;
 }
 
+void GesturesRequester::set_asset_bundle(std::shared_ptr<const AssetBundle> bundle) {
+    asset_bundle_ = std::move(bundle);
+}
+
 void GesturesRequester::set_overwrite_text(const std::string& text, bool failure) {
     overwrite_text_ = text;
     overwrite_text_log_.push_back(text);
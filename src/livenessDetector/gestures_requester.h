@@ -11,6 +11,8 @@
 #include <random>
 #include "gesture_detector.h"
 #include "translation_manager.h"
+#include "asset_bundle.h"
+#include "flight_recorder.h"
 
 enum class GesturesRequesterSystemStatus {
     IDLE = 1,
@@ -39,7 +41,7 @@ public:
 
     GesturesRequester(int number_of_gestures,
                       GestureDetector* gesture_detector,
-                      TranslationManager* translator,
+                      const TranslationManager* translator,
                       const std::string& font_path,
                       DebugLevel debug_level = DebugLevel::OFF);
     
@@ -50,11 +52,36 @@ public:
                          int show_face = 0,
                          const std::unordered_map<std::string, double>& npoints = {},
                          const std::string& warning_message = "");
+    // Same as above, rendering into img_out so callers can reuse its buffer across frames.
+    void process_image(const cv::Mat& img,
+                       cv::Mat& img_out,
+                       int show_face = 0,
+                       const std::unordered_map<std::string, double>& npoints = {},
+                       const std::string& warning_message = "");
     
     void set_gestures_list(const std::vector<GestureDetector::AddResult>& gestures);
+    // Draws a new random plan from the gestures list and starts it from the
+    // beginning, also after a not-alive result.
+    void restart();
+    std::vector<std::string> get_requested_gesture_ids() const;
+    // Every entry of the current plan, including the "starting" and result
+    // phases; FlightRecorder phase records index into this list.
+    std::vector<std::string> get_plan_ids() const;
+    GesturesRequesterSystemStatus get_status() const { return process_status_; }
+    const std::string& get_overwrite_text() const { return overwrite_text_; }
+    // Id of the plan entry shown now: "starting", a gesture, "youarealive" or
+    // "notAlive"; empty before the first plan.
+    std::string get_current_gesture_id() const;
+    // Whether the current gesture takes a picture and is on its last step, so
+    // it may complete with one of the next frames.
+    bool expects_picture() const;
+    // Records phase changes and not-alive timeouts; recorder must outlive the requester.
+    void set_flight_recorder(FlightRecorder* recorder);
     void set_report_alive_callback(std::function<void(bool)> callback);
-    void set_ask_to_take_picture_callback(std::function<void()> callback);
+    // Called with the id of a take_picture_at_the_end gesture when it completes.
+    void set_ask_to_take_picture_callback(std::function<void(const std::string&)> callback);
     void set_overwrite_text(const std::string& text = "", bool failure = false);
+    void set_asset_bundle(std::shared_ptr<const AssetBundle> bundle);
 
     // Disable copy and move
     GesturesRequester(const GesturesRequester&) = delete;
@@ -66,7 +93,7 @@ private:
     int number_of_gestures_to_request_;
     DebugLevel debug_level_;
     GestureDetector* gesture_detector_;
-    TranslationManager* translator_;
+    const TranslationManager* translator_;
     
     std::string overwrite_text_;
     std::vector<std::string> overwrite_text_log_;
@@ -79,15 +106,18 @@ private:
     bool start_time_;
     GestureRequest* current_gesture_request_;
     cv::Ptr<cv::freetype::FreeType2> ft_;
+    std::shared_ptr<const AssetBundle> asset_bundle_;
+    FlightRecorder* recorder_ = nullptr;
     
     std::function<void(bool)> report_alive_callback_;
-    std::function<void()> ask_to_take_picture_callback_;
+    std::function<void(const std::string&)> ask_to_take_picture_callback_;
 
     void gesture_detected_callback(const std::string& gesture_label);
     void move_to_next_gesture(uint64_t current_time = 0);
     void reset_not_alive();
     void generate_gestures_to_test_list(int number_of_gestures_to_request);
     void start_gestures_sequence();
+    cv::Mat load_icon(const std::string& icon_path) const;
     
     // Image processing helpers
     void draw_square(cv::Mat& img_out, const std::unordered_map<std::string, double>& npoints);
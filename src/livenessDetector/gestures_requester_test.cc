@@ -1,4 +1,5 @@
 #include "gestures_requester.h"
+#include "test_check.h"
 #include "gesture_detector.h"
 #include "translation_manager.h"
 #include <iostream>
@@ -13,8 +14,8 @@ void report_alive(bool is_alive) {
     std::cout << "Report Alive called: " << (is_alive ? "Yes" : "No") << std::endl;
 }
 
-void ask_to_take_picture() {
-    std::cout << "Ask to Take Picture called" << std::endl;
+void ask_to_take_picture(const std::string& gesture_id) {
+    std::cout << "Ask to Take Picture called for " << gesture_id << std::endl;
 }
 
 int main() {
@@ -50,7 +51,7 @@ int main() {
     GestureDetector gesture_detector;
 
     // Create an instance of GesturesRequester with mock components
-    GesturesRequester requester(3, &gesture_detector, &translation_manager, GesturesRequester::DebugLevel::INFO);
+    GesturesRequester requester(3, &gesture_detector, &translation_manager, "", GesturesRequester::DebugLevel::INFO);
 
     // Set callback functions
     requester.set_report_alive_callback(report_alive);
@@ -69,17 +70,45 @@ int main() {
     gesture_detector.add_gesture(std::move(gesture2));
 
     // Add gesture results to GesturesRequester
-    GestureDetector::AddResult result1 {true, "gesture1", "Gesture One", "icon_path_1", 5000, false};
-    GestureDetector::AddResult result2 {true, "gesture2", "Gesture Two", "icon_path_2", 5000, false};
+    GestureDetector::AddResult result1 {true, "gesture1", "First Gesture", "icon_path_1", 5000, false};
+    GestureDetector::AddResult result2 {true, "gesture2", "Second Gesture", "icon_path_2", 5000, false};
 
     requester.set_gestures_list({result1, result2});
 
     // Process an image with no gestures being detected
     cv::Mat img = cv::Mat::zeros(480, 640, CV_8UC3);
     cv::Mat result_img = requester.process_image(img);
-    assert(!result_img.empty());
+    TEST_CHECK(!result_img.empty());
     std::cout << "Image processed with no gestures detected" << std::endl;
 
+    // Restart mid-plan: a new plan from its start, without the overwrite text,
+    // and the old plan's gesture stopped by the detector's next tick
+    auto working = [&gesture_detector]() {
+        int count = 0;
+        for (const auto& gesture : gesture_detector.get_gestures()) {
+            count += gesture->get_working();
+        }
+        return count;
+    };
+    TEST_CHECK(requester.get_current_gesture_id() == "starting");
+    std::this_thread::sleep_for(std::chrono::milliseconds(5100)); // the "starting" phase lasts 5 s
+    requester.process_image(img, result_img);
+    std::string requested = requester.get_current_gesture_id();
+    TEST_CHECK(requested == "gesture1" || requested == "gesture2");
+    gesture_detector.process_signals({}, 0.0);
+    TEST_CHECK(working() == 1);
+    requester.set_overwrite_text("Not alive", true);
+    TEST_CHECK(requester.get_status() == GesturesRequesterSystemStatus::FAILURE);
+
+    requester.restart();
+    TEST_CHECK(requester.get_status() == GesturesRequesterSystemStatus::IDLE);
+    TEST_CHECK(requester.get_overwrite_text().empty());
+    TEST_CHECK(requester.get_current_gesture_id() == "starting");
+    TEST_CHECK(requester.get_plan_ids().size() == 5); // notAlive, starting, both gestures, youarealive
+    gesture_detector.process_signals({}, 33.0);
+    TEST_CHECK(working() == 0);
+    std::cout << "Restart begins a new plan" << std::endl;
+
     // Simulate gesture detection
     //gesture_detector.set_signal_trigger_callback([&requester](const std::string& label) {
     gesture_detector.set_signal_trigger_callback([](const std::string& label) {
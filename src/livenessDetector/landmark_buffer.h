@@ -0,0 +1,94 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+// Face landmarks of one landmarker result, one array per coordinate, laid out
+// in a single block: x[0..n), then y[0..n), then z[0..n). The block can be sent
+// or wrapped as a 3 x n array as is. x and z are scaled by the image aspect
+// ratio, so all three coordinates are in image heights and distances do not
+// depend on the camera resolution.
+class LandmarkBuffer {
+public:
+    size_t size() const { return size_; }
+    void resize(size_t count) {
+        size_ = count;
+        coords_.resize(3 * count);
+    }
+
+    float* x() { return coords_.data(); }
+    float* y() { return coords_.data() + size_; }
+    float* z() { return coords_.data() + 2 * size_; }
+    const float* x() const { return coords_.data(); }
+    const float* y() const { return coords_.data() + size_; }
+    const float* z() const { return coords_.data() + 2 * size_; }
+
+    // The whole block, 3 * size() floats in host byte order.
+    const float* data() const { return coords_.data(); }
+    size_t bytes() const { return coords_.size() * sizeof(float); }
+
+    // Timestamp of the frame the landmarks come from, on the landmarker's timeline.
+    int64_t timestamp_ms() const { return timestamp_ms_; }
+    void set_timestamp_ms(int64_t timestamp_ms) { timestamp_ms_ = timestamp_ms; }
+    // Width over height of that frame: dividing x and z by it gives back the
+    // landmarker's normalized coordinates.
+    float aspect() const { return aspect_; }
+    void set_aspect(float aspect) { aspect_ = aspect; }
+
+private:
+    std::vector<float> coords_;
+    size_t size_ = 0;
+    int64_t timestamp_ms_ = -1;
+    float aspect_ = 1.0f;
+};
+
+// Recycles LandmarkBuffers: acquire() hands out a buffer that returns to the
+// pool when its last reference is dropped, so publishing a buffer per result
+// does not reallocate the coordinates once the pool has warmed up. Consumers
+// may hold a buffer as long as they like; the pool just allocates another.
+// Thread safe, and the pool may go away before the buffers it handed out.
+class LandmarkBufferPool {
+public:
+    explicit LandmarkBufferPool(size_t max_free = 8) : state_(std::make_shared<State>()) {
+        state_->max_free = max_free;
+    }
+
+    std::shared_ptr<LandmarkBuffer> acquire() {
+        std::unique_ptr<LandmarkBuffer> buffer;
+        {
+            std::lock_guard<std::mutex> lock(state_->mutex);
+            if (!state_->free.empty()) {
+                buffer = std::move(state_->free.back());
+                state_->free.pop_back();
+            }
+        }
+        if (!buffer) {
+            buffer = std::make_unique<LandmarkBuffer>();
+        }
+        std::weak_ptr<State> pool = state_;
+        return std::shared_ptr<LandmarkBuffer>(buffer.release(), [pool](LandmarkBuffer* released) {
+            std::unique_ptr<LandmarkBuffer> owned(released);
+            if (auto state = pool.lock()) {
+                std::lock_guard<std::mutex> lock(state->mutex);
+                if (state->free.size() < state->max_free) {
+                    state->free.push_back(std::move(owned));
+                }
+            }
+        });
+    }
+
+    size_t free_count() const {
+        std::lock_guard<std::mutex> lock(state_->mutex);
+        return state_->free.size();
+    }
+
+private:
+    struct State {
+        std::mutex mutex;
+        std::vector<std::unique_ptr<LandmarkBuffer>> free;
+        size_t max_free = 0;
+    };
+    std::shared_ptr<State> state_;
+};
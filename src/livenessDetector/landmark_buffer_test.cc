@@ -0,0 +1,81 @@
+#include "landmark_buffer.h"
+#include "test_check.h"
+#include <iostream>
+#include <thread>
+#include <vector>
+
+int main() {
+    // One block: x, then y, then z
+    LandmarkBuffer buffer;
+    buffer.resize(478);
+    TEST_CHECK(buffer.size() == 478);
+    TEST_CHECK(buffer.bytes() == 3 * 478 * sizeof(float));
+    TEST_CHECK(buffer.y() == buffer.x() + 478 && buffer.z() == buffer.x() + 2 * 478);
+    buffer.z()[477] = 0.25f;
+    TEST_CHECK(buffer.data()[3 * 478 - 1] == 0.25f);
+    TEST_CHECK(buffer.timestamp_ms() == -1);
+    std::cout << "Coordinates laid out as one block\n";
+
+    // Released buffers are reused, coordinates and all
+    LandmarkBufferPool pool(2);
+    const float* coords = nullptr;
+    {
+        auto first = pool.acquire();
+        first->resize(478);
+        first->set_timestamp_ms(100);
+        coords = first->data();
+        TEST_CHECK(pool.free_count() == 0);
+    }
+    TEST_CHECK(pool.free_count() == 1);
+    auto reused = pool.acquire();
+    TEST_CHECK(reused->data() == coords && reused->size() == 478);
+    std::cout << "Released buffer reused\n";
+
+    // A held buffer is never handed out twice
+    auto other = pool.acquire();
+    TEST_CHECK(other.get() != reused.get());
+
+    // Beyond max_free, released buffers are freed
+    {
+        auto a = pool.acquire();
+        auto b = pool.acquire();
+        auto c = pool.acquire();
+    }
+    TEST_CHECK(pool.free_count() == 2);
+
+    // A consumer may outlive the pool
+    std::shared_ptr<const LandmarkBuffer> kept;
+    {
+        LandmarkBufferPool scoped;
+        kept = scoped.acquire();
+    }
+    kept.reset();
+
+    // Producer and consumer threads
+    LandmarkBufferPool shared(4);
+    std::vector<std::shared_ptr<const LandmarkBuffer>> held;
+    std::mutex held_mutex;
+    std::thread producer([&]() {
+        for (int i = 0; i < 10000; ++i) {
+            auto next = shared.acquire();
+            next->resize(478);
+            next->set_timestamp_ms(i);
+            std::lock_guard<std::mutex> lock(held_mutex);
+            held.push_back(std::move(next));
+        }
+    });
+    std::thread consumer([&]() {
+        for (int i = 0; i < 10000; ++i) {
+            std::lock_guard<std::mutex> lock(held_mutex);
+            held.clear();
+        }
+    });
+    producer.join();
+    consumer.join();
+    held.clear();
+    TEST_CHECK(shared.free_count() <= 4);
+    std::cout << "Pool shared between threads, " << shared.free_count() << " buffers kept\n";
+
+    std::cout << "Test completed.\n";
+    return 0;
+}
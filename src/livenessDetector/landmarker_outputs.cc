@@ -0,0 +1,48 @@
+#include "landmarker_outputs.h"
+#include <algorithm>
+
+LandmarkerOutputs LandmarkerOutputs::all(std::shared_ptr<const DerivedSignals> derived) {
+    LandmarkerOutputs outputs;
+    if (derived && !derived->empty()) {
+        outputs.derived = std::move(derived);
+    }
+    return outputs;
+}
+
+LandmarkerOutputs LandmarkerOutputs::for_signals(const std::set<std::string>& signals,
+                                                 std::shared_ptr<const DerivedSignals> derived) {
+    LandmarkerOutputs outputs;
+    outputs.blendshapes = false;
+    outputs.transformation = false;
+    for (const auto& name : signals) {
+        if (is_transformation_signal(name)) {
+            outputs.transformation = true;
+        } else if (derived && derived->index_of(name) >= 0) {
+            outputs.derived = derived;
+        } else if (!is_face_box_signal(name)) {
+            outputs.blendshapes = true;
+            outputs.blendshape_names.push_back(name); // std::set iterates in order
+        }
+    }
+    return outputs;
+}
+
+bool LandmarkerOutputs::is_transformation_signal(const std::string& name) {
+    return name.compare(0, 15, "Transformation ") == 0;
+}
+
+bool LandmarkerOutputs::is_face_box_signal(const std::string& name) {
+    return name == "Top Square" || name == "Left Square" || name == "Right Square" || name == "Bottom Square";
+}
+
+bool LandmarkerOutputs::wants_blendshape(const std::string& name) const {
+    if (!blendshapes) {
+        return false;
+    }
+    return blendshape_names.empty() ||
+           std::binary_search(blendshape_names.begin(), blendshape_names.end(), name);
+}
+
+bool LandmarkerOutputs::served_by(const LandmarkerOutputs& graph) const {
+    return blendshapes == graph.blendshapes && (!transformation || graph.transformation);
+}
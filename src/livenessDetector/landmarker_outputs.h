@@ -0,0 +1,40 @@
+#pragma once
+
+#include "derived_signals.h"
+#include <memory>
+#include <set>
+#include <string>
+#include <vector>
+
+// Which face landmarker outputs a session needs, derived from the raw signals
+// its gestures and signal filters read. The landmarks themselves are always
+// produced: the face box check ("Top Square", ...) reads them. Blendshapes
+// cost a second model per frame and the transformation matrix a geometry
+// pass, so both are requested only when a signal comes from them. Derived
+// signals come from the landmarks too, and are computed only when read.
+struct LandmarkerOutputs {
+    bool blendshapes = true;
+    bool transformation = true;
+    // Blendshape categories to extract, sorted; empty extracts every category.
+    std::vector<std::string> blendshape_names;
+    // Signals computed from the landmarks; null when none is read.
+    std::shared_ptr<const DerivedSignals> derived;
+
+    // Every output, every category, every derived signal: for sessions whose
+    // signals are not known.
+    static LandmarkerOutputs all(std::shared_ptr<const DerivedSignals> derived = nullptr);
+    // Signals named "Transformation ..." come from the transformation matrix,
+    // the face box ones and those declared in derived from the landmarks, and
+    // any other from the blendshapes.
+    static LandmarkerOutputs for_signals(const std::set<std::string>& signals,
+                                         std::shared_ptr<const DerivedSignals> derived = nullptr);
+
+    static bool is_transformation_signal(const std::string& name);
+    static bool is_face_box_signal(const std::string& name);
+
+    bool wants_blendshape(const std::string& name) const;
+    // Whether a landmarker built for graph serves this without a rebuild: it
+    // has every output this reads, and runs the blendshape model only when this
+    // reads blendshapes. An unused transformation matrix is cheap enough to keep.
+    bool served_by(const LandmarkerOutputs& graph) const;
+};
@@ -0,0 +1,49 @@
+#include "landmarker_outputs.h"
+#include <iostream>
+#include <cassert>
+
+int main() {
+    // Head pose only: no blendshape model
+    LandmarkerOutputs pose = LandmarkerOutputs::for_signals({"Transformation Pitch", "Top Square"});
+    assert(!pose.blendshapes && pose.transformation);
+    assert(!pose.wants_blendshape("eyeBlinkLeft"));
+
+    // Blendshapes only: just the categories the gestures read
+    LandmarkerOutputs blink = LandmarkerOutputs::for_signals({"eyeBlinkRight", "eyeBlinkLeft", "jawOpen"});
+    assert(blink.blendshapes && !blink.transformation);
+    assert(blink.blendshape_names.size() == 3);
+    assert(blink.wants_blendshape("eyeBlinkLeft") && blink.wants_blendshape("jawOpen"));
+    assert(!blink.wants_blendshape("mouthSmileRight"));
+    assert(!blink.served_by(pose) && !pose.served_by(blink));
+    assert(blink.served_by(LandmarkerOutputs::all()));
+    assert(!LandmarkerOutputs::all().served_by(blink)); // no transformation matrix in blink's graph
+    assert(!pose.served_by(LandmarkerOutputs::all()));  // the point: drop the blendshape model
+    std::cout << "Outputs follow the signals\n";
+
+    // Nothing known: everything
+    LandmarkerOutputs all = LandmarkerOutputs::all();
+    assert(all.blendshapes && all.transformation && all.wants_blendshape("anything"));
+
+    // Face box only: landmarks alone
+    LandmarkerOutputs box = LandmarkerOutputs::for_signals({"Left Square"});
+    assert(!box.blendshapes && !box.transformation);
+    assert(!box.derived);
+
+    // Derived signals are computed from the landmarks, not looked up in the blendshapes
+    DerivedSignals::Spec spec;
+    spec.name = "mouthOpening";
+    spec.points = {13, 14};
+    auto derived = std::make_shared<const DerivedSignals>(std::vector<DerivedSignals::Spec>{spec});
+    LandmarkerOutputs mouth = LandmarkerOutputs::for_signals({"mouthOpening", "Top Square"}, derived);
+    assert(!mouth.blendshapes && !mouth.transformation && mouth.derived == derived);
+    assert(!LandmarkerOutputs::for_signals({"jawOpen"}, derived).derived);
+    assert(LandmarkerOutputs::all(derived).derived == derived);
+    assert(!LandmarkerOutputs::all(std::make_shared<const DerivedSignals>()).derived);
+    std::cout << "Derived signals need the landmarks only\n";
+
+    assert(LandmarkerOutputs::is_transformation_signal("Transformation Translation Z"));
+    assert(!LandmarkerOutputs::is_transformation_signal("Transform"));
+
+    std::cout << "Test completed.\n";
+    return 0;
+}
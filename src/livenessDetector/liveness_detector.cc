@@ -1,30 +1,18 @@
 #include "liveness_detector.h"
 
-#include <iostream>
+#include "logger.h"
 #include <sstream>
 #include <iomanip>
 #include <filesystem>
 #include <thread>
 #include <stdexcept>
+#include <cmath>
+#include <utility>
 
 // For OpenCV functions
 #include <opencv2/imgproc.hpp>
 #include <opencv2/highgui.hpp>
 
-// ----------------------------------------------------------------
-// A dummy implementation of find_face.
-// In a real system this would run an actual face detector. (Not implemented yet)
-namespace {
-std::vector<cv::Rect> find_face(const cv::Mat& img) {
-    std::vector<cv::Rect> faces;
-    if (!img.empty()) {
-        // Dummy: if image is not empty, return one face rectangle.
-        faces.push_back(cv::Rect(10, 10, 100, 100));
-    }
-    return faces;
-}
-} // end anonymous namespace
-
 // --------------------- Utility method -------------------------
 std::string LivenessDetector::drawValueOf(const std::string& name, double value,
                                             double minValue, double maxValue,
@@ -44,7 +32,7 @@ std::string LivenessDetector::drawValueOf(const std::string& name, double value,
 // --------------------- Debug print helper ---------------------
 void LivenessDetector::_debug_print(int level_required, const std::string& message) const {
     if (debug_level_ >= level_required) {
-        std::cout << message << std::endl;
+        LOG_INFO("{}", message);
     }
 }
 
@@ -55,7 +43,9 @@ LivenessDetector::LivenessDetector(const std::string& verification_token,
                                    const std::string& q,
                                    const std::string& lang,
                                    int number_of_gestures_to_request,
-                                   int debug_level)
+                                   int debug_level,
+                                   std::vector<std::string> reference_images,
+                                   const SFaceMatcher::Config& face_match)
     : verification_token_(verification_token),
       done_(false),
       debug_level_(debug_level),
@@ -63,19 +53,31 @@ LivenessDetector::LivenessDetector(const std::string& verification_token,
       frames_counter_(0),
       cfg_(),
       take_a_picture_(false),
-      match_counter_(0)
+      match_counter_(0),
+      reference_images_(std::move(reference_images)),
+      face_match_workers_(WorkerPool::shared()),
+      jobs_token_(std::make_shared<CancellationToken>())
 {
     _debug_print(DEBUG_INFO, "LivenessDetector: Constructor called");
 
     // Instantiate the translator (using locales in "./gestures/locales/")
     translator_ = std::make_unique<TranslationManager>(lang, "./gestures/locales/");
 
+    // Loaded by the first detector, then shared with its reference cache.
+    std::string matcher_error = "no face matching models configured";
+    if (!face_match.detector_model.empty() && !face_match.recognizer_model.empty()) {
+        face_matcher_ = SFaceMatcher::shared(face_match, &matcher_error);
+    }
+    if (!face_matcher_) {
+        LOG_WARNING("LivenessDetector: face matching unavailable: {}", matcher_error);
+    }
+
     // Create the face processor with a default model path.
     faceProcessor_ = std::make_unique<FaceProcessor>("default_model_path");
     // Set callback on the face processor.
     faceProcessor_->SetCallback([this](const std::map<std::string, float>& blendshapes,
-                                       const std::map<std::string, float>& transformationValues) {
-        this->face_processor_result_all_callback(blendshapes, transformationValues);
+                                       const std::map<std::string, float>& transformationValues, int64_t timestamp_ms) {
+        this->face_processor_result_all_callback(blendshapes, transformationValues, timestamp_ms);
     });
 
     // Create the gesture detector.
@@ -89,7 +91,7 @@ LivenessDetector::LivenessDetector(const std::string& verification_token,
     gestures_requester_->set_report_alive_callback([this](bool alive) {
         this->gestures_requester_result_callback(alive);
     });
-    gestures_requester_->set_ask_to_take_picture_callback([this]() {
+    gestures_requester_->set_ask_to_take_picture_callback([this](const std::string&) {
         this->gestures_requester_take_a_picture_callback();
     });
 
@@ -147,6 +149,8 @@ bool LivenessDetector::is_done() const {
 // --------------------- cleanup method ---------------------------
 void LivenessDetector::cleanup() {
     _debug_print(DEBUG_INFO, "LivenessDetector Cleanup");
+    // Drop a queued face match and wait for a running one: both use the members reset below.
+    face_match_workers_->cancel(jobs_token_);
     if (faceProcessor_) {
         faceProcessor_->SetDoProcessImage(false);
         faceProcessor_.reset();
@@ -182,8 +186,10 @@ cv::Mat LivenessDetector::process_image(const cv::Mat& img) {
     cv::Mat img_out = gestures_requester_->process_image(resized_img, cfg_.show_face, face_square_normalized_points_, warning_text);
     if (take_a_picture_) {
         take_a_picture_ = false;
-        cv::Mat picture = resized_img.clone();
-        pictures_.push_back(picture);
+        if (pictures_.size() >= kMaxPictures) {
+            pictures_.erase(pictures_.begin());
+        }
+        pictures_.push_back(resized_img.clone());
     }
     return img_out;
 }
@@ -219,7 +225,8 @@ void LivenessDetector::face_processor_result_callback(const std::map<std::string
 
 // --------------------- face_processor_result_all_callback -----------
 void LivenessDetector::face_processor_result_all_callback(const std::map<std::string, float>& blendshapes,
-                                                          const std::map<std::string, float>& transformationValues) {
+                                                          const std::map<std::string, float>& transformationValues,
+                                                          int64_t timestamp_ms) {
     std::stringstream ss;
     ss << "Liveness Detector Thread>>>>>> " << std::this_thread::get_id();
     _debug_print(DEBUG_THREADING, ss.str());
@@ -232,7 +239,7 @@ void LivenessDetector::face_processor_result_all_callback(const std::map<std::st
     for (const auto& pair : transformationValues) {
         signals_dictionary[pair.first] = static_cast<double>(pair.second);
     }
-    gesture_detector_->process_signals(signals_dictionary);
+    gesture_detector_->process_signals(signals_dictionary, static_cast<double>(timestamp_ms));
 
     // Retrieve the square values.
     bool has_top = (transformationValues.find("Top Square") != transformationValues.end());
@@ -327,26 +334,17 @@ void LivenessDetector::_face_match_callback_function(const std::string& result,
     _debug_print(DEBUG_INFO, "callback result, id=" + id + ", " + result);
 }
 
-// --------------------- _async_face_match --------------------------
-std::future<FaceMatchResult> LivenessDetector::_async_face_match(const cv::Mat& image1, const cv::Mat& image2) {
-    return std::async(std::launch::async, [this, image1, image2]() -> FaceMatchResult {
-        // Optionally save images if matcher_save_match_images is enabled (code commented out)
-        FaceMatchResult result;
-        if (!image1.empty() && !image2.empty()) {
-            result.distance = 0.3; // dummy distance (simulate a good match)
-        } else {
-            result.distance = 1.0;
-        }
-        return result;
-    });
-}
-
 // --------------------- _compare_local_pictures_with_reference -----------
 void LivenessDetector::_compare_local_pictures_with_reference() {
-    // Launch asynchronous comparison on a separate thread.
-    std::thread([this]() {
+    // Run the comparison on the process-wide pool, behind more urgent work.
+    bool queued = face_match_workers_->submit([this]() {
         this->_async_compare_local_pictures_with_reference();
-    }).detach();
+    }, WorkerPool::Priority::Low, jobs_token_);
+    if (!queued) {
+        _debug_print(DEBUG_INFO, "Face matching queue full");
+        gestures_requester_->set_overwrite_text(translator_->translate("error.error_doing_face_match"), true);
+        done_ = true;
+    }
 }
 
 // --------------------- _async_compare_local_pictures_with_reference -----------
@@ -354,9 +352,8 @@ void LivenessDetector::_async_compare_local_pictures_with_reference() {
     faceProcessor_->SetDoProcessImage(false);
     try {
         gestures_requester_->set_overwrite_text(translator_->translate("message.getting_reference_images"));
-        // Here we would call mediaManager->download_images_from_token(...)
-        // For simulation, we use an empty vector to represent reference images.
-        std::vector<std::string> reference_images;
+        // Given at construction; mediaManager->download_images_from_token(...) would fill them.
+        const std::vector<std::string>& reference_images = reference_images_;
         // If error in download or no images found
         if (reference_images.empty()) {
             gestures_requester_->set_overwrite_text(
@@ -370,51 +367,37 @@ void LivenessDetector::_async_compare_local_pictures_with_reference() {
             gestures_requester_->set_overwrite_text(translator_->translate("message.done"));
         }
         
+        if (!face_matcher_) {
+            gestures_requester_->set_overwrite_text(translator_->translate("error.error_doing_face_match"), true);
+            done_ = true;
+            return;
+        }
+
+        // Every picture against every reference in one batch; reference embeddings are cached.
+        gestures_requester_->set_overwrite_text(translator_->translate("message.doing_face_match"));
+        std::vector<std::vector<double>> matches;
+        std::string match_error;
+        if (jobs_token_->cancelled()) {
+            return;
+        }
+        if (!face_matcher_->match(pictures_, reference_images, &matches, &match_error)) {
+            _debug_print(DEBUG_INFO, "Error occurred in face match: " + match_error);
+            gestures_requester_->set_overwrite_text(translator_->translate("error.error_doing_face_match"), true);
+        }
         std::vector<double> distances;
-        int p_index = 0;
-        for (const auto& reference_image_path : reference_images) {
-            std::vector<cv::Rect> faces_ref = find_face(cv::imread(reference_image_path));
-            if (faces_ref.size() == 1) {
-                _debug_print(DEBUG_INFO, "The reference image (" + reference_image_path +
-                             ") meets the criteria for an acceptable face picture.");
-            } else {
-                _debug_print(DEBUG_INFO, "The reference image (" + reference_image_path +
-                             ") doesn't meet the criteria for an acceptable face picture.");
-            }
-            cv::Mat reference_image = cv::imread(reference_image_path);
-            for (const auto& picture : pictures_) {
-                p_index++;
-                try {
-                    _debug_print(DEBUG_INFO, "Processing picture index: " + std::to_string(p_index));
-                    std::vector<cv::Rect> faces_pic = find_face(picture);
-                    if (faces_pic.size() == 1) {
-                        _debug_print(DEBUG_INFO, "The picture meets the criteria for an acceptable face match.");
-                    } else {
-                        _debug_print(DEBUG_INFO, "The picture doesn't meet the criteria for an acceptable face match.");
-                        gestures_requester_->set_overwrite_text(
-                            translator_->translate("message.doing_face_match") + " (" +
-                            std::to_string(p_index) + " " +
-                            translator_->translate("message.of") + " " +
-                            std::to_string(pictures_.size()) + "). " +
-                            translator_->translate("error.does_not_meet_criteria_for_acceptable_face_match"),
-                            true);
-                    }
+        for (size_t r = 0; r < matches.size(); ++r) {
+            for (size_t p = 0; p < matches[r].size(); ++p) {
+                if (std::isnan(matches[r][p])) {
+                    _debug_print(DEBUG_INFO, "Picture " + std::to_string(p + 1) +
+                                 " doesn't meet the criteria for an acceptable face match.");
                     gestures_requester_->set_overwrite_text(
-                        translator_->translate("message.doing_face_match") + " (" +
-                        std::to_string(p_index) + " " +
-                        translator_->translate("message.of") + " " +
-                        std::to_string(pictures_.size()) + "). ");
-                    auto future_result = _async_face_match(picture, reference_image);
-                    FaceMatchResult match_result = future_result.get();
-                    _debug_print(DEBUG_INFO, "face match result: " + std::to_string(match_result.distance));
-                    distances.push_back(match_result.distance);
-                } catch (const std::exception& e) {
-                    _debug_print(DEBUG_INFO, std::string("Error occurred in face match: ") + e.what());
-                    gestures_requester_->set_overwrite_text(translator_->translate("error.error_doing_face_match"), true);
+                        translator_->translate("error.does_not_meet_criteria_for_acceptable_face_match"), true);
+                    continue;
                 }
+                _debug_print(DEBUG_INFO, "face match result (" + reference_images[r] + ", picture " +
+                             std::to_string(p + 1) + "): " + std::to_string(matches[r][p]));
+                distances.push_back(matches[r][p]);
             }
-            // Optionally remove the reference image file here.
-            // std::remove(reference_image_path.c_str());
         }
         double total_distance = 0.0;
         for (double d : distances) {
@@ -422,7 +405,7 @@ void LivenessDetector::_async_compare_local_pictures_with_reference() {
         }
         double average_distance = distances.empty() ? 1.0 : total_distance / distances.size();
         _debug_print(DEBUG_INFO, "Average distance: " + std::to_string(average_distance));
-        if (average_distance < 0.4) {
+        if (average_distance < face_matcher_->threshold()) {
             _debug_print(DEBUG_INFO, "Verified!!");
             gestures_requester_->set_overwrite_text(translator_->translate("message.verified"));
             //TODO: Add this
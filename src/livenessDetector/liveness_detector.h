@@ -4,7 +4,6 @@
 #include <map>
 #include <unordered_map>
 #include <memory>
-#include <future>
 #include <opencv2/opencv.hpp>
 
 #include "gesture.h"
@@ -12,6 +11,8 @@
 #include "gestures_requester.h"
 #include "translation_manager.h"
 #include "face_processor.h"
+#include "face_matcher.h"
+#include "worker_pool.h"
 
 // A minimal FaceConfig (from liveness_detector_face_config) (For Now)
 class FaceConfig {
@@ -25,11 +26,6 @@ public:
     int show_face = 0;
 };
 
-// A simple structure to hold a face‐match result.
-struct FaceMatchResult {
-    double distance;
-};
-
 class LivenessDetector {
 public:
     // Debug levels (corresponding to Python constants)
@@ -40,13 +36,18 @@ public:
     // Constructor parameters:
     // verification_token, rd, d, q are strings used for mediaManager settings (see Python),
     // but the media manager calls remain commented.
+    // reference_images are the paths of pictures of the person the pictures
+    // taken during the verification are matched against. face_match names the
+    // YuNet and SFace models; matching is unavailable when they are not set.
     LivenessDetector(const std::string& verification_token,
                      const std::string& rd,
                      const std::string& d,
                      const std::string& q,
                      const std::string& lang,
                      int number_of_gestures_to_request,
-                     int debug_level = DEBUG_OFF);
+                     int debug_level = DEBUG_OFF,
+                     std::vector<std::string> reference_images = {},
+                     const SFaceMatcher::Config& face_match = SFaceMatcher::Config());
     ~LivenessDetector();
 
     bool is_done() const;
@@ -57,7 +58,8 @@ public:
     void face_processor_result_callback(const std::map<std::string, float>& blendshapes,
                                         const std::map<std::string, float>& transformationValues);
     void face_processor_result_all_callback(const std::map<std::string, float>& blendshapes,
-                                            const std::map<std::string, float>& transformationValues);
+                                            const std::map<std::string, float>& transformationValues,
+                                            int64_t timestamp_ms);
 
     // Callbacks from the gestures requester
     void gestures_requester_result_callback(bool alive);
@@ -84,7 +86,8 @@ private:
     // Gestures list (from add_gesture_from_file)
     std::vector<GestureDetector::AddResult> gestures_list_;
 
-    // Pictures captured
+    // Pictures captured, the most recent kMaxPictures
+    static constexpr size_t kMaxPictures = 8;
     std::vector<cv::Mat> pictures_;
     bool take_a_picture_;
 
@@ -93,13 +96,20 @@ private:
 
     size_t match_counter_;
 
+    std::vector<std::string> reference_images_;
+    // SFaceMatcher::shared(): one per process. Null when the face matching models cannot be loaded.
+    std::shared_ptr<FaceMatcher> face_matcher_;
+    // Shared by every detector in the process.
+    std::shared_ptr<WorkerPool> face_match_workers_;
+    // Marks this detector's jobs, cancelled by cleanup() before the members they use go away.
+    std::shared_ptr<CancellationToken> jobs_token_;
+
     // Private helper methods
     // Prints message if debug_level_ is high enough.
     void _debug_print(int level_required, const std::string& message) const;
     std::string drawValueOf(const std::string& name, double value, double minValue, double maxValue, int maxCharacters, int decimalPlaces) const;
     std::string _verify_correct_face() const;
     void _face_match_callback_function(const std::string& result, const std::string& id) const;
-    std::future<FaceMatchResult> _async_face_match(const cv::Mat& image1, const cv::Mat& image2);
     void _compare_local_pictures_with_reference();
     void _async_compare_local_pictures_with_reference();
 };
@@ -0,0 +1,402 @@
+#include "liveness_detector_c.h"
+
+#include "asset_snapshot.h"
+#include "face_processor.h"
+#include "liveness_session.h"
+#include "logger.h"
+#include "worker_pool.h"
+#include "nlohmann/json.hpp"
+
+#include <opencv2/opencv.hpp>
+#include <algorithm>
+#include <cstring>
+#include <deque>
+#include <memory>
+#include <string>
+#include <vector>
+
+struct ld_session {
+    std::unique_ptr<AssetSnapshotStore> store;
+    std::shared_ptr<LivenessSession> session;
+    std::deque<std::string> events;
+    cv::Mat converted; // frames pushed in another format than BGR
+    cv::Mat overlay;
+    bool has_overlay = false;
+    // The message returned by the last ld_session_next_binary.
+    std::string binary_header;
+    std::vector<uint8_t> binary_payload;
+    std::shared_ptr<const LandmarkBuffer> binary_landmarks; // payload of a landmarks message
+    int64_t landmarks_sent_ms = -1;
+    std::string last_error;
+    std::unique_ptr<FaceProcessor> processor; // last: stops delivering results before the session goes away
+};
+
+namespace {
+
+// Events of frames nobody pulled are dropped, oldest first, beyond this.
+constexpr size_t kMaxEvents = 64;
+
+// Copies text with its terminator when it fits; returns its length either way.
+size_t copy_out(const std::string& text, char* buffer, size_t size) {
+    if (buffer && text.size() < size) {
+        std::memcpy(buffer, text.data(), text.size());
+        buffer[text.size()] = '\0';
+    }
+    return text.size();
+}
+
+void copy_truncated(const std::string& text, char* buffer, size_t size) {
+    if (!buffer || size == 0) {
+        return;
+    }
+    size_t length = std::min(text.size(), size - 1);
+    std::memcpy(buffer, text.data(), length);
+    buffer[length] = '\0';
+}
+
+bool read_string(const nlohmann::json& config, const char* key, std::string* value, std::string* error) {
+    if (!config.contains(key)) {
+        return true;
+    }
+    if (!config[key].is_string()) {
+        *error = std::string(key) + " must be a string";
+        return false;
+    }
+    *value = config[key].get<std::string>();
+    return true;
+}
+
+bool read_strings(const nlohmann::json& config, const char* key, std::vector<std::string>* values, std::string* error) {
+    if (!config.contains(key)) {
+        return true;
+    }
+    const auto& array = config[key];
+    bool valid = array.is_array() &&
+                 std::all_of(array.begin(), array.end(), [](const nlohmann::json& item) { return item.is_string(); });
+    if (!valid) {
+        *error = std::string(key) + " must be an array of strings";
+        return false;
+    }
+    values->clear();
+    for (const auto& item : array) {
+        values->push_back(item.get<std::string>());
+    }
+    return true;
+}
+
+int channels_of(int32_t format) {
+    switch (format) {
+        case LD_PIXEL_FORMAT_BGR:
+        case LD_PIXEL_FORMAT_RGB:
+            return 3;
+        case LD_PIXEL_FORMAT_BGRA:
+        case LD_PIXEL_FORMAT_RGBA:
+            return 4;
+        case LD_PIXEL_FORMAT_GRAY:
+            return 1;
+        default:
+            return 0;
+    }
+}
+
+// The frame as BGR: a view of data when it already is, otherwise converted into `converted`.
+cv::Mat bgr_frame(const uint8_t* data, int32_t width, int32_t height, size_t stride, int32_t format,
+                  cv::Mat& converted) {
+    int channels = channels_of(format);
+    cv::Mat frame(height, width, CV_8UC(channels), const_cast<uint8_t*>(data), stride);
+    switch (format) {
+        case LD_PIXEL_FORMAT_RGB:
+            cv::cvtColor(frame, converted, cv::COLOR_RGB2BGR);
+            return converted;
+        case LD_PIXEL_FORMAT_BGRA:
+            cv::cvtColor(frame, converted, cv::COLOR_BGRA2BGR);
+            return converted;
+        case LD_PIXEL_FORMAT_RGBA:
+            cv::cvtColor(frame, converted, cv::COLOR_RGBA2BGR);
+            return converted;
+        case LD_PIXEL_FORMAT_GRAY:
+            cv::cvtColor(frame, converted, cv::COLOR_GRAY2BGR);
+            return converted;
+        default:
+            return frame;
+    }
+}
+
+std::unique_ptr<ld_session> create_session(const nlohmann::json& config, std::string* error) {
+    if (!config.is_object()) {
+        *error = "config must be a JSON object";
+        return nullptr;
+    }
+    std::string model_path;
+    std::string font_path;
+    std::vector<std::string> gestures_folders;
+    std::vector<std::string> locales_paths;
+    AssetSnapshotStore::Sources sources;
+    LivenessSession::Config session_config;
+    session_config.language = "en";
+    if (!read_string(config, "model_path", &model_path, error) ||
+        !read_strings(config, "gestures_folders", &gestures_folders, error) ||
+        !read_strings(config, "locales_paths", &locales_paths, error) ||
+        !read_string(config, "assets_bundle_path", &sources.bundle_path, error) ||
+        !read_string(config, "font_path", &session_config.font_path, error) ||
+        !read_string(config, "flight_recorder_dir", &session_config.flight_recorder_dir, error) ||
+        !session_config.apply_request(config, error)) {
+        return nullptr;
+    }
+    int warmup_frames = 3;
+    if (config.contains("warmup_frames")) {
+        if (!config["warmup_frames"].is_number_integer() || config["warmup_frames"].get<int>() < 0) {
+            *error = "warmup_frames must be a non-negative integer";
+            return nullptr;
+        }
+        warmup_frames = config["warmup_frames"].get<int>();
+    }
+    bool watch_assets = false;
+    if (config.contains("watch_assets")) {
+        if (!config["watch_assets"].is_boolean()) {
+            *error = "watch_assets must be a boolean";
+            return nullptr;
+        }
+        watch_assets = config["watch_assets"].get<bool>();
+    }
+    if (model_path.empty()) {
+        *error = "model_path is required";
+        return nullptr;
+    }
+    if (gestures_folders.empty() && sources.bundle_path.empty()) {
+        *error = "gestures_folders or assets_bundle_path is required";
+        return nullptr;
+    }
+
+    // Same layout as the server: each gestures folder brings its locales and signals.
+    sources.gestures_folders = gestures_folders;
+    for (const auto& folder : gestures_folders) {
+        locales_paths.push_back(folder + "/locales");
+        sources.signals_paths.push_back(folder + "/signals");
+    }
+    sources.locales_paths = locales_paths;
+    sources.languages = {session_config.language};
+    session_config.workers = WorkerPool::shared();
+
+    auto handle = std::make_unique<ld_session>();
+    handle->store = std::make_unique<AssetSnapshotStore>(sources);
+    if (!handle->store->reload()) {
+        *error = "No gestures loaded";
+        return nullptr;
+    }
+    if (watch_assets) {
+        handle->store->start_watching();
+    }
+
+    handle->session = std::make_shared<LivenessSession>(handle->store->current(), session_config);
+    if (!handle->session->start(error)) {
+        return nullptr;
+    }
+
+    handle->processor = std::make_unique<FaceProcessor>(model_path);
+    LivenessSession* session = handle->session.get(); // outlives the processor, see ld_session
+    handle->processor->SetDoProcessImage(true);
+    handle->processor->SetCallback([session](const std::map<std::string, float>& blendshapes,
+                                             const std::map<std::string, float>& transformationValues,
+                                             int64_t timestamp_ms) {
+        session->on_face_result(blendshapes, transformationValues, timestamp_ms);
+    });
+    // Before warming up, so a rebuilt landmarker is what gets warmed.
+    handle->processor->SetOutputs(handle->session->landmarker_outputs());
+    handle->processor->WarmUp(warmup_frames);
+    return handle;
+}
+
+// Runs body, turning an exception into LD_ERROR_INTERNAL and the session's last error.
+template <typename Body>
+int guarded(ld_session* session, Body body) {
+    if (!session) {
+        return LD_ERROR_INVALID_ARGUMENT;
+    }
+    session->last_error.clear();
+    try {
+        return body();
+    } catch (const std::exception& e) {
+        session->last_error = e.what();
+    } catch (...) {
+        session->last_error = "unknown error";
+    }
+    LOG_ERROR("[C API] {}", session->last_error);
+    return LD_ERROR_INTERNAL;
+}
+
+} // end anonymous namespace
+
+extern "C" {
+
+uint32_t ld_abi_version(void) {
+    return LD_ABI_VERSION;
+}
+
+ld_session* ld_session_create(const char* config_json, char* error, size_t error_size) {
+    std::string reason;
+    try {
+        if (!config_json) {
+            reason = "config_json is null";
+        } else {
+            nlohmann::json config = nlohmann::json::parse(config_json, nullptr, false);
+            if (config.is_discarded()) {
+                reason = "config_json is not valid JSON";
+            } else if (auto session = create_session(config, &reason)) {
+                copy_truncated("", error, error_size);
+                return session.release();
+            }
+        }
+    } catch (const std::exception& e) {
+        reason = e.what();
+    } catch (...) {
+        reason = "unknown error";
+    }
+    LOG_ERROR("[C API] Unable to create session: {}", reason);
+    copy_truncated(reason, error, error_size);
+    return nullptr;
+}
+
+void ld_session_destroy(ld_session* session) {
+    try {
+        delete session;
+    } catch (...) {
+        // Nothing a C caller could do about it.
+    }
+}
+
+int ld_session_push_frame(ld_session* session, const uint8_t* data, int32_t width, int32_t height,
+                          size_t stride, int32_t format, int64_t timestamp_ms) {
+    return guarded(session, [&]() {
+        int channels = channels_of(format);
+        size_t row = static_cast<size_t>(width) * channels;
+        if (stride == 0) {
+            stride = row;
+        }
+        if (!data || width <= 0 || height <= 0 || channels == 0 || stride < row) {
+            session->last_error = "invalid frame";
+            return static_cast<int>(LD_ERROR_INVALID_ARGUMENT);
+        }
+        cv::Mat img = bgr_frame(data, width, height, stride, format, session->converted);
+        int64_t used_ms = -1;
+        if (session->session->admit_frame(img, timestamp_ms)) {
+            used_ms = session->processor->ProcessImage(img, timestamp_ms);
+        }
+        std::string callback_data = session->session->process_frame(img, session->overlay, used_ms);
+        session->has_overlay = true;
+        if (!callback_data.empty()) {
+            if (session->events.size() >= kMaxEvents) {
+                LOG_WARNING("[C API] Event queue full, dropping: {}", session->events.front());
+                session->events.pop_front();
+            }
+            session->events.push_back(std::move(callback_data));
+        }
+        return static_cast<int>(LD_OK);
+    });
+}
+
+int ld_session_overlay(ld_session* session, const uint8_t** data, int32_t* width, int32_t* height,
+                       size_t* stride) {
+    return guarded(session, [&]() {
+        if (!data || !width || !height || !stride) {
+            return static_cast<int>(LD_ERROR_INVALID_ARGUMENT);
+        }
+        if (!session->has_overlay) {
+            return static_cast<int>(LD_ERROR_NO_DATA);
+        }
+        *data = session->overlay.data;
+        *width = session->overlay.cols;
+        *height = session->overlay.rows;
+        *stride = session->overlay.step[0];
+        return static_cast<int>(LD_OK);
+    });
+}
+
+size_t ld_session_next_event(ld_session* session, char* buffer, size_t size) {
+    size_t length = 0;
+    guarded(session, [&]() {
+        if (session->events.empty()) {
+            return static_cast<int>(LD_ERROR_NO_DATA);
+        }
+        length = copy_out(session->events.front(), buffer, size);
+        if (length < size) {
+            session->events.pop_front();
+        }
+        return static_cast<int>(LD_OK);
+    });
+    return length;
+}
+
+int ld_session_next_binary(ld_session* session, ld_binary_message* message) {
+    return guarded(session, [&]() {
+        if (!message) {
+            return static_cast<int>(LD_ERROR_INVALID_ARGUMENT);
+        }
+        session->binary_landmarks.reset();
+        session->binary_payload.clear();
+        // Same order as the server: flight recorder dumps, snapshots, then landmarks.
+        if (auto dump = session->session->take_binary_message()) {
+            session->binary_header = std::move(dump->header);
+            session->binary_payload = std::move(dump->payload);
+        } else if (auto snapshot = session->session->take_snapshot()) {
+            session->binary_header = snapshot->header();
+            session->binary_payload = std::move(snapshot->data);
+        } else {
+            auto landmarks = session->processor->LatestLandmarks();
+            if (!session->session->config().send_landmarks || !landmarks ||
+                landmarks->timestamp_ms() == session->landmarks_sent_ms) {
+                return static_cast<int>(LD_ERROR_NO_DATA);
+            }
+            const uint16_t probe = 1;
+            const bool little_endian = *reinterpret_cast<const uint8_t*>(&probe) == 1;
+            nlohmann::json header = {
+                {"type", "landmarks"},
+                {"timestamp_ms", landmarks->timestamp_ms()},
+                {"count", landmarks->size()},
+                {"aspect", landmarks->aspect()},
+                {"dtype", little_endian ? "<f4" : ">f4"},
+            };
+            session->landmarks_sent_ms = landmarks->timestamp_ms();
+            session->binary_header = header.dump();
+            session->binary_landmarks = std::move(landmarks);
+        }
+        message->header = session->binary_header.c_str();
+        if (session->binary_landmarks) {
+            message->payload = reinterpret_cast<const uint8_t*>(session->binary_landmarks->data());
+            message->payload_size = session->binary_landmarks->bytes();
+        } else {
+            message->payload = session->binary_payload.data();
+            message->payload_size = session->binary_payload.size();
+        }
+        return static_cast<int>(LD_OK);
+    });
+}
+
+size_t ld_session_info(ld_session* session, char* buffer, size_t size) {
+    size_t length = 0;
+    guarded(session, [&]() {
+        length = copy_out(session->session->info().dump(), buffer, size);
+        return static_cast<int>(LD_OK);
+    });
+    return length;
+}
+
+int ld_session_control(ld_session* session, const char* request_json, char* reply, size_t reply_size) {
+    return guarded(session, [&]() {
+        copy_truncated("", reply, reply_size);
+        nlohmann::json request = request_json ? nlohmann::json::parse(request_json, nullptr, false)
+                                              : nlohmann::json(nullptr);
+        if (!request.is_object()) {
+            session->last_error = "request_json must be a JSON object";
+            return static_cast<int>(LD_ERROR_INVALID_ARGUMENT);
+        }
+        copy_truncated(session->session->handle_control(request), reply, reply_size);
+        return static_cast<int>(LD_OK);
+    });
+}
+
+const char* ld_session_last_error(const ld_session* session) {
+    return session ? session->last_error.c_str() : "";
+}
+
+} // extern "C"
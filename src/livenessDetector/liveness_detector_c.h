@@ -0,0 +1,124 @@
+/* C interface to the liveness pipeline, built as libliveness_detector.so, for
+ * runtimes that cannot link C++ (Go through cgo, Node through N-API or FFI)
+ * and would otherwise have to spawn livenessDetectorServer and use its socket.
+ *
+ * A session owns the landmarker and one verification; create one per camera
+ * stream. Calls on one session must not overlap, while different sessions may
+ * be used from different threads. Strings are UTF-8 and NUL terminated, JSON
+ * is the same as on the socket, and no call lets a C++ exception through.
+ *
+ *   ld_session* session = ld_session_create(config_json, error, sizeof error);
+ *   ld_session_push_frame(session, pixels, width, height, stride, LD_PIXEL_FORMAT_BGR, -1);
+ *   while (ld_session_next_event(session, event, sizeof event) ...)
+ *   ld_session_destroy(session);
+ */
+#ifndef LIVENESS_DETECTOR_C_H
+#define LIVENESS_DETECTOR_C_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined(__GNUC__)
+#define LD_API __attribute__((visibility("default")))
+#else
+#define LD_API
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Bumped whenever a signature or a struct of this header changes. */
+#define LD_ABI_VERSION 1
+
+typedef struct ld_session ld_session;
+
+/* 8 bits per channel, in memory order. */
+typedef enum ld_pixel_format {
+    LD_PIXEL_FORMAT_BGR = 0,
+    LD_PIXEL_FORMAT_RGB = 1,
+    LD_PIXEL_FORMAT_BGRA = 2,
+    LD_PIXEL_FORMAT_RGBA = 3,
+    LD_PIXEL_FORMAT_GRAY = 4
+} ld_pixel_format;
+
+typedef enum ld_status {
+    LD_OK = 0,
+    LD_ERROR_INVALID_ARGUMENT = -1,
+    LD_ERROR_NO_DATA = -2,
+    LD_ERROR_INTERNAL = -3
+} ld_status;
+
+/* One binary message, laid out as message 0x03 of the socket protocol: a
+ * flight recorder dump, a snapshot, or the landmarks of a result. */
+typedef struct ld_binary_message {
+    const char* header;     /* JSON, with "type" */
+    const uint8_t* payload;
+    size_t payload_size;
+} ld_binary_message;
+
+/* LD_ABI_VERSION of the library, to check against the header a caller was built with. */
+LD_API uint32_t ld_abi_version(void);
+
+/* Loads the landmarker and the gestures and starts a verification. config_json:
+ *   {"model_path":"face_landmarker.task","gestures_folders":["gestures"],
+ *    "locales_paths":[],"assets_bundle_path":"","font_path":"DejaVuSans.ttf",
+ *    "flight_recorder_dir":"","warmup_frames":3,"watch_assets":false,
+ *    "language":"en","num_gestures":2,"gestures_list":["blink","smile"],
+ *    "flight_recorder":true,"quality_gate":true,"landmarks":true,"snapshots":true}
+ * model_path and either gestures_folders or assets_bundle_path are required;
+ * the fields after watch_assets are those of the start_session handshake.
+ * Returns NULL and writes the reason to error (when error_size > 0) on failure. */
+LD_API ld_session* ld_session_create(const char* config_json, char* error, size_t error_size);
+
+/* Stops the landmarker and frees the session. NULL is ignored. */
+LD_API void ld_session_destroy(ld_session* session);
+
+/* Runs one frame through the landmarker and renders its overlay. data is read
+ * in place when format is LD_PIXEL_FORMAT_BGR, otherwise converted into a
+ * buffer the session reuses; it is not kept after the call returns. stride is
+ * the distance between rows in bytes, 0 for tightly packed rows. timestamp_ms
+ * is the capture time, negative to use the time of the call. Events and
+ * binary messages produced by the frame are queued for the calls below. */
+LD_API int ld_session_push_frame(ld_session* session, const uint8_t* data, int32_t width, int32_t height,
+                                 size_t stride, int32_t format, int64_t timestamp_ms);
+
+/* Overlay rendered for the last frame, BGR, owned by the session and valid
+ * until the next ld_session_push_frame or ld_session_destroy. Returns
+ * LD_ERROR_NO_DATA before the first frame. */
+LD_API int ld_session_overlay(ld_session* session, const uint8_t** data, int32_t* width, int32_t* height,
+                              size_t* stride);
+
+/* Copies the oldest queued event into buffer and dequeues it: the callback
+ * JSON of one frame, e.g. {"takeAPicture":true,"reportAlive":true} or
+ * {"suspiciousInput":{...}}, the same as the socket's 0x02 replies. Returns its length
+ * without the terminator, like snprintf: when that is not below size, nothing
+ * is copied or dequeued, so the call can be repeated with a larger buffer.
+ * Returns 0 when no event is queued. */
+LD_API size_t ld_session_next_event(ld_session* session, char* buffer, size_t size);
+
+/* Dequeues the next binary message into message, owned by the session and
+ * valid until the next call of this function, ld_session_push_frame or
+ * ld_session_destroy. Landmarks are only sent when the session was created
+ * with "landmarks":true, snapshots with "snapshots". Returns LD_ERROR_NO_DATA
+ * when nothing is waiting. */
+LD_API int ld_session_next_binary(ld_session* session, ld_binary_message* message);
+
+/* Copies the description of the running verification (language, gestures,
+ * generation of the assets) into buffer; returns its length as ld_session_next_event does. */
+LD_API size_t ld_session_info(ld_session* session, char* buffer, size_t size);
+
+/* Handles a control message of the socket protocol, e.g.
+ * {"action":"set","variable":"overwrite_text","value":"..."} or {"action":"new_session"},
+ * and writes its reply, possibly empty and truncated to size - 1 bytes, to reply. */
+LD_API int ld_session_control(ld_session* session, const char* request_json, char* reply, size_t reply_size);
+
+/* Reason for the last call of this session that failed; "" when none did.
+ * Valid until the next call on the session. */
+LD_API const char* ld_session_last_error(const ld_session* session);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* LIVENESS_DETECTOR_C_H */
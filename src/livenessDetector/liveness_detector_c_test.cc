@@ -0,0 +1,125 @@
+#include "liveness_detector_c.h"
+#include "test_check.h"
+#include <iostream>
+#include <cstring>
+#include <string>
+#include <vector>
+
+// Without arguments only the failure paths are exercised; with a model and a
+// gestures folder, a session is also run on synthetic frames.
+int main(int argc, char** argv) {
+    TEST_CHECK(ld_abi_version() == LD_ABI_VERSION);
+
+    // Creation failures come back as NULL and a reason, never as an exception
+    char error[256];
+    auto refused = [&error](const char* config, const char* reason) {
+        TEST_CHECK(ld_session_create(config, error, sizeof error) == nullptr);
+        TEST_CHECK(reason ? std::string(error) == reason : std::strlen(error) > 0);
+    };
+    refused(nullptr, nullptr);
+    refused("{not json", "config_json is not valid JSON");
+    refused("{\"gestures_folders\":[\"gestures\"]}", "model_path is required");
+    refused("{\"model_path\":\"m.task\"}", "gestures_folders or assets_bundle_path is required");
+    refused("{\"model_path\":\"m.task\",\"gestures_folders\":\"gestures\"}",
+            "gestures_folders must be an array of strings");
+    refused("{\"model_path\":\"m.task\",\"gestures_folders\":[],\"num_gestures\":\"2\"}",
+            "num_gestures must be an integer");
+    char small[8];
+    TEST_CHECK(ld_session_create("{\"model_path\":\"m.task\"}", small, sizeof small) == nullptr);
+    TEST_CHECK(std::string(small) == "model_p"); // truncated, still terminated
+    TEST_CHECK(ld_session_create("{}", nullptr, 0) == nullptr);
+    std::cout << "Invalid configurations rejected\n";
+
+    // A NULL session is refused by every call
+    ld_session_destroy(nullptr);
+    uint8_t pixel[3] = {0, 0, 0};
+    TEST_CHECK(ld_session_push_frame(nullptr, pixel, 1, 1, 0, LD_PIXEL_FORMAT_BGR, -1) == LD_ERROR_INVALID_ARGUMENT);
+    ld_binary_message message;
+    TEST_CHECK(ld_session_next_binary(nullptr, &message) == LD_ERROR_INVALID_ARGUMENT);
+    char buffer[4096];
+    TEST_CHECK(ld_session_next_event(nullptr, buffer, sizeof buffer) == 0);
+    TEST_CHECK(ld_session_info(nullptr, buffer, sizeof buffer) == 0);
+    TEST_CHECK(ld_session_control(nullptr, "{}", buffer, sizeof buffer) == LD_ERROR_INVALID_ARGUMENT);
+    TEST_CHECK(std::string(ld_session_last_error(nullptr)).empty());
+    std::cout << "NULL session refused\n";
+
+    if (argc < 3) {
+        std::cout << "Usage: " << argv[0] << " <model_path> <gestures_folder> to also run a session\n";
+        std::cout << "Test completed.\n";
+        return 0;
+    }
+
+    std::string config = std::string("{\"model_path\":\"") + argv[1] + "\",\"gestures_folders\":[\"" + argv[2] +
+                         "\"],\"num_gestures\":1,\"warmup_frames\":1,\"landmarks\":true}";
+    ld_session* session = ld_session_create(config.c_str(), error, sizeof error);
+    if (!session) {
+        std::cerr << "Unable to create session: " << error << "\n";
+        return 1;
+    }
+
+    // Info is copied like snprintf: the length first, the text once it fits
+    size_t length = ld_session_info(session, nullptr, 0);
+    TEST_CHECK(length > 0);
+    std::vector<char> info(length + 1);
+    TEST_CHECK(ld_session_info(session, info.data(), info.size()) == length);
+    TEST_CHECK(std::string(info.data()).find("\"gestures\"") != std::string::npos);
+    std::cout << "Session: " << info.data() << "\n";
+
+    const uint8_t* overlay;
+    int32_t width, height;
+    size_t stride;
+    TEST_CHECK(ld_session_overlay(session, &overlay, &width, &height, &stride) == LD_ERROR_NO_DATA);
+
+    // Frames in every format, with padded rows; the overlay is always BGR
+    const int32_t frame_width = 320, frame_height = 240;
+    const int32_t formats[] = {LD_PIXEL_FORMAT_BGR, LD_PIXEL_FORMAT_RGB, LD_PIXEL_FORMAT_BGRA,
+                               LD_PIXEL_FORMAT_RGBA, LD_PIXEL_FORMAT_GRAY};
+    const size_t channels[] = {3, 3, 4, 4, 1};
+    for (size_t f = 0; f < 5; ++f) {
+        size_t frame_stride = frame_width * channels[f] + 16;
+        std::vector<uint8_t> frame(frame_stride * frame_height, static_cast<uint8_t>(60 + 30 * f));
+        for (int i = 0; i < 3; ++i) {
+            TEST_CHECK(ld_session_push_frame(session, frame.data(), frame_width, frame_height, frame_stride,
+                                             formats[f], -1) == LD_OK);
+        }
+        TEST_CHECK(ld_session_overlay(session, &overlay, &width, &height, &stride) == LD_OK);
+        TEST_CHECK(overlay && width == frame_width && height == frame_height && stride >= 3u * frame_width);
+    }
+    std::cout << "Frames pushed in every pixel format\n";
+
+    // Bad frames are refused with a reason, and do not end the session
+    TEST_CHECK(ld_session_push_frame(session, nullptr, 320, 240, 0, LD_PIXEL_FORMAT_BGR, -1) == LD_ERROR_INVALID_ARGUMENT);
+    TEST_CHECK(std::string(ld_session_last_error(session)) == "invalid frame");
+    std::vector<uint8_t> frame(320 * 240 * 3);
+    TEST_CHECK(ld_session_push_frame(session, frame.data(), 320, 240, 100, LD_PIXEL_FORMAT_BGR, -1) == LD_ERROR_INVALID_ARGUMENT);
+    TEST_CHECK(ld_session_push_frame(session, frame.data(), 320, 240, 0, 42, -1) == LD_ERROR_INVALID_ARGUMENT);
+    TEST_CHECK(ld_session_push_frame(session, frame.data(), 320, 240, 0, LD_PIXEL_FORMAT_BGR, -1) == LD_OK);
+    TEST_CHECK(std::string(ld_session_last_error(session)).empty());
+    std::cout << "Invalid frames refused\n";
+
+    // A too small buffer leaves the event queued
+    size_t event_length;
+    while ((event_length = ld_session_next_event(session, buffer, 1)) > 0) {
+        std::vector<char> event(event_length + 1);
+        TEST_CHECK(ld_session_next_event(session, event.data(), event.size()) == event_length);
+        std::cout << "Event: " << event.data() << "\n";
+    }
+
+    // Control messages, then the on-demand flight recorder dump as a binary message
+    TEST_CHECK(ld_session_control(session, "[1]", buffer, sizeof buffer) == LD_ERROR_INVALID_ARGUMENT);
+    TEST_CHECK(ld_session_control(session, "{\"action\":\"set\",\"variable\":\"overwrite_text\",\"value\":\"hi\"}",
+                                  buffer, sizeof buffer) == LD_OK);
+    TEST_CHECK(ld_session_control(session, "{\"action\":\"new_session\"}", buffer, sizeof buffer) == LD_OK);
+    TEST_CHECK(std::string(buffer).find("\"started\":true") != std::string::npos);
+    TEST_CHECK(ld_session_control(session, "{\"action\":\"dump_flight_recorder\"}", buffer, sizeof buffer) == LD_OK);
+    TEST_CHECK(ld_session_next_binary(session, &message) == LD_OK);
+    TEST_CHECK(std::string(message.header).find("flight_recorder") != std::string::npos);
+    while (ld_session_next_binary(session, &message) == LD_OK) {
+        std::cout << "Binary message: " << message.header << ", " << message.payload_size << " bytes\n";
+    }
+    std::cout << "Control messages handled\n";
+
+    ld_session_destroy(session);
+    std::cout << "Test completed.\n";
+    return 0;
+}
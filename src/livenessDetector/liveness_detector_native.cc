@@ -0,0 +1,314 @@
+// Python extension running the liveness pipeline in-process: frames are passed as
+// NumPy arrays without copying, inference and rendering run with the GIL released,
+// and overlay frames come back as NumPy views of pooled buffers.
+#include "asset_snapshot.h"
+#include "face_processor.h"
+#include "liveness_session.h"
+#include "nlohmann/json.hpp"
+
+#include <pybind11/pybind11.h>
+#include <pybind11/numpy.h>
+#include <pybind11/stl.h>
+
+#include <opencv2/opencv.hpp>
+#include <atomic>
+#include <memory>
+#include <optional>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace py = pybind11;
+
+namespace {
+
+// Overlay frames handed to Python. A buffer is reused once every NumPy view of it
+// has been released, which is when the pool holds the only reference. Only touched
+// with the GIL held, so the reference counts cannot change under us.
+class FrameBufferPool {
+public:
+    std::shared_ptr<cv::Mat> acquire() {
+        for (const auto& buffer : buffers_) {
+            if (buffer.use_count() == 1) {
+                return buffer;
+            }
+        }
+        auto buffer = std::make_shared<cv::Mat>();
+        if (buffers_.size() < kMaxBuffers) {
+            buffers_.push_back(buffer);
+        }
+        return buffer;
+    }
+
+private:
+    static constexpr size_t kMaxBuffers = 4;
+    std::vector<std::shared_ptr<cv::Mat>> buffers_;
+};
+
+py::array to_numpy_view(std::shared_ptr<cv::Mat> buffer) {
+    const cv::Mat& mat = *buffer;
+    auto* owner = new std::shared_ptr<cv::Mat>(std::move(buffer));
+    py::capsule capsule(owner, [](void* p) { delete static_cast<std::shared_ptr<cv::Mat>*>(p); });
+    return py::array_t<uint8_t>(
+        {static_cast<py::ssize_t>(mat.rows), static_cast<py::ssize_t>(mat.cols), static_cast<py::ssize_t>(mat.channels())},
+        {static_cast<py::ssize_t>(mat.step[0]), static_cast<py::ssize_t>(mat.elemSize()), static_cast<py::ssize_t>(1)},
+        mat.data,
+        capsule);
+}
+
+// Landmarks of one result as (header dict, 3 x count float32 array). The
+// array is a read-only view of the pooled buffer, which is recycled once
+// Python releases it.
+py::tuple to_landmarks(std::shared_ptr<const LandmarkBuffer> landmarks) {
+    py::dict header;
+    header["timestamp_ms"] = landmarks->timestamp_ms();
+    header["count"] = landmarks->size();
+    header["aspect"] = landmarks->aspect();
+    const py::ssize_t count = static_cast<py::ssize_t>(landmarks->size());
+    const float* data = landmarks->data();
+    auto* owner = new std::shared_ptr<const LandmarkBuffer>(std::move(landmarks));
+    py::capsule capsule(owner, [](void* p) { delete static_cast<std::shared_ptr<const LandmarkBuffer>*>(p); });
+    py::array_t<float> array({static_cast<py::ssize_t>(3), count},
+                             {count * static_cast<py::ssize_t>(sizeof(float)), static_cast<py::ssize_t>(sizeof(float))},
+                             data, capsule);
+    array.attr("setflags")(py::arg("write") = false);
+    return py::make_tuple(header, array);
+}
+
+py::dict to_dict(const nlohmann::json& j) {
+    py::dict result;
+    for (auto it = j.begin(); it != j.end(); ++it) {
+        const auto& value = it.value();
+        if (value.is_boolean()) {
+            result[py::str(it.key())] = value.get<bool>();
+        } else if (value.is_number_integer()) {
+            result[py::str(it.key())] = value.get<int64_t>();
+        } else if (value.is_string()) {
+            result[py::str(it.key())] = value.get<std::string>();
+        } else if (value.is_array()) {
+            py::list items;
+            for (const auto& item : value) {
+                items.append(item.is_string() ? py::cast(item.get<std::string>()) : py::cast(item.dump()));
+            }
+            result[py::str(it.key())] = items;
+        } else {
+            result[py::str(it.key())] = value.dump();
+        }
+    }
+    return result;
+}
+
+} // end anonymous namespace
+
+// One detector per camera stream: process_frame is not meant to be called from
+// several Python threads at once.
+class NativeLivenessDetector {
+public:
+    NativeLivenessDetector(const std::string& model_path,
+                           const std::vector<std::string>& gestures_folders,
+                           const std::vector<std::string>& locales_paths,
+                           const std::string& font_path,
+                           const std::string& language,
+                           int num_gestures,
+                           const std::vector<std::string>& gestures_list,
+                           const std::string& assets_bundle_path,
+                           int warmup_frames,
+                           bool watch_assets)
+        : store_(make_sources(gestures_folders, locales_paths, assets_bundle_path, language)),
+          processor_(model_path) {
+        defaults_.language = language;
+        defaults_.num_gestures = num_gestures;
+        defaults_.font_path = font_path;
+        defaults_.allowed_gestures.insert(gestures_list.begin(), gestures_list.end());
+
+        if (!store_.reload()) {
+            throw std::runtime_error("No gestures loaded");
+        }
+        if (watch_assets) {
+            store_.start_watching();
+        }
+
+        processor_.SetDoProcessImage(true);
+        processor_.SetCallback([this](const std::map<std::string, float>& blendshapes,
+                                      const std::map<std::string, float>& transformationValues,
+                                      int64_t timestamp_ms) {
+            auto session = std::atomic_load(&session_);
+            if (session) {
+                session->on_face_result(blendshapes, transformationValues, timestamp_ms);
+            }
+        });
+        processor_.WarmUp(warmup_frames);
+        warmup_frames_ = warmup_frames;
+    }
+
+    py::dict start_session(std::optional<std::string> language,
+                           std::optional<int> num_gestures,
+                           std::optional<std::vector<std::string>> gestures_list) {
+        LivenessSession::Config config = defaults_;
+        if (language) config.language = *language;
+        if (num_gestures) config.num_gestures = *num_gestures;
+        if (gestures_list) config.allowed_gestures = std::set<std::string>(gestures_list->begin(), gestures_list->end());
+
+        std::shared_ptr<LivenessSession> session;
+        std::string error;
+        {
+            py::gil_scoped_release release;
+            session = std::make_shared<LivenessSession>(store_.current(), config);
+            if (!session->start(&error)) {
+                session.reset();
+            } else if (processor_.SetOutputs(session->landmarker_outputs())) {
+                processor_.WarmUp(warmup_frames_);
+            }
+        }
+        if (!session) {
+            throw std::runtime_error("Unable to start session: " + error);
+        }
+        std::atomic_store(&session_, session);
+
+        nlohmann::json info = session->info();
+        info["started"] = true;
+        return to_dict(info);
+    }
+
+    py::dict new_session() {
+        auto session = current_session();
+        nlohmann::json reply = nlohmann::json::parse(session->handle_control({{"action", "new_session"}}));
+        return to_dict(reply["session"]);
+    }
+
+    py::array process_frame(py::array_t<uint8_t, py::array::c_style | py::array::forcecast> frame) {
+        if (frame.ndim() != 3 || frame.shape(2) != 3) {
+            throw std::invalid_argument("frame must be a HxWx3 uint8 BGR array");
+        }
+        auto session = current_session();
+        auto buffer = pool_.acquire();
+
+        // Wraps the NumPy memory; `frame` keeps it alive while the GIL is released.
+        cv::Mat img(static_cast<int>(frame.shape(0)), static_cast<int>(frame.shape(1)), CV_8UC3,
+                    const_cast<uint8_t*>(frame.data()));
+        std::string callback_data;
+        {
+            py::gil_scoped_release release;
+            int64_t timestamp_ms = -1;
+            if (session->admit_frame(img)) {
+                timestamp_ms = processor_.ProcessImage(img);
+            }
+            callback_data = session->process_frame(img, *buffer, timestamp_ms);
+        }
+
+        if (!callback_data.empty()) {
+            dispatch_callbacks(callback_data);
+        }
+        return to_numpy_view(std::move(buffer));
+    }
+
+    // Landmarks of the latest result, None when it found no face.
+    py::object latest_landmarks() {
+        auto landmarks = processor_.LatestLandmarks();
+        if (!landmarks) {
+            return py::none();
+        }
+        return to_landmarks(std::move(landmarks));
+    }
+
+    void set_overwrite_text(const std::string& text) {
+        current_session()->handle_control({{"action", "set"}, {"variable", "overwrite_text"}, {"value", text}});
+    }
+
+    void set_warning_message(const std::string& text) {
+        current_session()->handle_control({{"action", "set"}, {"variable", "warning_message"}, {"value", text}});
+    }
+
+    void set_string_callback(py::object callback) { string_callback_ = as_callback(std::move(callback)); }
+    void set_take_picture_callback(py::object callback) { take_picture_callback_ = as_callback(std::move(callback)); }
+    void set_report_alive_callback(py::object callback) { report_alive_callback_ = as_callback(std::move(callback)); }
+    void set_suspicious_input_callback(py::object callback) { suspicious_input_callback_ = as_callback(std::move(callback)); }
+
+private:
+    AssetSnapshotStore store_;
+    LivenessSession::Config defaults_;
+    int warmup_frames_ = 0;
+    std::shared_ptr<LivenessSession> session_;
+    FrameBufferPool pool_;
+    // Null until set: the constructor runs without the GIL and cannot touch Python objects.
+    py::object string_callback_;
+    py::object take_picture_callback_;
+    py::object report_alive_callback_;
+    py::object suspicious_input_callback_;
+    FaceProcessor processor_; // last: stops delivering results before the session goes away
+
+    static AssetSnapshotStore::Sources make_sources(const std::vector<std::string>& gestures_folders,
+                                                    std::vector<std::string> locales_paths,
+                                                    const std::string& assets_bundle_path,
+                                                    const std::string& language) {
+        AssetSnapshotStore::Sources sources;
+        sources.gestures_folders = gestures_folders;
+        for (const auto& folder : gestures_folders) {
+            locales_paths.push_back(folder + "/locales");
+            sources.signals_paths.push_back(folder + "/signals");
+        }
+        sources.locales_paths = locales_paths;
+        sources.bundle_path = assets_bundle_path;
+        sources.languages = {language};
+        return sources;
+    }
+
+    static py::object as_callback(py::object callback) {
+        return callback.is_none() ? py::object() : std::move(callback);
+    }
+
+    std::shared_ptr<LivenessSession> current_session() {
+        auto session = std::atomic_load(&session_);
+        if (!session) {
+            start_session(std::nullopt, std::nullopt, std::nullopt);
+            session = std::atomic_load(&session_);
+        }
+        return session;
+    }
+
+    // Called with the GIL held, after the frame has been processed.
+    void dispatch_callbacks(const std::string& callback_data) {
+        if (string_callback_) {
+            string_callback_(callback_data);
+        }
+        auto events = nlohmann::json::parse(callback_data);
+        if (events.contains("takeAPicture") && take_picture_callback_) {
+            take_picture_callback_(events["takeAPicture"].get<bool>());
+        }
+        if (events.contains("reportAlive") && report_alive_callback_) {
+            report_alive_callback_(events["reportAlive"].get<bool>());
+        }
+        if (events.contains("suspiciousInput") && suspicious_input_callback_) {
+            suspicious_input_callback_(to_dict(events["suspiciousInput"]));
+        }
+    }
+};
+
+PYBIND11_MODULE(liveness_detector_native, m) {
+    m.doc() = "In-process liveness detector";
+
+    py::class_<NativeLivenessDetector>(m, "NativeLivenessDetector")
+        .def(py::init<const std::string&, const std::vector<std::string>&, const std::vector<std::string>&,
+                      const std::string&, const std::string&, int, const std::vector<std::string>&,
+                      const std::string&, int, bool>(),
+             py::arg("model_path"), py::arg("gestures_folders"), py::arg("locales_paths"),
+             py::arg("font_path"), py::arg("language"), py::arg("num_gestures"),
+             py::arg("gestures_list") = std::vector<std::string>(),
+             py::arg("assets_bundle_path") = "",
+             py::arg("warmup_frames") = 3,
+             py::arg("watch_assets") = false,
+             py::call_guard<py::gil_scoped_release>())
+        .def("start_session", &NativeLivenessDetector::start_session,
+             py::arg("language") = py::none(), py::arg("num_gestures") = py::none(),
+             py::arg("gestures_list") = py::none())
+        .def("new_session", &NativeLivenessDetector::new_session)
+        .def("process_frame", &NativeLivenessDetector::process_frame, py::arg("frame"))
+        .def("latest_landmarks", &NativeLivenessDetector::latest_landmarks)
+        .def("set_overwrite_text", &NativeLivenessDetector::set_overwrite_text)
+        .def("set_warning_message", &NativeLivenessDetector::set_warning_message)
+        .def("set_string_callback", &NativeLivenessDetector::set_string_callback)
+        .def("set_take_picture_callback", &NativeLivenessDetector::set_take_picture_callback)
+        .def("set_report_alive_callback", &NativeLivenessDetector::set_report_alive_callback)
+        .def("set_suspicious_input_callback", &NativeLivenessDetector::set_suspicious_input_callback);
+}
@@ -0,0 +1,573 @@
+#include "liveness_session.h"
+#include "logger.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <filesystem>
+#include <unordered_map>
+
+std::string verify_correct_face(
+    const std::map<std::string, float>& face_square_normalized_points,
+    const TranslationManager* translator,
+    bool glasses,
+    float percentage_min_face_width,
+    float percentage_max_face_width,
+    float percentage_min_face_height,
+    float percentage_max_face_height,
+    float percentage_center_allowed_offset
+) {
+    // 1. Check if points exist
+    const char* required_keys[] = {"Top Square", "Left Square", "Right Square", "Bottom Square"};
+    for (const auto& key : required_keys) {
+        if (face_square_normalized_points.find(key) == face_square_normalized_points.end()) {
+            return translator->translate("warning.face_not_detected_message");
+        }
+    }
+
+    // 2. Glasses check
+    if (glasses) {
+        return translator->translate("warning.face_with_glasses_message");
+    }
+
+    // 3. Get coords
+    float topSquare    = face_square_normalized_points.at("Top Square");
+    float leftSquare   = face_square_normalized_points.at("Left Square");
+    float rightSquare  = face_square_normalized_points.at("Right Square");
+    float bottomSquare = face_square_normalized_points.at("Bottom Square");
+
+    // Quick fail if not valid detection
+    if (topSquare < 0 || leftSquare < 0 || rightSquare < 0 || bottomSquare < 0) {
+        return translator->translate("warning.face_not_detected_message");
+    }
+
+    // 4. Face width/height, center
+    float face_width  = rightSquare - leftSquare;
+    float face_height = bottomSquare - topSquare;
+    float face_center_x = (rightSquare + leftSquare) / 2.0f;
+    float face_center_y = (topSquare    + bottomSquare) / 2.0f;
+
+    // 5. Checks
+    if (!(percentage_min_face_width <= face_width && face_width <= percentage_max_face_width)) {
+        return translator->translate("warning.wrong_face_width_message");
+    }
+    if (!(percentage_min_face_height <= face_height && face_height <= percentage_max_face_height)) {
+        return translator->translate("warning.wrong_face_height_message");
+    }
+    float center = 0.5f;
+    if (!(center - percentage_center_allowed_offset <= face_center_x && face_center_x <= center + percentage_center_allowed_offset) ||
+        !(center - percentage_center_allowed_offset <= face_center_y && face_center_y <= center + percentage_center_allowed_offset)) {
+        return translator->translate("warning.wrong_face_center_message");
+    }
+
+    // OK!
+    return "";
+}
+
+namespace {
+
+// What a landmarker result tells about its frame; the face box is -1 when no face was found.
+BestFrameBuffer::Cues frame_cues(const std::map<std::string, float>& values) {
+    BestFrameBuffer::Cues cues;
+    auto left = values.find("Left Square");
+    auto right = values.find("Right Square");
+    auto top = values.find("Top Square");
+    auto bottom = values.find("Bottom Square");
+    if (left != values.end() && right != values.end() && top != values.end() && bottom != values.end() &&
+        left->second >= 0 && top->second >= 0 && right->second > left->second && bottom->second > top->second) {
+        cues.face = cv::Rect2f(left->second, top->second, right->second - left->second,
+                               bottom->second - top->second);
+    }
+    // Yaw is left out: its angle is unstable around a frontal pose.
+    auto pitch = values.find("Transformation Pitch");
+    auto roll = values.find("Transformation Roll");
+    if (pitch != values.end() && roll != values.end()) {
+        cues.pose = std::max(std::abs(pitch->second), std::abs(roll->second));
+    }
+    return cues;
+}
+
+} // namespace
+
+bool LivenessSession::Config::apply_request(const nlohmann::json& request, std::string* error) {
+    if (request.contains("language")) {
+        if (!request["language"].is_string()) {
+            if (error) *error = "language must be a string";
+            return false;
+        }
+        language = request["language"].get<std::string>();
+    }
+    if (request.contains("num_gestures")) {
+        if (!request["num_gestures"].is_number_integer()) {
+            if (error) *error = "num_gestures must be an integer";
+            return false;
+        }
+        num_gestures = request["num_gestures"].get<int>();
+    }
+    if (request.contains("gestures_list")) {
+        if (!request["gestures_list"].is_array()) {
+            if (error) *error = "gestures_list must be an array of gesture names";
+            return false;
+        }
+        allowed_gestures.clear();
+        for (const auto& name : request["gestures_list"]) {
+            if (!name.is_string()) {
+                if (error) *error = "gestures_list must be an array of gesture names";
+                return false;
+            }
+            allowed_gestures.insert(name.get<std::string>());
+        }
+    }
+    if (request.contains("flight_recorder")) {
+        if (!request["flight_recorder"].is_boolean()) {
+            if (error) *error = "flight_recorder must be a boolean";
+            return false;
+        }
+        send_flight_recorder = request["flight_recorder"].get<bool>();
+    }
+    if (request.contains("quality_gate")) {
+        if (!request["quality_gate"].is_boolean()) {
+            if (error) *error = "quality_gate must be a boolean";
+            return false;
+        }
+        quality_gate = request["quality_gate"].get<bool>();
+    }
+    if (request.contains("landmarks")) {
+        if (!request["landmarks"].is_boolean()) {
+            if (error) *error = "landmarks must be a boolean";
+            return false;
+        }
+        send_landmarks = request["landmarks"].get<bool>();
+    }
+    if (request.contains("snapshots")) {
+        const auto& value = request["snapshots"];
+        if (value.is_boolean()) {
+            snapshots = value.get<bool>();
+        } else if (value.is_object()) {
+            std::string snapshot_error;
+            if (!snapshot.apply_request(value, &snapshot_error) ||
+                !best_frame.apply_request(value, &snapshot_error)) {
+                if (error) *error = snapshot_error;
+                return false;
+            }
+            snapshots = true;
+        } else {
+            if (error) *error = "snapshots must be a boolean or an object";
+            return false;
+        }
+    }
+    return true;
+}
+
+LivenessSession::LivenessSession(std::shared_ptr<const AssetSnapshot> snapshot, Config config)
+    : snapshot_(std::move(snapshot)),
+      config_(std::move(config)),
+      translator_(snapshot_->translator(config_.language)),
+      filter_bank_(snapshot_->signal_filters),
+      quality_gate_(config_.quality),
+      jobs_token_(std::make_shared<CancellationToken>()),
+      callback_data_json_(nlohmann::json::object()) {
+    if (config_.snapshots) {
+        snapshots_ = std::make_unique<SnapshotStore>(config_.snapshot, config_.workers, jobs_token_);
+        best_frames_ = std::make_unique<BestFrameBuffer>(config_.best_frame);
+    }
+}
+
+LivenessSession::~LivenessSession() {
+    // Snapshots nobody will collect: drop the encodings still queued.
+    if (config_.workers) {
+        config_.workers->cancel(jobs_token_);
+    }
+    if (requester_) {
+        requester_->cleanup();
+    }
+}
+
+bool LivenessSession::start(std::string* error) {
+    std::vector<GestureDetector::AddResult> selected;
+    const auto& templates = snapshot_->gesture_template.get_gestures();
+    for (size_t i = 0; i < snapshot_->gestures.size(); ++i) {
+        const auto& entry = snapshot_->gestures[i];
+        if (config_.allowed_gestures.empty() || config_.allowed_gestures.count(entry.name) > 0) {
+            detector_.add_gesture(std::make_unique<Gesture>(*templates[i]));
+            selected.push_back(entry.info);
+        }
+    }
+
+    if (selected.empty()) {
+        if (error) *error = "No gestures loaded.";
+        return false;
+    }
+    if (config_.num_gestures > static_cast<int>(selected.size())) {
+        if (error) *error = "Requested number of gestures exceeds available gestures.";
+        return false;
+    }
+
+    detector_.set_flight_recorder(&recorder_);
+    requester_ = std::make_unique<GesturesRequester>(config_.num_gestures,
+                                                     &detector_,
+                                                     translator_.get(),
+                                                     config_.font_path,
+                                                     GesturesRequester::DebugLevel::INFO);
+    requester_->set_flight_recorder(&recorder_);
+
+    requester_->set_ask_to_take_picture_callback([this](const std::string& gesture_id) {
+        LOG_INFO("[Callback] Ask to take picture triggered by {}.", gesture_id);
+        std::lock_guard<std::mutex> lock(events_mutex_);
+        callback_data_json_["takeAPicture"] = true;
+        if (snapshots_) {
+            // The landmarker thread has no frame: the frame thread picks one once the window has passed.
+            // Called under sequence_mutex_, from a result or a render.
+            pending_pictures_.push_back({gesture_id, result_ms_});
+        }
+    });
+
+    requester_->set_report_alive_callback([this](bool alive) {
+        LOG_INFO("[Callback] GesturesRequester is {}.", alive ? "alive" : "not alive");
+        std::lock_guard<std::mutex> lock(events_mutex_);
+        callback_data_json_["reportAlive"] = alive;
+        if (!alive) {
+            not_alive_pending_ = true;
+        }
+    });
+
+    requester_->set_asset_bundle(snapshot_->bundle);
+    requester_->set_gestures_list(selected);
+    return true;
+}
+
+void LivenessSession::restart() {
+    {
+        std::lock_guard<std::mutex> lock(sequence_mutex_);
+        filter_bank_.reset();
+        requester_->restart();
+    }
+    std::lock_guard<std::mutex> lock(events_mutex_);
+    callback_data_json_ = nlohmann::json::object();
+    warning_message_.clear();
+    quality_warning_.clear();
+    pending_pictures_.clear();
+    result_cues_.clear();
+}
+
+LandmarkerOutputs LivenessSession::landmarker_outputs() const {
+    // verify_correct_face reads the face box
+    std::set<std::string> signals = {"Top Square", "Left Square", "Right Square", "Bottom Square"};
+    if (snapshots_) {
+        // The head pose weighs in when picking the snapshot's frame
+        signals.insert({"Transformation Pitch", "Transformation Roll"});
+    }
+    std::lock_guard<std::mutex> lock(sequence_mutex_);
+    if (!detector_.collect_signals(signals)) {
+        return LandmarkerOutputs::all(snapshot_->derived_signals);
+    }
+    filter_bank_.resolve_sources(signals);
+    return LandmarkerOutputs::for_signals(signals, snapshot_->derived_signals);
+}
+
+nlohmann::json LivenessSession::info() const {
+    nlohmann::json info;
+    info["generation"] = snapshot_->generation;
+    info["language"] = config_.language;
+    std::lock_guard<std::mutex> lock(sequence_mutex_);
+    info["gestures"] = requester_->get_requested_gesture_ids();
+    return info;
+}
+
+void LivenessSession::on_face_result(const std::map<std::string, float>& blendshapes,
+                                     const std::map<std::string, float>& transformationValues,
+                                     int64_t timestamp_ms) {
+    // Gestures read blendshapes and head pose ("Transformation Pitch", ...) alike.
+    std::unordered_map<std::string, double> signals;
+    for (const auto& pair : blendshapes) {
+        signals[pair.first] = static_cast<double>(pair.second);
+    }
+    for (const auto& pair : transformationValues) {
+        signals[pair.first] = static_cast<double>(pair.second);
+    }
+    uint64_t tick_start_ns = FlightRecorder::now_ns();
+    {
+        std::lock_guard<std::mutex> lock(sequence_mutex_);
+        last_signals_ = signals;
+        result_ms_ = timestamp_ms;
+        tick_signals(signals, timestamp_ms);
+    }
+    uint64_t tick_end_ns = FlightRecorder::now_ns();
+    recorder_.record(FlightRecorder::Type::Latency, static_cast<uint16_t>(FlightRecorder::Stage::SignalTick),
+                     static_cast<uint32_t>((tick_end_ns - tick_start_ns) / 1000), 0.0, tick_end_ns);
+
+    std::string warning = verify_correct_face(transformationValues, translator_.get());
+    std::lock_guard<std::mutex> lock(events_mutex_);
+    warning_message_ = std::move(warning);
+    if (snapshots_) {
+        result_cues_.emplace_back(timestamp_ms, frame_cues(transformationValues));
+    }
+}
+
+bool LivenessSession::admit_frame(const cv::Mat& img, int64_t timestamp_ms) {
+    if (!config_.quality_gate) {
+        return true;
+    }
+    FrameQualityGate::Verdict verdict = quality_gate_.assess(img);
+    if (verdict == FrameQualityGate::Verdict::Repeated) {
+        // Same picture as the previous frame, so the landmarks would be the same too.
+        if (timestamp_ms < 0) {
+            timestamp_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+                std::chrono::system_clock::now().time_since_epoch()).count();
+        }
+        replay_last_result(timestamp_ms);
+        return false;
+    }
+
+    const auto& metrics = quality_gate_.metrics();
+    std::string warning;
+    if (verdict != FrameQualityGate::Verdict::Ok) {
+        LOG_DEBUG("[QualityGate] Skipped frame: {} (luminance {}, sharpness {}, repeat difference {})",
+                  FrameQualityGate::warning_key(verdict), metrics.luminance, metrics.sharpness,
+                  metrics.repeat_difference);
+        warning = translator_->translate(FrameQualityGate::warning_key(verdict));
+    }
+    // Reported once per run, when it becomes long enough to be a frozen camera or a replay.
+    bool suspicious = verdict == FrameQualityGate::Verdict::Frozen &&
+                      metrics.repeated_frames == config_.quality.frozen_frames;
+    if (suspicious) {
+        LOG_WARNING("[QualityGate] {} identical frames in a row", metrics.repeated_frames);
+        recorder_.record(FlightRecorder::Type::SuspiciousInput, 0, metrics.repeated_frames, 0.0,
+                         FlightRecorder::now_ns());
+    }
+
+    std::lock_guard<std::mutex> lock(events_mutex_);
+    quality_warning_ = std::move(warning);
+    if (suspicious) {
+        callback_data_json_["suspiciousInput"] = {{"reason", "repeated_frames"},
+                                                  {"frames", metrics.repeated_frames}};
+    }
+    return verdict == FrameQualityGate::Verdict::Ok;
+}
+
+void LivenessSession::replay_last_result(int64_t timestamp_ms) {
+    std::lock_guard<std::mutex> lock(sequence_mutex_);
+    if (last_signals_.empty()) {
+        return;
+    }
+    std::unordered_map<std::string, double> signals = last_signals_;
+    tick_signals(signals, timestamp_ms);
+}
+
+void LivenessSession::tick_signals(std::unordered_map<std::string, double>& signals, int64_t timestamp_ms) {
+    // A replay is stamped when its frame arrives, and may overtake the result
+    // of an earlier frame still in the landmarker.
+    tick_ms_ = std::max(tick_ms_, static_cast<double>(timestamp_ms));
+    filter_bank_.process(signals, tick_ms_ * 1e-3);
+    detector_.process_signals(signals, tick_ms_);
+}
+
+std::pair<cv::Mat, std::string> LivenessSession::process_frame(const cv::Mat& img, int64_t timestamp_ms) {
+    cv::Mat processedImage;
+    std::string callback_data = process_frame(img, processedImage, timestamp_ms);
+    return {processedImage, callback_data};
+}
+
+std::string LivenessSession::process_frame(const cv::Mat& img, cv::Mat& out, int64_t timestamp_ms) {
+    std::string warning;
+    std::vector<PendingPicture> pictures;
+    std::vector<std::pair<int64_t, BestFrameBuffer::Cues>> results;
+    {
+        std::lock_guard<std::mutex> lock(events_mutex_);
+        warning = quality_warning_.empty() ? warning_message_ : quality_warning_;
+        pictures.swap(pending_pictures_);
+        results.swap(result_cues_);
+    }
+    if (snapshots_) {
+        // Before rendering: the snapshot is the camera frame, not the overlay.
+        capture_snapshots(img, timestamp_ms, std::move(pictures), results);
+    }
+
+    std::unordered_map<std::string, double> npoints;  // empty points; extend as needed!
+    uint64_t render_start_ns = FlightRecorder::now_ns();
+    {
+        std::lock_guard<std::mutex> lock(sequence_mutex_);
+        requester_->process_image(img, out, 0, npoints, warning);
+    }
+    uint64_t render_end_ns = FlightRecorder::now_ns();
+    recorder_.record(FlightRecorder::Type::Latency, static_cast<uint16_t>(FlightRecorder::Stage::Render),
+                     static_cast<uint32_t>((render_end_ns - render_start_ns) / 1000), 0.0, render_end_ns);
+
+    // Serialize the accumulated JSON object to a string
+    std::string callback_data;
+    bool not_alive = false;
+    {
+        std::lock_guard<std::mutex> lock(events_mutex_);
+        callback_data = callback_data_json_.empty() ? "" : callback_data_json_.dump();
+        callback_data_json_ = nlohmann::json::object();
+        std::swap(not_alive, not_alive_pending_);
+    }
+    if (not_alive) {
+        save_not_alive_dump();
+    }
+    return callback_data;
+}
+
+FlightRecorder::Dump LivenessSession::dump_flight_recorder(const std::string& reason) const {
+    nlohmann::json extra;
+    extra["reason"] = reason;
+    extra["generation"] = snapshot_->generation;
+    extra["language"] = config_.language;
+    nlohmann::json gestures = nlohmann::json::array();
+    for (const auto& gesture : detector_.get_gestures()) {
+        gestures.push_back(gesture->get_gesture_id());
+    }
+    extra["gestures"] = gestures;
+    {
+        std::lock_guard<std::mutex> lock(sequence_mutex_);
+        extra["plan"] = requester_->get_plan_ids();
+    }
+    return recorder_.dump(extra);
+}
+
+void LivenessSession::save_not_alive_dump() {
+    if (config_.flight_recorder_dir.empty() && !config_.send_flight_recorder) {
+        return;
+    }
+    FlightRecorder::Dump dump = dump_flight_recorder("not_alive");
+
+    if (!config_.flight_recorder_dir.empty()) {
+        static std::atomic<uint64_t> dump_counter{0};
+        auto now_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count();
+        std::string path = (std::filesystem::path(config_.flight_recorder_dir) /
+                            ("session-" + std::to_string(now_ms) + "-" + std::to_string(dump_counter++) + ".ldfr")).string();
+        // Copied only when the dump is also sent to the client below.
+        auto file_dump = std::make_shared<const FlightRecorder::Dump>(
+            config_.send_flight_recorder ? dump : std::move(dump));
+        auto write = [path, file_dump]() {
+            std::string error;
+            if (FlightRecorder::write_file(path, *file_dump, &error)) {
+                LOG_INFO("[FlightRecorder] Wrote {}", path);
+            } else {
+                LOG_ERROR("[FlightRecorder] {}", error);
+            }
+        };
+        // Off the frame thread, and without the session's token: the file
+        // should be written even when the session ends right after.
+        if (!config_.workers || !config_.workers->submit(write, WorkerPool::Priority::High)) {
+            write();
+        }
+    }
+
+    if (config_.send_flight_recorder) {
+        std::lock_guard<std::mutex> lock(events_mutex_);
+        binary_message_ = std::move(dump);
+    }
+}
+
+void LivenessSession::capture_snapshots(const cv::Mat& img, int64_t timestamp_ms, std::vector<PendingPicture> completed,
+                                        const std::vector<std::pair<int64_t, BestFrameBuffer::Cues>>& results) {
+    for (auto& picture : completed) {
+        waiting_pictures_.push_back(std::move(picture));
+    }
+    // Frames are copied only around a completion: while a picture gesture is on
+    // its last step, then until the window of its picture has passed. Frames
+    // the landmarker did not see have no cues and are never kept.
+    if (timestamp_ms >= 0) {
+        bool keep = !waiting_pictures_.empty();
+        if (!keep) {
+            std::lock_guard<std::mutex> lock(sequence_mutex_);
+            keep = requester_->expects_picture();
+        }
+        if (keep) {
+            best_frames_->push(img, timestamp_ms);
+        }
+    }
+    // Results come after their frame was pushed, and in timestamp order.
+    for (const auto& result : results) {
+        best_frames_->set_cues(result.first, result.second);
+        results_until_ms_ = std::max(results_until_ms_, result.first);
+    }
+
+    for (auto it = waiting_pictures_.begin(); it != waiting_pictures_.end();) {
+        if (results_until_ms_ < best_frames_->ready_at(it->completed_ms)) {
+            ++it;
+            continue;
+        }
+        auto pick = best_frames_->best(it->completed_ms);
+        if (!pick) {
+            LOG_WARNING("[Snapshots] {}: no frame kept around the completion", it->gesture_id);
+            it = waiting_pictures_.erase(it);
+            continue;
+        }
+        LOG_DEBUG("[Snapshots] {}: frame {} ms from completion, score {}, of {} frames", it->gesture_id,
+                  pick->timestamp_ms - it->completed_ms, pick->score, pick->candidates);
+        snapshots_->capture(*pick->frame, it->gesture_id, pick->cues.face);
+        it = waiting_pictures_.erase(it);
+    }
+}
+
+std::optional<SnapshotStore::Snapshot> LivenessSession::take_snapshot() {
+    if (!snapshots_) {
+        return std::nullopt;
+    }
+    return snapshots_->take();
+}
+
+std::optional<FlightRecorder::Dump> LivenessSession::take_binary_message() {
+    std::lock_guard<std::mutex> lock(events_mutex_);
+    std::optional<FlightRecorder::Dump> message = std::move(binary_message_);
+    binary_message_.reset();
+    return message;
+}
+
+std::string LivenessSession::handle_control(const nlohmann::json& j) {
+    if (j.contains("action") && j["action"] == "new_session") {
+        restart();
+        LOG_INFO("[Config] New session started");
+        nlohmann::json reply;
+        reply["session"] = info();
+        reply["session"]["started"] = true;
+        return reply.dump();
+    }
+
+    if (j.contains("action") && j["action"] == "dump_flight_recorder") {
+        FlightRecorder::Dump dump = dump_flight_recorder("on_demand");
+        std::lock_guard<std::mutex> lock(events_mutex_);
+        binary_message_ = std::move(dump);
+        return {};
+    }
+
+    // Check all required fields before proceeding
+    if (j.contains("action") && j["action"] == "set" &&
+        j.contains("variable") && j["variable"].is_string() &&
+        j.contains("value") && j["value"].is_string())
+    {
+        const std::string& variable = j["variable"];
+        const std::string& value = j["value"];
+
+        if (variable == "warning_message") {
+            std::lock_guard<std::mutex> lock(events_mutex_);
+            warning_message_ = value;
+            LOG_INFO("[Config] Set warning_message to: {}", warning_message_);
+        } else if (variable == "overwrite_text") {
+            std::lock_guard<std::mutex> lock(sequence_mutex_);
+            requester_->set_overwrite_text(value);
+            LOG_INFO("[Config] Set overwrite_text to: {}", value);
+        } else if (variable == "log_level") {
+            // Process wide: the logger is shared by every session.
+            Logger::Level level;
+            if (Logger::parse_level(value, &level)) {
+                Logger::instance().set_level(level);
+                LOG_INFO("[Config] Set log_level to: {}", value);
+            } else {
+                LOG_WARNING("[Config] Unknown log_level: {}", value);
+            }
+        }
+    }
+    return {};
+}
+
+const AssetSnapshot& LivenessSession::snapshot() const {
+    return *snapshot_;
+}
+
+const LivenessSession::Config& LivenessSession::config() const {
+    return config_;
+}
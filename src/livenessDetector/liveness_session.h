@@ -0,0 +1,178 @@
+#pragma once
+
+#include <opencv2/opencv.hpp>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "asset_snapshot.h"
+#include "best_frame_buffer.h"
+#include "flight_recorder.h"
+#include "frame_quality_gate.h"
+#include "gesture_detector.h"
+#include "gestures_requester.h"
+#include "landmarker_outputs.h"
+#include "signal_filter_bank.h"
+#include "snapshot_store.h"
+#include "translation_manager.h"
+#include "nlohmann/json.hpp"
+
+// Function to verify if the detected face satisfies all constraints.
+// Returns an empty string if OK, otherwise a warning message.
+std::string verify_correct_face(
+    const std::map<std::string, float>& face_square_normalized_points,
+    const TranslationManager* translator,
+    bool glasses = false,
+    float percentage_min_face_width = 0.1f,
+    float percentage_max_face_width = 0.5f,
+    float percentage_min_face_height = 0.1f,
+    float percentage_max_face_height = 0.7f,
+    float percentage_center_allowed_offset = 0.25f
+);
+
+// One verification: the gestures picked for it, the requester driving the
+// overlay and the events queued for the client. A session is bound to the
+// AssetSnapshot it was created from, so a hot reload never changes the
+// gestures or translations of a session that is already running.
+class LivenessSession {
+public:
+    struct Config {
+        std::string language;
+        int num_gestures = 0;
+        std::set<std::string> allowed_gestures; // empty means every gesture in the snapshot
+        std::string font_path;
+        // When set, the flight recorder of a session ending not alive is written here.
+        std::string flight_recorder_dir;
+        // Whether a not-alive flight recorder dump is also sent to the client.
+        bool send_flight_recorder = false;
+        // Whether the landmarks of each result are sent to the client.
+        bool send_landmarks = false;
+        // Whether a snapshot is taken, encoded and sent when a take_picture_at_the_end gesture completes.
+        bool snapshots = false;
+        SnapshotStore::Config snapshot;
+        // Recent frames the snapshot is picked from, the best around the gesture's completion.
+        BestFrameBuffer::Config best_frame;
+        // Runs the session's off-path work (snapshot encoding, flight recorder
+        // files); WorkerPool::shared() in the server. Done inline when unset.
+        std::shared_ptr<WorkerPool> workers;
+        // Skip inference on frames that are too dark, too bright, blurred or frozen.
+        bool quality_gate = true;
+        FrameQualityGate::Config quality;
+
+        // Overrides the fields present in a start_session handshake:
+        // {"action":"start_session","language":"es","num_gestures":2,"gestures_list":["blink","smile"],
+        //  "flight_recorder":true,"quality_gate":true,"landmarks":true,
+        //  "snapshots":{"format":"webp","quality":80,"face_only":true,"window_before_ms":200}}
+        // "snapshots" also takes true or false to use or skip the default snapshot settings.
+        // Returns false and fills error when a field has the wrong type.
+        bool apply_request(const nlohmann::json& request, std::string* error = nullptr);
+    };
+
+    LivenessSession(std::shared_ptr<const AssetSnapshot> snapshot, Config config);
+    ~LivenessSession();
+
+    LivenessSession(const LivenessSession&) = delete;
+    LivenessSession& operator=(const LivenessSession&) = delete;
+
+    // Picks the gestures for this session and starts the sequence. Returns false
+    // and fills error when the snapshot cannot satisfy the configuration.
+    bool start(std::string* error = nullptr);
+
+    // Starts a new verification with a freshly drawn set of gestures, reusing
+    // the gestures and translations already loaded for this session.
+    void restart();
+
+    // Description of the running verification, sent back to the client after a handshake.
+    nlohmann::json info() const;
+
+    // The landmarker outputs this session's gestures, signal filters and face
+    // box check read; every output when a gesture reads a signal by index.
+    LandmarkerOutputs landmarker_outputs() const;
+
+    // FaceProcessor results, called from the landmarker thread with the
+    // timestamp ProcessImage returned for the frame.
+    void on_face_result(const std::map<std::string, float>& blendshapes,
+                        const std::map<std::string, float>& transformationValues,
+                        int64_t timestamp_ms);
+
+    // Checks a frame before it goes to the landmarker. Returns false when
+    // inference should be skipped: a rejected frame shows the matching warning
+    // until a frame passes, and a repeat of the previous frame replays the last
+    // landmarker result instead. A long run of repeats is reported to the client
+    // as "suspiciousInput". Called from the thread that sends the frames.
+    // timestamp_ms is the frame's time on the landmarker's clock (a mapped
+    // capture time), -1 for now; a replayed result is stamped with it.
+    bool admit_frame(const cv::Mat& img, int64_t timestamp_ms = -1);
+
+    // Renders the overlay for img and returns it with the pending callback JSON.
+    // timestamp_ms is the one ProcessImage returned for img, -1 when img was
+    // not sent to the landmarker; only frames that were can become a snapshot.
+    std::pair<cv::Mat, std::string> process_frame(const cv::Mat& img, int64_t timestamp_ms = -1);
+    // Same, rendering into out (reusing its buffer when the size matches); returns the callback JSON.
+    std::string process_frame(const cv::Mat& img, cv::Mat& out, int64_t timestamp_ms = -1);
+
+    // Handles a parsed JSON control message ("set", "new_session",
+    // "dump_flight_recorder"); returns the reply to send, if any.
+    std::string handle_control(const nlohmann::json& j);
+
+    // Flight recorder dump waiting to be sent to the client, if any.
+    std::optional<FlightRecorder::Dump> take_binary_message();
+    // Encoded snapshot waiting to be sent to the client, if any; oldest first.
+    std::optional<SnapshotStore::Snapshot> take_snapshot();
+    FlightRecorder::Dump dump_flight_recorder(const std::string& reason) const;
+
+    const AssetSnapshot& snapshot() const;
+    const Config& config() const;
+
+private:
+    std::shared_ptr<const AssetSnapshot> snapshot_;
+    Config config_;
+    std::shared_ptr<const TranslationManager> translator_;
+    FlightRecorder recorder_; // declared first so it outlives detector_ and requester_
+    GestureDetector detector_;
+    SignalFilterBank filter_bank_;
+    std::unique_ptr<GesturesRequester> requester_;
+    std::unordered_map<std::string, double> last_signals_; // last landmarker result, for repeated frames
+    FrameQualityGate quality_gate_; // frame thread only
+    // Marks this session's jobs on config_.workers, cancelled when the session ends.
+    std::shared_ptr<CancellationToken> jobs_token_;
+    std::unique_ptr<SnapshotStore> snapshots_; // null unless config_.snapshots
+    std::unique_ptr<BestFrameBuffer> best_frames_; // frame thread only, with snapshots_
+    int64_t results_until_ms_ = -1; // frame thread only: timestamp of the newest result given to best_frames_
+
+    struct PendingPicture {
+        std::string gesture_id;
+        int64_t completed_ms = 0; // landmarker timestamp of the result that completed the gesture
+    };
+    std::vector<PendingPicture> waiting_pictures_; // frame thread only, until their window has passed
+    int64_t result_ms_ = -1; // timestamp of the result being processed, under sequence_mutex_
+    // Latest timestamp fed to the filters and windows, which need it monotonic;
+    // under sequence_mutex_.
+    double tick_ms_ = 0.0;
+
+    // Serializes the landmarker thread and the socket thread on detector_, filter_bank_ and requester_.
+    mutable std::mutex sequence_mutex_;
+
+    // Written from the landmarker thread, read from the socket thread.
+    std::mutex events_mutex_;
+    nlohmann::json callback_data_json_;
+    std::string warning_message_;
+    std::string quality_warning_; // shown instead of warning_message_ while frames are rejected
+    bool not_alive_pending_ = false;
+    std::optional<FlightRecorder::Dump> binary_message_;
+    std::vector<PendingPicture> pending_pictures_; // gestures completed since the last frame
+    // Cues of the results since the last frame, by timestamp, for best_frames_.
+    std::vector<std::pair<int64_t, BestFrameBuffer::Cues>> result_cues_;
+
+    void save_not_alive_dump();
+    void replay_last_result(int64_t timestamp_ms);
+    // Runs the filters and gestures over signals at timestamp_ms. Holds sequence_mutex_.
+    void tick_signals(std::unordered_map<std::string, double>& signals, int64_t timestamp_ms);
+    void capture_snapshots(const cv::Mat& img, int64_t timestamp_ms, std::vector<PendingPicture> completed,
+                           const std::vector<std::pair<int64_t, BestFrameBuffer::Cues>>& results);
+};
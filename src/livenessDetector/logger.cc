@@ -0,0 +1,219 @@
+#include "logger.h"
+#include <algorithm>
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+
+Logger& Logger::instance() {
+    // Never destroyed: threads and static destructors may still log during
+    // exit. shutdown() runs from atexit and switches to synchronous writes.
+    static Logger* logger = new Logger();
+    return *logger;
+}
+
+Logger::Logger() {
+    writer_ = std::thread(&Logger::writer_loop, this);
+    std::atexit(&Logger::shutdown);
+}
+
+bool Logger::parse_level(const std::string& name, Level* level) {
+    static const std::pair<const char*, Level> levels[] = {
+        {"debug", Level::Debug}, {"info", Level::Info}, {"warning", Level::Warning},
+        {"error", Level::Error}, {"off", Level::Off},
+    };
+    for (const auto& [level_name, value] : levels) {
+        if (name == level_name) {
+            *level = value;
+            return true;
+        }
+    }
+    return false;
+}
+
+const char* Logger::level_name(Level level) {
+    switch (level) {
+        case Level::Debug: return "debug";
+        case Level::Info: return "info";
+        case Level::Warning: return "warning";
+        case Level::Error: return "error";
+        case Level::Off: return "off";
+    }
+    return "unknown";
+}
+
+void Logger::set_sink(Sink sink) {
+    std::lock_guard<std::mutex> lock(sink_mutex_);
+    sink_ = std::move(sink);
+}
+
+Logger::ThreadBuffer* Logger::thread_buffer() {
+    struct Holder {
+        std::shared_ptr<ThreadBuffer> buffer;
+        ~Holder() {
+            if (buffer) {
+                buffer->retired.store(true, std::memory_order_release);
+            }
+        }
+    };
+    thread_local Holder holder;
+    if (!holder.buffer) {
+        holder.buffer = std::make_shared<ThreadBuffer>();
+        std::lock_guard<std::mutex> lock(buffers_mutex_);
+        buffers_.push_back(holder.buffer);
+    }
+    return holder.buffer.get();
+}
+
+void Logger::flush() {
+    if (stopped_.load(std::memory_order_acquire)) {
+        return;
+    }
+    std::unique_lock<std::mutex> lock(wake_mutex_);
+    uint64_t target = ++flush_requested_;
+    wake_.notify_one();
+    flushed_.wait(lock, [&] { return flush_completed_ >= target; });
+}
+
+void Logger::writer_loop() {
+    std::unique_lock<std::mutex> lock(wake_mutex_);
+    while (true) {
+        wake_.wait_for(lock, std::chrono::milliseconds(20), [&] {
+            return stop_ || flush_requested_ > flush_completed_ || urgent_.load(std::memory_order_relaxed);
+        });
+        uint64_t target = flush_requested_;
+        bool stop = stop_;
+        urgent_.store(false, std::memory_order_relaxed);
+        lock.unlock();
+        drain();
+        lock.lock();
+        flush_completed_ = target;
+        flushed_.notify_all();
+        if (stop) {
+            break;
+        }
+    }
+}
+
+void Logger::drain() {
+    std::vector<std::shared_ptr<ThreadBuffer>> buffers;
+    {
+        std::lock_guard<std::mutex> lock(buffers_mutex_);
+        // Buffers of exited threads go once everything in them is written.
+        buffers_.erase(std::remove_if(buffers_.begin(), buffers_.end(), [](const auto& buffer) {
+            return buffer->retired.load(std::memory_order_acquire) &&
+                   buffer->tail.load(std::memory_order_relaxed) == buffer->head.load(std::memory_order_acquire);
+        }), buffers_.end());
+        buffers = buffers_;
+    }
+
+    // Take what is published now, and write it in timestamp order across threads.
+    std::vector<uint64_t> heads(buffers.size());
+    std::vector<const Record*> batch;
+    for (size_t i = 0; i < buffers.size(); ++i) {
+        ThreadBuffer& buffer = *buffers[i];
+        heads[i] = buffer.head.load(std::memory_order_acquire);
+        for (uint64_t n = buffer.tail.load(std::memory_order_relaxed); n < heads[i]; ++n) {
+            batch.push_back(&buffer.records[n % kRingCapacity]);
+        }
+    }
+    if (batch.empty()) {
+        return;
+    }
+    std::stable_sort(batch.begin(), batch.end(), [](const Record* a, const Record* b) {
+        return a->timestamp_ns < b->timestamp_ns;
+    });
+
+    {
+        std::lock_guard<std::mutex> lock(sink_mutex_);
+        std::string line;
+        std::string out;
+        std::string err;
+        for (const Record* record : batch) {
+            format(*record, line);
+            if (sink_) {
+                sink_(record->level, line);
+            } else {
+                std::string& stream = record->level >= Level::Warning ? err : out;
+                stream += line;
+                stream += '\n';
+            }
+        }
+        if (!out.empty()) {
+            std::cout.write(out.data(), out.size());
+            std::cout.flush();
+        }
+        if (!err.empty()) {
+            std::cerr.write(err.data(), err.size());
+        }
+    }
+
+    for (size_t i = 0; i < buffers.size(); ++i) {
+        buffers[i]->tail.store(heads[i], std::memory_order_release);
+    }
+}
+
+void Logger::write_now(const Record& record) {
+    std::string line;
+    format(record, line);
+    std::lock_guard<std::mutex> lock(sink_mutex_);
+    if (sink_) {
+        sink_(record.level, line);
+        return;
+    }
+    line += '\n';
+    std::ostream& stream = record.level >= Level::Warning ? std::cerr : std::cout;
+    stream.write(line.data(), line.size());
+    stream.flush();
+}
+
+void Logger::format(const Record& record, std::string& line) {
+    line.clear();
+    int next = 0;
+    char number[32];
+    for (const char* c = record.format; *c != '\0'; ++c) {
+        if (c[0] != '{' || c[1] != '}' || next >= record.arg_count) {
+            line += *c;
+            continue;
+        }
+        ++c;
+        const Arg& arg = record.args[next++];
+        switch (arg.kind) {
+            case Arg::Kind::Int:
+                line.append(number, std::snprintf(number, sizeof(number), "%" PRId64, arg.i));
+                break;
+            case Arg::Kind::UInt:
+                line.append(number, std::snprintf(number, sizeof(number), "%" PRIu64, arg.u));
+                break;
+            case Arg::Kind::Double:
+                // Same as the default std::ostream formatting.
+                line.append(number, std::snprintf(number, sizeof(number), "%g", arg.d));
+                break;
+            case Arg::Kind::Bool:
+                line += arg.u ? '1' : '0';
+                break;
+            case Arg::Kind::Char:
+                line += static_cast<char>(arg.i);
+                break;
+            case Arg::Kind::Text:
+                line.append(record.text + arg.offset, arg.size);
+                if (arg.truncated) {
+                    line += "...";
+                }
+                break;
+        }
+    }
+}
+
+void Logger::shutdown() {
+    Logger& logger = instance();
+    logger.stopped_.store(true, std::memory_order_release);
+    {
+        std::lock_guard<std::mutex> lock(logger.wake_mutex_);
+        logger.stop_ = true;
+    }
+    logger.wake_.notify_one();
+    if (logger.writer_.joinable()) {
+        logger.writer_.join();
+    }
+}
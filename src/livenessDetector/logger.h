@@ -0,0 +1,211 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+// Leveled asynchronous logger. Use it through the macros:
+//
+//   LOG_INFO("Gesture Detected:{}", gesture_label);
+//   LOG_DEBUG("Received JSON: {}", json_str);
+//
+// A call below the current level costs one relaxed load and does not evaluate
+// its arguments. Otherwise the format pointer and the raw arguments are copied
+// into a fixed-size record in the calling thread's own ring (no lock, no
+// allocation) and a background thread formats and writes them. Records are
+// dropped, and counted, when a thread's ring is full.
+//
+// The format must be a string literal: only its pointer is stored. Each "{}"
+// is replaced by the next argument. Arguments can be integers, floating point
+// numbers, bools, chars and strings; strings are copied into the record and
+// truncated past kTextCapacity bytes.
+class Logger {
+public:
+    enum class Level : uint8_t { Debug = 0, Info = 1, Warning = 2, Error = 3, Off = 4 };
+
+    // Receives each formatted line, without the trailing newline, on the writer thread.
+    using Sink = std::function<void(Level, const std::string&)>;
+
+    static constexpr int kMaxArgs = 6;
+    static constexpr size_t kTextCapacity = 256;
+    static constexpr size_t kRingCapacity = 128; // records per thread
+
+    static Logger& instance();
+
+    void set_level(Level level) { level_.store(static_cast<uint8_t>(level), std::memory_order_relaxed); }
+    Level level() const { return static_cast<Level>(level_.load(std::memory_order_relaxed)); }
+    bool enabled(Level level) const {
+        return static_cast<uint8_t>(level) >= level_.load(std::memory_order_relaxed);
+    }
+
+    // "debug", "info", "warning", "error" or "off".
+    static bool parse_level(const std::string& name, Level* level);
+    static const char* level_name(Level level);
+
+    template <typename... Args>
+    void log(Level level, const char* format, const Args&... args) {
+        static_assert(sizeof...(Args) <= kMaxArgs, "too many log arguments");
+        if (stopped_.load(std::memory_order_acquire)) {
+            Record record;
+            record.start(level, format);
+            (record.add(args), ...);
+            write_now(record);
+            return;
+        }
+        ThreadBuffer* buffer = thread_buffer();
+        uint64_t head = buffer->head.load(std::memory_order_relaxed);
+        if (head - buffer->tail.load(std::memory_order_acquire) >= kRingCapacity) {
+            dropped_.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        Record& record = buffer->records[head % kRingCapacity];
+        record.start(level, format);
+        (record.add(args), ...);
+        buffer->head.store(head + 1, std::memory_order_release);
+        if (level >= Level::Error) {
+            urgent_.store(true, std::memory_order_relaxed);
+            wake_.notify_one();
+        }
+    }
+
+    // Default: Debug and Info lines to stdout, Warning and Error to stderr.
+    void set_sink(Sink sink);
+
+    // Returns once every record this thread logged before the call is written.
+    void flush();
+
+    // Records lost to full rings since start.
+    uint64_t dropped() const { return dropped_.load(std::memory_order_relaxed); }
+
+private:
+    struct Arg {
+        enum class Kind : uint8_t { Int, UInt, Double, Bool, Char, Text };
+        Kind kind;
+        bool truncated;
+        uint16_t offset; // Text: position in Record::text
+        uint16_t size;   // Text: bytes copied
+        union {
+            int64_t i;
+            uint64_t u;
+            double d;
+        };
+    };
+
+    struct Record {
+        uint64_t timestamp_ns;
+        const char* format;
+        Level level;
+        uint8_t arg_count;
+        uint16_t text_size;
+        Arg args[kMaxArgs];
+        char text[kTextCapacity];
+
+        void start(Level record_level, const char* record_format) {
+            timestamp_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now().time_since_epoch()).count();
+            format = record_format;
+            level = record_level;
+            arg_count = 0;
+            text_size = 0;
+        }
+
+        template <typename T>
+        void add(const T& value) {
+            Arg& arg = args[arg_count++];
+            arg.truncated = false;
+            if constexpr (std::is_same_v<T, bool>) {
+                arg.kind = Arg::Kind::Bool;
+                arg.u = value ? 1 : 0;
+            } else if constexpr (std::is_same_v<T, char>) {
+                arg.kind = Arg::Kind::Char;
+                arg.i = value;
+            } else if constexpr (std::is_integral_v<T> && std::is_signed_v<T>) {
+                arg.kind = Arg::Kind::Int;
+                arg.i = value;
+            } else if constexpr (std::is_integral_v<T>) {
+                arg.kind = Arg::Kind::UInt;
+                arg.u = value;
+            } else if constexpr (std::is_floating_point_v<T>) {
+                arg.kind = Arg::Kind::Double;
+                arg.d = value;
+            } else if constexpr (std::is_enum_v<T>) {
+                arg.kind = Arg::Kind::Int;
+                arg.i = static_cast<int64_t>(value);
+            } else {
+                add_text(arg, std::string_view(value));
+            }
+        }
+
+        void add_text(Arg& arg, std::string_view value) {
+            size_t room = kTextCapacity - text_size;
+            size_t size = value.size() < room ? value.size() : room;
+            arg.kind = Arg::Kind::Text;
+            arg.offset = text_size;
+            arg.size = static_cast<uint16_t>(size);
+            arg.truncated = size < value.size();
+            std::memcpy(text + text_size, value.data(), size);
+            text_size += static_cast<uint16_t>(size);
+        }
+    };
+
+    // Single-producer (the owning thread) single-consumer (the writer) ring.
+    struct ThreadBuffer {
+        Record records[kRingCapacity];
+        std::atomic<uint64_t> head{0}; // next record to write, owner only
+        std::atomic<uint64_t> tail{0}; // next record to read, writer only
+        std::atomic<bool> retired{false}; // owning thread exited
+    };
+
+    Logger();
+    ~Logger() = delete; // lives until exit; see shutdown()
+
+    ThreadBuffer* thread_buffer();
+    void writer_loop();
+    void drain();
+    void write_now(const Record& record);
+    static void format(const Record& record, std::string& line);
+    static void shutdown();
+
+    std::atomic<uint8_t> level_{static_cast<uint8_t>(Level::Info)};
+    std::atomic<uint64_t> dropped_{0};
+    std::atomic<bool> stopped_{false};
+    std::atomic<bool> urgent_{false};
+
+    std::mutex buffers_mutex_;
+    std::vector<std::shared_ptr<ThreadBuffer>> buffers_;
+
+    std::mutex sink_mutex_;
+    Sink sink_;
+
+    std::mutex wake_mutex_;
+    std::condition_variable wake_;
+    std::condition_variable flushed_;
+    uint64_t flush_requested_ = 0;
+    uint64_t flush_completed_ = 0;
+    bool stop_ = false;
+
+    std::thread writer_;
+};
+
+#define LIVENESS_LOG(level, ...)                                   \
+    do {                                                           \
+        Logger& liveness_logger_ = Logger::instance();             \
+        if (liveness_logger_.enabled(level)) {                     \
+            liveness_logger_.log(level, __VA_ARGS__);              \
+        }                                                          \
+    } while (0)
+
+#define LOG_DEBUG(...) LIVENESS_LOG(Logger::Level::Debug, __VA_ARGS__)
+#define LOG_INFO(...) LIVENESS_LOG(Logger::Level::Info, __VA_ARGS__)
+#define LOG_WARNING(...) LIVENESS_LOG(Logger::Level::Warning, __VA_ARGS__)
+#define LOG_ERROR(...) LIVENESS_LOG(Logger::Level::Error, __VA_ARGS__)
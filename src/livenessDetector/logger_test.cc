@@ -0,0 +1,109 @@
+#include "logger.h"
+#include "test_check.h"
+#include <iostream>
+#include <chrono>
+#include <cstdio>
+#include <map>
+#include <string>
+#include <thread>
+#include <vector>
+
+int main() {
+    Logger& logger = Logger::instance();
+
+    std::vector<std::pair<Logger::Level, std::string>> lines;
+    logger.set_sink([&lines](Logger::Level level, const std::string& line) {
+        lines.emplace_back(level, line);
+    });
+
+    // Formatting
+    std::string label = "Blink";
+    LOG_INFO("Gesture Detected:{}", label);
+    LOG_WARNING("{} of {} frames, {} ms, ok={} grade={}", 3, 10u, 2.5, true, 'A');
+    LOG_INFO("No placeholders");
+    LOG_INFO("Unused placeholder {} {}", "only one");
+    logger.flush();
+    TEST_CHECK(lines.size() == 4);
+    TEST_CHECK(lines[0].first == Logger::Level::Info && lines[0].second == "Gesture Detected:Blink");
+    TEST_CHECK(lines[1].first == Logger::Level::Warning && lines[1].second == "3 of 10 frames, 2.5 ms, ok=1 grade=A");
+    TEST_CHECK(lines[2].second == "No placeholders");
+    TEST_CHECK(lines[3].second == "Unused placeholder only one {}");
+
+    // Long strings are truncated, not split across records
+    lines.clear();
+    LOG_INFO("Received JSON: {}", std::string(1000, 'x'));
+    logger.flush();
+    TEST_CHECK(lines.size() == 1);
+    TEST_CHECK(lines[0].second == "Received JSON: " + std::string(Logger::kTextCapacity, 'x') + "...");
+
+    // Levels: arguments of filtered calls are not evaluated
+    lines.clear();
+    int evaluated = 0;
+    auto count = [&evaluated]() { return ++evaluated; };
+    LOG_DEBUG("debug {}", count());
+    TEST_CHECK(evaluated == 0);
+    Logger::Level level = Logger::Level::Info;
+    TEST_CHECK(Logger::parse_level("debug", &level) && level == Logger::Level::Debug);
+    TEST_CHECK(!Logger::parse_level("verbose", &level));
+    logger.set_level(Logger::Level::Debug);
+    LOG_DEBUG("debug {}", count());
+    TEST_CHECK(evaluated == 1);
+    logger.set_level(Logger::Level::Error);
+    LOG_WARNING("hidden");
+    logger.set_level(Logger::Level::Info);
+    logger.flush();
+    TEST_CHECK(lines.size() == 1 && lines[0].second == "debug 1");
+
+    // Several threads: every record arrives, each thread's in order
+    lines.clear();
+    const int threads_count = 4;
+    const int per_thread = 100;
+    std::vector<std::thread> threads;
+    for (int t = 0; t < threads_count; ++t) {
+        threads.emplace_back([t]() {
+            for (int i = 0; i < per_thread; ++i) {
+                LOG_INFO("{} {}", t, i);
+            }
+            Logger::instance().flush();
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    logger.flush();
+    std::map<int, int> next;
+    for (const auto& entry : lines) {
+        int t = 0, i = 0;
+        TEST_CHECK(std::sscanf(entry.second.c_str(), "%d %d", &t, &i) == 2);
+        TEST_CHECK(i == next[t]);
+        ++next[t];
+    }
+    TEST_CHECK(lines.size() + logger.dropped() == static_cast<size_t>(threads_count * per_thread));
+    std::cout << "Threads: " << lines.size() << " records written, " << logger.dropped() << " dropped\n";
+
+    // Cost on the calling thread, with a sink that discards
+    logger.set_sink([](Logger::Level, const std::string&) {});
+    const int iterations = 100000;
+    double total_ns = 0;
+    int measured = 0;
+    for (int i = 0; i < iterations; i += Logger::kRingCapacity / 2) {
+        auto start = std::chrono::steady_clock::now();
+        for (int j = 0; j < static_cast<int>(Logger::kRingCapacity / 2); ++j) {
+            LOG_INFO("Gesture Detected:{} step {} value {}", label, j, 0.5);
+        }
+        total_ns += std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+        measured += Logger::kRingCapacity / 2;
+        logger.flush();
+    }
+    std::cout << "LOG_INFO with 3 arguments: " << total_ns / measured << " ns per call\n";
+
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; ++i) {
+        LOG_DEBUG("Received JSON: {}", label);
+    }
+    double filtered_ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+    std::cout << "Filtered LOG_DEBUG: " << filtered_ns / iterations << " ns per call\n";
+
+    std::cout << "Test completed.\n";
+    return 0;
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <atomic>
+#include <utility>
+
+// Unbounded multi-producer single-consumer queue (Dmitry Vyukov's node-based
+// design). push() allocates a node, then links it with one atomic exchange,
+// never waiting on other producers or on the consumer; pop() must only be
+// called from one thread at a time.
+//
+// A push that is halfway done (exchanged but not yet linked) hides itself and
+// everything pushed after it until it completes, so pop() may briefly report
+// empty while items are on their way. Callers that drain once per tick simply
+// see those items on the next tick. T must be default constructible.
+template <typename T>
+class MpscQueue {
+public:
+    MpscQueue() : head_(new Node()), tail_(head_.load(std::memory_order_relaxed)) {}
+
+    ~MpscQueue() {
+        T discard;
+        while (pop(discard)) {}
+        delete tail_;
+    }
+
+    MpscQueue(const MpscQueue&) = delete;
+    MpscQueue& operator=(const MpscQueue&) = delete;
+
+    void push(T value) {
+        Node* node = new Node();
+        node->value = std::move(value);
+        Node* prev = head_.exchange(node, std::memory_order_acq_rel);
+        prev->next.store(node, std::memory_order_release);
+    }
+
+    bool pop(T& out) {
+        Node* next = tail_->next.load(std::memory_order_acquire);
+        if (next == nullptr) {
+            return false;
+        }
+        out = std::move(next->value);
+        // next becomes the new stub; its value has been moved out.
+        delete tail_;
+        tail_ = next;
+        return true;
+    }
+
+private:
+    struct Node {
+        std::atomic<Node*> next{nullptr};
+        T value{};
+    };
+
+    std::atomic<Node*> head_; // last pushed node, shared by producers
+    Node* tail_;              // stub before the oldest item, consumer only
+};
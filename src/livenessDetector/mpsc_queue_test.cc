@@ -0,0 +1,52 @@
+#include "mpsc_queue.h"
+#include "test_check.h"
+#include <iostream>
+#include <thread>
+#include <vector>
+
+int main() {
+    struct Item {
+        int producer = 0;
+        int sequence = 0;
+    };
+
+    MpscQueue<Item> queue;
+    const int producers = 4;
+    const int per_producer = 100000;
+
+    std::vector<std::thread> threads;
+    for (int p = 0; p < producers; ++p) {
+        threads.emplace_back([&queue, p]() {
+            for (int i = 0; i < per_producer; ++i) {
+                queue.push({p, i});
+            }
+        });
+    }
+
+    // Each producer's items must come out in the order it pushed them.
+    std::vector<int> next(producers, 0);
+    int received = 0;
+    Item item;
+    while (received < producers * per_producer) {
+        if (queue.pop(item)) {
+            TEST_CHECK(item.sequence == next[item.producer]);
+            ++next[item.producer];
+            ++received;
+        } else {
+            std::this_thread::yield();
+        }
+    }
+    for (auto& t : threads) {
+        t.join();
+    }
+    TEST_CHECK(!queue.pop(item));
+    std::cout << "Received " << received << " items from " << producers << " producers in order\n";
+
+    // Items still queued at destruction are freed
+    MpscQueue<std::vector<int>> leftovers;
+    leftovers.push(std::vector<int>(1000, 1));
+    leftovers.push(std::vector<int>(1000, 2));
+
+    std::cout << "Test completed.\n";
+    return 0;
+}
@@ -0,0 +1,323 @@
+#include "signal_filter_bank.h"
+#include <algorithm>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <numeric>
+
+namespace {
+
+constexpr double kPi = 3.14159265358979323846;
+
+// Smoothing factor of a first-order low-pass filter at the given cutoff.
+inline double low_pass_alpha(double cutoff_hz, double dt) {
+    double tau = 1.0 / (2.0 * kPi * cutoff_hz);
+    return 1.0 / (1.0 + tau / dt);
+}
+
+bool read_number(const nlohmann::json& entry, const char* key, double& value, std::string* error) {
+    if (!entry.contains(key)) {
+        return true;
+    }
+    if (!entry[key].is_number()) {
+        if (error) *error = std::string("filter field '") + key + "' must be a number";
+        return false;
+    }
+    value = entry[key].get<double>();
+    return true;
+}
+
+} // end anonymous namespace
+
+bool SignalFilterBank::parse_specs(const nlohmann::json& j, std::vector<FilterSpec>& specs, std::string* error) {
+    if (!j.contains("filters")) {
+        return true;
+    }
+    if (!j["filters"].is_array()) {
+        if (error) *error = "'filters' must be an array";
+        return false;
+    }
+
+    for (const auto& entry : j["filters"]) {
+        if (!entry.contains("name") || !entry["name"].is_string() ||
+            !entry.contains("source") || !entry["source"].is_string() ||
+            !entry.contains("type") || !entry["type"].is_string()) {
+            if (error) *error = "each filter needs string 'name', 'source' and 'type'";
+            return false;
+        }
+
+        FilterSpec spec;
+        spec.name = entry["name"].get<std::string>();
+        spec.source = entry["source"].get<std::string>();
+        const std::string type = entry["type"].get<std::string>();
+
+        if (type == "ema") {
+            spec.type = Type::EMA;
+            if (!read_number(entry, "alpha", spec.alpha, error)) return false;
+            if (spec.alpha <= 0.0 || spec.alpha > 1.0) {
+                if (error) *error = "ema filter '" + spec.name + "': alpha must be in (0, 1]";
+                return false;
+            }
+        } else if (type == "one_euro") {
+            spec.type = Type::OneEuro;
+            if (!read_number(entry, "min_cutoff", spec.min_cutoff, error)) return false;
+            if (!read_number(entry, "beta", spec.beta, error)) return false;
+            if (!read_number(entry, "d_cutoff", spec.d_cutoff, error)) return false;
+            if (spec.min_cutoff <= 0.0 || spec.d_cutoff <= 0.0 || spec.beta < 0.0) {
+                if (error) *error = "one_euro filter '" + spec.name + "': cutoffs must be positive and beta non-negative";
+                return false;
+            }
+        } else if (type == "median") {
+            spec.type = Type::Median;
+            if (entry.contains("window")) {
+                if (!entry["window"].is_number_integer()) {
+                    if (error) *error = "median filter '" + spec.name + "': window must be an integer";
+                    return false;
+                }
+                spec.window = entry["window"].get<int>();
+            }
+            if (spec.window < 1 || spec.window > 63) {
+                if (error) *error = "median filter '" + spec.name + "': window must be between 1 and 63";
+                return false;
+            }
+        } else {
+            if (error) *error = "unknown filter type '" + type + "'";
+            return false;
+        }
+        specs.push_back(std::move(spec));
+    }
+    return true;
+}
+
+bool SignalFilterBank::load_specs_from_folder(const std::string& folder, std::vector<FilterSpec>& specs, std::string* error) {
+    std::error_code ec;
+    if (!std::filesystem::is_directory(folder, ec)) {
+        return true;
+    }
+    for (const auto& entry : std::filesystem::directory_iterator(folder, ec)) {
+        if (entry.path().extension() != ".json") continue;
+        std::ifstream file(entry.path());
+        try {
+            nlohmann::json j;
+            file >> j;
+            std::string parse_error;
+            if (!parse_specs(j, specs, &parse_error)) {
+                if (error) *error = entry.path().string() + ": " + parse_error;
+                return false;
+            }
+        } catch (const std::exception& e) {
+            if (error) *error = entry.path().string() + ": " + e.what();
+            return false;
+        }
+    }
+    return true;
+}
+
+SignalFilterBank::SignalFilterBank(const std::vector<FilterSpec>& specs) {
+    // Stage of each filter: 0 when it reads a landmarker signal, one more than
+    // the filter it reads otherwise. A filter written over its source is no
+    // link: whoever reads that name gets the raw value. Cycles never resolve
+    // and go last, where their sources are missing.
+    std::unordered_map<std::string, size_t> producers;
+    for (size_t i = 0; i < specs.size(); ++i) {
+        if (specs[i].name != specs[i].source) {
+            producers.emplace(specs[i].name, i);
+        }
+    }
+    std::vector<int> stage(specs.size(), -1);
+    int last_stage = 0;
+    for (bool resolved = true; resolved;) {
+        resolved = false;
+        for (size_t i = 0; i < specs.size(); ++i) {
+            if (stage[i] >= 0) continue;
+            auto producer = producers.find(specs[i].source);
+            if (producer == producers.end() || producer->second == i) {
+                stage[i] = 0;
+            } else if (stage[producer->second] >= 0) {
+                stage[i] = stage[producer->second] + 1;
+            } else {
+                continue;
+            }
+            last_stage = std::max(last_stage, stage[i]);
+            resolved = true;
+        }
+    }
+    for (int& s : stage) {
+        if (s < 0) s = last_stage + 1;
+    }
+    std::vector<size_t> order(specs.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&stage](size_t a, size_t b) { return stage[a] < stage[b]; });
+
+    size_t median_samples = 0;
+    int max_window = 0;
+    for (size_t position = 0; position < order.size(); ++position) {
+        const FilterSpec& spec = specs[order[position]];
+        if (position > 0 && stage[order[position]] != stage[order[position - 1]]) {
+            stage_end_.push_back(position);
+        }
+        size_t index = names_.size();
+        names_.push_back(spec.name);
+        sources_.push_back(spec.source);
+
+        switch (spec.type) {
+            case Type::EMA:
+                ema_.filter.push_back(index);
+                ema_.alpha.push_back(spec.alpha);
+                break;
+            case Type::OneEuro:
+                one_euro_.filter.push_back(index);
+                one_euro_.min_cutoff.push_back(spec.min_cutoff);
+                one_euro_.beta.push_back(spec.beta);
+                one_euro_.d_cutoff.push_back(spec.d_cutoff);
+                break;
+            case Type::Median:
+                median_.filter.push_back(index);
+                median_.offset.push_back(median_samples);
+                median_.window.push_back(spec.window);
+                median_samples += spec.window;
+                max_window = std::max(max_window, spec.window);
+                break;
+        }
+    }
+    if (!order.empty()) {
+        stage_end_.push_back(order.size());
+    }
+
+    input_.assign(names_.size(), 0.0);
+    output_.assign(names_.size(), 0.0);
+    present_.assign(names_.size(), 0);
+    ema_.state.assign(ema_.filter.size(), 0.0);
+    one_euro_.x_prev.assign(one_euro_.filter.size(), 0.0);
+    one_euro_.dx_prev.assign(one_euro_.filter.size(), 0.0);
+    median_.count.assign(median_.filter.size(), 0);
+    median_.head.assign(median_.filter.size(), 0);
+    median_.samples.assign(median_samples, 0.0);
+    median_.scratch.assign(max_window, 0.0);
+    reset();
+}
+
+void SignalFilterBank::reset() {
+    std::fill(ema_.primed.begin(), ema_.primed.end(), 0);
+    ema_.primed.resize(ema_.filter.size(), 0);
+    std::fill(one_euro_.primed.begin(), one_euro_.primed.end(), 0);
+    one_euro_.primed.resize(one_euro_.filter.size(), 0);
+    std::fill(median_.count.begin(), median_.count.end(), 0);
+    std::fill(median_.head.begin(), median_.head.end(), 0);
+    has_timestamp_ = false;
+}
+
+size_t SignalFilterBank::size() const {
+    return names_.size();
+}
+
+void SignalFilterBank::resolve_sources(std::set<std::string>& names) const {
+    // A filter may read another filter's output, so repeat until nothing is added.
+    bool added = true;
+    while (added) {
+        added = false;
+        for (size_t i = 0; i < names_.size(); ++i) {
+            if (names.count(names_[i]) > 0 && names.insert(sources_[i]).second) {
+                added = true;
+            }
+        }
+    }
+    for (size_t i = 0; i < names_.size(); ++i) {
+        if (names_[i] != sources_[i]) { // a filter written over its source still reads the raw signal
+            names.erase(names_[i]);
+        }
+    }
+}
+
+void SignalFilterBank::process(std::unordered_map<std::string, double>& signals, double timestamp_s) {
+    if (names_.empty()) {
+        return;
+    }
+
+    double dt = has_timestamp_ ? timestamp_s - last_timestamp_s_ : 0.0;
+    if (has_timestamp_ && dt > kMaxGapSeconds) {
+        reset();
+    }
+    if (dt <= 0.0) {
+        dt = 1.0 / 30.0;
+    }
+    last_timestamp_s_ = timestamp_s;
+    has_timestamp_ = true;
+
+    size_t ema = 0, one_euro = 0, median = 0;
+    size_t begin = 0;
+    for (size_t end : stage_end_) {
+        // Gather the stage's inputs first, so a filter may publish under its source's name.
+        for (size_t i = begin; i < end; ++i) {
+            auto it = signals.find(sources_[i]);
+            present_[i] = it != signals.end();
+            if (present_[i]) {
+                input_[i] = it->second;
+            }
+        }
+        run_ema(end, ema);
+        run_one_euro(end, one_euro, dt);
+        run_median(end, median);
+        for (size_t i = begin; i < end; ++i) {
+            if (present_[i]) {
+                signals[names_[i]] = output_[i];
+            }
+        }
+        begin = end;
+    }
+}
+
+void SignalFilterBank::run_ema(size_t end, size_t& k) {
+    for (; k < ema_.filter.size() && ema_.filter[k] < end; ++k) {
+        size_t i = ema_.filter[k];
+        if (!present_[i]) continue;
+        double x = input_[i];
+        double a = ema_.alpha[k];
+        ema_.state[k] = ema_.primed[k] ? a * x + (1.0 - a) * ema_.state[k] : x;
+        ema_.primed[k] = 1;
+        output_[i] = ema_.state[k];
+    }
+}
+
+void SignalFilterBank::run_one_euro(size_t end, size_t& k, double dt) {
+    for (; k < one_euro_.filter.size() && one_euro_.filter[k] < end; ++k) {
+        size_t i = one_euro_.filter[k];
+        if (!present_[i]) continue;
+        double x = input_[i];
+        if (!one_euro_.primed[k]) {
+            one_euro_.x_prev[k] = x;
+            one_euro_.dx_prev[k] = 0.0;
+            one_euro_.primed[k] = 1;
+            output_[i] = x;
+            continue;
+        }
+        double dx = (x - one_euro_.x_prev[k]) / dt;
+        double a_d = low_pass_alpha(one_euro_.d_cutoff[k], dt);
+        double edx = a_d * dx + (1.0 - a_d) * one_euro_.dx_prev[k];
+        double cutoff = one_euro_.min_cutoff[k] + one_euro_.beta[k] * std::fabs(edx);
+        double a = low_pass_alpha(cutoff, dt);
+        double filtered = a * x + (1.0 - a) * one_euro_.x_prev[k];
+        one_euro_.x_prev[k] = filtered;
+        one_euro_.dx_prev[k] = edx;
+        output_[i] = filtered;
+    }
+}
+
+void SignalFilterBank::run_median(size_t end, size_t& k) {
+    for (; k < median_.filter.size() && median_.filter[k] < end; ++k) {
+        size_t i = median_.filter[k];
+        if (!present_[i]) continue;
+        int window = median_.window[k];
+        double* ring = &median_.samples[median_.offset[k]];
+        ring[median_.head[k]] = input_[i];
+        median_.head[k] = (median_.head[k] + 1) % window;
+        median_.count[k] = std::min(median_.count[k] + 1, window);
+
+        int n = median_.count[k];
+        std::copy(ring, ring + n, median_.scratch.begin());
+        auto middle = median_.scratch.begin() + n / 2;
+        std::nth_element(median_.scratch.begin(), middle, median_.scratch.begin() + n);
+        output_[i] = *middle;
+    }
+}
@@ -0,0 +1,109 @@
+#pragma once
+
+#include <cstdint>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "nlohmann/json.hpp"
+
+// Smooths raw landmarker signals once per frame, before GestureDetector sees
+// them. Each filter reads one signal and publishes its output under its own
+// name, which gestures reference through "signal_key" like any raw signal (a
+// filter named after its source replaces the raw value). A filter whose source
+// is another filter's name reads that filter's output of the same frame; the
+// filters of a cycle produce nothing.
+//
+// Filters are declared in <gestures_folder>/signals/*.json:
+//   {"filters": [
+//       {"name": "eyeBlinkLeftSmooth", "source": "eyeBlinkLeft", "type": "one_euro",
+//        "min_cutoff": 1.0, "beta": 0.5, "d_cutoff": 1.0},
+//       {"name": "jawOpenEma", "source": "jawOpen", "type": "ema", "alpha": 0.4},
+//       {"name": "mouthSmileRight", "source": "mouthSmileRight", "type": "median", "window": 5}
+//   ]}
+//
+// State is kept in one array per filter type so each frame runs a tight loop
+// per type instead of one virtual call per signal. Filters are ordered by
+// stage, their depth in a chain, and each stage runs after the one it reads.
+class SignalFilterBank {
+public:
+    enum class Type { EMA, OneEuro, Median };
+
+    struct FilterSpec {
+        std::string name;
+        std::string source;
+        Type type = Type::EMA;
+        double alpha = 0.5;      // ema: weight of the newest sample
+        double min_cutoff = 1.0; // one_euro: Hz
+        double beta = 0.0;       // one_euro: cutoff increase per unit/s of speed
+        double d_cutoff = 1.0;   // one_euro: Hz, for the derivative
+        int window = 5;          // median: samples
+    };
+
+    // Parses the "filters" array of one signals file and appends to specs.
+    // Returns false and fills error on the first invalid entry.
+    static bool parse_specs(const nlohmann::json& j, std::vector<FilterSpec>& specs, std::string* error = nullptr);
+    // Loads every *.json file in folder; a missing folder is not an error.
+    static bool load_specs_from_folder(const std::string& folder, std::vector<FilterSpec>& specs, std::string* error = nullptr);
+
+    SignalFilterBank() = default;
+    explicit SignalFilterBank(const std::vector<FilterSpec>& specs);
+
+    // Runs every filter whose source is present in signals and writes the
+    // results back into signals under the filter names. timestamp_s must come
+    // from a monotonic clock; after a gap (e.g. the face was lost) the filters
+    // restart from the next sample instead of smoothing across it.
+    void process(std::unordered_map<std::string, double>& signals, double timestamp_s);
+    void reset();
+    size_t size() const;
+    // Replaces the filter names in names with the signals they read (through
+    // chains of filters), leaving the raw landmarker signals.
+    void resolve_sources(std::set<std::string>& names) const;
+
+private:
+    static constexpr double kMaxGapSeconds = 0.5;
+
+    // Runs the filters of one type up to filter position end, from bank entry k on.
+    void run_ema(size_t end, size_t& k);
+    void run_one_euro(size_t end, size_t& k, double dt);
+    void run_median(size_t end, size_t& k);
+
+    // Filter position past the last filter of each stage.
+    std::vector<size_t> stage_end_;
+    // Per filter, indexed by filter position.
+    std::vector<std::string> names_;
+    std::vector<std::string> sources_;
+    std::vector<double> input_;
+    std::vector<double> output_;
+    std::vector<uint8_t> present_;
+
+    struct EmaBank {
+        std::vector<size_t> filter;
+        std::vector<double> alpha;
+        std::vector<double> state;
+        std::vector<uint8_t> primed;
+    } ema_;
+
+    struct OneEuroBank {
+        std::vector<size_t> filter;
+        std::vector<double> min_cutoff;
+        std::vector<double> beta;
+        std::vector<double> d_cutoff;
+        std::vector<double> x_prev;
+        std::vector<double> dx_prev;
+        std::vector<uint8_t> primed;
+    } one_euro_;
+
+    struct MedianBank {
+        std::vector<size_t> filter;
+        std::vector<size_t> offset; // into samples
+        std::vector<int> window;
+        std::vector<int> count;
+        std::vector<int> head;
+        std::vector<double> samples;
+        std::vector<double> scratch;
+    } median_;
+
+    double last_timestamp_s_ = 0.0;
+    bool has_timestamp_ = false;
+};
@@ -0,0 +1,88 @@
+#include "signal_filter_bank.h"
+#include "test_check.h"
+#include <algorithm>
+#include <iostream>
+#include <cmath>
+#include <set>
+
+int main() {
+    nlohmann::json config = nlohmann::json::parse(R"({
+        "filters": [
+            {"name": "blinkEma", "source": "eyeBlinkLeft", "type": "ema", "alpha": 0.5},
+            {"name": "blinkEuro", "source": "eyeBlinkLeft", "type": "one_euro", "min_cutoff": 1.0, "beta": 0.0},
+            {"name": "eyeBlinkLeft", "source": "eyeBlinkLeft", "type": "median", "window": 3}
+        ]
+    })");
+
+    std::vector<SignalFilterBank::FilterSpec> specs;
+    std::string error;
+    if (!SignalFilterBank::parse_specs(config, specs, &error)) {
+        std::cerr << "Parse failed: " << error << "\n";
+        return 1;
+    }
+    SignalFilterBank bank(specs);
+    std::cout << "Filters: " << bank.size() << "\n";
+
+    // A steady 0.2 signal with a one-frame spike to 0.9 at frame 5
+    double t = 0.0;
+    for (int frame = 0; frame < 10; ++frame, t += 1.0 / 30.0) {
+        double raw = frame == 5 ? 0.9 : 0.2;
+        std::unordered_map<std::string, double> signals = {{"eyeBlinkLeft", raw}};
+        bank.process(signals, t);
+        std::cout << "frame " << frame << " raw " << raw
+                  << " median " << signals["eyeBlinkLeft"]
+                  << " ema " << signals["blinkEma"]
+                  << " one_euro " << signals["blinkEuro"] << "\n";
+        // The median filter removes the spike entirely
+        TEST_CHECK(std::fabs(signals["eyeBlinkLeft"] - 0.2) < 1e-9);
+    }
+
+    // After a gap the filters restart from the next sample
+    std::unordered_map<std::string, double> signals = {{"eyeBlinkLeft", 0.8}};
+    bank.process(signals, t + 2.0);
+    std::cout << "after gap: ema " << signals["blinkEma"] << "\n";
+    TEST_CHECK(signals["blinkEma"] == 0.8);
+
+    // Filter names resolve to the raw signals they read
+    std::set<std::string> names = {"blinkEuro", "jawOpen"};
+    bank.resolve_sources(names);
+    TEST_CHECK((names == std::set<std::string>{"eyeBlinkLeft", "jawOpen"}));
+
+    // A filter may read another filter's output of the same frame, whatever
+    // the declaration order; the filters of a cycle produce nothing
+    std::vector<SignalFilterBank::FilterSpec> chained;
+    TEST_CHECK(SignalFilterBank::parse_specs(nlohmann::json::parse(R"({
+        "filters": [
+            {"name": "b", "source": "a", "type": "median", "window": 3},
+            {"name": "a", "source": "raw", "type": "ema", "alpha": 0.5},
+            {"name": "c", "source": "d", "type": "ema", "alpha": 0.5},
+            {"name": "d", "source": "c", "type": "ema", "alpha": 0.5}
+        ]
+    })"), chained, &error));
+    SignalFilterBank chain(chained);
+    std::vector<double> ema_outputs;
+    for (int frame = 0; frame < 6; ++frame) {
+        double raw = frame % 2;
+        ema_outputs.push_back(ema_outputs.empty() ? raw : 0.5 * raw + 0.5 * ema_outputs.back());
+        std::vector<double> window(ema_outputs.end() - std::min<size_t>(ema_outputs.size(), 3), ema_outputs.end());
+        std::sort(window.begin(), window.end());
+        double expected = window[window.size() / 2];
+
+        std::unordered_map<std::string, double> chain_signals = {{"raw", raw}};
+        chain.process(chain_signals, frame / 30.0);
+        std::cout << "chained frame " << frame << " a " << chain_signals["a"] << " b " << chain_signals["b"] << "\n";
+        TEST_CHECK(chain_signals.count("b") == 1);
+        TEST_CHECK(std::fabs(chain_signals["a"] - ema_outputs.back()) < 1e-9);
+        TEST_CHECK(std::fabs(chain_signals["b"] - expected) < 1e-9);
+        TEST_CHECK(chain_signals.count("c") == 0 && chain_signals.count("d") == 0);
+    }
+
+    // Invalid declarations are rejected
+    std::vector<SignalFilterBank::FilterSpec> bad;
+    bool ok = SignalFilterBank::parse_specs(nlohmann::json::parse(R"({"filters": [{"name": "x", "source": "y", "type": "kalman"}]})"), bad, &error);
+    std::cout << "Invalid filter rejected: " << (!ok ? "yes" : "no") << " (" << error << ")\n";
+    TEST_CHECK(!ok);
+
+    std::cout << "Test completed.\n";
+    return 0;
+}
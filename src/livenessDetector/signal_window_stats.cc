@@ -0,0 +1,76 @@
+#include "signal_window_stats.h"
+
+int SignalWindowStats::require(const std::string& signal, double window_ms) {
+    for (size_t i = 0; i < slots_.size(); ++i) {
+        if (slots_[i].signal == signal && slots_[i].window_ms == window_ms) {
+            return static_cast<int>(i);
+        }
+    }
+    Slot slot;
+    slot.signal = signal;
+    slot.window_ms = window_ms;
+    slots_.push_back(std::move(slot));
+    return static_cast<int>(slots_.size() - 1);
+}
+
+void SignalWindowStats::update(const std::unordered_map<std::string, double>& signals, double timestamp_ms) {
+    for (auto& slot : slots_) {
+        auto it = signals.find(slot.signal);
+        if (it != signals.end()) {
+            push(slot, timestamp_ms, it->second);
+        }
+    }
+}
+
+void SignalWindowStats::push(Slot& slot, double t, double v) {
+    if (!slot.samples.empty() && t - slot.samples.back().t > kMaxGapMs) {
+        slot.samples.clear();
+        slot.min_queue.clear();
+        slot.max_queue.clear();
+    }
+
+    slot.samples.push_back({t, v});
+    while (!slot.min_queue.empty() && slot.min_queue.back().v >= v) slot.min_queue.pop_back();
+    slot.min_queue.push_back({t, v});
+    while (!slot.max_queue.empty() && slot.max_queue.back().v <= v) slot.max_queue.pop_back();
+    slot.max_queue.push_back({t, v});
+
+    // Keep exactly one sample at or before the window start, so coverage can reach window_ms.
+    const double start = t - slot.window_ms;
+    while (slot.samples.size() > 1 && slot.samples[1].t <= start) {
+        slot.samples.pop_front();
+    }
+    const double oldest = slot.samples.front().t;
+    while (slot.min_queue.front().t < oldest) slot.min_queue.pop_front();
+    while (slot.max_queue.front().t < oldest) slot.max_queue.pop_front();
+
+    Window& stats = slot.stats;
+    stats.min = slot.min_queue.front().v;
+    stats.max = slot.max_queue.front().v;
+    stats.coverage_ms = t - oldest;
+    stats.velocity = stats.coverage_ms > 0.0
+        ? (v - slot.samples.front().v) * 1000.0 / stats.coverage_ms
+        : 0.0;
+}
+
+void SignalWindowStats::reset() {
+    for (auto& slot : slots_) {
+        slot.samples.clear();
+        slot.min_queue.clear();
+        slot.max_queue.clear();
+        slot.stats = Window{};
+    }
+}
+
+const SignalWindowStats::Window& SignalWindowStats::window(int slot) const {
+    return slots_.at(slot).stats;
+}
+
+bool SignalWindowStats::full(int slot) const {
+    const Slot& s = slots_.at(slot);
+    return !s.samples.empty() && s.stats.coverage_ms >= s.window_ms;
+}
+
+size_t SignalWindowStats::size() const {
+    return slots_.size();
+}
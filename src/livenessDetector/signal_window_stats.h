@@ -0,0 +1,56 @@
+#pragma once
+
+#include <deque>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Sliding-window statistics over the signals fed to GestureDetector. Each
+// (signal, window length) pair that some gesture step asks for gets one slot,
+// updated once per frame in amortized O(1): min and max come from monotonic
+// deques, velocity from the oldest sample still in the window.
+class SignalWindowStats {
+public:
+    struct Window {
+        double min = 0.0;
+        double max = 0.0;
+        double velocity = 0.0;    // units per second between the oldest and newest sample
+        double coverage_ms = 0.0; // time spanned by the samples; below the window length the stats are partial
+    };
+
+    // Returns the slot for signal over window_ms, creating it if needed.
+    int require(const std::string& signal, double window_ms);
+
+    // Adds the current value of every required signal present in signals.
+    // timestamp_ms must come from a monotonic clock.
+    void update(const std::unordered_map<std::string, double>& signals, double timestamp_ms);
+    void reset();
+
+    const Window& window(int slot) const;
+    // True once the slot has seen samples spanning its whole window.
+    bool full(int slot) const;
+    size_t size() const;
+
+private:
+    // A gap longer than this (e.g. the face was lost) empties the windows, so
+    // velocities and holds are never measured across missing frames.
+    static constexpr double kMaxGapMs = 500.0;
+
+    struct Sample {
+        double t;
+        double v;
+    };
+
+    struct Slot {
+        std::string signal;
+        double window_ms;
+        std::deque<Sample> samples; // front is the newest sample at or before now - window_ms
+        std::deque<Sample> min_queue; // increasing values
+        std::deque<Sample> max_queue; // decreasing values
+        Window stats;
+    };
+
+    std::vector<Slot> slots_;
+
+    static void push(Slot& slot, double t, double v);
+};
@@ -0,0 +1,56 @@
+#include "signal_window_stats.h"
+#include "test_check.h"
+#include "gesture.h"
+#include <iostream>
+#include <cmath>
+
+int main() {
+    SignalWindowStats stats;
+    int slot = stats.require("jawOpen", 100.0);
+    TEST_CHECK(stats.require("jawOpen", 100.0) == slot);
+    std::cout << "Slots: " << stats.size() << "\n";
+
+    // A ramp of 0.1 every 20 ms: 5 units per second
+    for (int i = 0; i <= 10; ++i) {
+        stats.update({{"jawOpen", 0.1 * i}}, 20.0 * i);
+    }
+    const SignalWindowStats::Window& w = stats.window(slot);
+    std::cout << "min " << w.min << " max " << w.max << " velocity " << w.velocity
+              << " coverage " << w.coverage_ms << " full " << stats.full(slot) << "\n";
+    TEST_CHECK(std::fabs(w.min - 0.5) < 1e-9);
+    TEST_CHECK(std::fabs(w.max - 1.0) < 1e-9);
+    TEST_CHECK(std::fabs(w.velocity - 5.0) < 1e-9);
+    TEST_CHECK(stats.full(slot));
+
+    // A gap empties the window
+    stats.update({{"jawOpen", 0.3}}, 2000.0);
+    std::cout << "after gap: coverage " << stats.window(slot).coverage_ms << " full " << stats.full(slot) << "\n";
+    TEST_CHECK(!stats.full(slot));
+
+    // hold_higher passes only once the signal stayed above 0.5 for the whole window
+    Gesture::Step hold{Gesture::Step::MoveType::HoldHigher, 0.5, std::nullopt, 100.0};
+    Gesture::Step release{Gesture::Step::MoveType::Lower, 0.2, std::nullopt};
+    Gesture gesture("hold", "Hold", 10.0, false, {hold, release}, std::nullopt, std::string("jawOpen"));
+    SignalWindowStats gesture_stats;
+    TEST_CHECK(gesture.bind_windows(gesture_stats));
+    gesture.start();
+
+    int passed_at = -1;
+    for (int i = 0; i < 20; ++i) {
+        gesture_stats.update({{"jawOpen", 0.8}}, 3000.0 + 20.0 * i);
+        gesture.update(0.8, std::nullopt, std::string("jawOpen"), &gesture_stats);
+        if (passed_at < 0 && gesture.get_current_index() == 1) {
+            passed_at = i;
+        }
+    }
+    std::cout << "hold passed at frame " << passed_at << "\n";
+    TEST_CHECK(passed_at == 5);
+
+    gesture_stats.update({{"jawOpen", 0.1}}, 3400.0);
+    bool done = gesture.update(0.1, std::nullopt, std::string("jawOpen"), &gesture_stats);
+    std::cout << "gesture completed: " << (done ? "yes" : "no") << "\n";
+    TEST_CHECK(done);
+
+    std::cout << "Test completed.\n";
+    return 0;
+}
@@ -0,0 +1,167 @@
+#include "snapshot_store.h"
+#include "logger.h"
+#include <algorithm>
+#include <chrono>
+
+bool SnapshotStore::Config::apply_request(const nlohmann::json& request, std::string* error) {
+    if (request.contains("format")) {
+        if (!request["format"].is_string() ||
+            (request["format"] != "jpeg" && request["format"] != "webp")) {
+            if (error) *error = "snapshot format must be \"jpeg\" or \"webp\"";
+            return false;
+        }
+        format = request["format"].get<std::string>();
+    }
+    if (request.contains("quality")) {
+        if (!request["quality"].is_number_integer() ||
+            request["quality"].get<int>() < 1 || request["quality"].get<int>() > 100) {
+            if (error) *error = "snapshot quality must be an integer between 1 and 100";
+            return false;
+        }
+        quality = request["quality"].get<int>();
+    }
+    if (request.contains("face_only")) {
+        if (!request["face_only"].is_boolean()) {
+            if (error) *error = "snapshot face_only must be a boolean";
+            return false;
+        }
+        face_only = request["face_only"].get<bool>();
+    }
+    if (request.contains("max_snapshots")) {
+        if (!request["max_snapshots"].is_number_integer() ||
+            request["max_snapshots"].get<int>() < 1 || request["max_snapshots"].get<int>() > 32) {
+            if (error) *error = "max_snapshots must be an integer between 1 and 32";
+            return false;
+        }
+        max_snapshots = request["max_snapshots"].get<size_t>();
+    }
+    return true;
+}
+
+std::string SnapshotStore::Snapshot::header() const {
+    nlohmann::json header;
+    header["type"] = "snapshot";
+    header["gesture"] = gesture_id;
+    header["format"] = format;
+    header["region"] = {region.x, region.y, region.width, region.height};
+    header["frame"] = {frame_size.width, frame_size.height};
+    header["captured_ms"] = captured_ms;
+    return header.dump();
+}
+
+SnapshotStore::SnapshotStore(Config config, std::shared_ptr<WorkerPool> workers,
+                             std::shared_ptr<CancellationToken> token)
+    : state_(std::make_shared<State>()),
+      workers_(std::move(workers)),
+      token_(std::move(token)) {
+    state_->config = std::move(config);
+}
+
+cv::Rect SnapshotStore::crop_region(const cv::Size& frame_size, const cv::Rect2f& face, float margin) {
+    cv::Rect whole(0, 0, frame_size.width, frame_size.height);
+    if (face.width <= 0.0f || face.height <= 0.0f) {
+        return whole;
+    }
+    float x0 = (face.x - face.width * margin) * frame_size.width;
+    float y0 = (face.y - face.height * margin) * frame_size.height;
+    float x1 = (face.x + face.width * (1.0f + margin)) * frame_size.width;
+    float y1 = (face.y + face.height * (1.0f + margin)) * frame_size.height;
+    cv::Rect region(cv::Point(cvRound(x0), cvRound(y0)), cv::Point(cvRound(x1), cvRound(y1)));
+    region &= whole;
+    return region.area() > 0 ? region : whole;
+}
+
+bool SnapshotStore::capture(const cv::Mat& frame, const std::string& gesture_id, const cv::Rect2f& face) {
+    if (frame.empty()) {
+        return false;
+    }
+    Snapshot snapshot;
+    snapshot.gesture_id = gesture_id;
+    snapshot.frame_size = frame.size();
+    snapshot.region = state_->config.face_only
+        ? crop_region(frame.size(), face, state_->config.face_margin)
+        : cv::Rect(0, 0, frame.cols, frame.rows);
+    snapshot.captured_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+
+    cv::Mat copy;
+    {
+        std::lock_guard<std::mutex> lock(state_->mutex);
+        if (state_->in_flight + state_->ready.size() >= state_->config.max_snapshots) {
+            state_->dropped++;
+            LOG_WARNING("[Snapshots] Store full, dropped the snapshot of {}", gesture_id);
+            return false;
+        }
+        state_->in_flight++;
+        if (!state_->free_frames.empty()) {
+            copy = std::move(state_->free_frames.back());
+            state_->free_frames.pop_back();
+        }
+    }
+    // Reuses the pooled buffer when the region has the same size as last time
+    frame(snapshot.region).copyTo(copy);
+
+    auto state = state_;
+    if (!workers_) {
+        encode(state, std::move(snapshot), copy);
+        return true;
+    }
+    // std::function needs a copyable job; the Mat header is, and shares the pixels
+    bool queued = workers_->submit([state, snapshot, copy]() mutable {
+        encode(state, std::move(snapshot), copy);
+    }, WorkerPool::Priority::Normal, token_);
+    if (queued) {
+        return true;
+    }
+    // Encoding here would stall the frame thread the pool is there to protect.
+    std::lock_guard<std::mutex> lock(state_->mutex);
+    state_->in_flight--;
+    state_->dropped++;
+    state_->free_frames.push_back(std::move(copy));
+    LOG_WARNING("[Snapshots] Encoder queue full, dropped the snapshot of {}", gesture_id);
+    return false;
+}
+
+void SnapshotStore::encode(const std::shared_ptr<State>& state, Snapshot snapshot, cv::Mat frame) {
+    std::vector<int> params;
+    std::string extension;
+    if (state->config.format == "webp") {
+        extension = ".webp";
+        params = {cv::IMWRITE_WEBP_QUALITY, state->config.quality};
+    } else {
+        extension = ".jpg";
+        params = {cv::IMWRITE_JPEG_QUALITY, state->config.quality};
+    }
+    snapshot.format = state->config.format;
+
+    bool encoded = false;
+    try {
+        encoded = cv::imencode(extension, frame, snapshot.data, params);
+    } catch (const cv::Exception& e) {
+        LOG_ERROR("[Snapshots] Encoding {} failed: {}", snapshot.format, e.what());
+    }
+
+    std::lock_guard<std::mutex> lock(state->mutex);
+    state->in_flight--;
+    state->free_frames.push_back(std::move(frame));
+    if (encoded) {
+        state->ready.push_back(std::move(snapshot));
+    } else {
+        state->dropped++;
+    }
+}
+
+std::optional<SnapshotStore::Snapshot> SnapshotStore::take() {
+    std::lock_guard<std::mutex> lock(state_->mutex);
+    if (state_->ready.empty()) {
+        return std::nullopt;
+    }
+    Snapshot snapshot = std::move(state_->ready.front());
+    state_->ready.pop_front();
+    return snapshot;
+}
+
+size_t SnapshotStore::dropped() const {
+    std::lock_guard<std::mutex> lock(state_->mutex);
+    return state_->dropped;
+}
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <opencv2/opencv.hpp>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <vector>
+#include "nlohmann/json.hpp"
+#include "worker_pool.h"
+
+// Pictures taken when a take_picture_at_the_end gesture completes, encoded
+// off the frame path and held until the client collects them. capture()
+// copies the frame, or just the face region, into a pooled buffer and queues
+// the encoding on a WorkerPool; take() hands out finished snapshots, oldest
+// first. At most max_snapshots are being encoded or waiting at once: later
+// captures are dropped and counted, so a client that never collects cannot
+// grow the session's memory.
+class SnapshotStore {
+public:
+    struct Config {
+        std::string format = "jpeg"; // or "webp"
+        int quality = 90;            // 1-100
+        bool face_only = false;      // crop to the face box when one is known
+        float face_margin = 0.25f;   // added on every side, as a fraction of the face box size
+        size_t max_snapshots = 4;
+
+        // Overrides the fields present in {"format":"webp","quality":80,"face_only":true,"max_snapshots":2}.
+        // Returns false and fills error when a field has the wrong type or value.
+        bool apply_request(const nlohmann::json& request, std::string* error = nullptr);
+    };
+
+    struct Snapshot {
+        std::string gesture_id;
+        std::string format;
+        cv::Rect region;      // part of the frame encoded
+        cv::Size frame_size;
+        int64_t captured_ms = 0; // system clock
+        std::vector<uchar> data; // encoded image
+
+        // {"type":"snapshot","gesture":...,"format":...,"region":[x,y,w,h],"frame":[w,h],"captured_ms":...}
+        std::string header() const;
+    };
+
+    // Without workers, capture() encodes on the calling thread. Encodings are
+    // queued with token, so the owner can drop those still waiting.
+    SnapshotStore(Config config, std::shared_ptr<WorkerPool> workers,
+                  std::shared_ptr<CancellationToken> token = nullptr);
+
+    // face is the face box in normalized image coordinates; an empty box, or
+    // face_only off, keeps the whole frame. Returns false when the snapshot
+    // was dropped because the store is full or the pool refused the encoding
+    // (queue full, token cancelled): it is never encoded on the calling thread
+    // when there are workers.
+    bool capture(const cv::Mat& frame, const std::string& gesture_id, const cv::Rect2f& face = cv::Rect2f());
+    std::optional<Snapshot> take();
+
+    const Config& config() const { return state_->config; }
+    size_t dropped() const;
+
+    // The part of a frame of frame_size that capture() encodes for face.
+    static cv::Rect crop_region(const cv::Size& frame_size, const cv::Rect2f& face, float margin);
+
+private:
+    // Shared with the queued jobs, which may finish after the store is gone.
+    struct State {
+        Config config;
+        std::mutex mutex;
+        std::deque<Snapshot> ready;
+        std::vector<cv::Mat> free_frames; // copies recycled between captures
+        size_t in_flight = 0;
+        size_t dropped = 0;
+    };
+
+    static void encode(const std::shared_ptr<State>& state, Snapshot snapshot, cv::Mat frame);
+
+    std::shared_ptr<State> state_;
+    std::shared_ptr<WorkerPool> workers_;
+    std::shared_ptr<CancellationToken> token_;
+};
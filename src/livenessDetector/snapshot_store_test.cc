@@ -0,0 +1,137 @@
+#include "snapshot_store.h"
+#include "test_check.h"
+#include <iostream>
+#include <chrono>
+#include <future>
+#include <thread>
+
+static cv::Mat noise_frame(int seed) {
+    cv::Mat frame(480, 640, CV_8UC3);
+    cv::RNG rng(seed);
+    rng.fill(frame, cv::RNG::UNIFORM, cv::Scalar::all(0), cv::Scalar::all(255));
+    return frame;
+}
+
+static std::optional<SnapshotStore::Snapshot> wait_for(SnapshotStore& store) {
+    for (int i = 0; i < 500; ++i) {
+        if (auto snapshot = store.take()) {
+            return snapshot;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    }
+    return std::nullopt;
+}
+
+int main() {
+    auto workers = std::make_shared<WorkerPool>(2);
+
+    // Whole frame, JPEG, encoded on the pool and tagged with its gesture.
+    SnapshotStore store(SnapshotStore::Config(), workers);
+    cv::Mat frame = noise_frame(1);
+    bool captured = store.capture(frame, "blink");
+    TEST_CHECK(captured);
+    auto snapshot = wait_for(store);
+    TEST_CHECK(snapshot && snapshot->gesture_id == "blink" && snapshot->format == "jpeg");
+    TEST_CHECK(snapshot->region == cv::Rect(0, 0, 640, 480));
+    cv::Mat decoded = cv::imdecode(snapshot->data, cv::IMREAD_COLOR);
+    TEST_CHECK(decoded.size() == frame.size());
+    std::cout << "JPEG snapshot: " << snapshot->data.size() << " bytes, header " << snapshot->header() << "\n";
+    snapshot = store.take();
+    TEST_CHECK(!snapshot);
+
+    // Face only: the face box grown by the margin, clipped to the frame
+    SnapshotStore::Config face_config;
+    face_config.face_only = true;
+    face_config.face_margin = 0.5f;
+    face_config.format = "webp";
+    SnapshotStore faces(face_config, nullptr); // encoded inline
+    captured = faces.capture(frame, "smile", cv::Rect2f(0.25f, 0.25f, 0.5f, 0.5f));
+    snapshot = faces.take();
+    TEST_CHECK(captured && snapshot && snapshot->region == cv::Rect(0, 0, 640, 480));
+    captured = faces.capture(frame, "smile", cv::Rect2f(0.4f, 0.4f, 0.2f, 0.2f));
+    snapshot = faces.take();
+    TEST_CHECK(captured && snapshot && snapshot->region == cv::Rect(192, 144, 256, 192));
+    decoded = cv::imdecode(snapshot->data, cv::IMREAD_COLOR);
+    TEST_CHECK(decoded.size() == cv::Size(256, 192));
+    // Without a face box the whole frame is kept
+    captured = faces.capture(frame, "smile");
+    snapshot = faces.take();
+    TEST_CHECK(captured && snapshot && snapshot->region == cv::Rect(0, 0, 640, 480));
+    std::cout << "Face crops follow the face box\n";
+
+    // Bounded: captures beyond max_snapshots are dropped until the client takes some
+    SnapshotStore::Config small;
+    small.max_snapshots = 2;
+    SnapshotStore bounded(small, nullptr);
+    bool a = bounded.capture(frame, "a");
+    bool b = bounded.capture(frame, "b");
+    bool c = bounded.capture(frame, "c");
+    TEST_CHECK(a && b && !c);
+    TEST_CHECK(bounded.dropped() == 1);
+    auto taken_a = bounded.take();
+    bool d = bounded.capture(frame, "d");
+    auto taken_b = bounded.take();
+    auto taken_d = bounded.take();
+    TEST_CHECK(d && taken_a->gesture_id == "a" && taken_b->gesture_id == "b" && taken_d->gesture_id == "d");
+    std::cout << "Store bounded to " << small.max_snapshots << " snapshots\n";
+
+    // A refused encoding is dropped, never done on the capturing thread
+    {
+        auto busy = std::make_shared<WorkerPool>(1, 1);
+        std::promise<void> release;
+        std::shared_future<void> gate = release.get_future().share();
+        std::promise<void> started;
+        bool blocking = busy->submit([&started, gate]() { started.set_value(); gate.wait(); });
+        started.get_future().wait();
+        bool filler = busy->submit([]() {}); // the only queue slot
+        TEST_CHECK(blocking && filler);
+        SnapshotStore refused(SnapshotStore::Config(), busy);
+        captured = refused.capture(frame, "blink");
+        TEST_CHECK(!captured && refused.dropped() == 1);
+        release.set_value();
+        snapshot = refused.take();
+        TEST_CHECK(!snapshot);
+
+        auto token = std::make_shared<CancellationToken>();
+        token->cancel();
+        SnapshotStore cancelled(SnapshotStore::Config(), workers, token);
+        captured = cancelled.capture(frame, "blink");
+        TEST_CHECK(!captured && cancelled.dropped() == 1);
+        std::cout << "Refused encodings dropped\n";
+    }
+
+    // The store may go away with encodings in flight
+    {
+        SnapshotStore gone(SnapshotStore::Config(), workers);
+        for (int i = 0; i < 4; ++i) {
+            gone.capture(noise_frame(i), "blink");
+        }
+    }
+
+    // Request parsing
+    SnapshotStore::Config parsed;
+    std::string error;
+    TEST_CHECK(parsed.apply_request({{"format", "webp"}, {"quality", 70}, {"face_only", true}, {"max_snapshots", 3}}, &error));
+    TEST_CHECK(parsed.format == "webp" && parsed.quality == 70 && parsed.face_only && parsed.max_snapshots == 3);
+    bool png = parsed.apply_request({{"format", "png"}}, &error);
+    bool zero_quality = parsed.apply_request({{"quality", 0}}, &error);
+    TEST_CHECK(!png && !zero_quality);
+    std::cout << "Rejected: " << error << "\n";
+
+    // Cost on the frame thread: the copy only
+    const int iterations = 200;
+    SnapshotStore::Config many;
+    many.max_snapshots = 8;
+    SnapshotStore timed(many, workers);
+    double capture_us = 0.0;
+    for (int i = 0; i < iterations; ++i) {
+        auto start = std::chrono::steady_clock::now();
+        timed.capture(frame, "blink");
+        capture_us += std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+        wait_for(timed);
+    }
+    std::cout << "capture: " << capture_us / iterations << " us per 640x480 frame on the frame thread\n";
+
+    std::cout << "Test completed.\n";
+    return 0;
+}
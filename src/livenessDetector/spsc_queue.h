@@ -0,0 +1,142 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+// Bounded single-producer single-consumer ring. try_push()/try_pop() are
+// wait-free: each side owns one index and only reads the other's. push() and
+// pop() block, spinning briefly and then sleeping on a condition variable
+// that the other side only signals when someone is asleep, so the mutex is
+// not touched while the queue keeps moving.
+//
+// close() wakes both sides: push() then fails, and pop() fails once the
+// remaining items are drained. T must be default constructible.
+template <typename T>
+class SpscQueue {
+public:
+    // capacity is rounded up to a power of two.
+    explicit SpscQueue(size_t capacity) {
+        size_t size = 1;
+        while (size < capacity) {
+            size <<= 1;
+        }
+        slots_.resize(size);
+        mask_ = size - 1;
+    }
+
+    SpscQueue(const SpscQueue&) = delete;
+    SpscQueue& operator=(const SpscQueue&) = delete;
+
+    size_t capacity() const { return slots_.size(); }
+
+    // Approximate when called from a third thread.
+    size_t size() const {
+        return tail_.load(std::memory_order_acquire) - head_.load(std::memory_order_acquire);
+    }
+
+    bool try_push(T& value) {
+        if (!put(value)) {
+            return false;
+        }
+        wake_if_sleeping();
+        return true;
+    }
+
+    bool try_pop(T& out) {
+        if (!take(out)) {
+            return false;
+        }
+        wake_if_sleeping();
+        return true;
+    }
+
+    // Waits for room; returns false once closed.
+    bool push(T value) {
+        return wait([this, &value]() { return put(value); });
+    }
+
+    // Waits for an item; returns false once closed and empty.
+    bool pop(T& out) {
+        return wait([this, &out]() { return take(out); });
+    }
+
+    void close() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        closed_.store(true, std::memory_order_seq_cst);
+        cv_.notify_all();
+    }
+
+    bool closed() const { return closed_.load(std::memory_order_acquire); }
+
+private:
+    static constexpr int kSpins = 64;
+
+    // The other side's index is read seq_cst so that, with the seq_cst
+    // sleepers_ updates, a sleeper and the side that would wake it never miss
+    // each other.
+    bool put(T& value) {
+        size_t tail = tail_.load(std::memory_order_relaxed);
+        if (tail - head_.load(std::memory_order_seq_cst) == slots_.size()) {
+            return false;
+        }
+        slots_[tail & mask_] = std::move(value);
+        tail_.store(tail + 1, std::memory_order_seq_cst);
+        return true;
+    }
+
+    bool take(T& out) {
+        size_t head = head_.load(std::memory_order_relaxed);
+        if (head == tail_.load(std::memory_order_seq_cst)) {
+            return false;
+        }
+        out = std::move(slots_[head & mask_]);
+        head_.store(head + 1, std::memory_order_seq_cst);
+        return true;
+    }
+
+    template <typename Attempt>
+    bool wait(Attempt attempt) {
+        for (int i = 0; i < kSpins; ++i) {
+            if (attempt()) {
+                wake_if_sleeping();
+                return true;
+            }
+            if (closed()) {
+                break;
+            }
+        }
+        std::unique_lock<std::mutex> lock(mutex_);
+        // Announce the sleep before each last attempt: either the other side
+        // sees sleepers_ after moving its index, or we see the moved index.
+        sleepers_.fetch_add(1, std::memory_order_seq_cst);
+        bool done = false;
+        while (!(done = attempt()) && !closed()) {
+            cv_.wait(lock);
+        }
+        sleepers_.fetch_sub(1, std::memory_order_seq_cst);
+        if (done) {
+            cv_.notify_all(); // the other side may be asleep; we hold the mutex
+        }
+        return done;
+    }
+
+    void wake_if_sleeping() {
+        if (sleepers_.load(std::memory_order_seq_cst) > 0) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            cv_.notify_all();
+        }
+    }
+
+    std::vector<T> slots_;
+    size_t mask_ = 0;
+    alignas(64) std::atomic<size_t> head_{0}; // consumer
+    alignas(64) std::atomic<size_t> tail_{0}; // producer
+    alignas(64) std::atomic<int> sleepers_{0};
+    std::atomic<bool> closed_{false};
+    std::mutex mutex_;
+    std::condition_variable cv_;
+};
@@ -0,0 +1,70 @@
+#include "spsc_queue.h"
+#include "test_check.h"
+#include <iostream>
+#include <chrono>
+#include <memory>
+#include <thread>
+
+int main() {
+    // Non-blocking calls respect the capacity
+    SpscQueue<int> small(3);
+    TEST_CHECK(small.capacity() == 4);
+    int accepted = 0;
+    for (int i = 0; i < 4; ++i) {
+        int value = i;
+        accepted += small.try_push(value);
+    }
+    TEST_CHECK(accepted == 4);
+    int value = 4;
+    TEST_CHECK(!small.try_push(value));
+    TEST_CHECK(small.size() == 4);
+    int out = -1;
+    TEST_CHECK(small.try_pop(out) && out == 0);
+    TEST_CHECK(small.try_push(value));
+
+    // Items left when closing are still delivered, then pop fails
+    small.close();
+    TEST_CHECK(!small.push(5));
+    for (int expected : {1, 2, 3, 4}) {
+        TEST_CHECK(small.pop(out) && out == expected);
+    }
+    TEST_CHECK(!small.pop(out));
+    std::cout << "Capacity and close\n";
+
+    // Blocking producer and consumer, in order, through a queue much smaller than the stream
+    SpscQueue<std::unique_ptr<int>> queue(4);
+    const int items = 200000;
+    std::thread producer([&queue]() {
+        for (int i = 0; i < items; ++i) {
+            TEST_CHECK(queue.push(std::make_unique<int>(i)));
+        }
+        queue.close();
+    });
+    std::unique_ptr<int> item;
+    int received = 0;
+    auto start = std::chrono::steady_clock::now();
+    while (queue.pop(item)) {
+        TEST_CHECK(*item == received);
+        ++received;
+    }
+    double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+    producer.join();
+    TEST_CHECK(received == items);
+    std::cout << "Received " << received << " items in order, " << ns / items << " ns per item\n";
+
+    // A consumer asleep on an empty queue is woken by a late push and by close
+    SpscQueue<int> idle(2);
+    std::thread late([&idle]() {
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        idle.push(7);
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        idle.close();
+    });
+    TEST_CHECK(idle.pop(out) && out == 7);
+    TEST_CHECK(!idle.pop(out));
+    late.join();
+    std::cout << "Sleeping consumer woken\n";
+
+    std::cout << "Test completed.\n";
+    return 0;
+}
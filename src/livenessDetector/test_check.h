@@ -0,0 +1,16 @@
+#pragma once
+
+#include <cstdlib>
+#include <iostream>
+
+// assert() for the *_test binaries, kept when NDEBUG is defined: they are also
+// built with -c opt, where assert() checks nothing. Prints the condition that
+// failed and exits with a non-zero status.
+#define TEST_CHECK(condition)                                                        \
+    do {                                                                             \
+        if (!(condition)) {                                                          \
+            std::cerr << __FILE__ << ":" << __LINE__ << ": check failed: " #condition \
+                      << std::endl;                                                  \
+            std::exit(EXIT_FAILURE);                                                 \
+        }                                                                            \
+    } while (0)
@@ -1,5 +1,5 @@
 #include "translation_manager.h"
-#include <iostream>
+#include "logger.h"
 #include <fstream>
 #include <sstream>
 #include <filesystem>
@@ -16,32 +16,46 @@ TranslationManager::TranslationManager(std::string locale, const std::vector<std
     translations = load_translations(locale);
 }
 
-std::string TranslationManager::translate(const std::string& key) {
+TranslationManager::TranslationManager(std::string locale, std::shared_ptr<const AssetBundle> bundle)
+    : locales_dir(""), locale(locale), locale_not_found(false), bundle(std::move(bundle))
+{
+    bundle_locale = find_bundle_locale(locale);
+}
+
+std::string TranslationManager::translate(const std::string& key) const {
     if (locale_not_found) {
         return key;
     }
 
-    nlohmann::json current = translations;
+    if (bundle) {
+        auto value = bundle->lookup(*bundle_locale, key);
+        return value ? std::string(*value) : key;
+    }
+
+    const nlohmann::json* current = &translations;
     std::istringstream iss(key);
     std::string token;
 
     while (std::getline(iss, token, '.')) {
-        try {
-            current = current.at(token);
-        } catch (nlohmann::json::exception& e) {
+        if (!current->is_object()) {
+            return key; // Return the key if not found
+        }
+        auto it = current->find(token);
+        if (it == current->end()) {
             return key; // Return the key if not found
         }
+        current = &*it;
     }
 
-    if (current.is_string()) {
-        return current.get<std::string>();
+    if (current->is_string()) {
+        return current->get<std::string>();
     }
 
     return key; // Return the key if not found
 }
 
 nlohmann::json TranslationManager::load_translations(const std::string& locale) {
-    std::cout << "Loading translation from:" << locale << std::endl;
+    LOG_INFO("Loading translation from:{}", locale);
     auto parts = split_locale(locale);
     try {
         return load_locale_file(locale);
@@ -50,14 +64,14 @@ nlohmann::json TranslationManager::load_translations(const std::string& locale)
             try {
                 return load_locale_file(parts[0]);
             } catch (std::exception&) {
-                std::cerr << "Warning, Locale Part not found: " << locale << std::endl;
+                LOG_WARNING("Warning, Locale Part not found: {}", locale);
             }
         }
         try {
             return load_locale_file("default");
         } catch (std::exception&) {
             locale_not_found = true;
-            std::cerr << "Warning, Locale not found: " << locale << std::endl;
+            LOG_WARNING("Warning, Locale not found: {}", locale);
             return nlohmann::json::object();
         }
     }
@@ -95,6 +109,26 @@ nlohmann::json TranslationManager::load_locale_file(const std::string& locale_na
     return j;
 }
 
+std::optional<size_t> TranslationManager::find_bundle_locale(const std::string& locale) {
+    LOG_INFO("Loading translation from bundle:{}", locale);
+    auto parts = split_locale(locale);
+    if (auto index = bundle->find_locale(locale)) {
+        return index;
+    }
+    if (parts.size() > 1) {
+        if (auto index = bundle->find_locale(parts[0])) {
+            return index;
+        }
+        LOG_WARNING("Warning, Locale Part not found: {}", locale);
+    }
+    if (auto index = bundle->find_locale("default")) {
+        return index;
+    }
+    locale_not_found = true;
+    LOG_WARNING("Warning, Locale not found: {}", locale);
+    return std::nullopt;
+}
+
 std::vector<std::string> TranslationManager::split_locale(const std::string& locale) {
     std::vector<std::string> parts;
     std::istringstream iss(locale);
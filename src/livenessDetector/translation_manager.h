@@ -2,13 +2,17 @@
 
 #include <string>
 #include <vector>
+#include <memory>
+#include <optional>
 #include "nlohmann/json.hpp"
+#include "asset_bundle.h"
 
 class TranslationManager {
 public:
     TranslationManager(std::string locale = "en", const std::string& locales_dir = "locales");
     TranslationManager(std::string locale, const std::vector<std::string>& locales_dirs);
-    std::string translate(const std::string& key);
+    TranslationManager(std::string locale, std::shared_ptr<const AssetBundle> bundle);
+    std::string translate(const std::string& key) const;
 
 private:
     std::string locales_dir;
@@ -16,8 +20,11 @@ private:
     std::string locale;
     bool locale_not_found;
     nlohmann::json translations;
+    std::shared_ptr<const AssetBundle> bundle;
+    std::optional<size_t> bundle_locale;
 
     nlohmann::json load_translations(const std::string& locale);
     nlohmann::json load_locale_file(const std::string& locale_name);
+    std::optional<size_t> find_bundle_locale(const std::string& locale);
     std::vector<std::string> split_locale(const std::string& locale);
 };
\ No newline at end of file
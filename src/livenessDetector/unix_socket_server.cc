@@ -1,17 +1,28 @@
 #include "unix_socket_server.h"
-#include <iostream>
+#include "logger.h"
+#include "spsc_queue.h"
 #include <sys/socket.h>
 #include <sys/un.h>
 #include <unistd.h>
 #include <vector>
 #include <arpa/inet.h>
+#include <endian.h>
+#include <cstring>
+#include <chrono>
+#include <thread>
 
 UnixSocketServer::UnixSocketServer(const std::string& socketPath,
                                    ImageProcessingCallback imgCallback,
                                    DataProcessingCallback dataCallback)
+    : UnixSocketServer(socketPath,
+                       [callbacks = ClientCallbacks{std::move(imgCallback), std::move(dataCallback), nullptr}]() {
+                           return std::optional<ClientCallbacks>(callbacks);
+                       }) {}
+
+UnixSocketServer::UnixSocketServer(const std::string& socketPath,
+                                   ClientConnectedCallback clientConnectedCallback)
     : socketPath(socketPath),
-      processImageCallback(std::move(imgCallback)),
-      processDataCallback(std::move(dataCallback)),
+      clientConnectedCallback(std::move(clientConnectedCallback)),
       server_fd(-1) {}
 
 UnixSocketServer::~UnixSocketServer() {
@@ -48,13 +59,13 @@ bool UnixSocketServer::start() {
         return false;
     }
 
-    std::cout << "Server started, listening for connections...\n";
+    LOG_INFO("Server started, listening for connections...");
     return true;
 }
 
 void UnixSocketServer::run() {
     if (server_fd == -1) {
-        std::cerr << "Server socket not initialized\n";
+        LOG_ERROR("Server socket not initialized");
         return;
     }
 
@@ -64,112 +75,320 @@ void UnixSocketServer::run() {
             perror("accept");
             continue;
         }
-        std::cout << "Client connected...\n";
+        LOG_INFO("Client connected...");
+
+        std::optional<ClientCallbacks> callbacks = clientConnectedCallback();
+        if (!callbacks) {
+            LOG_WARNING("Client rejected");
+            close(client_fd);
+            continue;
+        }
 
-        while (processClient(client_fd)) {}
+        if (callbacks->submitImage && callbacks->renderImage) {
+            PipelineStats stats = runPipeline(client_fd, *callbacks);
+            LOG_INFO("[Pipeline] {} frames in {} s, busy: receive {}, submit {}, render {}",
+                     stats.frames, stats.seconds, stats.receive_busy, stats.submit_busy, stats.render_busy);
+            LOG_DEBUG("[Pipeline] Frames waiting on arrival: submit {}, render {}",
+                      stats.submit_queued, stats.render_queued);
+        } else {
+            while (processClient(client_fd, *callbacks)) {}
+        }
 
-        std::cout << "Client disconnected...\n";
+        LOG_INFO("Client disconnected...");
+        if (callbacks->onDisconnect) {
+            callbacks->onDisconnect();
+        }
         close(client_fd);
     }
 }
 
-bool UnixSocketServer::processClient(int client_fd) {
+bool UnixSocketServer::processClient(int client_fd, const ClientCallbacks& callbacks) {
     uint8_t function_id;
     ssize_t bytes_read = read(client_fd, &function_id, sizeof(function_id));
     if (bytes_read != sizeof(function_id)) {
-        std::cerr << "Failed to read function ID\n";
+        LOG_WARNING("Failed to read function ID");
         return false;
     }
 
-    if (function_id == 0x01) { // Image processing
-        uint32_t frame_size;
-        bytes_read = read(client_fd, &frame_size, sizeof(frame_size));
-        if (bytes_read != sizeof(frame_size)) {
-            std::cerr << "Failed to read frame size\n";
+    if (function_id == 0x01 || function_id == 0x04) { // Image processing; 0x04 carries a capture timestamp
+        Frame frame;
+        if (!readImage(client_fd, function_id, frame)) {
             return false;
         }
-        frame_size = ntohl(frame_size);
-
-        uint32_t rows, cols;
-        if (read(client_fd, &rows, sizeof(rows)) != sizeof(rows)) return false;
-        if (read(client_fd, &cols, sizeof(cols)) != sizeof(cols)) return false;
-        rows = ntohl(rows);
-        cols = ntohl(cols);
-
-        std::vector<uchar> frame_data(frame_size);
-        size_t total_bytes_received = 0;
-        while (total_bytes_received < frame_size) {
-            ssize_t bytes_received = read(client_fd, frame_data.data() + total_bytes_received, frame_size - total_bytes_received);
-            if (bytes_received <= 0) {
-                std::cerr << "Client disconnected or read error\n";
-                return false;
-            }
-            total_bytes_received += bytes_received;
+        auto [processed_img, info_string] = callbacks.processImage(frame.image);
+        sendReply(client_fd, callbacks, frame, processed_img, info_string);
+    } else if (function_id == 0x02) { // JSON config/setup
+        return processJson(client_fd, callbacks);
+    }
+
+    return true;
+}
+
+UnixSocketServer::PipelineStats UnixSocketServer::runPipeline(int client_fd, const ClientCallbacks& callbacks) {
+    using Clock = std::chrono::steady_clock;
+    auto elapsed_ns = [](Clock::time_point since) {
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - since).count());
+    };
+
+    // Frames go round: free -> receive -> submit -> render -> free. A stage
+    // that falls behind fills the queue in front of it, and the socket thread
+    // stops reading once every frame is taken.
+    std::vector<Frame> frames(kPipelineDepth);
+    SpscQueue<Frame*> free_frames(kPipelineDepth);
+    SpscQueue<Frame*> to_submit(kPipelineDepth);
+    SpscQueue<Frame*> to_render(kPipelineDepth);
+    for (Frame& frame : frames) {
+        Frame* slot = &frame;
+        free_frames.try_push(slot);
+    }
+
+    uint64_t submit_busy_ns = 0;
+    uint64_t render_queued = 0;
+    std::thread submit_thread([&]() {
+        Frame* frame;
+        while (to_submit.pop(frame)) {
+            auto start = Clock::now();
+            callbacks.submitImage(frame->image, frame->timing);
+            submit_busy_ns += elapsed_ns(start);
+            render_queued += to_render.size();
+            to_render.push(frame);
         }
+        to_render.close();
+    });
 
-        cv::Mat img(rows, cols, CV_8UC3, frame_data.data());
-        auto [processed_img, info_string] = processImageCallback(img);
+    uint64_t render_busy_ns = 0;
+    std::thread render_thread([&]() {
+        Frame* frame;
+        while (to_render.pop(frame)) {
+            auto start = Clock::now();
+            auto [processed_img, info_string] = callbacks.renderImage(frame->image, frame->timing);
+            sendReply(client_fd, callbacks, *frame, processed_img, info_string);
+            render_busy_ns += elapsed_ns(start);
+            free_frames.push(frame);
+        }
+    });
 
-        if (!info_string.empty()) {
-            // Send string information
-            uint8_t response_function_id = 0x02; // For string data
-            uint32_t string_size = info_string.size();
-            string_size = htonl(string_size);
+    auto connected = Clock::now();
+    uint64_t receive_busy_ns = 0;
+    uint64_t submit_queued = 0;
+    uint64_t received = 0;
+    while (true) {
+        uint8_t function_id;
+        if (read(client_fd, &function_id, sizeof(function_id)) != sizeof(function_id)) {
+            break; // client disconnected
+        }
 
-            write(client_fd, &response_function_id, sizeof(response_function_id));
-            write(client_fd, &string_size, sizeof(string_size));
-            write(client_fd, info_string.data(), info_string.size());
+        if (function_id == 0x01 || function_id == 0x04) {
+            Frame* frame;
+            if (!free_frames.pop(frame)) {
+                break;
+            }
+            if (!readImage(client_fd, function_id, *frame)) {
+                break;
+            }
+            receive_busy_ns += elapsed_ns(frame->started);
+            ++received;
+            submit_queued += to_submit.size();
+            to_submit.push(frame);
+        } else if (function_id == 0x02) {
+            // Control messages may change the session the stages work on, so
+            // wait for every frame to come back before handling one.
+            std::vector<Frame*> drained;
+            Frame* frame;
+            while (drained.size() < kPipelineDepth && free_frames.pop(frame)) {
+                drained.push_back(frame);
+            }
+            bool ok = processJson(client_fd, callbacks);
+            for (Frame* slot : drained) {
+                free_frames.try_push(slot);
+            }
+            if (!ok) {
+                break;
+            }
         }
+    }
 
-        // Always send the processed image
-        uint8_t response_function_id = 0x01; // For image processing
-        write(client_fd, &response_function_id, sizeof(response_function_id));
+    to_submit.close();
+    submit_thread.join();
+    render_thread.join();
 
-        uint32_t processed_size = htonl(processed_img.total() * processed_img.elemSize());
-        uint32_t net_rows = htonl(processed_img.rows);
-        uint32_t net_cols = htonl(processed_img.cols);
+    PipelineStats stats;
+    stats.frames = received;
+    stats.seconds = elapsed_ns(connected) * 1e-9;
+    if (stats.seconds > 0) {
+        stats.receive_busy = receive_busy_ns * 1e-9 / stats.seconds;
+        stats.submit_busy = submit_busy_ns * 1e-9 / stats.seconds;
+        stats.render_busy = render_busy_ns * 1e-9 / stats.seconds;
+    }
+    if (received > 0) {
+        stats.submit_queued = static_cast<double>(submit_queued) / received;
+        stats.render_queued = static_cast<double>(render_queued) / received;
+    }
+    return stats;
+}
 
-        write(client_fd, &processed_size, sizeof(processed_size));
-        write(client_fd, &net_rows, sizeof(net_rows));
-        write(client_fd, &net_cols, sizeof(net_cols));
-        write(client_fd, processed_img.data, processed_img.total() * processed_img.elemSize());
-    } else if (function_id == 0x02) { // JSON config/setup
-        uint32_t json_size;
-        if (read(client_fd, &json_size, sizeof(json_size)) != sizeof(json_size)) {
-            std::cerr << "Failed to read JSON size\n";
+bool UnixSocketServer::readImage(int client_fd, uint8_t function_id, Frame& frame) {
+    frame.function_id = function_id;
+    frame.started = std::chrono::steady_clock::now();
+    frame.timing = FrameTiming();
+
+    uint32_t frame_size;
+    ssize_t bytes_read = read(client_fd, &frame_size, sizeof(frame_size));
+    if (bytes_read != sizeof(frame_size)) {
+        LOG_WARNING("Failed to read frame size");
+        return false;
+    }
+    frame_size = ntohl(frame_size);
+
+    uint32_t rows, cols;
+    if (read(client_fd, &rows, sizeof(rows)) != sizeof(rows)) return false;
+    if (read(client_fd, &cols, sizeof(cols)) != sizeof(cols)) return false;
+    rows = ntohl(rows);
+    cols = ntohl(cols);
+
+    if (function_id == 0x04) {
+        uint64_t capture_us;
+        if (read(client_fd, &capture_us, sizeof(capture_us)) != sizeof(capture_us)) return false;
+        frame.timing.capture_timestamp_us = be64toh(capture_us);
+    }
+
+    frame.data.resize(frame_size); // keeps the capacity of the previous frame
+    size_t total_bytes_received = 0;
+    while (total_bytes_received < frame_size) {
+        ssize_t bytes_received = read(client_fd, frame.data.data() + total_bytes_received, frame_size - total_bytes_received);
+        if (bytes_received <= 0) {
+            LOG_WARNING("Client disconnected or read error");
             return false;
         }
-        json_size = ntohl(json_size);
-    
-        std::vector<char> json_buffer(json_size);
-        size_t total_received = 0;
-        while (total_received < json_size) {
-            ssize_t r = read(client_fd, json_buffer.data() + total_received, json_size - total_received);
-            if (r <= 0) {
-                std::cerr << "Client disconnected or read error for JSON\n";
-                return false;
-            }
-            total_received += r;
-        }
-    
-        std::string json_str(json_buffer.data(), json_buffer.size());
-        std::cout << "Received JSON: " << json_str << std::endl;
-    
-        // send the JSON to the callback
-        std::string info_string = processDataCallback(json_str);
-        
-        if (!info_string.empty()) {
-            // Send string information
-            uint8_t response_function_id = 0x02; // For string data
-            uint32_t string_size = info_string.size();
-            string_size = htonl(string_size);
-
-            write(client_fd, &response_function_id, sizeof(response_function_id));
-            write(client_fd, &string_size, sizeof(string_size));
-            write(client_fd, info_string.data(), info_string.size());
+        total_bytes_received += bytes_received;
+    }
+
+    frame.image = cv::Mat(rows, cols, CV_8UC3, frame.data.data());
+    frame.timing.receive_us = static_cast<uint32_t>(std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - frame.started).count());
+    return true;
+}
+
+bool UnixSocketServer::processJson(int client_fd, const ClientCallbacks& callbacks) {
+    uint32_t json_size;
+    if (read(client_fd, &json_size, sizeof(json_size)) != sizeof(json_size)) {
+        LOG_WARNING("Failed to read JSON size");
+        return false;
+    }
+    json_size = ntohl(json_size);
+
+    std::vector<char> json_buffer(json_size);
+    size_t total_received = 0;
+    while (total_received < json_size) {
+        ssize_t r = read(client_fd, json_buffer.data() + total_received, json_size - total_received);
+        if (r <= 0) {
+            LOG_WARNING("Client disconnected or read error for JSON");
+            return false;
         }
+        total_received += r;
+    }
+
+    std::string json_str(json_buffer.data(), json_buffer.size());
+    LOG_DEBUG("Received JSON: {}", json_str);
+
+    // send the JSON to the callback
+    std::string info_string = callbacks.processData(json_str);
 
+    if (!info_string.empty()) {
+        // Send string information
+        uint8_t response_function_id = 0x02; // For string data
+        uint32_t string_size = info_string.size();
+        string_size = htonl(string_size);
+
+        write(client_fd, &response_function_id, sizeof(response_function_id));
+        write(client_fd, &string_size, sizeof(string_size));
+        write(client_fd, info_string.data(), info_string.size());
     }
 
+    sendBinaryMessage(client_fd, callbacks);
     return true;
+}
+
+void UnixSocketServer::sendReply(int client_fd, const ClientCallbacks& callbacks, Frame& frame,
+                                 const cv::Mat& processed_img, const std::string& info_string) {
+    if (!info_string.empty()) {
+        // Send string information
+        uint8_t response_function_id = 0x02; // For string data
+        uint32_t string_size = info_string.size();
+        string_size = htonl(string_size);
+
+        write(client_fd, &response_function_id, sizeof(response_function_id));
+        write(client_fd, &string_size, sizeof(string_size));
+        write(client_fd, info_string.data(), info_string.size());
+    }
+
+    sendBinaryMessage(client_fd, callbacks);
+
+    // Always send the processed image, as 0x04 with the timing when asked with 0x04
+    uint8_t response_function_id = frame.function_id;
+    write(client_fd, &response_function_id, sizeof(response_function_id));
+
+    uint32_t processed_size = htonl(processed_img.total() * processed_img.elemSize());
+    uint32_t net_rows = htonl(processed_img.rows);
+    uint32_t net_cols = htonl(processed_img.cols);
+
+    write(client_fd, &processed_size, sizeof(processed_size));
+    write(client_fd, &net_rows, sizeof(net_rows));
+    write(client_fd, &net_cols, sizeof(net_cols));
+    if (frame.function_id == 0x04) {
+        frame.timing.total_us = static_cast<uint32_t>(std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - frame.started).count());
+        sendFrameTiming(client_fd, frame.timing);
+    }
+    write(client_fd, processed_img.data, processed_img.total() * processed_img.elemSize());
+}
+
+void UnixSocketServer::sendBinaryMessage(int client_fd, const ClientCallbacks& callbacks) {
+    if (!callbacks.takeBinaryMessage) {
+        return;
+    }
+    while (std::optional<BinaryMessage> message = callbacks.takeBinaryMessage()) {
+        const uint8_t* payload = message->payload.data();
+        size_t size = message->payload.size();
+        if (message->external_payload) {
+            payload = message->external_payload;
+            size = message->external_size;
+        }
+
+        uint8_t response_function_id = 0x03; // Binary message
+        uint32_t header_size = htonl(message->header.size());
+        uint32_t payload_size = htonl(size);
+        write(client_fd, &response_function_id, sizeof(response_function_id));
+        write(client_fd, &header_size, sizeof(header_size));
+        write(client_fd, message->header.data(), message->header.size());
+        write(client_fd, &payload_size, sizeof(payload_size));
+
+        // Large payloads may need several writes
+        size_t sent = 0;
+        while (sent < size) {
+            ssize_t n = write(client_fd, payload + sent, size - sent);
+            if (n <= 0) {
+                perror("write binary message");
+                return;
+            }
+            sent += n;
+        }
+    }
+}
+
+void UnixSocketServer::sendFrameTiming(int client_fd, const FrameTiming& timing) {
+    // [u64 capture][u8 status][u32 x 8], network order, 41 bytes
+    uint8_t buffer[kFrameTimingSize];
+    uint64_t capture_us = htobe64(timing.capture_timestamp_us);
+    memcpy(buffer, &capture_us, sizeof(capture_us));
+    buffer[8] = static_cast<uint8_t>(timing.status);
+    const uint32_t fields[] = {
+        timing.receive_us, timing.gate_us, timing.submit_us, timing.render_us,
+        timing.inference_us, timing.total_us, timing.nudged_frames, timing.dropped_frames,
+    };
+    for (size_t i = 0; i < sizeof(fields) / sizeof(fields[0]); ++i) {
+        uint32_t value = htonl(fields[i]);
+        memcpy(buffer + 9 + i * sizeof(value), &value, sizeof(value));
+    }
+    write(client_fd, buffer, sizeof(buffer));
 }
\ No newline at end of file
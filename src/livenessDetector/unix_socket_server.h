@@ -1,7 +1,11 @@
 #pragma once
 
+#include "frame_timing.h"
 #include <opencv2/opencv.hpp>
+#include <chrono>
 #include <functional>
+#include <memory>
+#include <optional>
 #include <string>
 #include <vector>
 
@@ -9,22 +13,92 @@ class UnixSocketServer {
 public:
     using ImageProcessingCallback = std::function<std::pair<cv::Mat, std::string>(const cv::Mat&)>;
     using DataProcessingCallback = std::function<std::string(const std::string&)>;
+    // Pipeline stages for images (0x01 and 0x04). Each fills the timing of the
+    // steps it runs; the server fills receive_us and total_us.
+    using SubmitImageCallback = std::function<void(const cv::Mat&, FrameTiming&)>;
+    using RenderImageCallback = std::function<std::pair<cv::Mat, std::string>(const cv::Mat&, FrameTiming&)>;
+
+    // Sent as message 0x03: [u32 header size][header JSON][u32 payload size][payload].
+    struct BinaryMessage {
+        std::string header;
+        std::vector<uint8_t> payload;
+        // Sent instead of payload when set: bytes owned elsewhere, written
+        // without a copy. keep_alive holds them until the write is done.
+        const uint8_t* external_payload = nullptr;
+        size_t external_size = 0;
+        std::shared_ptr<const void> keep_alive;
+    };
+
+    // Callbacks bound to a single client connection.
+    struct ClientCallbacks {
+        ImageProcessingCallback processImage;
+        DataProcessingCallback processData;
+        std::function<void()> onDisconnect;
+        // Polled after every request until it returns std::nullopt; the messages
+        // are sent before the processed image, or after the reply to a JSON message.
+        std::function<std::optional<BinaryMessage>()> takeBinaryMessage;
+        // When both are set they replace processImage, and the connection runs
+        // as a pipeline: the socket thread receives frame N+2 while a second
+        // thread submits frame N+1 to the landmarker and a third renders and
+        // sends frame N. submitImage and renderImage are each called from their
+        // own thread, in frame order; the frame is submitted before it is
+        // rendered. JSON messages wait until the frames before them are sent.
+        SubmitImageCallback submitImage;
+        RenderImageCallback renderImage;
+    };
+    // Called for every accepted client; returning std::nullopt rejects the connection.
+    using ClientConnectedCallback = std::function<std::optional<ClientCallbacks>()>;
+
+    // Busy time of each pipeline stage over a connection. A stage whose
+    // occupancy nears 1 is the bottleneck; the others wait on it.
+    struct PipelineStats {
+        uint64_t frames = 0;
+        double seconds = 0.0;       // connection wall time
+        double receive_busy = 0.0;  // fraction of the wall time spent reading frames
+        double submit_busy = 0.0;
+        double render_busy = 0.0;   // render and send
+        double submit_queued = 0.0; // mean frames waiting for the submit stage when one arrives
+        double render_queued = 0.0;
+    };
 
     UnixSocketServer(
         const std::string& socketPath,
         ImageProcessingCallback imgCallback,
         DataProcessingCallback dataCallback
     );
+    UnixSocketServer(
+        const std::string& socketPath,
+        ClientConnectedCallback clientConnectedCallback
+    );
     ~UnixSocketServer();
 
     bool start();
     void run();
 
+    // Frames held by a pipelined connection: one per stage plus one spare.
+    static constexpr size_t kPipelineDepth = 4;
+
 private:
+    // A received image, moved between the pipeline stages.
+    struct Frame {
+        uint8_t function_id = 0;
+        std::vector<uchar> data;
+        cv::Mat image; // wraps data
+        FrameTiming timing;
+        std::chrono::steady_clock::time_point started;
+    };
+
     std::string socketPath;
-    ImageProcessingCallback processImageCallback;
-    DataProcessingCallback processDataCallback;
+    ClientConnectedCallback clientConnectedCallback;
     int server_fd;
 
-    bool processClient(int client_fd);
+    bool processClient(int client_fd, const ClientCallbacks& callbacks);
+    PipelineStats runPipeline(int client_fd, const ClientCallbacks& callbacks);
+    bool readImage(int client_fd, uint8_t function_id, Frame& frame);
+    bool processJson(int client_fd, const ClientCallbacks& callbacks);
+    void sendReply(int client_fd, const ClientCallbacks& callbacks, Frame& frame,
+                   const cv::Mat& processed_img, const std::string& info_string);
+    void sendBinaryMessage(int client_fd, const ClientCallbacks& callbacks);
+    static constexpr size_t kFrameTimingSize = 41;
+    void sendFrameTiming(int client_fd, const FrameTiming& timing);
 };
\ No newline at end of file
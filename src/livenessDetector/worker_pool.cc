@@ -0,0 +1,125 @@
+#include "worker_pool.h"
+#include "logger.h"
+#include <algorithm>
+
+WorkerPool::WorkerPool(size_t threads, size_t max_queued) : max_queued_(max_queued) {
+    if (threads == 0) {
+        threads = 1;
+    }
+    running_.assign(threads, nullptr);
+    threads_.reserve(threads);
+    for (size_t i = 0; i < threads; ++i) {
+        threads_.emplace_back([this, i]() { run(i); });
+    }
+}
+
+WorkerPool::~WorkerPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    cv_.notify_all();
+    for (auto& thread : threads_) {
+        thread.join();
+    }
+}
+
+std::shared_ptr<WorkerPool> WorkerPool::shared() {
+    static std::shared_ptr<WorkerPool> pool = std::make_shared<WorkerPool>(
+        std::clamp<size_t>(std::thread::hardware_concurrency() / 2, 2, 4));
+    return pool;
+}
+
+bool WorkerPool::submit(std::function<void()> job, Priority priority,
+                        std::shared_ptr<CancellationToken> token) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (stopping_ || queued_ >= max_queued_ || (token && token->cancelled())) {
+            return false;
+        }
+        jobs_[static_cast<size_t>(priority)].push_back({std::move(job), std::move(token)});
+        queued_++;
+    }
+    cv_.notify_one();
+    return true;
+}
+
+size_t WorkerPool::cancel(const std::shared_ptr<CancellationToken>& token) {
+    if (!token) {
+        return 0;
+    }
+    token->cancel();
+    size_t dropped = 0;
+    std::vector<Job> removed; // destroyed after unlocking: their captures may be anything
+    std::unique_lock<std::mutex> lock(mutex_);
+    for (auto& queue : jobs_) {
+        for (auto it = queue.begin(); it != queue.end();) {
+            if (it->token == token) {
+                removed.push_back(std::move(*it));
+                it = queue.erase(it);
+                dropped++;
+            } else {
+                ++it;
+            }
+        }
+    }
+    queued_ -= dropped;
+
+    size_t self = threads_.size();
+    for (size_t i = 0; i < threads_.size(); ++i) {
+        if (threads_[i].get_id() == std::this_thread::get_id()) {
+            self = i;
+        }
+    }
+    idle_cv_.wait(lock, [this, &token, self]() {
+        for (size_t i = 0; i < running_.size(); ++i) {
+            if (i != self && running_[i] == token.get()) {
+                return false;
+            }
+        }
+        return true;
+    });
+    lock.unlock();
+    return dropped;
+}
+
+size_t WorkerPool::queued() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return queued_;
+}
+
+void WorkerPool::run(size_t index) {
+    while (true) {
+        Job job;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            cv_.wait(lock, [this]() { return stopping_ || queued_ > 0; });
+            if (queued_ == 0) {
+                return; // stopping, and everything queued has run
+            }
+            for (auto& queue : jobs_) {
+                if (!queue.empty()) {
+                    job = std::move(queue.front());
+                    queue.pop_front();
+                    break;
+                }
+            }
+            queued_--;
+            if (job.token && job.token->cancelled()) {
+                continue; // cancelled after it was queued
+            }
+            running_[index] = job.token.get();
+        }
+        try {
+            job.run();
+        } catch (const std::exception& e) {
+            LOG_ERROR("[WorkerPool] Job failed: {}", e.what());
+        }
+        job.run = nullptr; // release the captures before reporting the job done
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            running_[index] = nullptr;
+        }
+        idle_cv_.notify_all();
+    }
+}
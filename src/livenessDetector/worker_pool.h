@@ -0,0 +1,78 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Marks the jobs of one owner (a session, a detector) so they can be dropped
+// together when it goes away. A running job may poll cancelled() to stop early.
+class CancellationToken {
+public:
+    void cancel() { cancelled_.store(true, std::memory_order_release); }
+    bool cancelled() const { return cancelled_.load(std::memory_order_acquire); }
+
+private:
+    std::atomic<bool> cancelled_{false};
+};
+
+// Fixed set of threads running queued jobs for work that must stay off the
+// frame path: reporting results, encoding snapshots, face matching. Jobs run
+// by priority, oldest first within a priority. submit() refuses a job once
+// max_queued jobs are waiting, so a slow pool sheds work instead of piling it
+// up or spawning threads. shared() is the pool every session and detector of
+// a process uses; jobs must not block on each other.
+//
+// A job submitted with a token is skipped once the token is cancelled, and
+// cancel() drops the token's queued jobs and waits for its running ones, so
+// an owner can cancel from its destructor and then free what its jobs use.
+// The destructor runs the jobs already queued, then joins the threads.
+class WorkerPool {
+public:
+    enum class Priority { High, Normal, Low };
+
+    explicit WorkerPool(size_t threads, size_t max_queued = 64);
+    ~WorkerPool();
+
+    WorkerPool(const WorkerPool&) = delete;
+    WorkerPool& operator=(const WorkerPool&) = delete;
+
+    // The process-wide pool: half the hardware threads, between 2 and 4.
+    static std::shared_ptr<WorkerPool> shared();
+
+    // Returns false when the queue is full, the token is already cancelled or
+    // the pool is shutting down.
+    bool submit(std::function<void()> job, Priority priority = Priority::Normal,
+                std::shared_ptr<CancellationToken> token = nullptr);
+
+    // Cancels token, drops its queued jobs and waits until none of its jobs is
+    // running, except one on the calling thread. Returns the jobs dropped.
+    size_t cancel(const std::shared_ptr<CancellationToken>& token);
+
+    size_t threads() const { return threads_.size(); }
+    size_t queued() const;
+
+private:
+    struct Job {
+        std::function<void()> run;
+        std::shared_ptr<CancellationToken> token;
+    };
+
+    void run(size_t index);
+
+    std::vector<std::thread> threads_;
+    mutable std::mutex mutex_;
+    std::condition_variable cv_;
+    std::condition_variable idle_cv_; // a job finished, for cancel()
+    std::array<std::deque<Job>, 3> jobs_; // by Priority
+    size_t queued_ = 0;
+    std::vector<const CancellationToken*> running_; // token of the job each thread runs, or null
+    size_t max_queued_;
+    bool stopping_ = false;
+};
@@ -0,0 +1,131 @@
+#include "worker_pool.h"
+#include "test_check.h"
+#include <iostream>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <string>
+#include <thread>
+
+int main() {
+    // Every accepted job runs, also the ones queued when the pool goes away.
+    std::atomic<int> done{0};
+    {
+        WorkerPool pool(3, 1000);
+        TEST_CHECK(pool.threads() == 3);
+        int accepted = 0;
+        for (int i = 0; i < 500; ++i) {
+            accepted += pool.submit([&done]() { done++; });
+        }
+        TEST_CHECK(accepted == 500);
+    }
+    TEST_CHECK(done == 500);
+    std::cout << "All queued jobs ran before shutdown\n";
+
+    // A full queue refuses new jobs instead of growing
+    WorkerPool pool(1, 2);
+    std::promise<void> release;
+    std::shared_future<void> gate = release.get_future().share();
+    std::promise<void> started;
+    TEST_CHECK(pool.submit([&started, gate]() { started.set_value(); gate.wait(); }));
+    started.get_future().wait(); // the only worker is now busy
+    bool first = pool.submit([]() {});
+    bool second = pool.submit([]() {});
+    TEST_CHECK(first && second);
+    TEST_CHECK(pool.queued() == 2);
+    TEST_CHECK(!pool.submit([]() {}));
+    release.set_value();
+    std::cout << "Full queue sheds jobs\n";
+
+    // A throwing job does not take its worker down. The queue may still be
+    // full from the previous case, so both submissions wait for room.
+    auto submit_when_room = [&pool](std::function<void()> job) {
+        while (!pool.submit(job)) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    };
+    std::promise<void> after;
+    submit_when_room([]() { throw std::runtime_error("encoder failed"); });
+    submit_when_room([&after]() { after.set_value(); });
+    auto survived = after.get_future().wait_for(std::chrono::seconds(5));
+    TEST_CHECK(survived == std::future_status::ready);
+    std::cout << "Worker survives a failing job\n";
+
+    // Higher priorities run first, in order within a priority
+    {
+        WorkerPool ordered(1, 16);
+        std::promise<void> go;
+        std::shared_future<void> wait = go.get_future().share();
+        std::promise<void> busy;
+        TEST_CHECK(ordered.submit([&busy, wait]() { busy.set_value(); wait.wait(); }));
+        busy.get_future().wait();
+        std::mutex order_mutex;
+        std::string order;
+        auto mark = [&order, &order_mutex](char c) {
+            return [&order, &order_mutex, c]() { std::lock_guard<std::mutex> lock(order_mutex); order += c; };
+        };
+        int queued = 0;
+        queued += ordered.submit(mark('l'), WorkerPool::Priority::Low);
+        queued += ordered.submit(mark('n'), WorkerPool::Priority::Normal);
+        queued += ordered.submit(mark('h'), WorkerPool::Priority::High);
+        queued += ordered.submit(mark('N'), WorkerPool::Priority::Normal);
+        std::promise<void> last;
+        queued += ordered.submit([&last]() { last.set_value(); }, WorkerPool::Priority::Low);
+        TEST_CHECK(queued == 5);
+        go.set_value();
+        last.get_future().wait();
+        std::lock_guard<std::mutex> lock(order_mutex);
+        TEST_CHECK(order == "hnNl");
+        std::cout << "Priority order: " << order << "\n";
+    }
+
+    // Cancelling a token drops its queued jobs and waits for its running one
+    {
+        WorkerPool cancellable(1, 16);
+        auto session = std::make_shared<CancellationToken>();
+        auto other = std::make_shared<CancellationToken>();
+        std::promise<void> running;
+        std::atomic<bool> finished{false};
+        std::atomic<int> ran{0};
+        bool waiting = cancellable.submit([&running, &finished, session]() {
+            running.set_value();
+            while (!session->cancelled()) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(20));
+            finished = true;
+        }, WorkerPool::Priority::Normal, session);
+        TEST_CHECK(waiting);
+        running.get_future().wait();
+        int queued = 0;
+        for (int i = 0; i < 5; ++i) {
+            queued += cancellable.submit([&ran]() { ran++; }, WorkerPool::Priority::Normal, session);
+        }
+        std::atomic<int> other_ran{0};
+        queued += cancellable.submit([&other_ran]() { other_ran++; }, WorkerPool::Priority::Normal, other);
+        TEST_CHECK(queued == 6);
+        TEST_CHECK(cancellable.cancel(session) == 5);
+        TEST_CHECK(finished); // the running job saw the token and returned before cancel() did
+        TEST_CHECK(!cancellable.submit([&ran]() { ran++; }, WorkerPool::Priority::Normal, session));
+        while (other_ran == 0) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        TEST_CHECK(ran == 0);
+        std::cout << "Cancelled jobs dropped, running job awaited\n";
+
+        // A job may cancel its own token without waiting for itself
+        auto self = std::make_shared<CancellationToken>();
+        std::promise<size_t> cancelled;
+        bool own = cancellable.submit([&cancellable, &cancelled, self]() {
+            cancelled.set_value(cancellable.cancel(self));
+        }, WorkerPool::Priority::High, self);
+        TEST_CHECK(own);
+        auto returned = cancelled.get_future().wait_for(std::chrono::seconds(5));
+        TEST_CHECK(returned == std::future_status::ready);
+    }
+
+    std::cout << "Test completed.\n";
+    return 0;
+}
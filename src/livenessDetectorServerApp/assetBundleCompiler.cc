@@ -0,0 +1,240 @@
+#include "livenessDetector/asset_bundle.h"
+#include "livenessDetector/gesture_detector.h"
+#include "livenessDetector/nlohmann/json.hpp"
+
+#include <opencv2/opencv.hpp>
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <string>
+#include <map>
+#include <set>
+#include <algorithm>
+#include <filesystem>
+
+using json = nlohmann::json;
+namespace fs = std::filesystem;
+
+// Validates value against the subset of JSON Schema (draft-07) used by
+// gestures_schema.json: type, properties, required, items and oneOf.
+void validate_against_schema(const json& value, const json& schema, const std::string& where, std::vector<std::string>& errors) {
+    if (schema.contains("type")) {
+        const std::string type = schema["type"];
+        bool ok = (type == "object" && value.is_object()) ||
+                  (type == "array" && value.is_array()) ||
+                  (type == "string" && value.is_string()) ||
+                  (type == "integer" && value.is_number_integer()) ||
+                  (type == "number" && value.is_number()) ||
+                  (type == "boolean" && value.is_boolean());
+        if (!ok) {
+            errors.push_back(where + ": expected " + type);
+            return;
+        }
+    }
+
+    if (schema.contains("required") && value.is_object()) {
+        for (const auto& key : schema["required"]) {
+            if (!value.contains(key.get<std::string>())) {
+                errors.push_back(where + ": missing required property '" + key.get<std::string>() + "'");
+            }
+        }
+    }
+
+    if (schema.contains("properties") && value.is_object()) {
+        for (auto it = schema["properties"].begin(); it != schema["properties"].end(); ++it) {
+            if (value.contains(it.key())) {
+                validate_against_schema(value[it.key()], it.value(), where + "." + it.key(), errors);
+            }
+        }
+    }
+
+    if (schema.contains("items") && value.is_array()) {
+        for (size_t i = 0; i < value.size(); ++i) {
+            validate_against_schema(value[i], schema["items"], where + "[" + std::to_string(i) + "]", errors);
+        }
+    }
+
+    if (schema.contains("oneOf")) {
+        int matches = 0;
+        for (const auto& option : schema["oneOf"]) {
+            std::vector<std::string> option_errors;
+            validate_against_schema(value, option, where, option_errors);
+            if (option_errors.empty()) {
+                matches++;
+            }
+        }
+        if (matches != 1) {
+            errors.push_back(where + ": must match exactly one of the 'oneOf' alternatives (matched " + std::to_string(matches) + ")");
+        }
+    }
+}
+
+std::map<std::string, std::string> parse_args(int argc, char** argv) {
+    std::map<std::string, std::string> args;
+    for (int i = 1; i < argc; i+=2) {
+        if (std::string(argv[i]).find("--") == 0) {
+            if (i + 1 < argc) {
+                args[argv[i]] = argv[i+1];
+            }
+        }
+    }
+    return args;
+}
+
+std::vector<std::string> split_paths(const std::string& paths, char delim = ':') {
+    std::vector<std::string> result;
+    size_t start = 0, end = 0;
+    while ((end = paths.find(delim, start)) != std::string::npos) {
+        if (end > start)
+            result.push_back(paths.substr(start, end - start));
+        start = end + 1;
+    }
+    if (!paths.substr(start).empty())
+        result.push_back(paths.substr(start));
+    return result;
+}
+
+int main(int argc, char** argv) {
+    auto args = parse_args(argc, argv);
+
+    std::vector<std::string> required_keys = {"--gestures_folder_path", "--schema_path", "--output"};
+    bool missing = false;
+    for (const auto& key : required_keys) {
+        if (args.find(key) == args.end()) {
+            std::cerr << "Missing required argument: " << key << std::endl;
+            missing = true;
+        }
+    }
+
+    if (missing) {
+        std::cerr << "Usage: " << argv[0]
+                  << " --gestures_folder_path <path1>:<path2>"
+                  << " --schema_path <gestures_schema.json>"
+                  << " --output <bundle.ldab>"
+                  << " [--locales_paths <path1>:<path2>]\n";
+        return EXIT_FAILURE;
+    }
+
+    std::vector<std::string> gestures_folders = split_paths(args["--gestures_folder_path"]);
+    std::vector<std::string> locales_paths;
+    if (args.find("--locales_paths") != args.end())
+        locales_paths = split_paths(args["--locales_paths"]);
+    // Same lookup order as the server: explicit locales first, then each gestures folder.
+    for (const auto& folder : gestures_folders)
+        locales_paths.push_back(folder + "/locales");
+
+    json schema;
+    try {
+        std::ifstream f(args["--schema_path"]);
+        schema = json::parse(f);
+    } catch (const std::exception& e) {
+        std::cerr << "Error reading schema " << args["--schema_path"] << ": " << e.what() << "\n";
+        return EXIT_FAILURE;
+    }
+
+    AssetBundleWriter writer;
+    GestureDetector detector;
+    bool failed = false;
+    std::set<std::string> names;
+
+    for (const auto& folder : gestures_folders) {
+        std::vector<fs::path> files;
+        try {
+            for (const auto& entry : fs::directory_iterator(folder)) {
+                if (entry.path().extension() == ".json") {
+                    files.push_back(entry.path());
+                }
+            }
+        } catch (fs::filesystem_error& e) {
+            std::cerr << "Error accessing the gestures folder: " << folder << ": " << e.what() << "\n";
+            failed = true;
+            continue;
+        }
+        std::sort(files.begin(), files.end());
+
+        for (const auto& file : files) {
+            json gesture_data;
+            try {
+                std::ifstream f(file);
+                gesture_data = json::parse(f);
+            } catch (const std::exception& e) {
+                std::cerr << file.string() << ": " << e.what() << "\n";
+                failed = true;
+                continue;
+            }
+
+            std::vector<std::string> errors;
+            validate_against_schema(gesture_data, schema, file.filename().string(), errors);
+            if (!errors.empty()) {
+                for (const auto& error : errors) {
+                    std::cerr << error << "\n";
+                }
+                failed = true;
+                continue;
+            }
+
+            std::string name = file.stem().string();
+            if (!names.insert(name).second) {
+                std::cerr << "Duplicate gesture name '" << name << "' in " << file.string() << "\n";
+                failed = true;
+                continue;
+            }
+
+            auto result = detector.add_gesture_from_file(file.string());
+            if (!result.success) {
+                failed = true;
+                continue;
+            }
+            writer.add_gesture(name, *detector.get_gestures().back(), result.icon_path);
+
+            if (!result.icon_path.empty() && !writer.has_icon(result.icon_path)) {
+                cv::Mat icon = cv::imread(result.icon_path, cv::IMREAD_UNCHANGED);
+                if (icon.empty()) {
+                    std::cerr << "Warning, icon not found for " << name << ": " << result.icon_path << "\n";
+                } else {
+                    if (!icon.isContinuous()) {
+                        icon = icon.clone();
+                    }
+                    writer.add_icon(result.icon_path, icon.rows, icon.cols, icon.type(), icon.step[0], icon.data);
+                }
+            }
+            std::cout << "Compiled gesture: " << name << " (" << result.gestureId << ")\n";
+        }
+    }
+
+    // Merge each locale across directories exactly like TranslationManager::load_locale_file.
+    std::map<std::string, json> locales;
+    for (const auto& dir : locales_paths) {
+        std::error_code ec;
+        for (const auto& entry : fs::directory_iterator(dir, ec)) {
+            if (entry.path().extension() != ".json") continue;
+            try {
+                std::ifstream f(entry.path());
+                json j = json::parse(f);
+                auto& merged = locales[entry.path().stem().string()];
+                if (merged.is_null()) merged = json::object();
+                merged.update(j);
+            } catch (const std::exception& e) {
+                std::cerr << entry.path().string() << ": " << e.what() << "\n";
+                failed = true;
+            }
+        }
+    }
+    for (const auto& [name, translations] : locales) {
+        writer.add_locale(name, translations);
+        std::cout << "Compiled locale: " << name << "\n";
+    }
+
+    if (failed) {
+        std::cerr << "Asset bundle not written due to previous errors.\n";
+        return EXIT_FAILURE;
+    }
+
+    std::string error;
+    if (!writer.write(args["--output"], &error)) {
+        std::cerr << error << "\n";
+        return EXIT_FAILURE;
+    }
+    std::cout << "Asset bundle written to " << args["--output"] << "\n";
+    return EXIT_SUCCESS;
+}
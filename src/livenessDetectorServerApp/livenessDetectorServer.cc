@@ -1,8 +1,10 @@
-#include "livenessDetector/gesture_detector.h"
-#include "livenessDetector/gestures_requester.h"
-#include "livenessDetector/translation_manager.h"
+#include "livenessDetector/asset_snapshot.h"
+#include "livenessDetector/liveness_session.h"
 #include "livenessDetector/unix_socket_server.h"
 #include "livenessDetector/face_processor.h"
+#include "livenessDetector/frame_timing.h"
+#include "livenessDetector/logger.h"
+#include "livenessDetector/worker_pool.h"
 #include "livenessDetector/nlohmann/json.hpp"
 
 #include <opencv2/opencv.hpp> 
@@ -11,80 +13,20 @@
 #include <set>
 #include <string>
 #include <map>
+#include <memory>
+#include <optional>
+#include <atomic>
 #include <unordered_map>
 #include <filesystem>
 #include <functional>
 #include <random>
 #include <algorithm>
+#include <chrono>
+#include <unistd.h>
 
 using json = nlohmann::json;
 namespace fs = std::filesystem;
 
-// Function to verify if the detected face satisfies all constraints.
-// Returns an empty string if OK, otherwise a warning message.
-std::string verify_correct_face(
-    const std::map<std::string, float>& face_square_normalized_points,
-    TranslationManager* translator,
-    bool glasses = false,
-    float percentage_min_face_width = 0.1f,
-    float percentage_max_face_width = 0.5f,
-    float percentage_min_face_height = 0.1f,
-    float percentage_max_face_height = 0.7f,
-    float percentage_center_allowed_offset = 0.25f
-) {
-    const std::string wrong_face_width_message   = translator->translate("warning.wrong_face_width_message");
-    const std::string wrong_face_height_message  = translator->translate("warning.wrong_face_height_message");
-    const std::string wrong_face_center_message  = translator->translate("warning.wrong_face_center_message");
-    const std::string face_not_detected_message  = translator->translate("warning.face_not_detected_message");
-    const std::string face_with_glasses_message  = translator->translate("warning.face_with_glasses_message");
-
-    // 1. Check if points exist
-    const char* required_keys[] = {"Top Square", "Left Square", "Right Square", "Bottom Square"};
-    for (const auto& key : required_keys) {
-        if (face_square_normalized_points.find(key) == face_square_normalized_points.end()) {
-            return face_not_detected_message;
-        }
-    }
-
-    // 2. Glasses check
-    if (glasses) {
-        return face_with_glasses_message;
-    }
-
-    // 3. Get coords
-    float topSquare    = face_square_normalized_points.at("Top Square");
-    float leftSquare   = face_square_normalized_points.at("Left Square");
-    float rightSquare  = face_square_normalized_points.at("Right Square");
-    float bottomSquare = face_square_normalized_points.at("Bottom Square");
-
-    // Quick fail if not valid detection
-    if (topSquare < 0 || leftSquare < 0 || rightSquare < 0 || bottomSquare < 0) {
-        return face_not_detected_message;
-    }
-
-    // 4. Face width/height, center
-    float face_width  = rightSquare - leftSquare;
-    float face_height = bottomSquare - topSquare;
-    float face_center_x = (rightSquare + leftSquare) / 2.0f;
-    float face_center_y = (topSquare    + bottomSquare) / 2.0f;
-
-    // 5. Checks
-    if (!(percentage_min_face_width <= face_width && face_width <= percentage_max_face_width)) {
-        return wrong_face_width_message;
-    }
-    if (!(percentage_min_face_height <= face_height && face_height <= percentage_max_face_height)) {
-        return wrong_face_height_message;
-    }
-    float center = 0.5f;
-    if (!(center - percentage_center_allowed_offset <= face_center_x && face_center_x <= center + percentage_center_allowed_offset) ||
-        !(center - percentage_center_allowed_offset <= face_center_y && face_center_y <= center + percentage_center_allowed_offset)) {
-        return wrong_face_center_message;
-    }
-
-    // OK!
-    return "";
-}
-
 std::map<std::string, std::string> parse_args(int argc, char** argv) {
     std::map<std::string, std::string> args;
     for (int i = 1; i < argc; i+=2) {
@@ -110,15 +52,41 @@ std::vector<std::string> split_paths(const std::string& paths, char delim = ':')
     return result;
 }
 
+// Landmarks of one result as message 0x03, written straight from the pooled
+// buffer: the header describes the 3 x count float32 block of the payload.
+UnixSocketServer::BinaryMessage landmarks_message(std::shared_ptr<const LandmarkBuffer> landmarks) {
+    const uint16_t probe = 1;
+    const bool little_endian = *reinterpret_cast<const uint8_t*>(&probe) == 1;
+    json header = {
+        {"type", "landmarks"},
+        {"timestamp_ms", landmarks->timestamp_ms()},
+        {"count", landmarks->size()},
+        {"aspect", landmarks->aspect()},
+        {"dtype", little_endian ? "<f4" : ">f4"},
+    };
+    UnixSocketServer::BinaryMessage message;
+    message.header = header.dump();
+    message.external_payload = reinterpret_cast<const uint8_t*>(landmarks->data());
+    message.external_size = landmarks->bytes();
+    message.keep_alive = std::move(landmarks);
+    return message;
+}
 
 int main(int argc, char** argv) {
 
+    auto started_at = std::chrono::steady_clock::now();
     auto args = parse_args(argc, argv);
 
-    // List of required argument names (without leading "--" since parse_args strips it)
+    // List of required argument names (without leading "--" since parse_args strips it).
+    // --language, --num_gestures and --gestures_list are only defaults: each connection
+    // can choose its own with a start_session handshake.
     std::vector<std::string> required_keys = {
-        "--model_path", "--gestures_folder_path", "--language", "--socket_path", "--num_gestures", "--font_path"
+        "--model_path", "--socket_path", "--font_path"
     };
+    // A compiled asset bundle replaces the gestures folders.
+    if (args.find("--assets_bundle_path") == args.end()) {
+        required_keys.push_back("--gestures_folder_path");
+    }
 
     bool missing = false;
     for (const auto& key : required_keys) {
@@ -132,195 +100,302 @@ int main(int argc, char** argv) {
         std::cerr << "Usage: " << argv[0]
                   << " --model_path <path>"
                   << " --gestures_folder_path <path1>:<path2>"
-                  << " --language <lang>"
                   << " --socket_path <path>"
-                  << " --num_gestures <int>"
                   << " --font_path <path>"
+                  << " [--language <lang>]"
+                  << " [--num_gestures <int>]"
                   << " [--locales_paths <path1>:<path2>]"
-                  << " [--gestures_list <gesture1>:<gesture2>:...]\n";
+                  << " [--signals_paths <path1>:<path2>]"
+                  << " [--gestures_list <gesture1>:<gesture2>:...]"
+                  << " [--assets_bundle_path <bundle.ldab>]"
+                  << " [--watch_assets <0|1>]"
+                  << " [--warmup_frames <int>]"
+                  << " [--warmup_image <path>]"
+                  << " [--ready_fd <fd>]"
+                  << " [--flight_recorder_dir <path>]"
+                  << " [--log_level <debug|info|warning|error|off>]\n";
         return EXIT_FAILURE;
     }
 
     std::string model_path = args["--model_path"];
     std::string gestures_folder_path = args["--gestures_folder_path"];
     std::vector<std::string> gestures_folders = split_paths(gestures_folder_path);
-    std::string language = args["--language"];
     std::string socket_path = args["--socket_path"];
-    int num_gestures = std::stoi(args["--num_gestures"]);
-    std::string font_path = args["--font_path"];
+    bool watch_assets = args.find("--watch_assets") == args.end() || args["--watch_assets"] != "0";
+    int warmup_frames = args.count("--warmup_frames") ? std::stoi(args["--warmup_frames"]) : 3;
+    int ready_fd = args.count("--ready_fd") ? std::stoi(args["--ready_fd"]) : -1;
+
+    LivenessSession::Config session_config;
+    session_config.language = args.count("--language") ? args["--language"] : "en";
+    session_config.num_gestures = args.count("--num_gestures") ? std::stoi(args["--num_gestures"]) : 2;
+    session_config.font_path = args["--font_path"];
+    if (args.count("--flight_recorder_dir"))
+        session_config.flight_recorder_dir = args["--flight_recorder_dir"];
+    // Off-path work of every connection (snapshot encoding, flight recorder files).
+    session_config.workers = WorkerPool::shared();
 
     std::vector<std::string> locales_paths;
     if (args.find("--locales_paths") != args.end())
         locales_paths = split_paths(args["--locales_paths"]);
     
-    std::set<std::string> allowed_gestures;
     if (args.find("--gestures_list") != args.end()) {
         auto lst = split_paths(args["--gestures_list"]); // uses ':' by default
-        allowed_gestures = std::set<std::string>(lst.begin(), lst.end());
+        session_config.allowed_gestures = std::set<std::string>(lst.begin(), lst.end());
     }
 
-    for (const auto& folder : gestures_folders)
-        locales_paths.push_back(folder + "/locales");
-
-    std::cout << "Starting Liveness Detector Server...\n";
-
-    // Initialize callback_data_ as a JSON object
-    json callback_data_json;
-
-    std::string warning_message = "";
-
-    // Load gesture definitions from JSON files.
-    std::vector<std::string> gestureFiles;
+    std::vector<std::string> signals_paths;
+    if (args.find("--signals_paths") != args.end())
+        signals_paths = split_paths(args["--signals_paths"]);
 
     for (const auto& folder : gestures_folders) {
-        try {
-            for (const auto& entry : fs::directory_iterator(folder)) {
-                if (entry.path().extension() == ".json") {
-                    std::string basename = entry.path().stem().string(); // without extension
-                    if (allowed_gestures.empty() || allowed_gestures.count(basename) > 0) {
-                        gestureFiles.push_back(entry.path().string());
-                    }
-                }
-            }
-        } catch (fs::filesystem_error& e) {
-            std::cerr << "Error accessing the gestures folder: " << folder << ": " << e.what() << "\n";
-            // Continue trying other folders (don't return yet);
-        }
+        locales_paths.push_back(folder + "/locales");
+        signals_paths.push_back(folder + "/signals");
     }
 
-    if (gestureFiles.empty()) {
-        std::cerr << "No gesture JSON files found in the specified folder. Exiting application.\n";
-        return EXIT_FAILURE;
+    if (args.count("--log_level")) {
+        Logger::Level level;
+        if (!Logger::parse_level(args["--log_level"], &level)) {
+            std::cerr << "Invalid --log_level: " << args["--log_level"] << "\n";
+            return EXIT_FAILURE;
+        }
+        Logger::instance().set_level(level);
     }
 
-    // Ensure we do not attempt to select more gestures than available
-    if (num_gestures > static_cast<int>(gestureFiles.size())) {
-        std::cerr << "Requested number of gestures exceeds available gestures. Exiting application.\n";
+    std::cout << "Starting Liveness Detector Server...\n";
+
+    // Load gesture and locale definitions, from the JSON folders or from the bundle when one is given.
+    AssetSnapshotStore::Sources sources;
+    sources.gestures_folders = gestures_folders;
+    sources.locales_paths = locales_paths;
+    sources.signals_paths = signals_paths;
+    if (args.find("--assets_bundle_path") != args.end())
+        sources.bundle_path = args["--assets_bundle_path"];
+    sources.languages = {session_config.language};
+
+    AssetSnapshotStore assets(sources);
+    if (!assets.reload()) {
+        std::cerr << "No gestures loaded. Exiting application.\n";
         return EXIT_FAILURE;
     }
 
-    // Randomly shuffle and select the specified number of gestures
-    std::random_device rd;
-    std::mt19937 g(rd());
-    std::shuffle(gestureFiles.begin(), gestureFiles.end(), g);
-
-    // Select only the specified number of gestures
-    gestureFiles.resize(num_gestures);
-
-    // Create an instance of GestureDetector
-    GestureDetector detector;
-    std::vector<GestureDetector::AddResult> loadedGestures;
-
-    for (const auto& file : gestureFiles) {
-        auto result = detector.add_gesture_from_file(file);
-        if (!result.success) {
-            std::cerr << "Failed to load gesture from file: " << file << "\n";
-        } else {
-            std::cout << "Loaded gesture: " << result.label
-                      << " (ID: " << result.gestureId << ")\n";
-            loadedGestures.push_back(result);
+    // Fail early if the configuration cannot be satisfied by the gestures on disk.
+    {
+        LivenessSession probe(assets.current(), session_config);
+        std::string error;
+        if (!probe.start(&error)) {
+            std::cerr << error << " Exiting application.\n";
+            return EXIT_FAILURE;
         }
     }
 
-    if (loadedGestures.empty()) {
-        std::cerr << "No gestures loaded. Exiting application.\n";
-        return EXIT_FAILURE;
+    if (watch_assets && !assets.start_watching()) {
+        std::cerr << "Hot reload of gestures and locales disabled.\n";
     }
 
-    TranslationManager translator(language, locales_paths);
-
-    // Create a GesturesRequester.
-    GesturesRequester requester(static_cast<int>(loadedGestures.size()),
-                                &detector,
-                                &translator,
-                                font_path,
-                                GesturesRequester::DebugLevel::INFO);
-
-    requester.set_gestures_list(loadedGestures);
-
-    // Capture the local variables by reference in the lambda
-    requester.set_ask_to_take_picture_callback([&callback_data_json]() {
-        std::cout << "[Callback] Ask to take picture triggered.\n";
-        // Add or update the 'takeAPicture' key in the callback_data_json object
-        callback_data_json["takeAPicture"] = true;
-    });
-
-    requester.set_report_alive_callback([&callback_data_json](bool alive) {
-        std::cout << "[Callback] GesturesRequester is " << (alive ? "alive" : "not alive") << ".\n";
-        // Add or update the 'reportAlive' key in the callback_data_json object
-        callback_data_json["reportAlive"] = alive;
-    });
+    // The session currently fed by the landmarker. Swapped atomically on connect/disconnect
+    // so results still in flight for a finished session never reach the next one.
+    std::shared_ptr<LivenessSession> active_session;
 
     // Create a FaceProcessor
     FaceProcessor processor(model_path);
     processor.SetDoProcessImage(true);
-    processor.SetCallback([&detector, &warning_message, &translator](const std::map<std::string, float>& blendshapes,
-        const std::map<std::string, float>& transformationValues) {
-            // Create an unordered_map to hold the converted blendshapes
-            std::unordered_map<std::string, double> convertedBlendshapes;
-            // Convert each element type
-            for (const auto& pair : blendshapes) {
-                convertedBlendshapes[pair.first] = static_cast<double>(pair.second);
+    processor.SetCallback([&active_session](const std::map<std::string, float>& blendshapes,
+        const std::map<std::string, float>& transformationValues, int64_t timestamp_ms) {
+            auto session = std::atomic_load(&active_session);
+            if (session) {
+                session->on_face_result(blendshapes, transformationValues, timestamp_ms);
             }
-            // Call process_signals with the converted map
-            detector.process_signals(convertedBlendshapes);
-            warning_message = verify_correct_face(transformationValues, &translator);
     });
 
-    // Create a UnixSocketServer using the provided socket path.
-    auto imageProcessingCallback = [&requester, &processor, &callback_data_json, &warning_message](const cv::Mat& inputImage) -> std::pair<cv::Mat, std::string> {
-        processor.ProcessImage(inputImage);
-
-        std::unordered_map<std::string, double> npoints;  // empty points; extend as needed!
-        cv::Mat processedImage = requester.process_image(inputImage, 0, npoints, warning_message);
+    // Pay the landmarker's lazy initialization now rather than on the first user's frames.
+    cv::Mat warmup_image;
+    if (warmup_frames > 0) {
+        if (args.count("--warmup_image")) {
+            warmup_image = cv::imread(args["--warmup_image"], cv::IMREAD_COLOR);
+            if (warmup_image.empty()) {
+                std::cerr << "Unable to read warm-up image " << args["--warmup_image"] << ", using a synthetic frame\n";
+            }
+        }
+        auto warmup_start = std::chrono::steady_clock::now();
+        int completed = processor.WarmUp(warmup_frames, warmup_image);
+        auto warmup_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now() - warmup_start).count();
+        std::cout << "Warm-up: " << completed << "/" << warmup_frames << " frames in " << warmup_ms << " ms\n";
+    }
 
-        // Serialize the accumulated JSON object to a string
-        std::string callback_data = callback_data_json.empty() ? "" : callback_data_json.dump();
-        callback_data_json.clear();
+    // A connection opens with a start_session handshake carrying its language and gestures;
+    // a client that sends a frame first gets a session with the command line defaults.
+    // Either way the session is built on the latest published snapshot, and the model and
+    // assets stay loaded between connections.
+    auto clientConnectedCallback = [&assets, &session_config, &active_session, &processor, warmup_frames, &warmup_image]()
+            -> std::optional<UnixSocketServer::ClientCallbacks> {
+        // Read and replaced with atomic loads and stores: the submit and render
+        // stages of the connection's pipeline run on their own threads.
+        auto session = std::make_shared<std::shared_ptr<LivenessSession>>();
+
+        auto open_session = [&assets, &active_session, &processor, warmup_frames, &warmup_image, session](
+                const LivenessSession::Config& config, std::string* error) {
+            auto next = std::make_shared<LivenessSession>(assets.current(), config);
+            if (!next->start(error)) {
+                return false;
+            }
+            // Only the outputs these gestures read, e.g. no blendshape model for head pose gestures.
+            // Runs with no frame being submitted: from the submit stage, or with the pipeline drained.
+            if (processor.SetOutputs(next->landmarker_outputs()) && warmup_frames > 0) {
+                processor.WarmUp(warmup_frames, warmup_image);
+            }
+            LOG_INFO("Session started on asset generation {} (language {})",
+                     next->snapshot().generation, config.language);
+            std::atomic_store(session.get(), next);
+            std::atomic_store(&active_session, next);
+            return true;
+        };
+
+        UnixSocketServer::ClientCallbacks callbacks;
+        // Capture timestamps are mapped per connection: each client has its own clock.
+        auto capture_clock = std::make_shared<CaptureClock>();
+        callbacks.submitImage = [session, open_session, capture_clock, &session_config, &processor](
+                const cv::Mat& inputImage, FrameTiming& timing) {
+            auto current = std::atomic_load(session.get());
+            std::string error;
+            if (!current) {
+                if (!open_session(session_config, &error)) {
+                    LOG_ERROR("Unable to start session: {}", error);
+                    return;
+                }
+                current = std::atomic_load(session.get());
+            }
+            auto stage_start = std::chrono::steady_clock::now();
+            auto stage_us = [&stage_start]() {
+                auto now = std::chrono::steady_clock::now();
+                auto us = std::chrono::duration_cast<std::chrono::microseconds>(now - stage_start).count();
+                stage_start = now;
+                return static_cast<uint32_t>(us);
+            };
+
+            // Mapped before the gate, so a repeated frame replays the last result at its own time.
+            int64_t timestamp_ms = -1; // frames sent as 0x01 are stamped on arrival
+            bool mapped = timing.capture_timestamp_us == 0 ||
+                          capture_clock->map(timing.capture_timestamp_us, current_time_millis(), &timestamp_ms);
+            bool admitted = mapped && current->admit_frame(inputImage, timestamp_ms);
+            timing.gate_us = stage_us();
+            if (!mapped) {
+                timing.status = FrameTiming::Status::Dropped;
+            } else if (!admitted) {
+                timing.status = FrameTiming::Status::Skipped;
+            } else {
+                int64_t used_ms = processor.ProcessImage(inputImage, timestamp_ms);
+                timing.landmarker_timestamp_ms = used_ms;
+                if (timestamp_ms >= 0 && used_ms != timestamp_ms) {
+                    capture_clock->count_nudge();
+                    timing.status = FrameTiming::Status::Nudged;
+                }
+            }
+            timing.submit_us = stage_us();
+            timing.nudged_frames = capture_clock->nudged();
+            timing.dropped_frames = capture_clock->dropped();
+        };
+        callbacks.renderImage = [session, &processor](const cv::Mat& inputImage, FrameTiming& timing)
+                -> std::pair<cv::Mat, std::string> {
+            auto current = std::atomic_load(session.get());
+            if (!current) {
+                return {inputImage, json{{"session", {{"started", false}, {"error", "no session"}}}}.dump()};
+            }
+            auto start = std::chrono::steady_clock::now();
+            auto result = current->process_frame(inputImage, timing.landmarker_timestamp_ms);
+            timing.render_us = static_cast<uint32_t>(std::chrono::duration_cast<std::chrono::microseconds>(
+                std::chrono::steady_clock::now() - start).count());
+            timing.inference_us = static_cast<uint32_t>(processor.LastInferenceMicros());
+            return result;
+        };
+        callbacks.processData = [session, open_session, &session_config](const std::string& json_str) -> std::string {
+            json j;
+            try {
+                j = json::parse(json_str);
+            } catch (const std::exception& e) {
+                LOG_ERROR("[Config] JSON parse error: {}", e.what());
+                return {};
+            }
 
-        return {processedImage, callback_data};
-    };
- 
-    auto dataProcessingCallback = [&warning_message, &requester](const std::string& json_str) -> std::string {
-        try {
-            auto j = nlohmann::json::parse(json_str);
-    
-            // Check all required fields before proceeding
-            if (j.contains("action") && j["action"] == "set" &&
-                j.contains("variable") && j["variable"].is_string() &&
-                j.contains("value") && j["value"].is_string())
-            {
-                const std::string& variable = j["variable"];
-                const std::string& value = j["value"];
-    
-                if (variable == "warning_message") {
-                    warning_message = value;
-                    std::cout << "[Config] Set warning_message to: " << warning_message << std::endl;
-                } else if (variable == "overwrite_text") {
-                    requester.set_overwrite_text(value);
-                    std::cout << "[Config] Set overwrite_text to: " << value << std::endl;
+            if (j.contains("action") && j["action"] == "start_session") {
+                LivenessSession::Config config = session_config;
+                std::string error;
+                if (!config.apply_request(j, &error) || !open_session(config, &error)) {
+                    LOG_ERROR("Unable to start session: {}", error);
+                    return json{{"session", {{"started", false}, {"error", error}}}}.dump();
                 }
+                json reply;
+                reply["session"] = std::atomic_load(session.get())->info();
+                reply["session"]["started"] = true;
+                return reply.dump();
             }
-        } catch (const std::exception& e) {
-            std::cerr << "[Config] JSON parse error: " << e.what() << std::endl;
-        }
-        return {};
+
+            std::string error;
+            if (!std::atomic_load(session.get()) && !open_session(session_config, &error)) {
+                LOG_ERROR("Unable to start session: {}", error);
+                return {};
+            }
+            return std::atomic_load(session.get())->handle_control(j);
+        };
+        // Each result's landmarks are sent once, with the next reply after it arrives.
+        auto landmarks_sent_ms = std::make_shared<std::atomic<int64_t>>(-1);
+        callbacks.takeBinaryMessage = [session, landmarks_sent_ms, &processor]()
+                -> std::optional<UnixSocketServer::BinaryMessage> {
+            auto current = std::atomic_load(session.get());
+            if (!current) {
+                return std::nullopt;
+            }
+            auto dump = current->take_binary_message();
+            if (dump) {
+                UnixSocketServer::BinaryMessage message;
+                message.header = std::move(dump->header);
+                message.payload = std::move(dump->payload);
+                return message;
+            }
+            if (auto snapshot = current->take_snapshot()) {
+                UnixSocketServer::BinaryMessage message;
+                message.header = snapshot->header();
+                message.payload = std::move(snapshot->data);
+                return message;
+            }
+            if (!current->config().send_landmarks) {
+                return std::nullopt;
+            }
+            auto landmarks = processor.LatestLandmarks();
+            if (!landmarks || landmarks->timestamp_ms() == landmarks_sent_ms->load(std::memory_order_relaxed)) {
+                return std::nullopt;
+            }
+            landmarks_sent_ms->store(landmarks->timestamp_ms(), std::memory_order_relaxed);
+            return landmarks_message(std::move(landmarks));
+        };
+        callbacks.onDisconnect = [&active_session]() {
+            std::atomic_store(&active_session, std::shared_ptr<LivenessSession>());
+        };
+        return callbacks;
     };
 
-    UnixSocketServer socketServer(
-        socket_path, 
-        imageProcessingCallback,
-        dataProcessingCallback
-    );
+    UnixSocketServer socketServer(socket_path, clientConnectedCallback);
 
     if (!socketServer.start()) {
         std::cerr << "Failed to start UnixSocketServer.\n";
         return EXIT_FAILURE;
     }
 
-    std::cout << "UnixSocketServer started at path: " << socket_path << ". Waiting for connection from Python client...\n";
+    auto ready_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - started_at).count();
+    std::cout << "UnixSocketServer started at path: " << socket_path << ". Ready in " << ready_ms
+              << " ms, waiting for connection from Python client...\n";
+
+    // Tell the launcher we are accepting connections, so it does not have to poll for the socket.
+    if (ready_fd >= 0) {
+        std::string ready_line = "READY " + std::to_string(ready_ms) + "\n";
+        if (write(ready_fd, ready_line.data(), ready_line.size()) == -1) {
+            perror("write ready_fd");
+        }
+        close(ready_fd);
+    }
 
     socketServer.run();
 
     return 0;
-}
\ No newline at end of file
+}
@@ -0,0 +1,322 @@
+import asyncio
+import collections
+import json
+import socket
+import struct
+
+import numpy as np
+
+from . import flight_recorder
+from . import frame_timing
+from . import landmarks
+from . import snapshots
+
+
+class AsyncGestureClient:
+    """
+    asyncio client for a running livenessDetectorServer (see
+    GestureServerClient.start_server(connect=False) to launch one).
+
+    Up to max_in_flight frames are sent before their results come back, so the
+    server never waits on the Python side between frames. Processed frames are
+    received with recv_into straight into a ring of preallocated buffers: the
+    array returned by process_frame stays valid until ring_size further frames
+    have been received, copy it if you need it for longer.
+
+    Callbacks may be plain functions or coroutine functions. They are scheduled
+    on the event loop instead of being run by the receive loop, so a slow
+    callback does not hold back the frames behind it.
+    """
+
+    def __init__(self, socket_path, max_in_flight=3):
+        self.socket_path = socket_path
+        self.max_in_flight = max_in_flight
+        self.ring_size = max_in_flight + 2
+
+        self.string_callback = None
+        self.take_picture_callback = None
+        self.report_alive_callback = None
+        self.suspicious_input_callback = None
+        self.flight_recorder_callback = None
+        self.frame_timing_callback = None
+        self.landmarks_callback = None
+        self.snapshot_callback = None
+
+        self._sock = None
+        self._loop = None
+        self._reader_task = None
+        self._slots = None
+        self._pending_frames = collections.deque()
+        self._pending_session = collections.deque()
+        self._pending_dumps = collections.deque()
+        self._ring = [None] * self.ring_size
+        self._ring_index = 0
+        self._header = bytearray(13)
+        self._timing = bytearray(frame_timing.TIMING_SIZE)
+
+    def set_string_callback(self, callback):
+        """ Set the callback function for string messages. """
+        self.string_callback = callback
+
+    def set_take_picture_callback(self, callback):
+        """ Set the callback function for the takeAPicture event. """
+        self.take_picture_callback = callback
+
+    def set_report_alive_callback(self, callback):
+        """ Set the callback function for the reportAlive event. """
+        self.report_alive_callback = callback
+
+    def set_suspicious_input_callback(self, callback):
+        """ Set the callback for suspiciousInput events, e.g. {"reason": "repeated_frames", "frames": 30}. """
+        self.suspicious_input_callback = callback
+
+    def set_flight_recorder_callback(self, callback):
+        """ Set the callback for not-alive flight recorder dumps: (header dict, records array). """
+        self.flight_recorder_callback = callback
+
+    def set_frame_timing_callback(self, callback):
+        """ Set the callback for the server's timing of timestamped frames: a dict, see frame_timing.decode. """
+        self.frame_timing_callback = callback
+
+    def set_landmarks_callback(self, callback):
+        """ Set the callback for each result's landmarks: (header dict, 3 x N array), see landmarks.decode. """
+        self.landmarks_callback = callback
+
+    def set_snapshot_callback(self, callback):
+        """ Set the callback for gesture snapshots: (header dict, encoded image bytes), see snapshots.decode. """
+        self.snapshot_callback = callback
+
+    async def connect(self):
+        self._loop = asyncio.get_running_loop()
+        self._sock = socket.socket(socket.AF_UNIX, socket.SOCK_STREAM)
+        self._sock.setblocking(False)
+        await self._loop.sock_connect(self._sock, self.socket_path)
+        self._slots = asyncio.Semaphore(self.max_in_flight)
+        # Messages must not interleave on the wire when a send has to wait.
+        self._send_lock = asyncio.Lock()
+        self._reader_task = asyncio.ensure_future(self._receive_loop())
+
+    async def close(self):
+        if self._reader_task:
+            self._reader_task.cancel()
+            try:
+                await self._reader_task
+            except (asyncio.CancelledError, ConnectionError):
+                pass
+            self._reader_task = None
+        if self._sock:
+            self._sock.close()
+            self._sock = None
+
+    async def start_session(self, language=None, num_gestures=None, gestures_list=None, flight_recorder=False,
+                            quality_gate=True, landmarks=False, snapshots=None):
+        """ Start a verification on this connection; returns the server's session description. """
+        message = {"action": "start_session"}
+        if flight_recorder:
+            message["flight_recorder"] = True
+        if not quality_gate:
+            message["quality_gate"] = False
+        if landmarks:
+            message["landmarks"] = True
+        if snapshots:
+            message["snapshots"] = snapshots
+        if language is not None:
+            message["language"] = language
+        if num_gestures is not None:
+            message["num_gestures"] = num_gestures
+        if gestures_list is not None:
+            message["gestures_list"] = list(gestures_list)
+        return await self._session_request(message)
+
+    async def new_session(self):
+        """ Start over with a new random set of gestures. """
+        return await self._session_request({"action": "new_session"})
+
+    async def dump_flight_recorder(self):
+        """ Fetch the session's flight recorder: (header dict, records array). """
+        future = self._loop.create_future()
+        data = json.dumps({"action": "dump_flight_recorder"}).encode('utf-8')
+        async with self._send_lock:
+            self._pending_dumps.append(future)
+            await self._send_buffers([struct.pack('!BI', 0x02, len(data)), data])
+        return await future
+
+    async def set_overwrite_text(self, text):
+        await self._send_json({"action": "set", "variable": "overwrite_text", "value": text})
+
+    async def set_warning_message(self, text):
+        await self._send_json({"action": "set", "variable": "warning_message", "value": text})
+
+    async def set_log_level(self, level):
+        await self._send_json({"action": "set", "variable": "log_level", "value": level})
+
+    async def submit_frame(self, frame, capture_timestamp_us=None):
+        """
+        Send a frame without waiting for its result. Waits only while
+        max_in_flight frames are already pending. Returns a future that
+        resolves to the processed frame. With a capture_timestamp_us
+        (frame_timing.capture_timestamp_us() at capture) the server keeps the
+        capture spacing and reports its timing to the frame timing callback.
+        """
+        frame = np.ascontiguousarray(frame, dtype=np.uint8)
+        rows, cols, channels = frame.shape
+        await self._slots.acquire()
+        future = self._loop.create_future()
+        if capture_timestamp_us is None:
+            header = struct.pack('!BIII', 0x01, frame.nbytes, rows, cols)
+        else:
+            header = struct.pack('!BIIIQ', 0x04, frame.nbytes, rows, cols, capture_timestamp_us)
+        async with self._send_lock:
+            self._pending_frames.append((future, channels))
+            await self._send_buffers([header, memoryview(frame).cast('B')])
+        return future
+
+    async def process_frame(self, frame, capture_timestamp_us=None):
+        """ Send a frame and wait for the processed frame. """
+        return await (await self.submit_frame(frame, capture_timestamp_us))
+
+    async def _session_request(self, message):
+        future = self._loop.create_future()
+        data = json.dumps(message).encode('utf-8')
+        async with self._send_lock:
+            self._pending_session.append(future)
+            await self._send_buffers([struct.pack('!BI', 0x02, len(data)), data])
+        return await future
+
+    async def _send_json(self, message):
+        data = json.dumps(message).encode('utf-8')
+        async with self._send_lock:
+            await self._send_buffers([struct.pack('!BI', 0x02, len(data)), data])
+
+    async def _send_buffers(self, buffers):
+        # Header and payload leave in one sendmsg; only a partial send falls back to waiting.
+        views = [memoryview(b).cast('B') for b in buffers]
+        while views:
+            try:
+                sent = self._sock.sendmsg(views)
+            except BlockingIOError:
+                await self._wait_writable()
+                continue
+            while views and sent >= len(views[0]):
+                sent -= len(views[0])
+                views.pop(0)
+            if views:
+                views[0] = views[0][sent:]
+                await self._wait_writable()
+
+    async def _wait_writable(self):
+        future = self._loop.create_future()
+        fd = self._sock.fileno()
+        self._loop.add_writer(fd, future.set_result, None)
+        try:
+            await future
+        finally:
+            self._loop.remove_writer(fd)
+
+    async def _recv_into(self, view):
+        received = 0
+        while received < len(view):
+            count = await self._loop.sock_recv_into(self._sock, view[received:])
+            if count == 0:
+                raise ConnectionError("Connection closed by server")
+            received += count
+
+    def _ring_buffer(self, size):
+        buffer = self._ring[self._ring_index]
+        if buffer is None or buffer.nbytes < size:
+            buffer = np.empty(size, dtype=np.uint8)
+            self._ring[self._ring_index] = buffer
+        self._ring_index = (self._ring_index + 1) % self.ring_size
+        return buffer[:size]
+
+    async def _receive_loop(self):
+        header = memoryview(self._header)
+        try:
+            while True:
+                await self._recv_into(header[:1])
+                function_id = header[0]
+
+                if function_id in (0x01, 0x04):
+                    await self._recv_into(header[1:13])
+                    size, rows, cols = struct.unpack_from('!III', header, 1)
+                    if function_id == 0x04:
+                        await self._recv_into(memoryview(self._timing))
+                        self._schedule(self.frame_timing_callback, frame_timing.decode(bytes(self._timing)))
+                    buffer = self._ring_buffer(size)
+                    await self._recv_into(memoryview(buffer))
+                    future, channels = self._pending_frames.popleft()
+                    self._slots.release()
+                    if not future.done():
+                        future.set_result(buffer.reshape((rows, cols, channels)))
+
+                elif function_id == 0x02:
+                    await self._recv_into(header[1:5])
+                    (size,) = struct.unpack_from('!I', header, 1)
+                    data = bytearray(size)
+                    await self._recv_into(memoryview(data))
+                    self._handle_json(data.decode('utf-8'))
+
+                elif function_id == 0x03:
+                    await self._recv_into(header[1:5])
+                    (header_size,) = struct.unpack_from('!I', header, 1)
+                    dump_header = bytearray(header_size)
+                    await self._recv_into(memoryview(dump_header))
+                    await self._recv_into(header[1:5])
+                    (payload_size,) = struct.unpack_from('!I', header, 1)
+                    payload = bytearray(payload_size)
+                    await self._recv_into(memoryview(payload))
+                    self._handle_binary_message(json.loads(dump_header), payload)
+
+                else:
+                    raise ConnectionError(f"Unknown message {function_id} from server")
+        except Exception as e:
+            for future, _ in self._pending_frames:
+                if not future.done():
+                    future.set_exception(e)
+            for future in list(self._pending_session) + list(self._pending_dumps):
+                if not future.done():
+                    future.set_exception(e)
+            self._pending_frames.clear()
+            self._pending_session.clear()
+            self._pending_dumps.clear()
+            raise
+
+    def _handle_json(self, string_data):
+        try:
+            json_data = json.loads(string_data)
+        except json.JSONDecodeError:
+            print(f"Failed to decode JSON string: {string_data}")
+            return
+
+        if 'session' in json_data and self._pending_session:
+            self._pending_session.popleft().set_result(json_data['session'])
+            return
+
+        self._schedule(self.string_callback, string_data)
+        if 'takeAPicture' in json_data:
+            self._schedule(self.take_picture_callback, json_data['takeAPicture'])
+        if 'reportAlive' in json_data:
+            self._schedule(self.report_alive_callback, json_data['reportAlive'])
+        if 'suspiciousInput' in json_data:
+            self._schedule(self.suspicious_input_callback, json_data['suspiciousInput'])
+
+    def _handle_binary_message(self, header, payload):
+        if header.get('type') == landmarks.TYPE:
+            self._schedule(self.landmarks_callback, *landmarks.decode(header, payload))
+            return
+        if header.get('type') == snapshots.TYPE:
+            self._schedule(self.snapshot_callback, *snapshots.decode(header, payload))
+            return
+        header, records = flight_recorder.decode(header, payload)
+        if header.get('reason') == 'on_demand' and self._pending_dumps:
+            self._pending_dumps.popleft().set_result((header, records))
+            return
+        self._schedule(self.flight_recorder_callback, header, records)
+
+    def _schedule(self, callback, *args):
+        if callback is None:
+            return
+        if asyncio.iscoroutinefunction(callback):
+            asyncio.ensure_future(callback(*args))
+        else:
+            self._loop.call_soon(callback, *args)
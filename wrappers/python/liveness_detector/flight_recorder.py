@@ -0,0 +1,49 @@
+import json
+import struct
+
+import numpy as np
+
+# Matches FlightRecorder::Record in src/livenessDetector/flight_recorder.h.
+RECORD_DTYPE = np.dtype([
+    ('timestamp_ns', '<u8'),
+    ('type', 'u1'),
+    ('reserved', 'u1'),
+    ('id', '<u2'),
+    ('arg', '<u4'),
+    ('value', '<f8'),
+])
+
+SIGNAL = 1
+STEP_ADVANCE = 2
+STEP_RESET = 3
+GESTURE_DONE = 4
+PHASE = 5
+NOT_ALIVE = 6
+LATENCY = 7
+SUSPICIOUS_INPUT = 8
+
+STAGE_SIGNAL_TICK = 0
+STAGE_RENDER = 1
+
+
+def decode(header, payload):
+    """
+    Decode a flight recorder dump received from the server (or read with
+    load()). Returns (header dict, structured array of records, oldest first).
+    Signal records index header['signals'], step records header['gestures'],
+    phase records header['plan'].
+    """
+    if isinstance(header, (bytes, bytearray, str)):
+        header = json.loads(header)
+    records = np.frombuffer(payload, dtype=RECORD_DTYPE)
+    return header, records
+
+
+def load(path):
+    """ Read a .ldfr file written by the server's --flight_recorder_dir. """
+    with open(path, 'rb') as f:
+        (header_size,) = struct.unpack('!I', f.read(4))
+        header = f.read(header_size)
+        (payload_size,) = struct.unpack('!I', f.read(4))
+        payload = f.read(payload_size)
+    return decode(header, payload)
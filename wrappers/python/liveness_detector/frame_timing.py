@@ -0,0 +1,41 @@
+import struct
+import time
+
+# Matches UnixSocketServer::sendFrameTiming in src/livenessDetector/unix_socket_server.cc.
+TIMING_FORMAT = '!QB8I'
+TIMING_SIZE = struct.calcsize(TIMING_FORMAT)
+
+PROCESSED = 0
+NUDGED = 1
+DROPPED = 2
+SKIPPED = 3
+
+STATUS_NAMES = {PROCESSED: 'processed', NUDGED: 'nudged', DROPPED: 'dropped', SKIPPED: 'skipped'}
+
+
+def capture_timestamp_us():
+    """ Capture timestamp to send with a frame: microseconds on the monotonic clock. """
+    return time.monotonic_ns() // 1000
+
+
+def decode(data):
+    """
+    Decode the timing block of a 0x04 reply. Durations are in microseconds;
+    end_to_end_us is measured on this side, from the capture timestamp
+    (taken with capture_timestamp_us()) to now.
+    """
+    (capture_us, status, receive_us, gate_us, submit_us, render_us,
+     inference_us, total_us, nudged_frames, dropped_frames) = struct.unpack(TIMING_FORMAT, data)
+    return {
+        'capture_timestamp_us': capture_us,
+        'status': STATUS_NAMES.get(status, status),
+        'receive_us': receive_us,
+        'gate_us': gate_us,
+        'submit_us': submit_us,
+        'render_us': render_us,
+        'inference_us': inference_us,
+        'server_total_us': total_us,
+        'end_to_end_us': capture_timestamp_us() - capture_us,
+        'nudged_frames': nudged_frames,
+        'dropped_frames': dropped_frames,
+    }
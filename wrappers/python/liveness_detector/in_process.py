@@ -0,0 +1,92 @@
+import os
+
+try:
+    from liveness_detector import liveness_detector_native
+except ImportError:  # wheel built without the extension
+    liveness_detector_native = None
+
+
+class InProcessLivenessDetector:
+    """
+    Same workflow as GestureServerClient, without the server process: frames are
+    processed inside this process and never copied through a socket.
+
+    The frame passed to process_frame is read in place when it is a contiguous
+    uint8 HxWx3 array. The returned overlay is a read-only view of a buffer the
+    detector reuses once every reference to that view has been dropped; copy it
+    if you need to keep it across many frames.
+    """
+
+    def __init__(
+        self,
+        language,
+        num_gestures,
+        extra_gestures_paths=None,
+        extra_locales_paths=None,
+        gestures_list=None,
+        assets_bundle_path=None,
+        warmup_frames=3,
+        watch_assets=False
+    ):
+        if liveness_detector_native is None:
+            raise RuntimeError("liveness_detector_native extension is not available on this platform.")
+
+        base = os.path.dirname(__file__)
+        self.model_path = os.path.join(base, './model/face_landmarker.task')
+        self.gestures_folder_path = os.path.join(base, './gestures')
+        self.font_path = os.path.join(base, './fonts/DejaVuSans.ttf')
+
+        self._detector = liveness_detector_native.NativeLivenessDetector(
+            model_path=self.model_path,
+            gestures_folders=[self.gestures_folder_path] + (extra_gestures_paths or []),
+            locales_paths=extra_locales_paths or [],
+            font_path=self.font_path,
+            language=language,
+            num_gestures=num_gestures,
+            gestures_list=gestures_list or [],
+            assets_bundle_path=assets_bundle_path or "",
+            warmup_frames=warmup_frames,
+            watch_assets=watch_assets,
+        )
+
+    def set_string_callback(self, callback):
+        """ Set the callback function for string messages. """
+        self._detector.set_string_callback(callback)
+
+    def set_take_picture_callback(self, callback):
+        """ Set the callback function for the takeAPicture event. """
+        self._detector.set_take_picture_callback(callback)
+
+    def set_report_alive_callback(self, callback):
+        """ Set the callback function for the reportAlive event. """
+        self._detector.set_report_alive_callback(callback)
+
+    def set_suspicious_input_callback(self, callback):
+        """ Set the callback for suspiciousInput events, e.g. {"reason": "repeated_frames", "frames": 30}. """
+        self._detector.set_suspicious_input_callback(callback)
+
+    def start_session(self, language=None, num_gestures=None, gestures_list=None):
+        """ Start a verification; arguments left as None use the constructor values. """
+        return self._detector.start_session(language, num_gestures, gestures_list)
+
+    def new_session(self):
+        """ Start over with a new random set of gestures. """
+        return self._detector.new_session()
+
+    def set_overwrite_text(self, text):
+        self._detector.set_overwrite_text(text)
+
+    def set_warning_message(self, text):
+        self._detector.set_warning_message(text)
+
+    def process_frame(self, frame):
+        """ Process a BGR frame and return the overlay frame. Callbacks run before this returns. """
+        return self._detector.process_frame(frame)
+
+    def latest_landmarks(self):
+        """
+        Landmarks of the latest result: (header dict, 3 x N float32 array of
+        x, y, z rows), or None when no face was found. The array is a read-only
+        view of the detector's buffer; see landmarks.decode for the units.
+        """
+        return self._detector.latest_landmarks()
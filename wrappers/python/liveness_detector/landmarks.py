@@ -0,0 +1,28 @@
+import json
+
+import numpy as np
+
+# Matches landmarks_message in src/livenessDetectorServerApp/livenessDetectorServer.cc.
+TYPE = 'landmarks'
+
+
+def decode(header, payload):
+    """
+    Decode a landmarks message (sessions started with landmarks=True).
+    Returns (header dict, 3 x N float32 array): rows x, y and z of the face
+    mesh landmarks, in image heights. Divide x and z by header['aspect'] for
+    the landmarker's normalized coordinates. header['timestamp_ms'] is the
+    frame's timestamp on the landmarker's timeline.
+    """
+    if isinstance(header, (bytes, bytearray, str)):
+        header = json.loads(header)
+    array = np.frombuffer(payload, dtype=np.dtype(header.get('dtype', '<f4')))
+    return header, array.reshape((3, header['count']))
+
+
+def normalized(header, array):
+    """ The landmarks in the landmarker's normalized image coordinates, as an N x 3 array. """
+    points = array.T.copy()
+    points[:, 0] /= header['aspect']
+    points[:, 2] /= header['aspect']
+    return points
@@ -3,9 +3,16 @@ import os
 import platform
 import subprocess
 import signal
+import select
 import time
 import numpy as np
 import json
+import struct
+
+from . import flight_recorder
+from . import frame_timing
+from . import landmarks
+from . import snapshots
 
 
 def get_server_executable_path():
@@ -29,7 +36,10 @@ class GestureServerClient:
         num_gestures, 
         extra_gestures_paths=None, 
         extra_locales_paths=None, 
-        gestures_list=None
+        gestures_list=None,
+        assets_bundle_path=None,
+        warmup_frames=None,
+        log_level=None
     ):
         self.server_executable_path = os.path.join(os.path.dirname(__file__), get_server_executable_path())
         self.model_path = os.path.join(os.path.dirname(__file__),'./model/face_landmarker.task')
@@ -43,12 +53,20 @@ class GestureServerClient:
         self.extra_gestures_paths = extra_gestures_paths if extra_gestures_paths else []
         self.extra_locales_paths = extra_locales_paths if extra_locales_paths else []
         self.gestures_list = gestures_list if gestures_list else []
+        self.assets_bundle_path = assets_bundle_path
+        self.warmup_frames = warmup_frames
+        self.log_level = log_level
 
         self.server_process = None
         self.client_socket = None
         self.string_callback = None
         self.take_picture_callback = None
         self.report_alive_callback = None
+        self.suspicious_input_callback = None
+        self.flight_recorder_callback = None
+        self.frame_timing_callback = None
+        self.landmarks_callback = None
+        self.snapshot_callback = None
 
     def set_string_callback(self, callback):
         """ Set the callback function for string messages. """
@@ -62,6 +80,41 @@ class GestureServerClient:
         """ Set the callback function for the reportAlive event. """
         self.report_alive_callback = callback
 
+    def set_suspicious_input_callback(self, callback):
+        """ Set the callback for suspiciousInput events, e.g. {"reason": "repeated_frames", "frames": 30}. """
+        self.suspicious_input_callback = callback
+
+    def set_flight_recorder_callback(self, callback):
+        """
+        Set the callback for flight recorder dumps the server sends when a
+        session ends not alive (start the session with flight_recorder=True).
+        Called with (header dict, records array), see flight_recorder.decode.
+        """
+        self.flight_recorder_callback = callback
+
+    def set_frame_timing_callback(self, callback):
+        """
+        Set the callback for the server's timing of frames sent with a capture
+        timestamp, called with the dict built by frame_timing.decode.
+        """
+        self.frame_timing_callback = callback
+
+    def set_landmarks_callback(self, callback):
+        """
+        Set the callback for the landmarks of each result (start the session
+        with landmarks=True), called with (header dict, 3 x N array), see
+        landmarks.decode.
+        """
+        self.landmarks_callback = callback
+
+    def set_snapshot_callback(self, callback):
+        """
+        Set the callback for the pictures taken when a take_picture_at_the_end
+        gesture completes (start the session with snapshots enabled), called
+        with (header dict, encoded image bytes), see snapshots.decode.
+        """
+        self.snapshot_callback = callback
+
     def set_font_path(self, font_path):
         """ Set the font path to be used. Use it before call start_server. """
         self.font_path = font_path
@@ -75,8 +128,11 @@ class GestureServerClient:
         except OSError as e:
             print(f"Error removing socket file: {e}")
 
-    def start_server(self):
-        """ Start the server process. """
+    def start_server(self, connect=True):
+        """
+        Start the server process. With connect=False the server is only launched,
+        for use with another client such as AsyncGestureClient.
+        """
         self.cleanup_socket()
 
         # Compose gestures_folder_path for argument (main + extras)
@@ -109,10 +165,49 @@ class GestureServerClient:
             server_command.extend(["--locales_paths", locales_paths_arg])
         if gestures_list_arg:
             server_command.extend(["--gestures_list", gestures_list_arg])
+        if self.assets_bundle_path:
+            server_command.extend(["--assets_bundle_path", self.assets_bundle_path])
+
+        if self.warmup_frames is not None:
+            server_command.extend(["--warmup_frames", str(self.warmup_frames)])
+        if self.log_level is not None:
+            server_command.extend(["--log_level", self.log_level])
+
+        if os.name != "posix":
+            print("Launching server with:", " ".join(server_command))
+            self.server_process = subprocess.Popen(server_command)
+            if not self._wait_for_socket():
+                return False
+            return self.connect() if connect else True
 
+        # The server writes "READY <ms>" to this pipe once it accepts connections.
+        ready_read, ready_write = os.pipe()
+        server_command.extend(["--ready_fd", str(ready_write)])
         print("Launching server with:", " ".join(server_command))
-        self.server_process = subprocess.Popen(server_command)
+        try:
+            self.server_process = subprocess.Popen(server_command, pass_fds=(ready_write,))
+        finally:
+            os.close(ready_write)
+
+        try:
+            ready, _, _ = select.select([ready_read], [], [], 30)
+            line = os.read(ready_read, 64).decode('utf-8', 'replace') if ready else ""
+        finally:
+            os.close(ready_read)
+
+        if not line.startswith("READY"):
+            if not ready:
+                print("Timeout while waiting for the server to become ready.")
+            else:
+                print("Server exited before becoming ready.")
+            self.stop_server()
+            return False
+
+        print(f"Server ready in {line.split()[1]} ms")
+        return self.connect() if connect else True
 
+    def _wait_for_socket(self):
+        """ Fallback for platforms without fd inheritance: poll for the socket file. """
         start_time = time.time()
         while not os.path.exists(self.socket_path):
             if time.time() - start_time > 30:
@@ -122,7 +217,10 @@ class GestureServerClient:
 
             print(f"Waiting for server socket at {self.socket_path}...")
             time.sleep(0.5)
+        return True
 
+    def connect(self):
+        """ Connect to a server that is already running at socket_path. """
         self.client_socket = socket.socket(socket.AF_UNIX, socket.SOCK_STREAM)
         try:
             self.client_socket.connect(self.socket_path)
@@ -133,6 +231,132 @@ class GestureServerClient:
             self.stop_server()
             return False
 
+    def start_session(self, language=None, num_gestures=None, gestures_list=None, flight_recorder=False,
+                      quality_gate=True, landmarks=False, snapshots=None):
+        """
+        Start a verification on the running server without restarting it.
+        Arguments left as None use the values given to the constructor.
+        With flight_recorder=True a session ending not alive sends its flight
+        recorder to the flight recorder callback. With quality_gate=False every
+        frame goes to the landmarker, even dark, blurred or frozen ones. With
+        landmarks=True the face mesh of each result goes to the landmarks callback.
+        With snapshots=True, or a dict such as {"format": "webp", "quality": 80,
+        "face_only": True, "max_snapshots": 4, "window_before_ms": 200}, the
+        server encodes the best frame around the completion of each
+        take_picture_at_the_end gesture and sends it to the snapshot callback.
+        Returns the session description sent by the server, e.g.
+        {"started": True, "language": "en", "gestures": ["blink", "smile"], "generation": 1}.
+        """
+        message = {
+            "action": "start_session",
+            "language": language if language is not None else self.language,
+            "num_gestures": num_gestures if num_gestures is not None else self.num_gestures,
+        }
+        gestures = gestures_list if gestures_list is not None else self.gestures_list
+        if gestures:
+            message["gestures_list"] = list(gestures)
+        if flight_recorder:
+            message["flight_recorder"] = True
+        if not quality_gate:
+            message["quality_gate"] = False
+        if landmarks:
+            message["landmarks"] = True
+        if snapshots:
+            message["snapshots"] = snapshots
+        self._send_json(message)
+        return self._wait_session_reply()
+
+    def new_session(self):
+        """ Start over with a new random set of gestures, keeping language and gestures list. """
+        self._send_json({"action": "new_session"})
+        return self._wait_session_reply()
+
+    def dump_flight_recorder(self):
+        """ Fetch the current session's flight recorder: (header dict, records array). """
+        self._send_json({"action": "dump_flight_recorder"})
+        while True:
+            function_id = self._recv_exact(1)[0]
+            if function_id == 0x03:
+                header, payload = self._read_binary_message()
+                if header.get('type') == 'flight_recorder' and header.get('reason') == 'on_demand':
+                    return flight_recorder.decode(header, payload)
+                self._dispatch_binary_message(header, payload)
+            elif function_id == 0x02:
+                size = int.from_bytes(self._recv_exact(4), 'big')
+                self.handle_json_response(self._recv_exact(size).decode('utf-8'))
+            else:
+                raise RuntimeError(f"Unexpected message {function_id} while waiting for the flight recorder")
+
+    def _read_binary_message(self):
+        (header_size,) = struct.unpack('!I', self._recv_exact(4))
+        header = self._recv_exact(header_size)
+        (payload_size,) = struct.unpack('!I', self._recv_exact(4))
+        payload = self._recv_exact(payload_size)
+        return json.loads(header), payload
+
+    def _dispatch_binary_message(self, header, payload):
+        if header.get('type') == landmarks.TYPE:
+            if self.landmarks_callback:
+                self.landmarks_callback(*landmarks.decode(header, payload))
+        elif header.get('type') == snapshots.TYPE:
+            if self.snapshot_callback:
+                self.snapshot_callback(*snapshots.decode(header, payload))
+        elif self.flight_recorder_callback:
+            self.flight_recorder_callback(*flight_recorder.decode(header, payload))
+
+    def _send_json(self, message):
+        if self.client_socket is None:
+            raise RuntimeError("Server not started or connection failed.")
+        data = json.dumps(message).encode('utf-8')
+        self.client_socket.sendall((0x02).to_bytes(1, 'big') + len(data).to_bytes(4, 'big') + data)
+
+    def _recv_exact(self, size):
+        buffer = bytearray(size)
+        self._recv_exact_into(memoryview(buffer))
+        return bytes(buffer)
+
+    def _recv_exact_into(self, view):
+        received = 0
+        while received < len(view):
+            count = self.client_socket.recv_into(view[received:])
+            if count == 0:
+                raise ConnectionError("Connection closed by server")
+            received += count
+
+    def _sendall_buffers(self, buffers):
+        """ sendall() for several buffers, gathered into as few system calls as possible. """
+        views = [memoryview(b).cast('B') for b in buffers]
+        if not hasattr(self.client_socket, 'sendmsg'):
+            for view in views:
+                self.client_socket.sendall(view)
+            return
+        while views:
+            sent = self.client_socket.sendmsg(views)
+            while views and sent >= len(views[0]):
+                sent -= len(views[0])
+                views.pop(0)
+            if views:
+                views[0] = views[0][sent:]
+
+    def _wait_session_reply(self):
+        """ Read string messages until the reply to a session request arrives. """
+        while True:
+            function_id = self._recv_exact(1)[0]
+            if function_id == 0x03:
+                self._dispatch_binary_message(*self._read_binary_message())
+                continue
+            if function_id != 0x02:
+                raise RuntimeError(f"Unexpected message {function_id} while waiting for the session reply")
+            size = int.from_bytes(self._recv_exact(4), 'big')
+            string_data = self._recv_exact(size).decode('utf-8')
+            try:
+                json_data = json.loads(string_data)
+            except json.JSONDecodeError:
+                json_data = {}
+            if 'session' in json_data:
+                return json_data['session']
+            self.handle_json_response(string_data)
+
     def set_overwrite_text(self, text):
         """ Send a command to the server to set the overwrite text. """
         if self.client_socket is None:
@@ -161,58 +385,57 @@ class GestureServerClient:
         self.client_socket.sendall(len(data).to_bytes(4, 'big'))
         self.client_socket.sendall(data)
     
-    def process_frame(self, frame):
-        """ Send a frame to the server and receive the processed frame. """
+    def set_log_level(self, level):
+        """ Change the server's log level: 'debug', 'info', 'warning', 'error' or 'off'. """
+        self._send_json({"action": "set", "variable": "log_level", "value": level})
+
+    def process_frame(self, frame, capture_timestamp_us=None):
+        """
+        Send a frame to the server and receive the processed frame. With a
+        capture_timestamp_us (frame_timing.capture_timestamp_us() when the frame
+        was captured), the landmarker gets the capture spacing rather than the
+        arrival spacing, and the server's timing goes to the frame timing callback.
+        """
         if self.client_socket is None:
             raise RuntimeError("Server not started or connection failed.")
 
+        frame = np.ascontiguousarray(frame, dtype=np.uint8)
         rows, cols, channels = frame.shape
         frame_size = rows * cols * channels
 
-        function_id = (0x01).to_bytes(1, byteorder='big')
+        if capture_timestamp_us is None:
+            header = struct.pack('!BIII', 0x01, frame_size, rows, cols)
+        else:
+            header = struct.pack('!BIIIQ', 0x04, frame_size, rows, cols, capture_timestamp_us)
 
         try:
-            self.client_socket.sendall(function_id)
-            self.client_socket.sendall(frame_size.to_bytes(4, byteorder='big'))
-            self.client_socket.sendall(rows.to_bytes(4, byteorder='big'))
-            self.client_socket.sendall(cols.to_bytes(4, byteorder='big'))
-            frame_bytes = frame.tobytes()
-            self.client_socket.sendall(frame_bytes)
+            # One call for header and pixels, without copying the frame into a bytes object
+            self._sendall_buffers([header, memoryview(frame).cast('B')])
 
             while True:
-                response_function_id_data = self.client_socket.recv(1)
-                if not response_function_id_data:
-                    print("No response from server (function ID), quitting")
-                    return None
-
-                response_function_id = int.from_bytes(response_function_id_data, byteorder='big')
+                response_function_id = self._recv_exact(1)[0]
 
                 if response_function_id == 0x02:
-                    string_size_data = self.client_socket.recv(4)
-                    string_size = int.from_bytes(string_size_data, byteorder='big')
-                    string_data = self.client_socket.recv(string_size).decode('utf-8')
+                    string_size = int.from_bytes(self._recv_exact(4), byteorder='big')
+                    string_data = self._recv_exact(string_size).decode('utf-8')
 
                     # Process the JSON response
                     self.handle_json_response(string_data)
 
-                elif response_function_id == 0x01:
-                    received_size_data = self.client_socket.recv(4)
-                    processed_size = int.from_bytes(received_size_data, byteorder='big')
-
-                    processed_rows_data = self.client_socket.recv(4)
-                    processed_cols_data = self.client_socket.recv(4)
-                    processed_rows = int.from_bytes(processed_rows_data, byteorder='big')
-                    processed_cols = int.from_bytes(processed_cols_data, byteorder='big')
+                elif response_function_id == 0x03:
+                    self._dispatch_binary_message(*self._read_binary_message())
 
-                    processed_frame_bytes = b''
-                    while len(processed_frame_bytes) < processed_size:
-                        packet = self.client_socket.recv(min(processed_size - len(processed_frame_bytes), 1024 * 1024))
-                        if not packet:
-                            print("Connection closed by server")
-                            return None
-                        processed_frame_bytes += packet
+                elif response_function_id in (0x01, 0x04):
+                    processed_size, processed_rows, processed_cols = struct.unpack('!III', self._recv_exact(12))
+                    if response_function_id == 0x04:
+                        timing = frame_timing.decode(self._recv_exact(frame_timing.TIMING_SIZE))
+                        if self.frame_timing_callback:
+                            self.frame_timing_callback(timing)
 
-                    processed_frame = np.frombuffer(processed_frame_bytes, dtype=np.uint8).reshape((processed_rows, processed_cols, channels))
+                    processed_frame = np.empty((processed_rows, processed_cols, channels), dtype=np.uint8)
+                    if processed_frame.nbytes != processed_size:
+                        raise RuntimeError(f"Unexpected processed frame size {processed_size}")
+                    self._recv_exact_into(memoryview(processed_frame).cast('B'))
                     return processed_frame
         except Exception as e:
             print(f"Error processing frame: {e}")
@@ -228,6 +451,8 @@ class GestureServerClient:
                 self.take_picture_callback(json_data['takeAPicture'])
             if 'reportAlive' in json_data and self.report_alive_callback:
                 self.report_alive_callback(json_data['reportAlive'])
+            if 'suspiciousInput' in json_data and self.suspicious_input_callback:
+                self.suspicious_input_callback(json_data['suspiciousInput'])
         except json.JSONDecodeError as e:
             print(f"Failed to decode JSON string: {string_data}")
 
@@ -0,0 +1,18 @@
+import json
+
+# Matches SnapshotStore::Snapshot::header in src/livenessDetector/snapshot_store.cc.
+TYPE = 'snapshot'
+
+
+def decode(header, payload):
+    """
+    Decode a snapshot message (sessions started with snapshots enabled).
+    Returns (header dict, encoded image bytes). header['gesture'] is the
+    take_picture_at_the_end gesture that triggered it, header['format'] is
+    "jpeg" or "webp" and header['region'] the [x, y, w, h] part of the
+    header['frame'] sized frame that was encoded. Use
+    cv2.imdecode(np.frombuffer(data, np.uint8), cv2.IMREAD_COLOR) for pixels.
+    """
+    if isinstance(header, (bytes, bytearray, str)):
+        header = json.loads(header)
+    return header, bytes(payload)
@@ -29,6 +29,7 @@ setup(
                 "server/livenessDetectorServer",
                 "server/livenessDetectorServer.exe",
                 "server/lib/*",
+                "liveness_detector_native*.so",
             ]
         },
     include_package_data=True,